@@ -51,6 +51,8 @@ sample_format_to_string(SampleFormat format)
 		return "8";
 
 	case SampleFormat::S16:
+	case SampleFormat::DSD_U16_LE:
+	case SampleFormat::DSD_U16_BE:
 		return "16";
 
 	case SampleFormat::S24_P32:
@@ -63,6 +63,18 @@ enum class SampleFormat : uint8_t {
 	  */
 	DSD_U8,
 
+	/**
+	 * DSD native output, 1 bit samples. Each frame carries 2 DSD
+	 * 1 byte samples, Little Endian
+	 */
+	DSD_U16_LE,
+
+	/**
+	 * DSD native output, 1 bit samples. Each frame carries 2 DSD
+	 * 1 byte samples, Big Endian
+	 */
+	DSD_U16_BE,
+
 	/**
 	 * DSD native output, 1 bit samples. Each frame carries 4 DSD
 	 * 1 byte samples, Big Endian
@@ -217,6 +229,8 @@ audio_valid_sample_format(SampleFormat format)
 	case SampleFormat::FLOAT:
 	case SampleFormat::DSD:
 	case SampleFormat::DSD_U8:
+	case SampleFormat::DSD_U16_LE:
+	case SampleFormat::DSD_U16_BE:
 	case SampleFormat::DSD_U32_BE:
 	case SampleFormat::DSD_U32_LE:
 		return true;
@@ -272,6 +286,8 @@ sample_format_size(SampleFormat format)
 		return 1;
 
 	case SampleFormat::S16:
+	case SampleFormat::DSD_U16_LE:
+	case SampleFormat::DSD_U16_BE:
 		return 2;
 
 	case SampleFormat::S24_P32:
@@ -24,6 +24,7 @@
 #include "ClientMessage.hxx"
 #include "command/CommandListBuilder.hxx"
 #include "event/FullyBufferedSocket.hxx"
+#include "command/CommandResult.hxx"
 #include "event/TimeoutMonitor.hxx"
 #include "Compiler.h"
 
@@ -36,6 +37,8 @@
 
 struct sockaddr;
 class EventLoop;
+class ClientCursor;
+struct ClientJob;
 struct Partition;
 
 class Client final : private FullyBufferedSocket, TimeoutMonitor {
@@ -79,6 +82,22 @@ public:
 	 */
 	std::list<ClientMessage> messages;
 
+private:
+	/**
+	 * If not nullptr, then the response to the current command
+	 * is being generated by this object.  Input is paused
+	 * meanwhile.
+	 */
+	ClientCursor *cursor;
+
+	/**
+	 * If not nullptr, then the current command is being executed
+	 * by a worker thread, and its response is collected in this
+	 * object.  Input is paused meanwhile.
+	 */
+	ClientJob *job;
+
+public:
 	Client(EventLoop &loop, Partition &partition,
 	       int fd, int uid, int num);
 
@@ -94,7 +113,71 @@ public:
 	void Close();
 	void SetExpired();
 
-	using FullyBufferedSocket::Write;
+	/*
+	 * These wrap the #FullyBufferedSocket methods.  While a #job
+	 * is running, the response goes to its buffer instead of the
+	 * socket.
+	 */
+
+	bool Write(const void *data, size_t length) {
+		if (gcc_unlikely(job != nullptr)) {
+			WriteToJob(data, length);
+			return true;
+		}
+
+		return FullyBufferedSocket::Write(data, length);
+	}
+
+	void *PrepareWrite(size_t *max_length_r) {
+		if (gcc_unlikely(job != nullptr))
+			return PrepareJobWrite(max_length_r);
+
+		return FullyBufferedSocket::PrepareWrite(max_length_r);
+	}
+
+	bool CommitWrite(size_t length) {
+		if (gcc_unlikely(job != nullptr)) {
+			CommitJobWrite(length);
+			return true;
+		}
+
+		return FullyBufferedSocket::CommitWrite(length);
+	}
+
+	/**
+	 * Is a command list being executed?  Commands inside a list
+	 * must complete synchronously.
+	 */
+	bool IsInCommandList() const {
+		return cmd_list.IsActive();
+	}
+
+	/**
+	 * Generate the response of the current command with the
+	 * given #ClientCursor, which becomes owned by this object.
+	 * Must not be called inside a command list.
+	 *
+	 * @return CommandResult::OK if the response is already
+	 * complete, CommandResult::DEFERRED otherwise
+	 */
+	CommandResult StartCursor(ClientCursor *cursor);
+
+	/**
+	 * Execute the given command line in a worker thread, if the
+	 * command allows that (see command_is_thread_safe()).  Must
+	 * not be called inside a command list.
+	 *
+	 * @return true if the command has been submitted; the
+	 * response will be sent by OnJobFinished()
+	 */
+	bool SubmitJob(const char *line);
+
+	/**
+	 * Called in the main thread after the worker thread has
+	 * finished the #job.  Sends the response and resumes
+	 * processing input.  This may delete the object.
+	 */
+	void OnJobFinished();
 
 	/**
 	 * returns the uid of the client process, or a negative value
@@ -157,8 +240,22 @@ private:
 	virtual void OnSocketError(Error &&error) override;
 	virtual void OnSocketClosed() override;
 
+	/* virtual methods from class FullyBufferedSocket */
+	virtual bool OnSocketDrained() override;
+
 	/* virtual methods from class TimeoutMonitor */
 	virtual void OnTimeout() override;
+
+	/**
+	 * Let the #cursor generate more of the response.
+	 *
+	 * @return true if it is not finished yet
+	 */
+	bool StepCursor();
+
+	void WriteToJob(const void *data, size_t length);
+	void *PrepareJobWrite(size_t *max_length_r);
+	void CommitJobWrite(size_t length);
 };
 
 void client_manager_init(void);
@@ -167,11 +264,30 @@ void
 client_new(EventLoop &loop, Partition &partition,
 	   int fd, const struct sockaddr *sa, size_t sa_length, int uid);
 
+/**
+ * Write a block of data to the client.
+ */
+void client_write(Client &client, const char *data, size_t length);
+
 /**
  * Write a C string to the client.
  */
 void client_puts(Client &client, const char *s);
 
+/**
+ * Write a "name: value" line to the client.  This is faster than
+ * client_printf().
+ */
+void
+client_write_pair(Client &client, const char *name, const char *value);
+
+/**
+ * Write a "name: value" line with an unsigned integer value to the
+ * client.  This is faster than client_printf().
+ */
+void
+client_write_uint(Client &client, const char *name, unsigned long value);
+
 /**
  * Write a printf-like formatted string to the client.
  */
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+#include "ClientCursor.hxx"
+#include "ClientInternal.hxx"
+#include "protocol/Result.hxx"
+
+/**
+ * Stop generating the response when this much data is waiting in the
+ * output buffer; continue when it has been sent.
+ */
+static constexpr size_t CURSOR_BUFFER_SIZE = 16384;
+
+/**
+ * The maximum number of ClientCursor::Next() calls in one go, to
+ * avoid blocking other clients if this client reads very quickly.
+ */
+static constexpr unsigned CURSOR_MAX_STEPS = 16;
+
+CommandResult
+Client::StartCursor(ClientCursor *_cursor)
+{
+	assert(cursor == nullptr);
+	assert(!cmd_list.IsActive());
+
+	cursor = _cursor;
+	if (StepCursor())
+		return CommandResult::DEFERRED;
+
+	return CommandResult::OK;
+}
+
+bool
+Client::StepCursor()
+{
+	assert(cursor != nullptr);
+
+	/* a large response may take longer than the client
+	   timeout */
+	TimeoutMonitor::ScheduleSeconds(client_timeout);
+
+	for (unsigned i = 0; i < CURSOR_MAX_STEPS; ++i) {
+		if (!cursor->Next(*this)) {
+			delete cursor;
+			cursor = nullptr;
+			return false;
+		}
+
+		if (IsExpired() || GetOutputSize() >= CURSOR_BUFFER_SIZE)
+			return true;
+	}
+
+	if (GetOutputSize() == 0)
+		/* everything has been sent already; continue in the
+		   next main loop iteration */
+		ScheduleFlush();
+
+	return true;
+}
+
+bool
+Client::OnSocketDrained()
+{
+	if (cursor == nullptr)
+		return true;
+
+	if (StepCursor())
+		return !IsExpired();
+
+	/* the response is complete: finish the command and process
+	   the input which has arrived meanwhile */
+	command_success(*this);
+	if (IsExpired())
+		return false;
+
+	return ResumeInput();
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_CLIENT_CURSOR_HXX
+#define MPD_CLIENT_CURSOR_HXX
+
+#include "check.h"
+
+class Client;
+
+/**
+ * Generates a large response in small portions, so the whole
+ * response never needs to be buffered, and other clients can be
+ * served meanwhile.  Between two calls, the object must not keep
+ * pointers into data structures which may be modified by others
+ * (e.g. the database).
+ *
+ * @see Client::StartCursor()
+ */
+class ClientCursor {
+public:
+	virtual ~ClientCursor() {}
+
+	/**
+	 * Write the next portion of the response to the client.
+	 *
+	 * @return true if there is more, false if the response is
+	 * complete
+	 */
+	virtual bool Next(Client &client) = 0;
+};
+
+#endif
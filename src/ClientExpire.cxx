@@ -19,6 +19,7 @@
 
 #include "config.h"
 #include "ClientInternal.hxx"
+#include "ClientWorker.hxx"
 #include "Log.hxx"
 
 void
@@ -27,6 +28,15 @@ Client::SetExpired()
 	if (IsExpired())
 		return;
 
+	if (job != nullptr) {
+		/* a worker thread may be checking IsExpired(); close
+		   the socket in OnJobFinished() */
+		job->closed = true;
+		SocketMonitor::Cancel();
+		TimeoutMonitor::Cancel();
+		return;
+	}
+
 	FullyBufferedSocket::Close();
 	TimeoutMonitor::Schedule(0);
 }
@@ -19,6 +19,7 @@
 
 #include "config.h"
 #include "ClientInternal.hxx"
+#include "ClientCursor.hxx"
 #include "ClientList.hxx"
 #include "Partition.hxx"
 #include "Instance.hxx"
@@ -55,7 +56,8 @@ Client::Client(EventLoop &_loop, Partition &_partition,
 	 uid(_uid),
 	 num(_num),
 	 idle_waiting(false), idle_flags(0),
-	 num_subscriptions(0)
+	 num_subscriptions(0),
+	 cursor(nullptr), job(nullptr)
 {
 	TimeoutMonitor::ScheduleSeconds(client_timeout);
 }
@@ -117,10 +119,19 @@ client_new(EventLoop &loop, Partition &partition,
 void
 Client::Close()
 {
+	if (job != nullptr) {
+		/* a worker thread is still using this object;
+		   OnJobFinished() will close it */
+		SetExpired();
+		return;
+	}
+
 	partition.instance.client_list->Remove(*this);
 
 	SetExpired();
 
+	delete cursor;
+
 	FormatInfo(client_domain, "[%u] closed", num);
 	delete this;
 }
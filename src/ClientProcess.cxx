@@ -119,6 +119,11 @@ client_process_line(Client &client, char *line)
 		} else if (strcmp(line, CLIENT_LIST_OK_MODE_BEGIN) == 0) {
 			client.cmd_list.Begin(true);
 			ret = CommandResult::OK;
+		} else if (client.SubmitJob(line)) {
+			FormatDebug(client_domain,
+				    "[%u] submitted command \"%s\" to worker",
+				    client.num, line);
+			ret = CommandResult::DEFERRED;
 		} else {
 			FormatDebug(client_domain,
 				    "[%u] process command \"%s\"",
@@ -29,6 +29,11 @@
 BufferedSocket::InputResult
 Client::OnSocketInput(void *data, size_t length)
 {
+	if (cursor != nullptr || job != nullptr)
+		/* the previous command is still generating its
+		   response */
+		return InputResult::PAUSE;
+
 	char *p = (char *)data;
 	char *newline = (char *)memchr(p, '\n', length);
 	if (newline == nullptr)
@@ -52,6 +57,14 @@ Client::OnSocketInput(void *data, size_t length)
 	case CommandResult::ERROR:
 		break;
 
+	case CommandResult::DEFERRED:
+		if (IsExpired()) {
+			Close();
+			return InputResult::CLOSED;
+		}
+
+		return InputResult::PAUSE;
+
 	case CommandResult::KILL:
 		Close();
 		main_loop->Break();
@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+#include "ClientWorker.hxx"
+#include "ClientInternal.hxx"
+#include "ClientCursor.hxx"
+#include "command/AllCommands.hxx"
+#include "protocol/Result.hxx"
+#include "DatabaseSimple.hxx"
+#include "ConfigGlobal.hxx"
+#include "ConfigOption.hxx"
+#include "event/DeferredMonitor.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+#include "util/fifo_buffer.h"
+#include "util/growing_fifo.h"
+#include "util/Error.hxx"
+#include "Log.hxx"
+
+#include <list>
+
+#include <assert.h>
+
+/*
+ * The worker thread calls command_process() with the #Client.  While
+ * the job runs, the main thread does not touch the #Client: input
+ * is paused, the response is collected in ClientJob::output, and
+ * closing the client is postponed until the job has finished.
+ */
+
+static constexpr unsigned DEFAULT_COMMAND_THREADS = 2;
+
+/**
+ * The number of bytes sent by one ClientJobCursor::Next() call.
+ */
+static constexpr size_t JOB_CURSOR_CHUNK = 16384;
+
+class ClientWorkerMonitor final : public DeferredMonitor {
+public:
+	ClientWorkerMonitor(EventLoop &_loop)
+		:DeferredMonitor(_loop) {}
+
+protected:
+	virtual void RunDeferred() override;
+};
+
+static unsigned n_started;
+static Thread *threads;
+
+static ClientWorkerMonitor *worker_monitor;
+
+static Mutex worker_mutex;
+
+/**
+ * Wakes up the worker threads: a new job or #worker_quit.
+ */
+static Cond worker_cond;
+
+static std::list<ClientJob *> pending, finished;
+
+static bool worker_quit;
+
+ClientJob::ClientJob(Client &_client, const char *_line)
+	:client(_client), line(_line),
+	 result(CommandResult::ERROR), output(growing_fifo_new()),
+	 closed(false) {}
+
+ClientJob::~ClientJob()
+{
+	if (output != nullptr)
+		/* not taken by a ClientJobCursor */
+		fifo_buffer_free(output);
+}
+
+/**
+ * Sends the response of a #ClientJob in chunks, as the socket
+ * drains; it may be larger than the client's output buffer.
+ */
+class ClientJobCursor final : public ClientCursor {
+	struct fifo_buffer *buffer;
+
+public:
+	explicit ClientJobCursor(ClientJob &job)
+		:buffer(job.output) {
+		job.output = nullptr;
+	}
+
+	~ClientJobCursor() {
+		fifo_buffer_free(buffer);
+	}
+
+	virtual bool Next(Client &client) override {
+		size_t length;
+		const void *data = fifo_buffer_read(buffer, &length);
+		if (data == nullptr)
+			return false;
+
+		if (length > JOB_CURSOR_CHUNK)
+			length = JOB_CURSOR_CHUNK;
+
+		client_write(client, (const char *)data, length);
+		fifo_buffer_consume(buffer, length);
+		return !fifo_buffer_is_empty(buffer);
+	}
+};
+
+static void
+worker_thread_func(gcc_unused void *ctx)
+{
+	const ScopeLock protect(worker_mutex);
+
+	while (true) {
+		if (pending.empty()) {
+			if (worker_quit)
+				break;
+
+			worker_cond.wait(worker_mutex);
+			continue;
+		}
+
+		ClientJob &job = *pending.front();
+		pending.pop_front();
+
+		worker_mutex.unlock();
+
+		job.result = command_process(job.client, 0, &job.line[0]);
+
+		worker_mutex.lock();
+
+		finished.push_back(&job);
+		worker_monitor->Schedule();
+	}
+}
+
+/**
+ * Deliver the results of all finished jobs.  Runs in the main
+ * thread.
+ */
+static void
+worker_flush()
+{
+	std::list<ClientJob *> batch;
+
+	worker_mutex.lock();
+	batch.swap(finished);
+	worker_mutex.unlock();
+
+	for (ClientJob *job : batch)
+		job->client.OnJobFinished();
+}
+
+void
+ClientWorkerMonitor::RunDeferred()
+{
+	worker_flush();
+}
+
+void
+client_worker_init(EventLoop &loop)
+{
+	const unsigned n_threads =
+		config_get_unsigned(CONF_COMMAND_THREADS,
+				    DEFAULT_COMMAND_THREADS);
+	if (n_threads == 0)
+		return;
+
+	worker_monitor = new ClientWorkerMonitor(loop);
+	worker_quit = false;
+
+	threads = new Thread[n_threads];
+	for (unsigned i = 0; i < n_threads; ++i) {
+		Error error;
+		if (!threads[i].Start(worker_thread_func, nullptr, "worker",
+				      error)) {
+			LogError(error);
+			break;
+		}
+
+		++n_started;
+	}
+}
+
+void
+client_worker_finish()
+{
+	if (worker_monitor == nullptr)
+		return;
+
+	worker_mutex.lock();
+
+	for (ClientJob *job : pending)
+		job->result = CommandResult::CLOSE;
+	finished.splice(finished.end(), pending);
+
+	worker_quit = true;
+	worker_cond.broadcast();
+	worker_mutex.unlock();
+
+	for (unsigned i = 0; i < n_started; ++i)
+		threads[i].Join();
+
+	delete[] threads;
+	threads = nullptr;
+	n_started = 0;
+
+	worker_flush();
+
+	delete worker_monitor;
+	worker_monitor = nullptr;
+}
+
+bool
+Client::SubmitJob(const char *line)
+{
+	assert(job == nullptr);
+	assert(cursor == nullptr);
+	assert(!cmd_list.IsActive());
+
+	/* the proxy database plugin is not thread-safe */
+	if (n_started == 0 || !db_is_simple() ||
+	    !command_is_thread_safe(line))
+		return false;
+
+	job = new ClientJob(*this, line);
+
+	const ScopeLock protect(worker_mutex);
+	pending.push_back(job);
+	worker_cond.signal();
+	return true;
+}
+
+void
+Client::OnJobFinished()
+{
+	assert(job != nullptr);
+
+	ClientJob *const j = job;
+	job = nullptr;
+
+	if (j->closed || j->result == CommandResult::CLOSE) {
+		delete j;
+		Close();
+		return;
+	}
+
+	TimeoutMonitor::ScheduleSeconds(client_timeout);
+
+	if (j->result != CommandResult::OK) {
+		/* an error response is small; send it right away */
+		size_t length;
+		const void *data = fifo_buffer_read(j->output, &length);
+		if (data != nullptr)
+			client_write(*this, (const char *)data, length);
+
+		delete j;
+	} else {
+		const CommandResult result =
+			StartCursor(new ClientJobCursor(*j));
+		delete j;
+
+		if (result == CommandResult::DEFERRED)
+			/* OnSocketDrained() will finish the command */
+			return;
+
+		command_success(*this);
+	}
+
+	if (IsExpired()) {
+		Close();
+		return;
+	}
+
+	ResumeInput();
+}
+
+void
+Client::WriteToJob(const void *data, size_t length)
+{
+	growing_fifo_append(&job->output, data, length);
+}
+
+void *
+Client::PrepareJobWrite(size_t *max_length_r)
+{
+	/* reserve room for a typical line; longer lines go through
+	   WriteToJob() */
+	growing_fifo_write(&job->output, 1024);
+	return fifo_buffer_write(job->output, max_length_r);
+}
+
+void
+Client::CommitJobWrite(size_t length)
+{
+	fifo_buffer_append(job->output, length);
+}
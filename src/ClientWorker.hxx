@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/** \file
+ *
+ * A pool of threads which execute slow read-only commands (see
+ * command_is_thread_safe()), so they do not block the main thread
+ * and the other clients.
+ */
+
+#ifndef MPD_CLIENT_WORKER_HXX
+#define MPD_CLIENT_WORKER_HXX
+
+#include "check.h"
+#include "command/CommandResult.hxx"
+
+#include <string>
+
+class EventLoop;
+class Client;
+struct fifo_buffer;
+
+/**
+ * A command being executed by a worker thread on behalf of a
+ * #Client.
+ */
+struct ClientJob {
+	Client &client;
+
+	/**
+	 * The command line.  command_process() modifies it.
+	 */
+	std::string line;
+
+	CommandResult result;
+
+	/**
+	 * The response; filled by the worker thread via
+	 * Client::Write().
+	 */
+	struct fifo_buffer *output;
+
+	/**
+	 * Has the client expired while the job was running?  The
+	 * socket is closed only after the job has finished, because
+	 * the worker thread may still be checking it.  Only accessed
+	 * by the main thread.
+	 */
+	bool closed;
+
+	ClientJob(Client &_client, const char *_line);
+
+	~ClientJob();
+
+	ClientJob(const ClientJob &) = delete;
+	ClientJob &operator=(const ClientJob &) = delete;
+};
+
+/**
+ * Start the worker threads.
+ */
+void
+client_worker_init(EventLoop &loop);
+
+/**
+ * Stop the worker threads.  Jobs which have not been started yet are
+ * discarded, and their clients are closed.  Must be called before
+ * the #ClientList is destroyed.
+ */
+void
+client_worker_finish();
+
+#endif
@@ -21,12 +21,10 @@
 #include "ClientInternal.hxx"
 #include "util/FormatString.hxx"
 
+#include <stdio.h>
 #include <string.h>
 
-/**
- * Write a block of data to the client.
- */
-static void
+void
 client_write(Client &client, const char *data, size_t length)
 {
 	/* if the client is going to be closed, do nothing */
@@ -42,12 +40,88 @@ client_puts(Client &client, const char *s)
 	client_write(client, s, strlen(s));
 }
 
+/**
+ * Write several strings as one line, copying them straight into the
+ * output buffer if it has enough room.
+ */
+static void
+client_write_line(Client &client, const char *const*parts,
+		  const size_t *lengths, unsigned n)
+{
+	if (client.IsExpired())
+		return;
+
+	size_t total = 1;
+	for (unsigned i = 0; i < n; ++i)
+		total += lengths[i];
+
+	size_t max_length;
+	char *p = (char *)client.PrepareWrite(&max_length);
+	if (p != nullptr && max_length >= total) {
+		for (unsigned i = 0; i < n; ++i) {
+			memcpy(p, parts[i], lengths[i]);
+			p += lengths[i];
+		}
+
+		*p = '\n';
+		client.CommitWrite(total);
+		return;
+	}
+
+	for (unsigned i = 0; i < n; ++i)
+		client_write(client, parts[i], lengths[i]);
+	client_write(client, "\n", 1);
+}
+
+void
+client_write_pair(Client &client, const char *name, const char *value)
+{
+	const char *const parts[] = { name, ": ", value };
+	const size_t lengths[] = { strlen(name), 2, strlen(value) };
+	client_write_line(client, parts, lengths, 3);
+}
+
+void
+client_write_uint(Client &client, const char *name, unsigned long value)
+{
+	char buffer[24], *end = buffer + sizeof(buffer), *p = end;
+	do {
+		*--p = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+
+	const char *const parts[] = { name, ": ", p };
+	const size_t lengths[] = { strlen(name), 2, size_t(end - p) };
+	client_write_line(client, parts, lengths, 3);
+}
+
 void
 client_vprintf(Client &client, const char *fmt, va_list args)
 {
-	char *p = FormatNewV(fmt, args);
-	client_write(client, p, strlen(p));
-	delete[] p;
+	if (client.IsExpired())
+		return;
+
+	/* format directly into the output buffer */
+	size_t max_length;
+	char *p = (char *)client.PrepareWrite(&max_length);
+	if (p != nullptr) {
+		va_list copy;
+		va_copy(copy, args);
+		const int length = vsnprintf(p, max_length, fmt, copy);
+		va_end(copy);
+
+		if (length >= 0 && size_t(length) < max_length) {
+			client.CommitWrite(length);
+			return;
+		}
+	}
+
+	/* not enough room in the buffer; this happens only when the
+	   line is huge or the buffer is switching to its peak
+	   area */
+	char *s = FormatNewV(fmt, args);
+	client_write(client, s, strlen(s));
+	delete[] s;
 }
 
 void
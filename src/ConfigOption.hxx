@@ -52,7 +52,12 @@ enum ConfigOption {
 	CONF_VOLUME_NORMALIZATION,
 	CONF_SAMPLERATE_CONVERTER,
 	CONF_AUDIO_BUFFER_SIZE,
+	CONF_AUDIO_BUFFER_TIME,
+	CONF_AUDIO_BUFFER_TIME_STREAM,
 	CONF_BUFFER_BEFORE_PLAY,
+	CONF_AUDIO_CHUNK_SIZE,
+	CONF_AUDIO_BUFFER_POLICY,
+	CONF_LOOKAHEAD_BUFFER_SIZE,
 	CONF_HTTP_PROXY_HOST,
 	CONF_HTTP_PROXY_PORT,
 	CONF_HTTP_PROXY_USER,
@@ -62,6 +67,7 @@ enum ConfigOption {
 	CONF_MAX_PLAYLIST_LENGTH,
 	CONF_MAX_COMMAND_LIST_SIZE,
 	CONF_MAX_OUTPUT_BUFFER_SIZE,
+	CONF_COMMAND_THREADS,
 	CONF_FS_CHARSET,
 	CONF_ID3V1_ENCODING,
 	CONF_METADATA_TO_USE,
@@ -72,11 +78,16 @@ enum ConfigOption {
 	CONF_PLAYLIST_PLUGIN,
 	CONF_AUTO_UPDATE,
 	CONF_AUTO_UPDATE_DEPTH,
+	CONF_UPDATE_THREADS,
 	CONF_DESPOTIFY_USER,
 	CONF_DESPOTIFY_PASSWORD,
 	CONF_DESPOTIFY_HIGH_BITRATE,
 	CONF_AUDIO_FILTER,
 	CONF_DATABASE,
+	CONF_DSD_DECIMATOR,
+	CONF_DSD_NOISE_SHAPING,
+	CONF_THREAD,
+	CONF_MEMORY_LOCK,
 	CONF_MAX
 };
 
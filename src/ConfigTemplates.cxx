@@ -52,7 +52,12 @@ const ConfigTemplate config_templates[] = {
 	{ "volume_normalization", false, false },
 	{ "samplerate_converter", false, false },
 	{ "audio_buffer_size", false, false },
+	{ "audio_buffer_time", false, false },
+	{ "audio_buffer_time_stream", false, false },
 	{ "buffer_before_play", false, false },
+	{ "audio_chunk_size", false, false },
+	{ "audio_buffer_policy", false, false },
+	{ "lookahead_buffer_size", false, false },
 	{ "http_proxy_host", false, false },
 	{ "http_proxy_port", false, false },
 	{ "http_proxy_user", false, false },
@@ -62,6 +67,7 @@ const ConfigTemplate config_templates[] = {
 	{ "max_playlist_length", false, false },
 	{ "max_command_list_size", false, false },
 	{ "max_output_buffer_size", false, false },
+	{ "command_threads", false, false },
 	{ "filesystem_charset", false, false },
 	{ "id3v1_encoding", false, false },
 	{ "metadata_to_use", false, false },
@@ -72,11 +78,16 @@ const ConfigTemplate config_templates[] = {
 	{ "playlist_plugin", true, true },
 	{ "auto_update", false, false },
 	{ "auto_update_depth", false, false },
+	{ "update_threads", false, false },
 	{ "despotify_user", false, false },
 	{ "despotify_password", false, false},
 	{ "despotify_high_bitrate", false, false },
 	{ "filter", true, true },
 	{ "database", false, true },
+	{ "dsd_decimator", false, false },
+	{ "dsd_noise_shaping", false, false },
+	{ "thread", true, true },
+	{ "memory_lock", false, false },
 };
 
 static constexpr unsigned n_config_templates =
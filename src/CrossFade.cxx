@@ -92,6 +92,7 @@ CrossFadeSettings::Calculate(float total_time,
 			     const char *mixramp_start, const char *mixramp_prev_end,
 			     const AudioFormat af,
 			     const AudioFormat old_format,
+			     size_t chunk_size,
 			     unsigned max_chunks) const
 {
 	unsigned int chunks = 0;
@@ -105,7 +106,8 @@ CrossFadeSettings::Calculate(float total_time,
 	assert(duration >= 0);
 	assert(af.IsValid());
 
-	chunks_f = (float)af.GetTimeToSize() / (float)CHUNK_SIZE;
+	chunks_f = (float)af.GetTimeToSize() /
+		(float)music_chunk::CalcFillSize(af, chunk_size);
 
 	if (mixramp_delay <= 0 || !mixramp_start || !mixramp_prev_end) {
 		chunks = (chunks_f * duration + 0.5);
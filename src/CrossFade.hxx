@@ -22,6 +22,8 @@
 
 #include "Compiler.h"
 
+#include <stddef.h>
+
 struct AudioFormat;
 
 struct CrossFadeSettings {
@@ -55,6 +57,7 @@ struct CrossFadeSettings {
 	 * @param mixramp_prev_end the last songs mixramp_end setting
 	 * @param af the audio format of the new song
 	 * @param old_format the audio format of the current song
+	 * @param chunk_size the capacity of each #music_chunk
 	 * @param max_chunks the maximum number of chunks
 	 * @return the number of chunks for crossfading, or 0 if cross fading
 	 * should be disabled for this song change
@@ -65,6 +68,7 @@ struct CrossFadeSettings {
 			   const char *mixramp_start,
 			   const char *mixramp_prev_end,
 			   AudioFormat af, AudioFormat old_format,
+			   size_t chunk_size,
 			   unsigned max_chunks) const;
 };
 
@@ -0,0 +1,704 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "DatabaseBinary.hxx"
+#include "DatabaseLock.hxx"
+#include "DatabaseError.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+#include "tag/Tag.hxx"
+#include "tag/TagPool.hxx"
+#include "tag/TagSettings.h"
+#include "fs/Path.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/Charset.hxx"
+#include "util/Error.hxx"
+#include "Log.hxx"
+
+#include <glib.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static constexpr char DB_BINARY_MAGIC[8] = {
+	'M', 'P', 'D', 'D', 'B', 'b', 'i', 'n',
+};
+
+/**
+ * Version 2 added the file fingerprints and the directory scan
+ * time.
+ */
+static constexpr uint32_t DB_BINARY_VERSION = 2;
+
+/**
+ * Written in host byte order; a file from a machine with a different
+ * byte order will not match.
+ */
+static constexpr uint32_t DB_BINARY_BYTE_ORDER = 0x01020304;
+
+/**
+ * The "parent" of the root directory record.
+ */
+static constexpr uint32_t DB_BINARY_NONE = 0xffffffff;
+
+static_assert(TAG_NUM_OF_ITEM_TYPES <= 32, "tag_mask is too small");
+
+struct BinaryHeader {
+	char magic[sizeof(DB_BINARY_MAGIC)];
+	uint32_t version;
+	uint32_t byte_order;
+
+	/**
+	 * Bit mask of the tag types which were enabled when the file
+	 * was written (see #ignore_tag_items).
+	 */
+	uint32_t tag_mask;
+
+	/**
+	 * String index of the file system charset.
+	 */
+	uint32_t charset;
+
+	uint32_t n_strings, n_directories, n_songs, n_items, n_playlists;
+	uint32_t reserved;
+
+	uint64_t string_data_size;
+
+	/**
+	 * File offsets of the sections.
+	 */
+	uint64_t strings, string_data;
+	uint64_t directories, songs, items, playlists;
+};
+
+/**
+ * Directories are stored in pre-order, so the parent of a directory
+ * always has a lower index.  The songs and playlists of a directory
+ * are contiguous.
+ */
+struct BinaryDirectory {
+	uint32_t name;
+	uint32_t parent;
+	uint32_t first_song, n_songs;
+	uint32_t first_playlist, n_playlists;
+	int64_t mtime;
+	int64_t scan_time;
+};
+
+enum {
+	BINARY_SONG_TAG = 0x1,
+	BINARY_SONG_PLAYLIST = 0x2,
+};
+
+struct BinarySong {
+	uint32_t uri;
+	uint32_t start_ms, end_ms;
+	int32_t time;
+	uint32_t first_item, n_items;
+	uint32_t flags;
+	uint32_t mtime_ns;
+	int64_t mtime;
+	uint64_t size, inode, hash;
+};
+
+struct BinaryItem {
+	uint32_t type;
+	uint32_t value;
+};
+
+struct BinaryPlaylist {
+	uint32_t name;
+	uint32_t reserved;
+	int64_t mtime;
+};
+
+static_assert(sizeof(BinaryHeader) % 8 == 0, "Bad BinaryHeader size");
+static_assert(sizeof(BinaryDirectory) == 40, "Bad BinaryDirectory size");
+static_assert(sizeof(BinarySong) == 64, "Bad BinarySong size");
+static_assert(sizeof(BinaryItem) == 8, "Bad BinaryItem size");
+static_assert(sizeof(BinaryPlaylist) == 16, "Bad BinaryPlaylist size");
+
+static constexpr uint64_t
+AlignSection(uint64_t offset)
+{
+	return (offset + 7) & ~uint64_t(7);
+}
+
+gcc_pure
+static uint32_t
+CurrentTagMask()
+{
+	uint32_t mask = 0;
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		if (!ignore_tag_items[i])
+			mask |= 1u << i;
+	return mask;
+}
+
+/**
+ * Collects the records of a whole tree in memory, to be written in
+ * one go.
+ */
+class BinaryDatabaseBuilder {
+	std::map<std::string, uint32_t> string_map;
+	std::vector<uint32_t> string_offsets;
+	std::string string_data;
+
+	std::vector<BinaryDirectory> directories;
+	std::vector<BinarySong> songs;
+	std::vector<BinaryItem> items;
+	std::vector<BinaryPlaylist> playlists;
+
+public:
+	uint32_t Intern(const char *s);
+
+	void AddDirectory(const Directory &directory, uint32_t parent);
+
+	void Write(FILE *fp);
+
+private:
+	void AddSong(const Song &song);
+};
+
+uint32_t
+BinaryDatabaseBuilder::Intern(const char *s)
+{
+	auto r = string_map.insert(std::make_pair(std::string(s),
+						  uint32_t(string_offsets.size())));
+	if (r.second) {
+		string_offsets.push_back(string_data.size());
+		string_data.append(s);
+		string_data.push_back(0);
+	}
+
+	return r.first->second;
+}
+
+inline void
+BinaryDatabaseBuilder::AddSong(const Song &song)
+{
+	BinarySong s;
+	memset(&s, 0, sizeof(s));
+	s.uri = Intern(song.uri);
+	s.start_ms = song.start_ms;
+	s.end_ms = song.end_ms;
+	s.mtime = song.mtime;
+	s.mtime_ns = song.mtime_ns;
+	s.size = song.size;
+	s.inode = song.inode;
+	s.hash = song.hash;
+	s.first_item = items.size();
+
+	const Tag *tag = song.tag;
+	if (tag != nullptr) {
+		s.flags |= BINARY_SONG_TAG;
+		if (tag->has_playlist)
+			s.flags |= BINARY_SONG_PLAYLIST;
+		s.time = tag->time;
+		s.n_items = tag->num_items;
+
+		for (unsigned i = 0; i < tag->num_items; ++i) {
+			const TagItem &item = *tag->items[i];
+			items.push_back({uint32_t(item.type),
+					 Intern(item.value)});
+		}
+	}
+
+	songs.push_back(s);
+}
+
+void
+BinaryDatabaseBuilder::AddDirectory(const Directory &directory,
+				    uint32_t parent)
+{
+	const uint32_t index = directories.size();
+
+	BinaryDirectory d;
+	memset(&d, 0, sizeof(d));
+	d.name = Intern(directory.IsRoot() ? "" : directory.GetName());
+	d.parent = parent;
+	d.mtime = directory.mtime;
+	d.scan_time = directory.scan_time;
+	d.first_song = songs.size();
+	d.first_playlist = playlists.size();
+
+	Song *song;
+	directory_for_each_song(song, directory)
+		AddSong(*song);
+
+	for (const auto &pi : directory.playlists)
+		playlists.push_back({Intern(pi.name.c_str()), 0,
+				     int64_t(pi.mtime)});
+
+	d.n_songs = songs.size() - d.first_song;
+	d.n_playlists = playlists.size() - d.first_playlist;
+	directories.push_back(d);
+
+	Directory *child;
+	directory_for_each_child(child, directory)
+		AddDirectory(*child, index);
+}
+
+template<typename T>
+static void
+WriteSection(FILE *fp, uint64_t &position, uint64_t offset,
+	     const T *data, size_t size)
+{
+	static constexpr char padding[8] = {};
+	assert(offset >= position && offset - position < sizeof(padding));
+
+	fwrite(padding, 1, offset - position, fp);
+	fwrite(data, 1, size, fp);
+	position = offset + size;
+}
+
+void
+BinaryDatabaseBuilder::Write(FILE *fp)
+{
+	BinaryHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, DB_BINARY_MAGIC, sizeof(header.magic));
+	header.version = DB_BINARY_VERSION;
+	header.byte_order = DB_BINARY_BYTE_ORDER;
+	header.tag_mask = CurrentTagMask();
+	header.charset = Intern(GetFSCharset());
+
+	header.n_strings = string_offsets.size();
+	header.n_directories = directories.size();
+	header.n_songs = songs.size();
+	header.n_items = items.size();
+	header.n_playlists = playlists.size();
+	header.string_data_size = string_data.size();
+
+	const size_t strings_size = string_offsets.size() * sizeof(uint32_t);
+	const size_t directories_size =
+		directories.size() * sizeof(BinaryDirectory);
+	const size_t songs_size = songs.size() * sizeof(BinarySong);
+	const size_t items_size = items.size() * sizeof(BinaryItem);
+	const size_t playlists_size =
+		playlists.size() * sizeof(BinaryPlaylist);
+
+	header.strings = sizeof(header);
+	header.string_data = AlignSection(header.strings + strings_size);
+	header.directories = AlignSection(header.string_data +
+					  string_data.size());
+	header.songs = AlignSection(header.directories + directories_size);
+	header.items = AlignSection(header.songs + songs_size);
+	header.playlists = AlignSection(header.items + items_size);
+
+	uint64_t position = 0;
+	WriteSection(fp, position, 0, &header, sizeof(header));
+	WriteSection(fp, position, header.strings,
+		     string_offsets.data(), strings_size);
+	WriteSection(fp, position, header.string_data,
+		     string_data.data(), string_data.size());
+	WriteSection(fp, position, header.directories,
+		     directories.data(), directories_size);
+	WriteSection(fp, position, header.songs,
+		     songs.data(), songs_size);
+	WriteSection(fp, position, header.items,
+		     items.data(), items_size);
+	WriteSection(fp, position, header.playlists,
+		     playlists.data(), playlists_size);
+}
+
+void
+db_save_binary(FILE *fp, const Directory &root)
+{
+	BinaryDatabaseBuilder builder;
+	builder.AddDirectory(root, DB_BINARY_NONE);
+	builder.Write(fp);
+}
+
+bool
+db_binary_probe(Path path)
+{
+	FILE *fp = FOpen(path, FOpenMode::ReadBinary);
+	if (fp == nullptr)
+		return false;
+
+	char magic[sizeof(DB_BINARY_MAGIC)];
+	const bool result = fread(magic, sizeof(magic), 1, fp) == 1 &&
+		memcmp(magic, DB_BINARY_MAGIC, sizeof(magic)) == 0;
+	fclose(fp);
+	return result;
+}
+
+/**
+ * A read-only mapping of a whole file.
+ */
+class DatabaseMapping {
+	void *data;
+	size_t size;
+
+public:
+	DatabaseMapping():data(MAP_FAILED), size(0) {}
+
+	~DatabaseMapping() {
+		if (data != MAP_FAILED)
+			munmap(data, size);
+	}
+
+	DatabaseMapping(const DatabaseMapping &) = delete;
+	DatabaseMapping &operator=(const DatabaseMapping &) = delete;
+
+	bool Open(Path path, Error &error);
+
+	const void *GetData() const {
+		return data;
+	}
+
+	size_t GetSize() const {
+		return size;
+	}
+
+	/**
+	 * Returns a pointer to an array of records, or nullptr if it
+	 * does not fit inside the file.
+	 */
+	template<typename T>
+	gcc_pure
+	const T *GetSection(uint64_t offset, uint64_t n) const {
+		if (offset % alignof(T) != 0 || offset > size ||
+		    n > (size - offset) / sizeof(T))
+			return nullptr;
+
+		return (const T *)((const char *)data + offset);
+	}
+};
+
+bool
+DatabaseMapping::Open(Path path, Error &error)
+{
+	int fd = OpenFile(path, O_RDONLY, 0);
+	if (fd < 0) {
+		error.FormatErrno("Failed to open database file \"%s\"",
+				  path.ToUTF8().c_str());
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		error.FormatErrno("Failed to stat database file \"%s\"",
+				  path.ToUTF8().c_str());
+		close(fd);
+		return false;
+	}
+
+	if (uint64_t(st.st_size) < sizeof(BinaryHeader)) {
+		error.Set(db_domain, "Database corrupted");
+		close(fd);
+		return false;
+	}
+
+	size = st.st_size;
+	data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		error.FormatErrno("Failed to map database file \"%s\"",
+				  path.ToUTF8().c_str());
+		return false;
+	}
+
+	/* the whole file is read front to back */
+	madvise(data, size, MADV_WILLNEED);
+	return true;
+}
+
+/**
+ * Builds the tree from a mapped binary database file.  All indices
+ * are checked against the section sizes before they are used.
+ */
+class BinaryDatabaseLoader {
+	const BinaryHeader &header;
+
+	const uint32_t *string_offsets;
+	const char *string_data;
+	const BinaryDirectory *directories;
+	const BinarySong *songs;
+	const BinaryItem *items;
+	const BinaryPlaylist *playlists;
+
+	/**
+	 * The #TagItem most recently created for each string, so
+	 * each distinct tag value is looked up in the #TagPool only
+	 * once.
+	 */
+	std::vector<TagItem *> item_cache;
+
+public:
+	explicit BinaryDatabaseLoader(const BinaryHeader &_header)
+		:header(_header) {}
+
+	bool Open(const DatabaseMapping &mapping, Error &error);
+
+	/**
+	 * Caller must lock the #db_mutex.
+	 */
+	bool Load(Directory &root, Error &error);
+
+	gcc_pure
+	const char *GetString(uint32_t i) const {
+		if (i >= header.n_strings ||
+		    string_offsets[i] >= header.string_data_size)
+			return nullptr;
+
+		return string_data + string_offsets[i];
+	}
+
+private:
+	bool LoadSongs(Directory &directory, const BinaryDirectory &d,
+		       Error &error);
+
+	Tag *LoadTag(const BinarySong &s);
+};
+
+bool
+BinaryDatabaseLoader::Open(const DatabaseMapping &mapping, Error &error)
+{
+	string_offsets = mapping.GetSection<uint32_t>(header.strings,
+						       header.n_strings);
+	string_data = mapping.GetSection<char>(header.string_data,
+					       header.string_data_size);
+	directories = mapping.GetSection<BinaryDirectory>(header.directories,
+							  header.n_directories);
+	songs = mapping.GetSection<BinarySong>(header.songs, header.n_songs);
+	items = mapping.GetSection<BinaryItem>(header.items, header.n_items);
+	playlists = mapping.GetSection<BinaryPlaylist>(header.playlists,
+						       header.n_playlists);
+
+	if (string_offsets == nullptr || string_data == nullptr ||
+	    directories == nullptr || songs == nullptr ||
+	    items == nullptr || playlists == nullptr ||
+	    header.n_directories == 0 ||
+	    /* the string table must be null-terminated, so no
+	       string can run past its end */
+	    header.string_data_size == 0 ||
+	    string_data[header.string_data_size - 1] != 0) {
+		error.Set(db_domain, "Database corrupted");
+		return false;
+	}
+
+	item_cache.resize(header.n_strings, nullptr);
+	return true;
+}
+
+Tag *
+BinaryDatabaseLoader::LoadTag(const BinarySong &s)
+{
+	Tag *tag = new Tag();
+	tag->time = s.time;
+	tag->has_playlist = (s.flags & BINARY_SONG_PLAYLIST) != 0;
+
+	if (s.n_items == 0)
+		return tag;
+
+	tag->items = g_new(TagItem *, s.n_items);
+
+	const BinaryItem *i = items + s.first_item;
+	const BinaryItem *const end = i + s.n_items;
+
+	for (; i != end; ++i) {
+		const TagType type = TagType(i->type);
+		if (ignore_tag_items[type])
+			continue;
+
+		TagItem *&cached = item_cache[i->value];
+		TagItem *item;
+		if (cached != nullptr && cached->type == type) {
+			item = tag_pool_dup_item(cached);
+		} else {
+			const char *value = GetString(i->value);
+			item = cached = tag_pool_get_item(type, value,
+							  strlen(value));
+		}
+
+		tag->items[tag->num_items++] = item;
+	}
+
+	return tag;
+}
+
+inline bool
+BinaryDatabaseLoader::LoadSongs(Directory &directory,
+				const BinaryDirectory &d, Error &error)
+{
+	if (uint64_t(d.first_song) + d.n_songs > header.n_songs ||
+	    uint64_t(d.first_playlist) + d.n_playlists > header.n_playlists) {
+		error.Set(db_domain, "Database corrupted");
+		return false;
+	}
+
+	for (const BinarySong *s = songs + d.first_song,
+		     *end = s + d.n_songs;
+	     s != end; ++s) {
+		const char *uri = GetString(s->uri);
+		if (uri == nullptr || *uri == 0 ||
+		    uint64_t(s->first_item) + s->n_items > header.n_items) {
+			error.Set(db_domain, "Database corrupted");
+			return false;
+		}
+
+		for (const BinaryItem *i = items + s->first_item,
+			     *i_end = i + s->n_items;
+		     i != i_end; ++i) {
+			if (i->type >= TAG_NUM_OF_ITEM_TYPES ||
+			    GetString(i->value) == nullptr) {
+				error.Set(db_domain, "Database corrupted");
+				return false;
+			}
+		}
+
+		Song *song = Song::NewFile(uri, &directory);
+		song->mtime = s->mtime;
+		song->mtime_ns = s->mtime_ns;
+		song->size = s->size;
+		song->inode = s->inode;
+		song->hash = s->hash;
+		song->start_ms = s->start_ms;
+		song->end_ms = s->end_ms;
+
+		if (s->flags & BINARY_SONG_TAG)
+			song->tag = LoadTag(*s);
+
+		directory.AddSong(song);
+	}
+
+	for (const BinaryPlaylist *p = playlists + d.first_playlist,
+		     *end = p + d.n_playlists;
+	     p != end; ++p) {
+		const char *name = GetString(p->name);
+		if (name == nullptr || *name == 0) {
+			error.Set(db_domain, "Database corrupted");
+			return false;
+		}
+
+		directory.playlists.push_back(PlaylistInfo(name, p->mtime));
+	}
+
+	return true;
+}
+
+bool
+BinaryDatabaseLoader::Load(Directory &root, Error &error)
+{
+	std::vector<Directory *> tree(header.n_directories);
+
+	if (directories[0].parent != DB_BINARY_NONE) {
+		error.Set(db_domain, "Database corrupted");
+		return false;
+	}
+
+	tree[0] = &root;
+
+	for (uint32_t i = 0; i < header.n_directories; ++i) {
+		const BinaryDirectory &d = directories[i];
+
+		if (i > 0) {
+			const char *name = GetString(d.name);
+			if (d.parent >= i || name == nullptr || *name == 0) {
+				error.Set(db_domain, "Database corrupted");
+				return false;
+			}
+
+			tree[i] = tree[d.parent]->CreateChild(name);
+		}
+
+		tree[i]->mtime = d.mtime;
+		tree[i]->scan_time = d.scan_time;
+
+		if (!LoadSongs(*tree[i], d, error))
+			return false;
+	}
+
+	return true;
+}
+
+bool
+db_load_binary(Path path, Directory &root, Error &error)
+{
+	DatabaseMapping mapping;
+	if (!mapping.Open(path, error))
+		return false;
+
+	const BinaryHeader &header =
+		*(const BinaryHeader *)mapping.GetData();
+	if (memcmp(header.magic, DB_BINARY_MAGIC,
+		   sizeof(header.magic)) != 0) {
+		error.Set(db_domain, "Database corrupted");
+		return false;
+	}
+
+	if (header.version != DB_BINARY_VERSION ||
+	    header.byte_order != DB_BINARY_BYTE_ORDER) {
+		error.Set(db_domain,
+			  "Database format mismatch, "
+			  "discarding database file");
+		return false;
+	}
+
+	/* all enabled tags must have been enabled when the file was
+	   written */
+	const uint32_t tag_mask = CurrentTagMask();
+	if ((header.tag_mask & tag_mask) != tag_mask) {
+		error.Set(db_domain,
+			  "Tag list mismatch, "
+			  "discarding database file");
+		return false;
+	}
+
+	BinaryDatabaseLoader loader(header);
+	if (!loader.Open(mapping, error))
+		return false;
+
+	const char *new_charset = loader.GetString(header.charset);
+	const char *const old_charset = GetFSCharset();
+	if (new_charset == nullptr) {
+		error.Set(db_domain, "Database corrupted");
+		return false;
+	}
+
+	if (*old_charset != 0 && strcmp(new_charset, old_charset) != 0) {
+		error.Format(db_domain,
+			     "Existing database has charset "
+			     "\"%s\" instead of \"%s\"; "
+			     "discarding database file",
+			     new_charset, old_charset);
+		return false;
+	}
+
+	LogDebug(db_domain, "reading binary DB");
+
+	db_lock();
+	const bool success = loader.Load(root, error);
+	db_unlock();
+
+	return success;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DATABASE_BINARY_HXX
+#define MPD_DATABASE_BINARY_HXX
+
+#include "Compiler.h"
+
+#include <stdio.h>
+
+struct Directory;
+class Path;
+class Error;
+
+/*
+ * The binary database format.  It is a versioned, flat image of the
+ * directory tree: a string table holding each distinct name and tag
+ * value once, followed by fixed-size directory, song, tag item and
+ * playlist records which refer to each other by index.  The loader
+ * maps the file and builds the tree directly from the records,
+ * without parsing text and with only one #TagPool lookup per
+ * distinct tag value.
+ *
+ * The file is in host byte order; a file written on a machine with
+ * a different byte order is rejected (and rebuilt by the next
+ * update).
+ */
+
+/**
+ * Does the given file start with the binary database header?
+ */
+gcc_pure
+bool
+db_binary_probe(Path path);
+
+/**
+ * Writes the whole tree to the given file in the binary format.  The
+ * caller must check ferror() afterwards.
+ */
+void
+db_save_binary(FILE *fp, const Directory &root);
+
+/**
+ * Loads a binary database file into the (empty) root directory.
+ */
+bool
+db_load_binary(Path path, Directory &root, Error &error);
+
+#endif
@@ -30,6 +30,8 @@
 #include "DatabasePlugin.hxx"
 #include "db/SimpleDatabasePlugin.hxx"
 
+#include <vector>
+
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -124,6 +126,38 @@ db_get_directory(const char *name)
 	return music_root->LookupDirectory(name);
 }
 
+void
+db_index_add_song(Song &song)
+{
+	assert(db != nullptr);
+	assert(db_is_simple());
+
+	((SimpleDatabase *)db)->GetTagIndex().Add(song);
+}
+
+void
+db_index_remove_song(const Song &song)
+{
+	assert(db != nullptr);
+	assert(db_is_simple());
+
+	((SimpleDatabase *)db)->GetTagIndex().Remove(song);
+}
+
+bool
+db_index_count(const SongFilter &filter, size_t &count_r)
+{
+	assert(db != nullptr);
+	assert(db_is_simple());
+
+	std::vector<Song *> songs;
+	if (!((SimpleDatabase *)db)->GetTagIndex().Lookup(filter, songs))
+		return false;
+
+	count_r = songs.size();
+	return true;
+}
+
 bool
 db_save(Error &error)
 {
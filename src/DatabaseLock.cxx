@@ -21,8 +21,9 @@
 #include "DatabaseLock.hxx"
 #include "Compiler.h"
 
-Mutex db_mutex;
+SharedMutex db_mutex;
 
 #ifndef NDEBUG
 ThreadId db_mutex_holder;
+__thread bool db_mutex_shared;
 #endif
@@ -27,12 +27,16 @@
 #define MPD_DB_LOCK_HXX
 
 #include "check.h"
-#include "thread/Mutex.hxx"
+#include "thread/SharedMutex.hxx"
 #include "Compiler.h"
 
 #include <assert.h>
 
-extern Mutex db_mutex;
+/**
+ * The database lock.  The update thread holds it exclusively while
+ * modifying the tree; readers share it.
+ */
+extern SharedMutex db_mutex;
 
 #ifndef NDEBUG
 
@@ -41,20 +45,36 @@ extern Mutex db_mutex;
 extern ThreadId db_mutex_holder;
 
 /**
- * Does the current thread hold the database lock?
+ * Does the current thread hold the database lock in shared mode?
+ */
+extern __thread bool db_mutex_shared;
+
+/**
+ * Does the current thread hold the database lock exclusively?
  */
 gcc_pure
 static inline bool
-holding_db_lock(void)
+holding_db_write_lock(void)
 {
 	return db_mutex_holder.IsInside();
 }
 
+/**
+ * Does the current thread hold the database lock (shared or
+ * exclusively)?
+ */
+gcc_pure
+static inline bool
+holding_db_lock(void)
+{
+	return db_mutex_shared || holding_db_write_lock();
+}
+
 #endif
 
 /**
- * Obtain the global database lock.  This is needed before
- * dereferencing a #song or #directory.  It is not recursive.
+ * Obtain the global database lock exclusively.  This is needed
+ * before modifying a #song or #directory.  It is not recursive.
  */
 static inline void
 db_lock(void)
@@ -70,12 +90,12 @@ db_lock(void)
 }
 
 /**
- * Release the global database lock.
+ * Release the exclusive database lock.
  */
 static inline void
 db_unlock(void)
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 #ifndef NDEBUG
 	db_mutex_holder = ThreadId::Null();
 #endif
@@ -83,6 +103,40 @@ db_unlock(void)
 	db_mutex.unlock();
 }
 
+/**
+ * Obtain the global database lock in shared mode.  This is needed
+ * before dereferencing a #song or #directory.  Other threads may
+ * read the database at the same time.  It is not recursive.
+ */
+static inline void
+db_lock_shared(void)
+{
+	assert(!holding_db_lock());
+
+	db_mutex.lock_shared();
+
+#ifndef NDEBUG
+	db_mutex_shared = true;
+#endif
+}
+
+/**
+ * Release the shared database lock.
+ */
+static inline void
+db_unlock_shared(void)
+{
+	assert(db_mutex_shared);
+#ifndef NDEBUG
+	db_mutex_shared = false;
+#endif
+
+	db_mutex.unlock_shared();
+}
+
+/**
+ * Hold the database lock exclusively, for modifying the database.
+ */
 class ScopeDatabaseLock {
 public:
 	ScopeDatabaseLock() {
@@ -94,4 +148,18 @@ public:
 	}
 };
 
+/**
+ * Hold the database lock in shared mode, for reading the database.
+ */
+class ScopeDatabaseReadLock {
+public:
+	ScopeDatabaseReadLock() {
+		db_lock_shared();
+	}
+
+	~ScopeDatabaseReadLock() {
+		db_unlock_shared();
+	}
+};
+
 #endif
@@ -26,12 +26,17 @@
 #include "TimePrint.hxx"
 #include "Directory.hxx"
 #include "Client.hxx"
+#include "ClientCursor.hxx"
 #include "tag/Tag.hxx"
 #include "Song.hxx"
 #include "DatabaseGlue.hxx"
 #include "DatabasePlugin.hxx"
+#include "DatabaseSimple.hxx"
+#include "DatabaseLock.hxx"
 
 #include <functional>
+#include <string>
+#include <vector>
 
 static bool
 PrintDirectoryBrief(Client &client, const Directory &directory)
@@ -139,6 +144,145 @@ db_selection_print(Client &client, const DatabaseSelection &selection,
 	return db->Visit(selection, d, s, p, error);
 }
 
+/**
+ * Filtered listings which the tag index narrows down to at most this
+ * many candidates are printed synchronously; they are small and the
+ * index is faster than walking the tree.
+ */
+static constexpr size_t CURSOR_MIN_CANDIDATES = 1024;
+
+/**
+ * The number of songs visited by one DirectoryCursor::Next() call.
+ */
+static constexpr unsigned CURSOR_BATCH_SONGS = 256;
+
+/**
+ * Prints a directory tree of the #SimpleDatabase incrementally, in the
+ * same order as SimpleDatabase::Visit().  The database lock is held only
+ * during each Next() call.  Between the calls, the update thread may
+ * modify the tree, therefore only path names are kept, and the
+ * objects are looked up again each time.
+ */
+class DirectoryCursor final : public ClientCursor {
+	const bool full;
+
+	SongFilter filter;
+
+	/**
+	 * The directories which have yet to be printed; the next one
+	 * is at the back.
+	 */
+	std::vector<std::string> pending;
+
+	/**
+	 * The directory being printed.
+	 */
+	std::string current;
+
+	/**
+	 * The name of the last song in #current which was visited,
+	 * or an empty string if this directory was not started yet.
+	 */
+	std::string last_song;
+
+public:
+	DirectoryCursor(const char *uri, bool _full, SongFilter &&_filter)
+		:full(_full), filter(std::move(_filter)), current(uri) {}
+
+	virtual bool Next(Client &client) override;
+
+private:
+	bool NextDirectory() {
+		if (pending.empty())
+			return false;
+
+		current = std::move(pending.back());
+		pending.pop_back();
+		last_song.clear();
+		return true;
+	}
+};
+
+bool
+DirectoryCursor::Next(Client &client)
+{
+	const ScopeDatabaseReadLock protect;
+
+	const Directory *directory =
+		db_get_root()->LookupDirectory(current.c_str());
+	if (directory == nullptr)
+		/* it was deleted meanwhile */
+		return NextDirectory();
+
+	const bool filtered = !filter.IsEmpty();
+
+	const struct list_head *i;
+	if (last_song.empty()) {
+		if (!filtered)
+			(full ? PrintDirectoryFull : PrintDirectoryBrief)
+				(client, *directory);
+
+		i = directory->songs.next;
+	} else {
+		/* continue after the last song; if it was deleted
+		   meanwhile, skip the rest of this directory */
+		const Song *song = directory->FindSong(last_song.c_str());
+		i = song != nullptr ? song->siblings.next : &directory->songs;
+	}
+
+	for (unsigned n = 0; i != &directory->songs; i = i->next, ++n) {
+		if (n == CURSOR_BATCH_SONGS)
+			return true;
+
+		const Song &song = *list_entry_const(i, Song, siblings);
+		if (!filtered || filter.Match(song))
+			(full ? PrintSongFull : PrintSongBrief)(client, song);
+
+		last_song = song.uri;
+	}
+
+	if (!filtered)
+		for (const PlaylistInfo &p : directory->playlists)
+			(full ? PrintPlaylistFull : PrintPlaylistBrief)
+				(client, p, *directory);
+
+	/* push the sub directories in reverse order, so the first
+	   one is printed next */
+	Directory *child;
+	list_for_each_entry_reverse(child, &directory->children, siblings)
+		pending.emplace_back(child->GetPath());
+
+	return NextDirectory();
+}
+
+ClientCursor *
+db_selection_print_cursor(Client &client, const char *uri, bool full,
+			  SongFilter *filter)
+{
+	if (client.IsInCommandList() || GetDatabase() == nullptr ||
+	    !db_is_simple())
+		return nullptr;
+
+	{
+		const ScopeDatabaseReadLock protect;
+
+		if (db_get_root()->LookupDirectory(uri) == nullptr)
+			/* not a directory: let db_selection_print()
+			   deal with it */
+			return nullptr;
+
+		size_t n;
+		if (filter != nullptr && db_index_count(*filter, n) &&
+		    n <= CURSOR_MIN_CANDIDATES)
+			return nullptr;
+	}
+
+	return new DirectoryCursor(uri, full,
+				   filter != nullptr
+				   ? std::move(*filter)
+				   : SongFilter());
+}
+
 struct SearchStats {
 	int numberOfSongs;
 	unsigned long playTime;
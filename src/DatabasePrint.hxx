@@ -26,12 +26,30 @@ class SongFilter;
 struct DatabaseSelection;
 struct db_visitor;
 class Client;
+class ClientCursor;
 class Error;
 
 bool
 db_selection_print(Client &client, const DatabaseSelection &selection,
 		   bool full, Error &error);
 
+/**
+ * Create a #ClientCursor which prints the directory tree at the
+ * given URI recursively (like db_selection_print()), for use with
+ * Client::StartCursor().
+ *
+ * @param filter an optional filter; its contents are moved into the
+ * cursor if one is created
+ * @return nullptr if the response should rather be generated
+ * synchronously by db_selection_print(), e.g. because the
+ * database plugin does not support cursors, the URI is not a
+ * directory, or inside a command list
+ */
+gcc_nonnull(2)
+ClientCursor *
+db_selection_print_cursor(Client &client, const char *uri, bool full,
+			  SongFilter *filter=nullptr);
+
 gcc_nonnull(2)
 bool
 printAllIn(Client &client, const char *uri_utf8, Error &error);
@@ -44,7 +44,13 @@
 #define DIRECTORY_FS_CHARSET "fs_charset: "
 #define DB_TAG_PREFIX "tag: "
 
-static constexpr unsigned DB_FORMAT = 1;
+/**
+ * Format 2 added the file fingerprints ("size", "inode", "mtime_ns",
+ * "hash"), the directory "scanned" time and the time stamps of the
+ * root directory; format 1 files can still be loaded.
+ */
+static constexpr unsigned DB_FORMAT = 2;
+static constexpr unsigned DB_FORMAT_MIN = 1;
 
 void
 db_save_internal(FILE *fp, const Directory &music_root)
@@ -131,7 +137,7 @@ db_load_internal(TextFile &file, Directory &music_root, Error &error)
 		}
 	}
 
-	if (format != DB_FORMAT) {
+	if (format < DB_FORMAT_MIN || format > DB_FORMAT) {
 		error.Set(db_domain,
 			  "Database format mismatch, "
 			  "discarding database file");
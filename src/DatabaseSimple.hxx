@@ -23,9 +23,12 @@
 #include "Compiler.h"
 
 #include <sys/time.h>
+#include <stddef.h>
 
 struct config_param;
 struct Directory;
+struct Song;
+class SongFilter;
 struct db_selection;
 struct db_visitor;
 class Error;
@@ -56,6 +59,37 @@ gcc_pure
 Directory *
 db_get_directory(const char *name);
 
+/**
+ * Adds a song which was just inserted into the tree (or whose tag
+ * was just replaced) to the tag index.  Caller must lock the
+ * #db_mutex.
+ *
+ * May only be used if db_is_simple() returns true.
+ */
+void
+db_index_add_song(Song &song);
+
+/**
+ * Removes a song from the tag index, before it gets removed from
+ * the tree (or before its tag gets replaced).  Caller must lock the
+ * #db_mutex.
+ *
+ * May only be used if db_is_simple() returns true.
+ */
+void
+db_index_remove_song(const Song &song);
+
+/**
+ * Asks the tag index how many songs may match the filter.  Caller
+ * must lock the #db_mutex.
+ *
+ * May only be used if db_is_simple() returns true.
+ *
+ * @return false if the index cannot answer this filter
+ */
+bool
+db_index_count(const SongFilter &filter, size_t &count_r);
+
 /**
  * May only be used if db_is_simple() returns true.
  */
@@ -29,6 +29,7 @@
 #include "DecoderInternal.hxx"
 #include "Song.hxx"
 #include "InputStream.hxx"
+#include "pcm/PcmCopyStats.hxx"
 #include "util/Error.hxx"
 #include "Log.hxx"
 
@@ -385,18 +386,18 @@ update_stream_tag(Decoder &decoder, InputStream *is)
 	return true;
 }
 
-DecoderCommand
-decoder_data(Decoder &decoder,
-	     InputStream *is,
-	     const void *data, size_t length,
-	     uint16_t kbit_rate)
+/**
+ * Common code for decoder_data() and decoder_data_direct(): check
+ * for a pending command and submit stream tags.
+ */
+static DecoderCommand
+decoder_data_begin(Decoder &decoder, InputStream *is, size_t length)
 {
 	DecoderControl &dc = decoder.dc;
 	DecoderCommand cmd;
 
 	assert(dc.state == DecoderState::DECODE);
 	assert(dc.pipe != nullptr);
-	assert(length % dc.in_audio_format.GetFrameSize() == 0);
 
 	dc.Lock();
 	cmd = decoder_get_virtual_command(decoder);
@@ -426,21 +427,21 @@ decoder_data(Decoder &decoder,
 			return cmd;
 	}
 
-	if (dc.in_audio_format != dc.out_audio_format) {
-		Error error;
-		data = decoder.conv_state.Convert(dc.in_audio_format,
-						   data, length,
-						   dc.out_audio_format,
-						   &length,
-						   error);
-		if (data == nullptr) {
-			/* the PCM conversion has failed - stop
-			   playback, since we have no better way to
-			   bail out */
-			LogError(error);
-			return DecoderCommand::STOP;
-		}
-	}
+	return DecoderCommand::NONE;
+}
+
+/**
+ * Distribute data in the output audio format over music chunks.
+ * The #write function is called for each chunk with the
+ * destination pointer, the offset and the size.
+ */
+template<typename W>
+static DecoderCommand
+decoder_write_chunks(Decoder &decoder, size_t length, uint16_t kbit_rate,
+		     W write)
+{
+	DecoderControl &dc = decoder.dc;
+	size_t offset = 0;
 
 	while (length > 0) {
 		struct music_chunk *chunk;
@@ -471,7 +472,8 @@ decoder_data(Decoder &decoder,
 
 		/* copy the buffer */
 
-		memcpy(dest.data, data, nbytes);
+		write(dest.data, offset, nbytes);
+		pcm_copy_count(PcmCopyPath::DECODER, nbytes);
 
 		/* expand the music pipe chunk */
 
@@ -481,7 +483,7 @@ decoder_data(Decoder &decoder,
 			decoder_flush_chunk(decoder);
 		}
 
-		data = (const uint8_t *)data + nbytes;
+		offset += nbytes;
 		length -= nbytes;
 
 		decoder.timestamp += (double)nbytes /
@@ -497,6 +499,74 @@ decoder_data(Decoder &decoder,
 	return DecoderCommand::NONE;
 }
 
+DecoderCommand
+decoder_data(Decoder &decoder,
+	     InputStream *is,
+	     const void *data, size_t length,
+	     uint16_t kbit_rate)
+{
+	DecoderControl &dc = decoder.dc;
+
+	assert(length % dc.in_audio_format.GetFrameSize() == 0);
+
+	DecoderCommand cmd = decoder_data_begin(decoder, is, length);
+	if (cmd != DecoderCommand::NONE || length == 0)
+		return cmd;
+
+	if (dc.in_audio_format != dc.out_audio_format) {
+		Error error;
+		data = decoder.conv_state.Convert(dc.in_audio_format,
+						   data, length,
+						   dc.out_audio_format,
+						   &length,
+						   error);
+		if (data == nullptr) {
+			/* the PCM conversion has failed - stop
+			   playback, since we have no better way to
+			   bail out */
+			LogError(error);
+			return DecoderCommand::STOP;
+		}
+	}
+
+	const uint8_t *const src = (const uint8_t *)data;
+	return decoder_write_chunks(decoder, length, kbit_rate,
+				    [src](void *dest, size_t offset,
+					  size_t nbytes){
+					    memcpy(dest, src + offset,
+						   nbytes);
+				    });
+}
+
+DecoderCommand
+decoder_data_direct(Decoder &decoder, InputStream *is,
+		    size_t length, uint16_t kbit_rate,
+		    DecoderWriteFunction write, void *ctx)
+{
+	DecoderControl &dc = decoder.dc;
+
+	assert(length % dc.in_audio_format.GetFrameSize() == 0);
+
+	if (dc.in_audio_format != dc.out_audio_format) {
+		/* the data needs to be converted: let the plugin
+		   write into a temporary buffer, and pass it to the
+		   converter */
+		void *buffer = decoder.direct_buffer.Get(length);
+		write(buffer, 0, length, ctx);
+		return decoder_data(decoder, is, buffer, length, kbit_rate);
+	}
+
+	DecoderCommand cmd = decoder_data_begin(decoder, is, length);
+	if (cmd != DecoderCommand::NONE || length == 0)
+		return cmd;
+
+	return decoder_write_chunks(decoder, length, kbit_rate,
+				    [write, ctx](void *dest, size_t offset,
+						 size_t nbytes){
+					    write(dest, offset, nbytes, ctx);
+				    });
+}
+
 DecoderCommand
 decoder_tag(Decoder &decoder, InputStream *is,
 	    Tag &&tag)
@@ -165,6 +165,43 @@ decoder_data(Decoder &decoder, InputStream &is,
 	return decoder_data(decoder, &is, data, length, kbit_rate);
 }
 
+/**
+ * A callback for decoder_data_direct() which writes a range of the
+ * decoded data.
+ *
+ * @param dest the destination buffer
+ * @param offset the offset of the first byte to be written, relative
+ * to the beginning of the decoded block
+ * @param length the number of bytes to be written; a multiple of the
+ * frame size
+ * @param ctx the opaque pointer passed to decoder_data_direct()
+ */
+typedef void (*DecoderWriteFunction)(void *dest, size_t offset,
+				     size_t length, void *ctx);
+
+/**
+ * Like decoder_data(), but instead of copying a buffer, the callback
+ * writes the data directly into the music pipe.  This allows the
+ * plugin to combine its own rearrangement of the data (e.g. byte
+ * order or interleaving) with the copy into the pipe.  The callback
+ * may be invoked several times with consecutive ranges.
+ *
+ * @param length the total number of bytes in the decoded block
+ */
+DecoderCommand
+decoder_data_direct(Decoder &decoder, InputStream *is,
+		    size_t length, uint16_t kbit_rate,
+		    DecoderWriteFunction write, void *ctx);
+
+static inline DecoderCommand
+decoder_data_direct(Decoder &decoder, InputStream &is,
+		    size_t length, uint16_t kbit_rate,
+		    DecoderWriteFunction write, void *ctx)
+{
+	return decoder_data_direct(decoder, &is, length, kbit_rate,
+				   write, ctx);
+}
+
 /**
  * This function is called by the decoder plugin when it has
  * successfully decoded a tag.
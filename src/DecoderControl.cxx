@@ -32,6 +32,7 @@ DecoderControl::DecoderControl(Mutex &_mutex, Cond &_client_cond)
 	 command(DecoderCommand::NONE),
 	 client_is_waiting(false),
 	 song(nullptr),
+	 pipe(nullptr), pipe_limit(0),
 	 replay_gain_db(0), replay_gain_prev_db(0) {}
 
 DecoderControl::~DecoderControl()
@@ -71,10 +72,17 @@ DecoderControl::IsCurrentSong(const Song &_song) const
 	gcc_unreachable();
 }
 
+bool
+DecoderControl::IsThrottled() const
+{
+	return pipe_limit > 0 && pipe->GetSize() >= pipe_limit;
+}
+
 void
 DecoderControl::Start(Song *_song,
 		      unsigned _start_ms, unsigned _end_ms,
-		      MusicBuffer &_buffer, MusicPipe &_pipe)
+		      MusicBuffer &_buffer, MusicPipe &_pipe,
+		      unsigned _pipe_limit)
 {
 	assert(_song != nullptr);
 	assert(_pipe.IsEmpty());
@@ -87,6 +95,7 @@ DecoderControl::Start(Song *_song,
 	end_ms = _end_ms;
 	buffer = &_buffer;
 	pipe = &_pipe;
+	pipe_limit = _pipe_limit;
 
 	LockSynchronousCommand(DecoderCommand::START);
 }
@@ -153,6 +153,17 @@ struct DecoderControl {
 	 */
 	MusicPipe *pipe;
 
+	/**
+	 * If non-zero, then the decoder does not push more than this
+	 * number of chunks into #pipe; it waits until the player
+	 * lifts the limit with Unthrottle().  This is used by the
+	 * look-ahead decoder, which must not take the #MusicBuffer
+	 * away from the decoder of the current song.
+	 *
+	 * This attribute is set by dc_start().
+	 */
+	unsigned pipe_limit;
+
 	float replay_gain_db;
 	float replay_gain_prev_db;
 
@@ -295,6 +306,24 @@ struct DecoderControl {
 	gcc_pure
 	bool IsCurrentSong(const Song &_song) const;
 
+	/**
+	 * Has the decoder reached #pipe_limit?
+	 *
+	 * Caller must lock the object.
+	 */
+	gcc_pure
+	bool IsThrottled() const;
+
+	/**
+	 * Clear #pipe_limit and wake up the decoder thread.
+	 *
+	 * Caller must lock the object.
+	 */
+	void Unthrottle() {
+		pipe_limit = 0;
+		Signal();
+	}
+
 	gcc_pure
 	bool LockIsCurrentSong(const Song &_song) const {
 		Lock();
@@ -359,9 +388,11 @@ public:
 	 * @param end_ms see #DecoderControl
 	 * @param pipe the pipe which receives the decoded chunks (owned by
 	 * the caller)
+	 * @param pipe_limit see #DecoderControl
 	 */
 	void Start(Song *song, unsigned start_ms, unsigned end_ms,
-		   MusicBuffer &buffer, MusicPipe &pipe);
+		   MusicBuffer &buffer, MusicPipe &pipe,
+		   unsigned pipe_limit=0);
 
 	void Stop();
 
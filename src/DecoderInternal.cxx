@@ -24,6 +24,7 @@
 #include "MusicBuffer.hxx"
 #include "MusicChunk.hxx"
 #include "tag/Tag.hxx"
+#include "system/ThreadFaults.hxx"
 
 #include <assert.h>
 
@@ -60,6 +61,17 @@ decoder_get_chunk(Decoder &decoder)
 		return decoder.chunk;
 
 	do {
+		dc.Lock();
+		if (dc.IsThrottled()) {
+			/* this is the look-ahead decoder, and it has
+			   used up its budget; wait until the player
+			   switches to this song */
+			cmd = need_chunks(dc);
+			dc.Unlock();
+			continue;
+		}
+		dc.Unlock();
+
 		decoder.chunk = dc.buffer->Allocate();
 		if (decoder.chunk != nullptr) {
 			decoder.chunk->replay_gain_serial =
@@ -96,6 +108,8 @@ decoder_flush_chunk(Decoder &decoder)
 
 	decoder.chunk = nullptr;
 
+	UpdateThreadFaults();
+
 	dc.Lock();
 	if (dc.client_is_waiting)
 		dc.client_cond.signal();
@@ -22,6 +22,7 @@
 
 #include "DecoderCommand.hxx"
 #include "pcm/PcmConvert.hxx"
+#include "pcm/PcmBuffer.hxx"
 #include "ReplayGainInfo.hxx"
 
 struct DecoderControl;
@@ -33,6 +34,12 @@ struct Decoder {
 
 	PcmConvert conv_state;
 
+	/**
+	 * A temporary buffer for decoder_data_direct(), used only if
+	 * the data needs to be converted.
+	 */
+	PcmBuffer direct_buffer;
+
 	/**
 	 * The time stamp of the next data chunk, in seconds.
 	 */
@@ -157,6 +157,19 @@ decoder_plugin_from_suffix(const char *suffix,
 	return nullptr;
 }
 
+bool
+decoder_plugins_reentrant(const char *suffix)
+{
+	for (const DecoderPlugin *plugin =
+		     decoder_plugin_from_suffix(suffix, nullptr);
+	     plugin != nullptr;
+	     plugin = decoder_plugin_from_suffix(suffix, plugin))
+		if (!plugin->reentrant)
+			return false;
+
+	return true;
+}
+
 const struct DecoderPlugin *
 decoder_plugin_from_mime_type(const char *mimeType, unsigned int next)
 {
@@ -38,6 +38,14 @@ const struct DecoderPlugin *
 decoder_plugin_from_suffix(const char *suffix,
 			   const struct DecoderPlugin *plugin);
 
+/**
+ * May files with the specified suffix be scanned or decoded by
+ * several threads at the same time?  This is true if all enabled
+ * plugins which support the suffix have DecoderPlugin::reentrant.
+ */
+bool
+decoder_plugins_reentrant(const char *suffix);
+
 const struct DecoderPlugin *
 decoder_plugin_from_mime_type(const char *mimeType, unsigned int next);
 
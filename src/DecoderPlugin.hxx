@@ -102,6 +102,16 @@ struct DecoderPlugin {
 	const char *const*suffixes;
 	const char *const*mime_types;
 
+	/**
+	 * May the methods of this plugin be called by several threads
+	 * at the same time?  Plugins whose library keeps global state
+	 * (or which have not been audited) leave this false; the
+	 * database update then scans their files one at a time, and
+	 * the player does not decode their songs with the look-ahead
+	 * decoder.
+	 */
+	bool reentrant;
+
 	/**
 	 * Initialize a decoder plugin.
 	 *
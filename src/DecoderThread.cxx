@@ -456,6 +456,6 @@ decoder_thread_start(DecoderControl &dc)
 	dc.quit = false;
 
 	Error error;
-	if (!dc.thread.Start(decoder_task, &dc, error))
+	if (!dc.thread.Start(decoder_task, &dc, "decoder", error))
 		FatalError(error);
 }
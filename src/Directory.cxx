@@ -33,10 +33,44 @@ extern "C" {
 
 #include <glib.h>
 
+#include <unordered_map>
+
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
 
+/**
+ * Directories with fewer entries than this are searched linearly;
+ * see Directory::index.
+ */
+static constexpr unsigned DIRECTORY_INDEX_THRESHOLD = 32;
+
+struct DirectoryIndex {
+	struct Hash {
+		gcc_pure
+		size_t operator()(const char *p) const {
+			size_t hash = 2166136261u;
+			while (*p != 0)
+				hash = (hash ^ (unsigned char)*p++) * 16777619u;
+			return hash;
+		}
+	};
+
+	struct Equal {
+		gcc_pure
+		bool operator()(const char *a, const char *b) const {
+			return strcmp(a, b) == 0;
+		}
+	};
+
+	/**
+	 * The keys point to Directory::GetName() and Song::uri of
+	 * the values.
+	 */
+	std::unordered_map<const char *, Directory *, Hash, Equal> children;
+	std::unordered_map<const char *, Song *, Hash, Equal> songs;
+};
+
 inline Directory *
 Directory::Allocate(const char *path)
 {
@@ -56,6 +90,7 @@ Directory::Allocate(const char *path)
 }
 
 Directory::Directory()
+	:index(nullptr), n_children(0), n_songs(0)
 {
 	INIT_LIST_HEAD(&children);
 	INIT_LIST_HEAD(&songs);
@@ -64,6 +99,7 @@ Directory::Directory()
 }
 
 Directory::Directory(const char *_path)
+	:index(nullptr), n_children(0), n_songs(0)
 {
 	INIT_LIST_HEAD(&children);
 	INIT_LIST_HEAD(&songs);
@@ -80,6 +116,64 @@ Directory::~Directory()
 	Directory *child, *n;
 	directory_for_each_child_safe(child, n, *this)
 		child->Free();
+
+	delete index;
+}
+
+void
+Directory::AddToIndex(Directory &child)
+{
+	if (index != nullptr)
+		index->children.emplace(child.GetName(), &child);
+}
+
+void
+Directory::AddToIndex(Song &song)
+{
+	if (index != nullptr)
+		index->songs.emplace(song.uri, &song);
+}
+
+void
+Directory::RemoveFromIndex(const Directory &child)
+{
+	if (index == nullptr)
+		return;
+
+	auto i = index->children.find(child.GetName());
+	if (i != index->children.end() && i->second == &child)
+		index->children.erase(i);
+}
+
+void
+Directory::RemoveFromIndex(const Song &song)
+{
+	if (index == nullptr)
+		return;
+
+	auto i = index->songs.find(song.uri);
+	if (i != index->songs.end() && i->second == &song)
+		index->songs.erase(i);
+}
+
+void
+Directory::CheckIndex()
+{
+	if (index != nullptr ||
+	    n_children + n_songs < DIRECTORY_INDEX_THRESHOLD)
+		return;
+
+	index = new DirectoryIndex();
+	index->children.reserve(n_children);
+	index->songs.reserve(n_songs);
+
+	Directory *child;
+	directory_for_each_child(child, *this)
+		index->children.emplace(child->GetName(), child);
+
+	Song *song;
+	directory_for_each_song(song, *this)
+		index->songs.emplace(song->uri, song);
 }
 
 Directory *
@@ -105,10 +199,12 @@ Directory::Free()
 void
 Directory::Delete()
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(parent != nullptr);
 
 	list_del(&siblings);
+	--parent->n_children;
+	parent->RemoveFromIndex(*this);
 	Free();
 }
 
@@ -123,7 +219,7 @@ Directory::GetName() const
 Directory *
 Directory::CreateChild(const char *name_utf8)
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(name_utf8 != nullptr);
 	assert(*name_utf8 != 0);
 
@@ -142,6 +238,9 @@ Directory::CreateChild(const char *name_utf8)
 	g_free(allocated);
 
 	list_add_tail(&child->siblings, &children);
+	++n_children;
+	AddToIndex(*child);
+	CheckIndex();
 	return child;
 }
 
@@ -150,6 +249,11 @@ Directory::FindChild(const char *name) const
 {
 	assert(holding_db_lock());
 
+	if (index != nullptr) {
+		auto i = index->children.find(name);
+		return i != index->children.end() ? i->second : nullptr;
+	}
+
 	const Directory *child;
 	directory_for_each_child(child, *this)
 		if (strcmp(child->GetName(), name) == 0)
@@ -161,7 +265,7 @@ Directory::FindChild(const char *name) const
 void
 Directory::PruneEmpty()
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 
 	Directory *child, *n;
 	directory_for_each_child_safe(child, n, *this) {
@@ -209,21 +313,26 @@ Directory::LookupDirectory(const char *uri)
 void
 Directory::AddSong(Song *song)
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(song != nullptr);
 	assert(song->parent == this);
 
 	list_add_tail(&song->siblings, &songs);
+	++n_songs;
+	AddToIndex(*song);
+	CheckIndex();
 }
 
 void
 Directory::RemoveSong(Song *song)
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(song != nullptr);
 	assert(song->parent == this);
 
 	list_del(&song->siblings);
+	--n_songs;
+	RemoveFromIndex(*song);
 }
 
 const Song *
@@ -232,6 +341,11 @@ Directory::FindSong(const char *name_utf8) const
 	assert(holding_db_lock());
 	assert(name_utf8 != nullptr);
 
+	if (index != nullptr) {
+		auto i = index->songs.find(name_utf8);
+		return i != index->songs.end() ? i->second : nullptr;
+	}
+
 	Song *song;
 	directory_for_each_song(song, *this) {
 		assert(song->parent == this);
@@ -285,7 +399,7 @@ directory_cmp(gcc_unused void *priv,
 void
 Directory::Sort()
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 
 	list_sort(nullptr, &children, directory_cmp);
 	song_list_sort(&songs);
@@ -44,6 +44,7 @@
 	list_for_each_entry_safe(pos, n, &(directory).songs, siblings)
 
 struct Song;
+struct DirectoryIndex;
 struct db_visitor;
 class SongFilter;
 class Error;
@@ -79,6 +80,32 @@ struct Directory {
 
 	Directory *parent;
 	time_t mtime;
+
+	/**
+	 * The time when the update thread last read the complete
+	 * listing of this directory.  If #mtime is older than that
+	 * and has not changed since, the listing still matches the
+	 * database, and the next update does not need to read it.
+	 * Zero if unknown.
+	 */
+	time_t scan_time;
+
+	/**
+	 * A hash table of the #children and #songs by name.  It is
+	 * created when the directory grows beyond
+	 * #DIRECTORY_INDEX_THRESHOLD entries (nullptr before that),
+	 * and then maintained by all methods which add or remove
+	 * entries.  The lists remain authoritative for the order.
+	 *
+	 * This attribute is protected with the global #db_mutex.
+	 */
+	DirectoryIndex *index;
+
+	/**
+	 * The number of entries in #children and #songs.
+	 */
+	unsigned n_children, n_songs;
+
 	ino_t inode;
 	dev_t device;
 	bool have_stat; /* not needed if ino_t == dev_t == 0 is impossible */
@@ -87,6 +114,16 @@ struct Directory {
 protected:
 	Directory(const char *path);
 
+	void AddToIndex(Directory &child);
+	void AddToIndex(Song &song);
+	void RemoveFromIndex(const Directory &child);
+	void RemoveFromIndex(const Song &song);
+
+	/**
+	 * Create the #index if the directory has become large enough.
+	 */
+	void CheckIndex();
+
 	gcc_malloc gcc_nonnull_all
 	static Directory *Allocate(const char *path);
 
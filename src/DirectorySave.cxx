@@ -35,6 +35,7 @@
 
 #define DIRECTORY_DIR "directory: "
 #define DIRECTORY_MTIME "mtime: "
+#define DIRECTORY_SCAN_TIME "scanned: "
 #define DIRECTORY_BEGIN "begin: "
 #define DIRECTORY_END "end: "
 
@@ -43,12 +44,16 @@ static constexpr Domain directory_domain("directory");
 void
 directory_save(FILE *fp, const Directory &directory)
 {
-	if (!directory.IsRoot()) {
-		fprintf(fp, DIRECTORY_MTIME "%lu\n",
-			(unsigned long)directory.mtime);
+	/* the root directory has no "begin" line; its time stamps
+	   are the first lines of its contents */
+	fprintf(fp, DIRECTORY_MTIME "%lu\n",
+		(unsigned long)directory.mtime);
+	if (directory.scan_time > 0)
+		fprintf(fp, DIRECTORY_SCAN_TIME "%lu\n",
+			(unsigned long)directory.scan_time);
 
+	if (!directory.IsRoot())
 		fprintf(fp, "%s%s\n", DIRECTORY_BEGIN, directory.GetPath());
-	}
 
 	Directory *cur;
 	directory_for_each_child(cur, directory) {
@@ -103,6 +108,18 @@ directory_load_subdir(TextFile &file, Directory &parent, const char *name,
 		}
 	}
 
+	if (g_str_has_prefix(line, DIRECTORY_SCAN_TIME)) {
+		directory->scan_time =
+			ParseUint64(line + sizeof(DIRECTORY_SCAN_TIME) - 1);
+
+		line = file.ReadLine();
+		if (line == nullptr) {
+			error.Set(directory_domain, "Unexpected end of file");
+			directory->Delete();
+			return nullptr;
+		}
+	}
+
 	if (!g_str_has_prefix(line, DIRECTORY_BEGIN)) {
 		error.Format(directory_domain, "Malformed line: %s", line);
 		directory->Delete();
@@ -125,7 +142,15 @@ directory_load(TextFile &file, Directory &directory, Error &error)
 
 	while ((line = file.ReadLine()) != nullptr &&
 	       !g_str_has_prefix(line, DIRECTORY_END)) {
-		if (g_str_has_prefix(line, DIRECTORY_DIR)) {
+		if (g_str_has_prefix(line, DIRECTORY_MTIME) &&
+		    directory.IsRoot()) {
+			directory.mtime =
+				ParseUint64(line + sizeof(DIRECTORY_MTIME) - 1);
+		} else if (g_str_has_prefix(line, DIRECTORY_SCAN_TIME) &&
+			   directory.IsRoot()) {
+			directory.scan_time =
+				ParseUint64(line + sizeof(DIRECTORY_SCAN_TIME) - 1);
+		} else if (g_str_has_prefix(line, DIRECTORY_DIR)) {
 			Directory *subdir =
 				directory_load_subdir(file, directory,
 						      line + sizeof(DIRECTORY_DIR) - 1,
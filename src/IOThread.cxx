@@ -74,7 +74,7 @@ io_thread_start()
 	const ScopeLock protect(io.mutex);
 
 	Error error;
-	if (!io.thread.Start(io_thread_func, nullptr, error))
+	if (!io.thread.Start(io_thread_func, nullptr, "io", error))
 		FatalError(error);
 }
 
@@ -236,7 +236,7 @@ watch_directory_depth(const WatchDirectory *d)
 
 static void
 mpd_inotify_callback(int wd, unsigned mask,
-		     gcc_unused const char *name, gcc_unused void *ctx)
+		     const char *name, gcc_unused void *ctx)
 {
 	WatchDirectory *directory;
 
@@ -275,7 +275,16 @@ mpd_inotify_callback(int wd, unsigned mask,
 		/* a file was changed, or a directory was
 		   moved/deleted: queue a database update */
 
-		if (!uri_fs.IsNull()) {
+		if ((mask & IN_ISDIR) == 0 && name != nullptr && *name != 0) {
+			/* only this file was changed: don't rescan
+			   the whole directory */
+			const auto file_fs = uri_fs.IsNull()
+				? AllocatedPath::FromFS(name)
+				: AllocatedPath::Build(uri_fs, name);
+			const std::string uri_utf8 = file_fs.ToUTF8();
+			if (!uri_utf8.empty())
+				inotify_queue->Enqueue(uri_utf8.c_str());
+		} else if (!uri_fs.IsNull()) {
 			const std::string uri_utf8 = uri_fs.ToUTF8();
 			if (!uri_utf8.empty())
 				inotify_queue->Enqueue(uri_utf8.c_str());
@@ -34,6 +34,7 @@
 #include "Listen.hxx"
 #include "Client.hxx"
 #include "ClientList.hxx"
+#include "ClientWorker.hxx"
 #include "command/AllCommands.hxx"
 #include "Partition.hxx"
 #include "Volume.hxx"
@@ -48,6 +49,7 @@
 #include "InputInit.hxx"
 #include "event/Loop.hxx"
 #include "IOThread.hxx"
+#include "ThreadConfig.hxx"
 #include "fs/AllocatedPath.hxx"
 #include "fs/Config.hxx"
 #include "PlaylistRegistry.hxx"
@@ -55,6 +57,7 @@
 #include "DecoderList.hxx"
 #include "AudioConfig.hxx"
 #include "pcm/PcmResample.hxx"
+#include "pcm/PcmConvert.hxx"
 #include "Daemon.hxx"
 #include "system/FatalError.hxx"
 #include "util/Error.hxx"
@@ -80,6 +83,8 @@
 
 #include <glib.h>
 
+#include <algorithm>
+
 #include <unistd.h>
 #include <stdlib.h>
 #include <errno.h>
@@ -96,6 +101,7 @@
 
 static constexpr unsigned DEFAULT_BUFFER_SIZE = 4096;
 static constexpr unsigned DEFAULT_BUFFER_BEFORE_PLAY = 10;
+static constexpr unsigned DEFAULT_LOOKAHEAD_BUFFER_SIZE = 512;
 
 static constexpr Domain main_domain("main");
 
@@ -253,6 +259,28 @@ static void winsock_init(void)
 #endif
 }
 
+static HugePolicy
+parse_buffer_policy(const struct config_param *param)
+{
+	if (param == nullptr)
+		return HugePolicy::LAZY;
+
+	const char *value = param->value.c_str();
+	if (strcmp(value, "lazy") == 0)
+		return HugePolicy::LAZY;
+	else if (strcmp(value, "prefault") == 0)
+		return HugePolicy::PREFAULT;
+	else if (strcmp(value, "mlock") == 0)
+		return HugePolicy::LOCK;
+	else if (strcmp(value, "hugetlb") == 0)
+		return HugePolicy::HUGETLB;
+
+	FormatFatalError("audio buffer policy \"%s\" is not one of "
+			 "\"lazy\", \"prefault\", \"mlock\", "
+			 "\"hugetlb\", line %i",
+			 value, param->line);
+}
+
 /**
  * Initialize the decoder and player core, including the music pipe.
  */
@@ -261,7 +289,7 @@ initialize_decoder_and_player(void)
 {
 	const struct config_param *param;
 	char *test;
-	size_t buffer_size;
+	size_t buffer_size, chunk_size;
 	float perc;
 	unsigned buffered_chunks;
 	unsigned buffered_before_play;
@@ -279,12 +307,37 @@ initialize_decoder_and_player(void)
 
 	buffer_size *= 1024;
 
-	buffered_chunks = buffer_size / CHUNK_SIZE;
+	param = config_get_param(CONF_AUDIO_CHUNK_SIZE);
+	if (param != nullptr) {
+		long tmp = strtol(param->value.c_str(), &test, 10);
+		if (*test != '\0' || tmp <= 0 || tmp > 1024)
+			FormatFatalError("chunk size \"%s\" is not a "
+					 "positive integer up to 1024, line %i",
+					 param->value.c_str(), param->line);
+		chunk_size = tmp * 1024;
+	} else
+		chunk_size = DEFAULT_CHUNK_SIZE;
+
+	/* chunks are filled with at least this many bytes of any
+	   audio format (see music_chunk::CalcFillSize()); counting
+	   chunks in this unit keeps the duration of the buffer
+	   independent of the chunk capacity, and the player limits
+	   the number of chunks in use for larger fills */
+	const size_t min_fill_size = std::min(chunk_size, DEFAULT_CHUNK_SIZE);
+
+	buffered_chunks = buffer_size / min_fill_size;
+	if (buffered_chunks < 2)
+		FormatFatalError("buffer size \"%lu\" is too small for "
+				 "the chunk size",
+				 (unsigned long)buffer_size);
 
 	if (buffered_chunks >= 1 << 15)
 		FormatFatalError("buffer size \"%lu\" is too big",
 				 (unsigned long)buffer_size);
 
+	const HugePolicy buffer_policy =
+		parse_buffer_policy(config_get_param(CONF_AUDIO_BUFFER_POLICY));
+
 	param = config_get_param(CONF_BUFFER_BEFORE_PLAY);
 	if (param != nullptr) {
 		perc = strtod(param->value.c_str(), &test);
@@ -301,6 +354,33 @@ initialize_decoder_and_player(void)
 	if (buffered_before_play > buffered_chunks)
 		buffered_before_play = buffered_chunks;
 
+	const unsigned buffer_time =
+		config_get_unsigned(CONF_AUDIO_BUFFER_TIME, 0);
+	const unsigned stream_buffer_time =
+		config_get_unsigned(CONF_AUDIO_BUFFER_TIME_STREAM,
+				    buffer_time);
+
+	const size_t lookahead_size =
+		size_t(config_get_unsigned(CONF_LOOKAHEAD_BUFFER_SIZE,
+					   DEFAULT_LOOKAHEAD_BUFFER_SIZE)) * 1024;
+	unsigned lookahead_chunks =
+		(lookahead_size + min_fill_size - 1) / min_fill_size;
+	if (lookahead_chunks > buffered_chunks / 2) {
+		if (config_get_param(CONF_LOOKAHEAD_BUFFER_SIZE) != nullptr)
+			FormatFatalError("lookahead buffer size \"%lu\" is too big "
+					 "for the audio buffer",
+					 (unsigned long)(lookahead_size / 1024));
+
+		/* the default is too big for a small audio buffer:
+		   shrink the look-ahead instead of failing */
+		lookahead_chunks = buffered_chunks / 2;
+		FormatWarning(main_domain,
+			      "audio_buffer_size is too small for the default "
+			      "lookahead buffer; reducing it to %lu KiB",
+			      (unsigned long)(lookahead_chunks *
+					      min_fill_size / 1024));
+	}
+
 	const unsigned max_length =
 		config_get_positive(CONF_MAX_PLAYLIST_LENGTH,
 				    DEFAULT_PLAYLIST_MAX_LENGTH);
@@ -308,7 +388,11 @@ initialize_decoder_and_player(void)
 	instance->partition = new Partition(*instance,
 					    max_length,
 					    buffered_chunks,
-					    buffered_before_play);
+					    chunk_size,
+					    buffer_policy,
+					    buffered_before_play,
+					    buffer_time, stream_buffer_time,
+					    lookahead_chunks);
 }
 
 /**
@@ -395,6 +479,11 @@ int mpd_main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	if (!ThreadConfigInit(error)) {
+		LogError(error);
+		return EXIT_FAILURE;
+	}
+
 	main_thread = ThreadId::GetCurrent();
 	main_loop = new EventLoop(EventLoop::Default());
 
@@ -431,11 +520,15 @@ int mpd_main(int argc, char *argv[])
 	archive_plugin_init_all();
 #endif
 
-	if (!pcm_resample_global_init(error)) {
+	if (!pcm_resample_global_init(config_get_string(CONF_SAMPLERATE_CONVERTER,
+							""),
+				      error)) {
 		LogError(error);
 		return EXIT_FAILURE;
 	}
 
+	pcm_convert_global_init();
+
 	decoder_plugin_init_all();
 	update_global_init();
 
@@ -460,6 +553,8 @@ int mpd_main(int argc, char *argv[])
 
 	daemonize(options.daemon);
 
+	ThreadConfigLockMemory();
+
 	setup_log_output(options.log_stderr);
 
 	SignalHandlersInit(*main_loop);
@@ -470,6 +565,10 @@ int mpd_main(int argc, char *argv[])
 
 	player_create(instance->partition->pc);
 
+	/* the worker threads must be started after daemonize(),
+	   because threads do not survive fork() */
+	client_worker_init(*main_loop);
+
 	if (create_db) {
 		/* the database failed to load: recreate the
 		   database */
@@ -527,6 +626,7 @@ int mpd_main(int argc, char *argv[])
 	instance->partition->pc.Kill();
 	ZeroconfDeinit();
 	listen_global_finish();
+	client_worker_finish();
 	delete instance->client_list;
 
 	start = clock();
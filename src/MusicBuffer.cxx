@@ -21,20 +21,58 @@
 #include "MusicBuffer.hxx"
 #include "MusicChunk.hxx"
 #include "system/FatalError.hxx"
+#include "util/HugeAllocator.hxx"
 
 #include <assert.h>
+#include <errno.h>
+#include <string.h>
 
-MusicBuffer::MusicBuffer(unsigned num_chunks)
-	:buffer(num_chunks) {
-	if (buffer.IsOOM())
-		FatalError("Failed to allocate buffer");
+/**
+ * The chunk headers are small; reserving a whole explicit huge page
+ * for them would be a waste, so they are only locked.
+ */
+static constexpr HugePolicy
+HeaderPolicy(HugePolicy policy)
+{
+	return policy == HugePolicy::HUGETLB
+		? HugePolicy::LOCK
+		: policy;
+}
+
+MusicBuffer::MusicBuffer(unsigned num_chunks, size_t _chunk_size,
+			 HugePolicy _policy)
+	:buffer(num_chunks, HeaderPolicy(_policy)), chunk_size(_chunk_size),
+	 data((uint8_t *)HugeAllocate(num_chunks * chunk_size, _policy)),
+	 policy(_policy), limit(num_chunks) {
+	assert(chunk_size > 0);
+
+	if (buffer.IsOOM() || data == nullptr)
+		FormatFatalError("Failed to allocate buffer: %s",
+				 strerror(errno));
+}
+
+MusicBuffer::~MusicBuffer()
+{
+	HugeFree(data, buffer.GetCapacity() * chunk_size, policy);
 }
 
 music_chunk *
 MusicBuffer::Allocate()
 {
-	const ScopeLock protect(mutex);
-	return buffer.Allocate();
+	if (buffer.GetAllocated() >= GetLimit())
+		return nullptr;
+
+	return AllocateBeyondLimit();
+}
+
+music_chunk *
+MusicBuffer::AllocateBeyondLimit()
+{
+	music_chunk *chunk = buffer.Allocate(nullptr, chunk_size);
+	if (chunk != nullptr)
+		chunk->data = data + buffer.GetIndex(chunk) * chunk_size;
+
+	return chunk;
 }
 
 void
@@ -42,8 +80,6 @@ MusicBuffer::Return(music_chunk *chunk)
 {
 	assert(chunk != nullptr);
 
-	const ScopeLock protect(mutex);
-
 	if (chunk->other != nullptr) {
 		assert(chunk->other->other == nullptr);
 		buffer.Free(chunk->other);
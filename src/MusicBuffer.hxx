@@ -20,34 +20,67 @@
 #ifndef MPD_MUSIC_BUFFER_HXX
 #define MPD_MUSIC_BUFFER_HXX
 
+#include "MusicChunk.hxx"
 #include "util/SliceBuffer.hxx"
-#include "thread/Mutex.hxx"
 
-struct music_chunk;
+#include <atomic>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
 
 /**
- * An allocator for #music_chunk objects.
+ * An allocator for #music_chunk objects.  All methods are lock-free
+ * and may be called from any thread.
  */
 class MusicBuffer {
-	/** a mutex which protects #buffer */
-	Mutex mutex;
-
 	SliceBuffer<music_chunk> buffer;
 
+	/**
+	 * The capacity of each chunk in bytes.
+	 */
+	const size_t chunk_size;
+
+	/**
+	 * The data buffers of all chunks; the chunk at index i owns
+	 * the range starting at i * #chunk_size.
+	 */
+	uint8_t *const data;
+
+	const HugePolicy policy;
+
+	/**
+	 * Allocate() refuses to hand out more than this number of
+	 * chunks.  It is adjusted to the audio format of the current
+	 * song with SetLimit(), while the memory is reserved for
+	 * GetSize() chunks once.
+	 */
+	std::atomic_uint limit;
+
 public:
 	/**
 	 * Creates a new #MusicBuffer object.
 	 *
 	 * @param num_chunks the number of #music_chunk reserved in
 	 * this buffer
+	 * @param chunk_size the capacity of each chunk in bytes
+	 * @param policy how to allocate the memory; all policies
+	 * except #HugePolicy::LAZY make sure that the audio threads
+	 * never page fault on the buffer
 	 */
-	MusicBuffer(unsigned num_chunks);
+	MusicBuffer(unsigned num_chunks, size_t chunk_size=DEFAULT_CHUNK_SIZE,
+		    HugePolicy policy=HugePolicy::LAZY);
+
+	~MusicBuffer();
+
+	MusicBuffer(const MusicBuffer &) = delete;
+	MusicBuffer &operator=(const MusicBuffer &) = delete;
 
 #ifndef NDEBUG
 	/**
 	 * Check whether the buffer is empty.  This call is not
-	 * protected with the mutex, and may only be used while this
-	 * object is inaccessible to other threads.
+	 * synchronized, and may only be used while this object is
+	 * inaccessible to other threads.
 	 */
 	bool IsEmptyUnsafe() const {
 		return buffer.IsEmpty();
@@ -64,15 +97,56 @@ public:
 		return buffer.GetCapacity();
 	}
 
+	/**
+	 * Returns the capacity of each chunk in bytes.
+	 */
+	gcc_pure
+	size_t GetChunkSize() const {
+		return chunk_size;
+	}
+
+	/**
+	 * Returns the number of chunks which may be in use at a time,
+	 * see SetLimit().
+	 */
+	gcc_pure
+	unsigned GetLimit() const {
+		return limit.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Changes the number of chunks which may be in use at a time.
+	 * Lowering it below the number of chunks currently in use
+	 * does not affect those; Allocate() just fails until enough
+	 * of them have been returned.
+	 *
+	 * @param _limit a value between 1 and GetSize()
+	 */
+	void SetLimit(unsigned _limit) {
+		assert(_limit > 0);
+		assert(_limit <= GetSize());
+
+		limit.store(_limit, std::memory_order_relaxed);
+	}
+
 	/**
 	 * Allocates a chunk from the buffer.  When it is not used anymore,
 	 * call Return().
 	 *
 	 * @return an empty chunk or nullptr if there are no chunks
-	 * available
+	 * available, or if the limit (see SetLimit()) has been
+	 * reached
 	 */
 	music_chunk *Allocate();
 
+	/**
+	 * Like Allocate(), but ignores the limit.  This is for the
+	 * few chunks the player thread needs for itself (e.g. for
+	 * silence), which must not fail only because the limit has
+	 * just been lowered.
+	 */
+	music_chunk *AllocateBeyondLimit();
+
 	/**
 	 * Returns a chunk to the buffer.  It can be reused by
 	 * Allocate() then.
@@ -55,7 +55,11 @@ music_chunk::Write(const AudioFormat af,
 	}
 
 	const size_t frame_size = af.GetFrameSize();
-	size_t num_frames = (sizeof(data) - length) / frame_size;
+	const size_t fill_size = GetFillSize(af);
+	if (length >= fill_size)
+		return WritableBuffer<void>::Null();
+
+	size_t num_frames = (fill_size - length) / frame_size;
 	if (num_frames == 0)
 		return WritableBuffer<void>::Null();
 
@@ -71,10 +75,10 @@ music_chunk::Expand(const AudioFormat af, size_t _length)
 {
 	const size_t frame_size = af.GetFrameSize();
 
-	assert(length + _length <= sizeof(data));
+	assert(length + _length <= capacity);
 	assert(audio_format == af);
 
 	length += _length;
 
-	return length + frame_size > sizeof(data);
+	return length + frame_size > GetFillSize(af);
 }
@@ -21,18 +21,27 @@
 #define MPD_MUSIC_CHUNK_HXX
 
 #include "ReplayGainInfo.hxx"
+#include "AudioFormat.hxx"
 #include "util/WritableBuffer.hxx"
 
-#ifndef NDEBUG
-#include "AudioFormat.hxx"
-#endif
+#include <algorithm>
+#include <atomic>
 
 #include <stdint.h>
 #include <stddef.h>
 
-static constexpr size_t CHUNK_SIZE = 4096;
+/**
+ * The default capacity of a #music_chunk in bytes.
+ */
+static constexpr size_t DEFAULT_CHUNK_SIZE = 4096;
+
+/**
+ * Chunks which are larger than #DEFAULT_CHUNK_SIZE are filled only
+ * up to this duration, so low-rate formats are not delayed by huge
+ * chunks.
+ */
+static constexpr unsigned CHUNK_TIME_MS = 20;
 
-struct AudioFormat;
 struct Tag;
 
 /**
@@ -40,8 +49,12 @@ struct Tag;
  * MusicPipe::Push() caller.
  */
 struct music_chunk {
-	/** the next chunk in a linked list */
-	struct music_chunk *next;
+	/**
+	 * The next chunk in a linked list.  This is atomic because
+	 * #MusicPipe links new chunks while other threads walk the
+	 * list.
+	 */
+	std::atomic<struct music_chunk *> next;
 
 	/**
 	 * An optional chunk which should be mixed into this chunk.
@@ -56,7 +69,10 @@ struct music_chunk {
 	float mix_ratio;
 
 	/** number of bytes stored in this chunk */
-	uint16_t length;
+	uint32_t length;
+
+	/** the size of the #data buffer */
+	uint32_t capacity;
 
 	/** current bit rate of the source file */
 	uint16_t bit_rate;
@@ -85,18 +101,22 @@ struct music_chunk {
 	 */
 	unsigned replay_gain_serial;
 
-	/** the data (probably PCM) */
-	uint8_t data[CHUNK_SIZE];
+	/**
+	 * The data (probably PCM).  The buffer is owned by the
+	 * #MusicBuffer.
+	 */
+	uint8_t *data;
 
 #ifndef NDEBUG
 	AudioFormat audio_format;
 #endif
 
-	music_chunk()
+	music_chunk(uint8_t *_data, size_t _capacity)
 		:other(nullptr),
-		 length(0),
+		 length(0), capacity(_capacity),
 		 tag(nullptr),
-		 replay_gain_serial(0) {}
+		 replay_gain_serial(0),
+		 data(_data) {}
 
 	~music_chunk();
 
@@ -113,6 +133,35 @@ struct music_chunk {
 	bool CheckFormat(AudioFormat audio_format) const;
 #endif
 
+	/**
+	 * Returns the number of bytes of the given audio format which
+	 * fill this chunk.  This is the capacity (rounded down to
+	 * whole frames), but large chunks are limited to
+	 * #CHUNK_TIME_MS.
+	 */
+	gcc_pure
+	size_t GetFillSize(AudioFormat af) const {
+		return CalcFillSize(af, capacity);
+	}
+
+	/**
+	 * Like GetFillSize(), but for an arbitrary chunk capacity.
+	 */
+	gcc_pure
+	static size_t CalcFillSize(AudioFormat af, size_t capacity) {
+		const size_t frame_size = af.GetFrameSize();
+
+		size_t size = capacity;
+		if (size > DEFAULT_CHUNK_SIZE) {
+			const size_t time_size =
+				af.GetTimeToSize() * CHUNK_TIME_MS / 1000;
+			size = std::min(size,
+					std::max(time_size, DEFAULT_CHUNK_SIZE));
+		}
+
+		return size / frame_size * frame_size;
+	}
+
 	/**
 	 * Prepares appending to the music chunk.  Returns a buffer
 	 * where you may write into.  After you are finished, call
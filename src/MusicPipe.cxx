@@ -27,9 +27,7 @@
 bool
 MusicPipe::Contains(const music_chunk *chunk) const
 {
-	const ScopeLock protect(mutex);
-
-	for (const struct music_chunk *i = head; i != nullptr; i = i->next)
+	for (const struct music_chunk *i = Peek(); i != nullptr; i = i->next)
 		if (i == chunk)
 			return true;
 
@@ -41,33 +39,44 @@ MusicPipe::Contains(const music_chunk *chunk) const
 music_chunk *
 MusicPipe::Shift()
 {
-	const ScopeLock protect(mutex);
-
-	music_chunk *chunk = head;
-	if (chunk != nullptr) {
-		assert(!chunk->IsEmpty());
+	music_chunk *chunk = head.load(std::memory_order_acquire);
+	if (chunk == nullptr)
+		return nullptr;
 
-		head = chunk->next;
-		--size;
-
-		if (head == nullptr) {
-			assert(size == 0);
-			assert(tail_r == &chunk->next);
+	assert(!chunk->IsEmpty());
 
-			tail_r = &head;
+	music_chunk *next = chunk->next.load(std::memory_order_acquire);
+	if (next == nullptr) {
+		/* this may be the last chunk: try to mark the pipe
+		   empty */
+		music_chunk *expected = chunk;
+		if (tail.compare_exchange_strong(expected, nullptr,
+						 std::memory_order_acq_rel)) {
+			/* a Push() which comes after this has
+			   already set the new head; don't overwrite
+			   it */
+			expected = chunk;
+			head.compare_exchange_strong(expected, nullptr,
+						     std::memory_order_acq_rel);
 		} else {
-			assert(size > 0);
-			assert(tail_r != &chunk->next);
+			/* the producer has just replaced the tail,
+			   but has not linked the new chunk yet; wait
+			   until Push() returns */
+			const ScopeLock protect(push_mutex);
+			next = chunk->next.load(std::memory_order_acquire);
+			assert(next != nullptr);
+			head.store(next, std::memory_order_release);
 		}
+	} else
+		head.store(next, std::memory_order_release);
 
-#ifndef NDEBUG
-		/* poison the "next" reference */
-		chunk->next = (music_chunk *)(void *)0x01010101;
+	assert(size > 0);
+	--size;
 
-		if (size == 0)
-			audio_format.Clear();
+#ifndef NDEBUG
+	/* poison the "next" reference */
+	chunk->next = (music_chunk *)(void *)0x01010101;
 #endif
-	}
 
 	return chunk;
 }
@@ -87,20 +96,31 @@ MusicPipe::Push(music_chunk *chunk)
 	assert(!chunk->IsEmpty());
 	assert(chunk->length == 0 || chunk->audio_format.IsValid());
 
-	const ScopeLock protect(mutex);
+	chunk->next.store(nullptr, std::memory_order_relaxed);
+
+	/* count the chunk before it becomes visible, so Shift()
+	   never decrements a size of zero; IsEmpty() does not depend
+	   on it */
+	++size;
+
+	const ScopeLock protect(push_mutex);
+
+	music_chunk *prev = tail.exchange(chunk, std::memory_order_acq_rel);
+
+#ifndef NDEBUG
+	if (prev == nullptr)
+		/* the pipe was empty */
+		audio_format.Clear();
 
-	assert(size > 0 || !audio_format.IsDefined());
 	assert(!audio_format.IsDefined() ||
 	       chunk->CheckFormat(audio_format));
 
-#ifndef NDEBUG
 	if (!audio_format.IsDefined() && chunk->length > 0)
 		audio_format = chunk->audio_format;
 #endif
 
-	chunk->next = nullptr;
-	*tail_r = chunk;
-	tail_r = &chunk->next;
-
-	++size;
+	if (prev == nullptr)
+		head.store(chunk, std::memory_order_release);
+	else
+		prev->next.store(chunk, std::memory_order_release);
 }
@@ -27,6 +27,8 @@
 #include "AudioFormat.hxx"
 #endif
 
+#include <atomic>
+
 #include <assert.h>
 
 struct music_chunk;
@@ -35,19 +37,38 @@ class MusicBuffer;
 /**
  * A queue of #music_chunk objects.  One party appends chunks at the
  * tail, and the other consumes them from the head.
+ *
+ * This is a single-producer/single-consumer queue: Push() may be
+ * called by one thread while Shift() is called by another.  Shift()
+ * is lock-free unless it removes the last chunk while a Push() is in
+ * progress; then it waits for #push_mutex instead of spinning on a
+ * producer which may have been preempted.  The chunks are linked
+ * with their #music_chunk::next attribute, which allows other
+ * threads (the audio outputs) to walk the queue, as long as the
+ * consumer does not shift chunks they are still using.
  */
 class MusicPipe {
-	/** the first chunk */
-	music_chunk *head;
+	/**
+	 * The first chunk.  Written only by the consumer, except
+	 * when the pipe is empty.
+	 */
+	std::atomic<music_chunk *> head;
 
-	/** a pointer to the tail of the chunk */
-	music_chunk **tail_r;
+	/**
+	 * The last chunk, or nullptr if the pipe is empty.  Written
+	 * by the producer; the consumer resets it when it removes
+	 * the last chunk.
+	 */
+	std::atomic<music_chunk *> tail;
 
 	/** the current number of chunks */
-	unsigned size;
+	std::atomic_uint size;
 
-	/** a mutex which protects #head and #tail_r */
-	mutable Mutex mutex;
+	/**
+	 * Held by Push() while it links a new chunk.  It is never
+	 * contended, except in the rare case described above.
+	 */
+	Mutex push_mutex;
 
 #ifndef NDEBUG
 	AudioFormat audio_format;
@@ -58,7 +79,7 @@ public:
 	 * Creates a new #MusicPipe object.  It is empty.
 	 */
 	MusicPipe()
-		:head(nullptr), tail_r(&head), size(0) {
+		:head(nullptr), tail(nullptr), size(0) {
 #ifndef NDEBUG
 		audio_format.Clear();
 #endif
@@ -69,7 +90,7 @@ public:
 	 */
 	~MusicPipe() {
 		assert(head == nullptr);
-		assert(tail_r == &head);
+		assert(tail == nullptr);
 	}
 
 #ifndef NDEBUG
@@ -85,6 +106,7 @@ public:
 
 	/**
 	 * Checks if the specified chunk is enqueued in the music pipe.
+	 * This may only be called by the consumer.
 	 */
 	gcc_pure
 	bool Contains(const music_chunk *chunk) const;
@@ -96,11 +118,12 @@ public:
 	 */
 	gcc_pure
 	const music_chunk *Peek() const {
-		return head;
+		return head.load(std::memory_order_acquire);
 	}
 
 	/**
 	 * Removes the first chunk from the head, and returns it.
+	 * This may only be called by the consumer.
 	 */
 	music_chunk *Shift();
 
@@ -112,21 +135,29 @@ public:
 	void Clear(MusicBuffer &buffer);
 
 	/**
-	 * Pushes a chunk to the tail of the pipe.
+	 * Pushes a chunk to the tail of the pipe.  This may only be
+	 * called by the producer.  It never blocks.
 	 */
 	void Push(music_chunk *chunk);
 
 	/**
-	 * Returns the number of chunks currently in this pipe.
+	 * Returns the number of chunks currently in this pipe.  While
+	 * a Push() is in progress, this may include the new chunk
+	 * before it can be shifted.
 	 */
 	gcc_pure
 	unsigned GetSize() const {
-		return size;
+		return size.load(std::memory_order_relaxed);
 	}
 
+	/**
+	 * Is the pipe empty?  Unlike GetSize(), this checks the
+	 * chunks which are linked already, so if the consumer sees
+	 * false, its next Shift() call returns a chunk.
+	 */
 	gcc_pure
 	bool IsEmpty() const {
-		return GetSize() == 0;
+		return Peek() == nullptr;
 	}
 };
 
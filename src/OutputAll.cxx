@@ -21,6 +21,7 @@
 #include "OutputAll.hxx"
 #include "PlayerControl.hxx"
 #include "OutputInternal.hxx"
+#include "OutputPlugin.hxx"
 #include "OutputControl.hxx"
 #include "OutputError.hxx"
 #include "MusicBuffer.hxx"
@@ -28,6 +29,9 @@
 #include "MusicChunk.hxx"
 #include "system/FatalError.hxx"
 #include "util/Error.hxx"
+#include "util/CircularBuffer.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
 #include "ConfigData.hxx"
 #include "ConfigGlobal.hxx"
 #include "ConfigOption.hxx"
@@ -35,6 +39,8 @@
 
 #include <glib.h>
 
+#include <atomic>
+
 #include <assert.h>
 #include <string.h>
 
@@ -54,6 +60,12 @@ static MusicBuffer *g_music_buffer;
  */
 static MusicPipe *g_mp;
 
+/**
+ * The number of chunks pushed into #g_mp so far; see
+ * audio_output::taken_chunks.
+ */
+static std::atomic_uint pushed_chunks;
+
 /**
  * The "elapsed_time" stamp of the most recently finished chunk.
  */
@@ -293,6 +305,7 @@ audio_output_all_play(struct music_chunk *chunk, Error &error)
 	}
 
 	g_mp->Push(chunk);
+	pushed_chunks.fetch_add(1, std::memory_order_relaxed);
 
 	for (i = 0; i < num_audio_outputs; ++i)
 		audio_output_play(audio_outputs[i]);
@@ -391,6 +404,104 @@ chunk_is_consumed(const struct music_chunk *chunk)
 	return true;
 }
 
+/**
+ * Has this output run out of data, i.e. it has consumed the whole
+ * pipe, and its ring buffer (if any) is running low?
+ */
+static bool
+audio_output_is_starving(const struct audio_output *ao,
+			 const struct music_chunk *tail)
+{
+	return ao->open && !ao->ring_waiting &&
+		chunk_is_consumed_in(ao, tail) &&
+		(ao->ring == nullptr ||
+		 ao->ring->GetSize() <= ao->ring->GetCapacity() / 4);
+}
+
+/**
+ * Can this output skip the given chunk?  That is the case if it has
+ * a ring buffer which is full, and it is waiting for space between
+ * two chunks.
+ */
+static bool
+audio_output_is_stalled(const struct audio_output *ao,
+			const struct music_chunk *chunk)
+{
+	return ao->open && ao->ring_waiting &&
+		(ao->chunk == nullptr || ao->chunk_finished) &&
+		!chunk_is_consumed_in(ao, chunk);
+}
+
+/**
+ * The chunk at the head of the pipe (#g_mp) has not been consumed
+ * yet.  If the outputs holding it back are merely waiting for space
+ * in their ring buffers while another output is starving, let them
+ * skip all chunks in the pipe, so they cannot hold back the others
+ * any longer.
+ *
+ * @return true if at least one output has skipped chunks
+ */
+static bool
+skip_stalled_outputs(const struct music_chunk *head)
+{
+	bool any_waiting = false;
+	for (unsigned i = 0; i < num_audio_outputs && !any_waiting; ++i) {
+		struct audio_output *ao = audio_outputs[i];
+
+		const ScopeLock protect(ao->mutex);
+		any_waiting = ao->ring_waiting;
+	}
+
+	if (!any_waiting)
+		/* the quick path: no output is waiting for ring
+		   buffer space */
+		return false;
+
+	const struct music_chunk *tail = head;
+	while (tail->next != nullptr)
+		tail = tail->next;
+
+	bool starving = false;
+	for (unsigned i = 0; i < num_audio_outputs && !starving; ++i) {
+		struct audio_output *ao = audio_outputs[i];
+
+		const ScopeLock protect(ao->mutex);
+		starving = audio_output_is_starving(ao, tail);
+	}
+
+	if (!starving)
+		return false;
+
+	bool skipped = false;
+	for (unsigned i = 0; i < num_audio_outputs; ++i) {
+		struct audio_output *ao = audio_outputs[i];
+
+		const ScopeLock protect(ao->mutex);
+		if (!audio_output_is_stalled(ao, head))
+			continue;
+
+		unsigned n = 1;
+		for (const struct music_chunk *c = ao->chunk != nullptr
+			     ? ao->chunk->next.load()
+			     : head;
+		     c != tail; c = c->next)
+			++n;
+
+		ao->chunk = tail;
+		ao->chunk_finished = true;
+		ao->ring_waiting = false;
+		ao->ring_drops += n;
+		ao->taken_chunks += n;
+		skipped = true;
+
+		FormatDebug(output_domain,
+			    "\"%s\" [%s] is too slow, skipped %u chunks",
+			    ao->name, ao->plugin->name, n);
+	}
+
+	return skipped;
+}
+
 /**
  * There's only one chunk left in the pipe (#g_mp), and all audio
  * outputs have consumed it already.  Clear the reference.
@@ -434,7 +545,9 @@ audio_output_all_check(void)
 	while ((chunk = g_mp->Peek()) != nullptr) {
 		assert(!g_mp->IsEmpty());
 
-		if (!chunk_is_consumed(chunk))
+		if (!chunk_is_consumed(chunk) &&
+		    (!skip_stalled_outputs(chunk) ||
+		     !chunk_is_consumed(chunk)))
 			/* at least one output is not finished playing
 			   this chunk */
 			return g_mp->GetSize();
@@ -587,8 +700,83 @@ audio_output_all_song_border(void)
 	audio_output_all_elapsed_time = 0.0;
 }
 
+/**
+ * Returns the duration of the audio in the output's #ring, i.e. what
+ * it has taken from the pipe but not yet played.  Caller must lock
+ * the mutex.
+ */
+gcc_pure
+static double
+ao_ring_time(const struct audio_output *ao)
+{
+	return ao->open && ao->ring != nullptr
+		? (ao->ring->GetSize() + ao->ring_rest_size) /
+		ao->out_audio_format.GetTimeToSize()
+		: 0;
+}
+
 float
 audio_output_all_get_elapsed_time(void)
 {
-	return audio_output_all_elapsed_time;
+	float elapsed = audio_output_all_elapsed_time;
+	if (elapsed <= 0)
+		return elapsed;
+
+	/* an output with a ring finishes a chunk when it has copied
+	   it into the ring; subtract what it has not played yet */
+	double ring_time = 0;
+	for (unsigned i = 0; i < num_audio_outputs; ++i) {
+		struct audio_output *ao = audio_outputs[i];
+
+		const ScopeLock protect(ao->mutex);
+		const double t = ao_ring_time(ao);
+		if (t > ring_time)
+			ring_time = t;
+	}
+
+	elapsed -= ring_time;
+	return elapsed > 0 ? elapsed : 0;
+}
+
+unsigned
+audio_output_all_get_pushed(void)
+{
+	return pushed_chunks.load(std::memory_order_relaxed);
+}
+
+AudioOutputStats
+audio_output_get_stats(struct audio_output *ao)
+{
+	AudioOutputStats stats;
+
+	const ScopeLock protect(ao->mutex);
+
+	stats.drops = ao->ring_drops;
+	stats.pinned = 0;
+	stats.lag_ms = 0;
+	stats.play_rate = ao->play_duration > 0
+		? ao->play_calls / ao->play_duration
+		: 0;
+
+	if (!ao->open)
+		return stats;
+
+	/* the difference is "negative" for a moment when the output
+	   thread has computed its counter while a chunk was being
+	   pushed */
+	const unsigned pinned =
+		audio_output_all_get_pushed() - ao->taken_chunks;
+	if (pinned < (1u << 31))
+		stats.pinned = pinned;
+
+	double lag = ao_ring_time(ao);
+
+	if (stats.pinned > 0 && g_music_buffer != nullptr)
+		lag += stats.pinned *
+			music_chunk::CalcFillSize(ao->in_audio_format,
+						  g_music_buffer->GetChunkSize()) /
+			ao->in_audio_format.GetTimeToSize();
+
+	stats.lag_ms = unsigned(lag * 1000 + 0.5);
+	return stats;
 }
@@ -164,11 +164,55 @@ audio_output_all_song_border(void);
 
 /**
  * Returns the "elapsed_time" stamp of the most recently finished
- * chunk.  A negative value is returned when no chunk has been
+ * chunk, minus the audio which outputs with a ring buffer have not
+ * played yet.  A negative value is returned when no chunk has been
  * finished yet.
+ *
+ * Note that the song border (see audio_output_all_song_border()) is
+ * still reached when the last chunk of a song has been copied into
+ * the rings, i.e. up to "ring_buffer_time" before it is audible.
  */
-gcc_pure
 float
 audio_output_all_get_elapsed_time(void);
 
+/**
+ * Returns the number of chunks which have been pushed into the
+ * #MusicPipe so far.  The counter wraps around.
+ */
+gcc_pure
+unsigned
+audio_output_all_get_pushed(void);
+
+struct AudioOutputStats {
+	/**
+	 * How far (in milliseconds) this output is behind the
+	 * player: the audio in its ring buffer plus the chunks it has
+	 * not taken from the #MusicPipe yet.
+	 */
+	unsigned lag_ms;
+
+	/**
+	 * The number of chunks this output has skipped because it
+	 * was too slow.
+	 */
+	unsigned drops;
+
+	/**
+	 * The number of chunks in the #MusicPipe which this output
+	 * has not taken yet, i.e. which cannot be returned to the
+	 * #MusicBuffer because of it.
+	 */
+	unsigned pinned;
+
+	/**
+	 * The number of play() calls on the plugin per second of
+	 * audio, i.e. roughly the number of system calls it causes.
+	 */
+	float play_rate;
+};
+
+gcc_pure
+AudioOutputStats
+audio_output_get_stats(struct audio_output *ao);
+
 #endif
@@ -31,6 +31,7 @@ ao_base_finish(struct audio_output *ao)
 	assert(!ao->open);
 	assert(ao->fail_timer == nullptr);
 	assert(!ao->thread.IsDefined());
+	assert(ao->ring == nullptr);
 
 	if (ao->mixer != nullptr)
 		mixer_free(ao->mixer);
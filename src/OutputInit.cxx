@@ -175,6 +175,19 @@ ao_base_init(struct audio_output *ao,
 	ao->woken_for_play = false;
 	ao->fail_timer = nullptr;
 
+	ao->ring_time = param.GetBlockValue("ring_buffer_time", 0u);
+	ao->ring = nullptr;
+	ao->ring_chunk_size = 0;
+	ao->ring_rest = nullptr;
+	ao->ring_rest_size = 0;
+	ao->ring_waiting = false;
+	ao->ring_drops = 0;
+	ao->taken_chunks = 0;
+
+	ao->batch_time = param.GetBlockValue("batch_time", 0u);
+	ao->play_calls = 0;
+	ao->play_duration = 0;
+
 	/* set up the filter chain */
 
 	ao->filter = filter_chain_new();
@@ -27,7 +27,9 @@
 #include "thread/Thread.hxx"
 
 #include <time.h>
+#include <stdint.h>
 
+template<typename T> class CircularBuffer;
 class Error;
 class Filter;
 class MusicPipe;
@@ -173,6 +175,20 @@ struct audio_output {
 	 */
 	PcmBuffer cross_fade_buffer;
 
+	/**
+	 * The configured "batch_time" in milliseconds: up to this
+	 * much audio from consecutive chunks is passed through the
+	 * filter chain and to the plugin's play() method at once.  0
+	 * means one chunk at a time.
+	 */
+	unsigned batch_time;
+
+	/**
+	 * The buffer which collects the chunks of one batch before
+	 * the filter chain is applied.
+	 */
+	PcmBuffer batch_buffer;
+
 	/**
 	 * The filter object of this audio output.  This is an
 	 * instance of chain_filter_plugin.
@@ -258,6 +274,77 @@ struct audio_output {
 	 * Has the output finished playing #chunk?
 	 */
 	bool chunk_finished;
+
+	/**
+	 * The configured "ring_buffer_time" in milliseconds.  0
+	 * means this output plays directly from the shared
+	 * #MusicPipe, without a #ring.
+	 */
+	unsigned ring_time;
+
+	/**
+	 * Filtered PCM data in #out_audio_format which has not been
+	 * played yet.  The output thread copies each chunk into this
+	 * buffer after running the filters, which allows the chunk to
+	 * be returned to the #MusicBuffer right away, even if the
+	 * device is slow.  Allocated while the device is open (and
+	 * #ring_time is non-zero), nullptr otherwise.
+	 *
+	 * Only the output thread accesses it, and it modifies it only
+	 * while holding #mutex.
+	 */
+	CircularBuffer<uint8_t> *ring;
+
+	/**
+	 * The largest filtered chunk copied into #ring so far.  The
+	 * next chunk is only taken from the pipe if there is at least
+	 * this much space.
+	 */
+	size_t ring_chunk_size;
+
+	/**
+	 * The part of a filtered chunk which did not fit into #ring
+	 * because a command interrupted the output thread.  It is
+	 * copied into #ring before the next chunk, unless the command
+	 * was CANCEL or CLOSE.  Protected by #mutex.
+	 */
+	const uint8_t *ring_rest;
+	size_t ring_rest_size;
+
+	/**
+	 * The buffer which #ring_rest points into.
+	 */
+	PcmBuffer ring_rest_buffer;
+
+	/**
+	 * Is the output thread waiting for space in #ring while there
+	 * are more chunks in the pipe?  In this state, it may be
+	 * skipped by audio_output_all_check() if it holds back the
+	 * other outputs.  Protected by #mutex.
+	 */
+	bool ring_waiting;
+
+	/**
+	 * The number of chunks which were skipped, because this
+	 * output's #ring was full and other outputs were starving.
+	 * Protected by #mutex.
+	 */
+	unsigned ring_drops;
+
+	/**
+	 * The number of chunks this output has taken from the pipe,
+	 * compared with audio_output_all_get_pushed() to find out how
+	 * many chunks it is still holding back.  Protected by #mutex.
+	 */
+	unsigned taken_chunks;
+
+	/**
+	 * The number of successful play() calls on the plugin, and the
+	 * amount of audio (in seconds) played by them.  Protected by
+	 * #mutex.
+	 */
+	uint64_t play_calls;
+	double play_duration;
 };
 
 /**
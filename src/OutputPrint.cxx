@@ -34,12 +34,19 @@ printAudioDevices(Client &client)
 	const unsigned n = audio_output_count();
 
 	for (unsigned i = 0; i < n; ++i) {
-		const struct audio_output *ao = audio_output_get(i);
+		struct audio_output *ao = audio_output_get(i);
+		const AudioOutputStats stats = audio_output_get_stats(ao);
 
 		client_printf(client,
 			      "outputid: %i\n"
 			      "outputname: %s\n"
-			      "outputenabled: %i\n",
-			      i, ao->name, ao->enabled);
+			      "outputenabled: %i\n"
+			      "outputlag: %u\n"
+			      "outputdrops: %u\n"
+			      "outputpinned: %u\n"
+			      "outputplayrate: %.1f\n",
+			      i, ao->name, ao->enabled,
+			      stats.lag_ms, stats.drops, stats.pinned,
+			      (double)stats.play_rate);
 	}
 }
@@ -22,6 +22,7 @@
 #include "OutputInternal.hxx"
 #include "OutputAPI.hxx"
 #include "OutputError.hxx"
+#include "OutputAll.hxx"
 #include "pcm/PcmMix.hxx"
 #include "notify.hxx"
 #include "FilterInternal.hxx"
@@ -31,12 +32,17 @@
 #include "MusicPipe.hxx"
 #include "MusicChunk.hxx"
 #include "system/FatalError.hxx"
+#include "system/ThreadFaults.hxx"
 #include "util/Error.hxx"
+#include "util/CircularBuffer.hxx"
 #include "Log.hxx"
 #include "Compiler.h"
 
 #include <glib.h>
 
+#include <algorithm>
+#include <string>
+
 #include <assert.h>
 #include <string.h>
 
@@ -125,6 +131,39 @@ ao_filter_close(struct audio_output *ao)
 	ao->filter->Close();
 }
 
+/**
+ * Returns the maximum number of bytes passed to the plugin's play()
+ * method at a time when playing from the #ring: #CHUNK_TIME_MS, or
+ * the #batch_time if that is larger.
+ */
+gcc_pure
+static size_t
+ao_ring_play_size(AudioFormat af, unsigned batch_time)
+{
+	const size_t size = music_chunk::CalcFillSize(af, SIZE_MAX);
+	const size_t frame_size = af.GetFrameSize();
+	const size_t batch_size =
+		af.GetTimeToSize() * batch_time / 1000 / frame_size * frame_size;
+	return std::max(size, batch_size);
+}
+
+/**
+ * Calculates the capacity of the #ring in bytes.  It is a multiple of
+ * the frame size, and has room for at least two writes.
+ */
+gcc_pure
+static size_t
+ao_ring_capacity(AudioFormat af, unsigned ms, unsigned batch_time)
+{
+	const size_t frame_size = af.GetFrameSize();
+	const size_t size = std::max(size_t(af.GetTimeToSize() * ms / 1000),
+				     2 * ao_ring_play_size(af, batch_time));
+	return size / frame_size * frame_size;
+}
+
+static void
+ao_ring_flush(struct audio_output *ao);
+
 static void
 ao_open(struct audio_output *ao)
 {
@@ -188,6 +227,20 @@ ao_open(struct audio_output *ao)
 
 	ao->open = true;
 
+	if (ao->ring_time > 0) {
+		ao->ring = new CircularBuffer<uint8_t>(ao_ring_capacity(ao->out_audio_format,
+									 ao->ring_time,
+									 ao->batch_time));
+		ao->ring_chunk_size = 0;
+		ao->ring_rest_size = 0;
+	}
+
+	ao->ring_waiting = false;
+
+	/* the chunks which are already in the pipe are not ours */
+	ao->taken_chunks = audio_output_all_get_pushed() -
+		ao->pipe->GetSize();
+
 	FormatDebug(output_domain,
 		    "opened plugin=%s name=\"%s\" audio_format=%s",
 		    ao->plugin->name, ao->name,
@@ -204,6 +257,17 @@ ao_close(struct audio_output *ao, bool drain)
 {
 	assert(ao->open);
 
+	if (drain)
+		ao_ring_flush(ao);
+
+	if (!ao->open)
+		/* failed while flushing the ring */
+		return;
+
+	delete ao->ring;
+	ao->ring = nullptr;
+	ao->ring_rest_size = 0;
+
 	ao->pipe = nullptr;
 
 	ao->chunk = nullptr;
@@ -242,6 +306,10 @@ ao_reopen_filter(struct audio_output *ao)
 		   but we cannot call this function because we must
 		   not call filter_close(ao->filter) again */
 
+		delete ao->ring;
+		ao->ring = nullptr;
+		ao->ring_rest_size = 0;
+
 		ao->pipe = nullptr;
 
 		ao->chunk = nullptr;
@@ -344,9 +412,13 @@ ao_chunk_data(struct audio_output *ao, const struct music_chunk *chunk,
 	return data;
 }
 
+/**
+ * Applies replay gain and cross-fading to a chunk.  The result is
+ * still in #in_audio_format.
+ */
 static const void *
-ao_filter_chunk(struct audio_output *ao, const struct music_chunk *chunk,
-		size_t *length_r)
+ao_mix_chunk(struct audio_output *ao, const struct music_chunk *chunk,
+	     size_t *length_r)
 {
 	size_t length;
 	const void *data = ao_chunk_data(ao, chunk, ao->replay_gain_filter,
@@ -409,20 +481,162 @@ ao_filter_chunk(struct audio_output *ao, const struct music_chunk *chunk,
 		length = other_length;
 	}
 
-	/* apply filter chain */
+	*length_r = length;
+	return data;
+}
 
+static const void *
+ao_chain_filter(struct audio_output *ao, const void *data, size_t length,
+		size_t *length_r)
+{
 	Error error;
-	data = ao->filter->FilterPCM(data, length, &length, error);
-	if (data == nullptr) {
+	data = ao->filter->FilterPCM(data, length, length_r, error);
+	if (data == nullptr)
 		FormatError(error, "\"%s\" [%s] failed to filter",
 			    ao->name, ao->plugin->name);
+
+	return data;
+}
+
+static const void *
+ao_filter_chunk(struct audio_output *ao, const struct music_chunk *chunk,
+		size_t *length_r)
+{
+	size_t length;
+	const void *data = ao_mix_chunk(ao, chunk, &length);
+	if (data == nullptr)
 		return nullptr;
+
+	if (length == 0) {
+		/* empty chunk, nothing to do */
+		*length_r = 0;
+		return data;
 	}
 
-	*length_r = length;
-	return data;
+	return ao_chain_filter(ao, data, length, length_r);
 }
 
+/**
+ * Can this chunk be appended to the current batch?  A chunk with a
+ * tag starts a new batch, because the tag must be sent to the plugin
+ * before its audio.
+ */
+static bool
+ao_batch_accepts(const struct audio_output *ao,
+		 const struct music_chunk *chunk)
+{
+	return !chunk->IsEmpty() && !(ao->tags && chunk->tag != nullptr);
+}
+
+/**
+ * Like ao_filter_chunk(), but appends the chunks following @first
+ * which are already in the pipe, up to #batch_time, and passes them
+ * through the filter chain at once.  Replay gain and cross-fading are
+ * still applied to each chunk separately.
+ *
+ * @param last_r the last chunk of the batch is returned here
+ */
+static const void *
+ao_filter_batch(struct audio_output *ao, const struct music_chunk *first,
+		const struct music_chunk **last_r, size_t *length_r)
+{
+	*last_r = first;
+
+	if (ao->batch_time == 0 || first->next == nullptr)
+		return ao_filter_chunk(ao, first, length_r);
+
+	/* determine the chunks of this batch and an upper bound for
+	   the mixed size */
+
+	const size_t budget = ao->in_audio_format.GetTimeToSize() *
+		ao->batch_time / 1000;
+	const struct music_chunk *last = first;
+	size_t max_size = first->length;
+	if (first->other != nullptr)
+		max_size = std::max(max_size, size_t(first->other->length));
+
+	for (const struct music_chunk *c = first->next;
+	     c != nullptr && max_size < budget && ao_batch_accepts(ao, c);
+	     c = c->next) {
+		last = c;
+		max_size += c->other != nullptr
+			? std::max(c->length, c->other->length)
+			: c->length;
+	}
+
+	if (last == first)
+		return ao_filter_chunk(ao, first, length_r);
+
+	uint8_t *const dest = (uint8_t *)ao->batch_buffer.Get(max_size);
+	size_t length = 0;
+
+	for (const struct music_chunk *c = first;; c = c->next) {
+		size_t nbytes;
+		const void *data = ao_mix_chunk(ao, c, &nbytes);
+		if (data == nullptr)
+			return nullptr;
+
+		assert(length + nbytes <= max_size);
+		memcpy(dest + length, data, nbytes);
+		length += nbytes;
+
+		if (c == last)
+			break;
+	}
+
+	*last_r = last;
+
+	if (length == 0) {
+		*length_r = 0;
+		return dest;
+	}
+
+	return ao_chain_filter(ao, dest, length, length_r);
+}
+
+/**
+ * Updates the play() statistics after the plugin has played the
+ * specified number of bytes.
+ */
+static void
+ao_count_play(struct audio_output *ao, size_t nbytes)
+{
+	++ao->play_calls;
+	ao->play_duration += nbytes / ao->out_audio_format.GetTimeToSize();
+}
+
+/**
+ * Moves ao->chunk forward through a batch, to the chunk which
+ * contains the specified input position.  The chunks before it are
+ * finished and may be returned to the buffer.
+ *
+ * @param last the last chunk of the batch
+ * @param done_r the input size of the chunks before ao->chunk; is
+ * updated by this function
+ * @param position the input position (relative to the start of the
+ * batch) which has been played
+ */
+static void
+ao_advance_batch(struct audio_output *ao, const struct music_chunk *last,
+		 size_t *done_r, size_t position)
+{
+	while (ao->chunk != last &&
+	       *done_r + ao->chunk->length <= position) {
+		*done_r += ao->chunk->length;
+		ao->chunk = ao->chunk->next;
+		++ao->taken_chunks;
+	}
+}
+
+/**
+ * Plays a chunk, and possibly (see #batch_time) the chunks following
+ * it.  Afterwards, ao->chunk points to the last chunk which was
+ * played.  If a command interrupts a batch, ao->chunk points to the
+ * chunk which was being played, and the following chunks of the
+ * batch are played after the command.
+ *
+ * @return false if the device has failed (and has been closed)
+ */
 static bool
 ao_play_chunk(struct audio_output *ao, const struct music_chunk *chunk)
 {
@@ -440,7 +654,9 @@ ao_play_chunk(struct audio_output *ao, const struct music_chunk *chunk)
 	/* workaround -Wmaybe-uninitialized false positive */
 	size = 0;
 #endif
-	const char *data = (const char *)ao_filter_chunk(ao, chunk, &size);
+	const struct music_chunk *last;
+	const char *data = (const char *)ao_filter_batch(ao, chunk, &last,
+							 &size);
 	if (data == nullptr) {
 		ao_close(ao, false);
 
@@ -450,6 +666,19 @@ ao_play_chunk(struct audio_output *ao, const struct music_chunk *chunk)
 		return false;
 	}
 
+	/* the filtered size is not proportional to the chunks'
+	   lengths exactly, but close enough to find the chunk which
+	   is being played */
+	size_t batch_length = 0;
+	for (const struct music_chunk *c = chunk;; c = c->next) {
+		batch_length += c->length;
+		if (c == last)
+			break;
+	}
+
+	const size_t batch_size = size;
+	size_t batch_done = 0;
+
 	Error error;
 
 	while (size > 0 && ao->command == AO_COMMAND_NONE) {
@@ -479,10 +708,19 @@ ao_play_chunk(struct audio_output *ao, const struct music_chunk *chunk)
 		assert(nbytes <= size);
 		assert(nbytes % ao->out_audio_format.GetFrameSize() == 0);
 
+		ao_count_play(ao, nbytes);
+
 		data += nbytes;
 		size -= nbytes;
+
+		ao_advance_batch(ao, last, &batch_done,
+				 uint64_t(batch_size - size) * batch_length /
+				 batch_size);
 	}
 
+	if (size == 0)
+		ao_advance_batch(ao, last, &batch_done, SIZE_MAX);
+
 	return true;
 }
 
@@ -526,6 +764,7 @@ ao_play(struct audio_output *ao)
 		assert(!ao->chunk_finished);
 
 		ao->chunk = chunk;
+		++ao->taken_chunks;
 
 		success = ao_play_chunk(ao, chunk);
 		if (!success) {
@@ -533,13 +772,286 @@ ao_play(struct audio_output *ao)
 			break;
 		}
 
-		assert(ao->chunk == chunk);
-		chunk = chunk->next;
+		chunk = ao->chunk->next;
 	}
 
 	assert(ao->in_playback_loop);
 	ao->in_playback_loop = false;
 
+	UpdateThreadFaults();
+
+	ao->chunk_finished = true;
+
+	ao->mutex.unlock();
+	ao->player_control->LockSignal();
+	ao->mutex.lock();
+
+	return true;
+}
+
+/**
+ * Plays one portion (at most #CHUNK_TIME_MS) from the #ring.
+ *
+ * @return false if the device has failed (and has been closed)
+ */
+static bool
+ao_ring_play(struct audio_output *ao)
+{
+	assert(ao->ring != nullptr);
+	assert(!ao->ring->IsEmpty());
+
+	/* only this thread modifies the ring, so it is safe to
+	   access this range without holding the mutex */
+	const auto r = ao->ring->Read();
+	const size_t size = std::min(r.size,
+				     ao_ring_play_size(ao->out_audio_format,
+						       ao->batch_time));
+
+	Error error;
+	ao->mutex.unlock();
+	size_t nbytes = ao_plugin_play(ao, r.data, size, error);
+	ao->mutex.lock();
+	if (nbytes == 0) {
+		/* play()==0 means failure */
+		FormatError(error, "\"%s\" [%s] failed to play",
+			    ao->name, ao->plugin->name);
+
+		ao_close(ao, false);
+
+		/* don't automatically reopen this device for 10
+		   seconds */
+		assert(ao->fail_timer == nullptr);
+		ao->fail_timer = g_timer_new();
+
+		return false;
+	}
+
+	assert(nbytes <= size);
+	assert(nbytes % ao->out_audio_format.GetFrameSize() == 0);
+
+	ao_count_play(ao, nbytes);
+	ao->ring->Consume(nbytes);
+	return true;
+}
+
+/**
+ * Copies as much data as fits into the #ring.
+ *
+ * @return the number of bytes which were copied
+ */
+static size_t
+ao_ring_append(struct audio_output *ao, const uint8_t *data, size_t size)
+{
+	const auto w = ao->ring->Write();
+	const size_t nbytes = std::min(w.size, size);
+	memcpy(w.data, data, nbytes);
+	ao->ring->Append(nbytes);
+	return nbytes;
+}
+
+/**
+ * Copies as much of #ring_rest as fits into the #ring.
+ */
+static void
+ao_ring_append_rest(struct audio_output *ao)
+{
+	const size_t nbytes = ao_ring_append(ao, ao->ring_rest,
+					     ao->ring_rest_size);
+	ao->ring_rest += nbytes;
+	ao->ring_rest_size -= nbytes;
+}
+
+/**
+ * Plays the rest of the #ring (and #ring_rest), ignoring pending
+ * commands.  This is used before the device gets drained.
+ */
+static void
+ao_ring_flush(struct audio_output *ao)
+{
+	while (ao->ring != nullptr) {
+		if (ao->ring_rest_size > 0)
+			ao_ring_append_rest(ao);
+
+		if (ao->ring->IsEmpty())
+			break;
+
+		unsigned delay;
+		while ((delay = ao_plugin_delay(ao)) > 0)
+			(void)ao->cond.timed_wait(ao->mutex, delay);
+
+		if (!ao_ring_play(ao))
+			break;
+	}
+}
+
+/**
+ * Copies #ring_rest into the #ring, playing some of the ring to make
+ * room.  If a command interrupts this, the remaining data stays in
+ * #ring_rest.
+ *
+ * @return false if the device has failed (and has been closed)
+ */
+static bool
+ao_ring_push_rest(struct audio_output *ao)
+{
+	while (true) {
+		ao_ring_append_rest(ao);
+		if (ao->ring_rest_size == 0)
+			return true;
+
+		if (!ao_wait(ao))
+			return true;
+
+		if (!ao_ring_play(ao))
+			return false;
+	}
+}
+
+/**
+ * Filters a chunk and copies the result into the #ring.  If the
+ * chunk does not fit, some of the ring is played to make room.  If a
+ * command interrupts this, the rest of the chunk is saved in
+ * #ring_rest, except for CANCEL and CLOSE, which discard it anyway.
+ *
+ * @return false if the device has failed (and has been closed)
+ */
+static bool
+ao_ring_push_chunk(struct audio_output *ao, const struct music_chunk *chunk)
+{
+	if (ao->tags && gcc_unlikely(chunk->tag != nullptr)) {
+		ao->mutex.unlock();
+		ao_plugin_send_tag(ao, chunk->tag);
+		ao->mutex.lock();
+	}
+
+	size_t size = 0;
+	const uint8_t *data = (const uint8_t *)ao_filter_chunk(ao, chunk, &size);
+	if (data == nullptr) {
+		ao_close(ao, false);
+
+		/* don't automatically reopen this device for 10
+		   seconds */
+		ao->fail_timer = g_timer_new();
+		return false;
+	}
+
+	if (size > ao->ring_chunk_size)
+		ao->ring_chunk_size = size;
+
+	while (true) {
+		const size_t nbytes = ao_ring_append(ao, data, size);
+		data += nbytes;
+		size -= nbytes;
+		if (size == 0)
+			return true;
+
+		if (!ao_wait(ao)) {
+			/* a command was received: keep the rest of
+			   this chunk for later, because the chunk
+			   itself is already finished */
+			if (ao->command != AO_COMMAND_CANCEL &&
+			    ao->command != AO_COMMAND_CLOSE) {
+				uint8_t *rest = (uint8_t *)
+					ao->ring_rest_buffer.Get(size);
+				memcpy(rest, data, size);
+				ao->ring_rest = rest;
+				ao->ring_rest_size = size;
+			}
+
+			return true;
+		}
+
+		if (!ao_ring_play(ao))
+			return false;
+	}
+}
+
+/**
+ * The ao_play() variant for outputs with a #ring.  Chunks are copied
+ * into the ring as long as there is room, and the device is fed from
+ * the ring.  Unlike ao_play(), this returns each chunk to the pipe as
+ * soon as it has been filtered, so a slow device does not hold back
+ * the #MusicBuffer for the other outputs.
+ *
+ * @return true if there was something to do, false if the tail of
+ * the pipe was already reached and the ring is empty
+ */
+static bool
+ao_play_ring(struct audio_output *ao)
+{
+	assert(ao->pipe != nullptr);
+	assert(ao->ring != nullptr);
+
+	if (ao_next_chunk(ao) == nullptr && ao->ring->IsEmpty() &&
+	    ao->ring_rest_size == 0)
+		/* nothing to do */
+		return false;
+
+	assert(!ao->in_playback_loop);
+	ao->in_playback_loop = true;
+
+	bool taken = false;
+
+	while (ao->command == AO_COMMAND_NONE) {
+		if (ao->ring_rest_size > 0) {
+			/* finish the chunk which was interrupted by a
+			   command first */
+			if (!ao_ring_push_rest(ao))
+				break;
+
+			continue;
+		}
+
+		/* audio_output_all_check() may move ao->chunk while
+		   the mutex is unlocked, so this must be checked
+		   again in each iteration */
+		const struct music_chunk *chunk = ao_next_chunk(ao);
+
+		if (chunk != nullptr &&
+		    (ao->ring->IsEmpty() ||
+		     ao->ring->GetSpace() >= ao->ring_chunk_size)) {
+			ao->ring_waiting = false;
+			ao->chunk = chunk;
+			ao->chunk_finished = false;
+			++ao->taken_chunks;
+			taken = true;
+
+			if (!ao_ring_push_chunk(ao, chunk)) {
+				assert(ao->chunk == nullptr);
+				break;
+			}
+
+			ao->chunk_finished = true;
+			continue;
+		}
+
+		if (ao->ring->IsEmpty())
+			break;
+
+		ao->ring_waiting = chunk != nullptr;
+
+		if (taken) {
+			/* let the player return the chunks we have
+			   copied before we block in the device */
+			taken = false;
+
+			ao->mutex.unlock();
+			ao->player_control->LockSignal();
+			ao->mutex.lock();
+			continue;
+		}
+
+		if (!ao_wait(ao) || !ao_ring_play(ao))
+			break;
+	}
+
+	ao->ring_waiting = false;
+
+	assert(ao->in_playback_loop);
+	ao->in_playback_loop = false;
+
+	UpdateThreadFaults();
+
 	ao->chunk_finished = true;
 
 	ao->mutex.unlock();
@@ -639,6 +1151,10 @@ audio_output_task(void *arg)
 				assert(ao->chunk == nullptr);
 				assert(ao->pipe->Peek() == nullptr);
 
+				ao_ring_flush(ao);
+			}
+
+			if (ao->open) {
 				ao->mutex.unlock();
 				ao_plugin_drain(ao);
 				ao->mutex.lock();
@@ -650,6 +1166,13 @@ audio_output_task(void *arg)
 		case AO_COMMAND_CANCEL:
 			ao->chunk = nullptr;
 
+			if (ao->ring != nullptr)
+				ao->ring->Clear();
+			ao->ring_rest_size = 0;
+
+			/* the pipe is about to be cleared */
+			ao->taken_chunks = audio_output_all_get_pushed();
+
 			if (ao->open) {
 				ao->mutex.unlock();
 				ao_plugin_cancel(ao);
@@ -666,7 +1189,8 @@ audio_output_task(void *arg)
 			return;
 		}
 
-		if (ao->open && ao->allow_play && ao_play(ao))
+		if (ao->open && ao->allow_play &&
+		    (ao->ring != nullptr ? ao_play_ring(ao) : ao_play(ao)))
 			/* don't wait for an event if there are more
 			   chunks in the pipe */
 			continue;
@@ -682,7 +1206,9 @@ void audio_output_thread_start(struct audio_output *ao)
 {
 	assert(ao->command == AO_COMMAND_NONE);
 
+	const std::string name = std::string("output:") + ao->name;
+
 	Error error;
-	if (!ao->thread.Start(audio_output_task, ao, error))
+	if (!ao->thread.Start(audio_output_task, ao, name.c_str(), error))
 		FatalError(error);
 }
@@ -39,9 +39,16 @@ struct Partition {
 	Partition(Instance &_instance,
 		  unsigned max_length,
 		  unsigned buffer_chunks,
-		  unsigned buffered_before_play)
+		  size_t chunk_size,
+		  HugePolicy buffer_policy,
+		  unsigned buffered_before_play,
+		  unsigned buffer_time, unsigned stream_buffer_time,
+		  unsigned lookahead_chunks)
 		:instance(_instance), playlist(max_length),
-		 pc(buffer_chunks, buffered_before_play) {
+		 pc(buffer_chunks, chunk_size, buffer_policy,
+		    buffered_before_play,
+		    buffer_time, stream_buffer_time,
+		    lookahead_chunks) {
 	}
 
 	void ClearQueue() {
@@ -27,10 +27,18 @@
 
 #include <assert.h>
 
-PlayerControl::PlayerControl(unsigned _buffer_chunks,
-			     unsigned _buffered_before_play)
+PlayerControl::PlayerControl(unsigned _buffer_chunks, size_t _chunk_size,
+			     HugePolicy _buffer_policy,
+			     unsigned _buffered_before_play,
+			     unsigned _buffer_time,
+			     unsigned _stream_buffer_time,
+			     unsigned _lookahead_chunks)
 	:buffer_chunks(_buffer_chunks),
+	 chunk_size(_chunk_size),
+	 buffer_policy(_buffer_policy),
 	 buffered_before_play(_buffered_before_play),
+	 buffer_time(_buffer_time), stream_buffer_time(_stream_buffer_time),
+	 lookahead_chunks(_lookahead_chunks),
 	 command(PlayerCommand::NONE),
 	 state(PlayerState::STOP),
 	 error_type(PlayerError::NONE),
@@ -25,6 +25,7 @@
 #include "thread/Cond.hxx"
 #include "thread/Thread.hxx"
 #include "util/Error.hxx"
+#include "util/HugeAllocator.hxx"
 #include "CrossFade.hxx"
 
 #include <stdint.h>
@@ -90,11 +91,74 @@ struct player_status {
 	float elapsed_time;
 };
 
+/**
+ * Statistics about the transitions between two songs, see
+ * PlayerControl::GetTransitionStats().
+ */
+struct PlayerTransitionStats {
+	/**
+	 * The number of song borders crossed during playback.
+	 */
+	unsigned count;
+
+	/**
+	 * How many of them were pre-decoded by the look-ahead
+	 * decoder?
+	 */
+	unsigned predecoded;
+
+	/**
+	 * The sum and the maximum of the time [us] between a song
+	 * border and the first chunk of the new song being sent to
+	 * the audio outputs.
+	 */
+	uint64_t total_us;
+	unsigned max_us;
+
+	PlayerTransitionStats()
+		:count(0), predecoded(0), total_us(0), max_us(0) {}
+
+	void Add(unsigned latency_us, bool _predecoded) {
+		++count;
+		if (_predecoded)
+			++predecoded;
+		total_us += latency_us;
+		if (latency_us > max_us)
+			max_us = latency_us;
+	}
+};
+
 struct PlayerControl {
 	unsigned buffer_chunks;
 
+	/**
+	 * The capacity of each #music_chunk in bytes.
+	 */
+	size_t chunk_size;
+
+	/**
+	 * How the #MusicBuffer memory is allocated.
+	 */
+	HugePolicy buffer_policy;
+
 	unsigned int buffered_before_play;
 
+	/**
+	 * How much audio [ms] the #MusicBuffer should hold for songs
+	 * from local files and for remote streams.  The player
+	 * converts this to a chunk count whenever the audio format
+	 * changes, up to #buffer_chunks.  0 means always use all
+	 * #buffer_chunks.  #buffered_before_play scales accordingly.
+	 */
+	unsigned buffer_time, stream_buffer_time;
+
+	/**
+	 * The number of chunks the look-ahead decoder may pre-decode
+	 * of the queued song while the current song is still being
+	 * decoded.  0 disables the look-ahead decoder.
+	 */
+	unsigned lookahead_chunks;
+
 	/**
 	 * The handle of the player thread.
 	 */
@@ -161,6 +225,11 @@ struct PlayerControl {
 
 	double total_play_time;
 
+	/**
+	 * Protected by #mutex.
+	 */
+	PlayerTransitionStats transition_stats;
+
 	/**
 	 * If this flag is set, then the player will be auto-paused at
 	 * the end of the song, before the next song starts to play.
@@ -170,8 +239,11 @@ struct PlayerControl {
 	 */
 	bool border_pause;
 
-	PlayerControl(unsigned buffer_chunks,
-		      unsigned buffered_before_play);
+	PlayerControl(unsigned buffer_chunks, size_t chunk_size,
+		      HugePolicy buffer_policy,
+		      unsigned buffered_before_play,
+		      unsigned buffer_time, unsigned stream_buffer_time,
+		      unsigned lookahead_chunks);
 	~PlayerControl();
 
 	/**
@@ -449,6 +521,14 @@ public:
 	double GetTotalPlayTime() const {
 		return total_play_time;
 	}
+
+	gcc_pure
+	PlayerTransitionStats GetTransitionStats() const {
+		Lock();
+		const PlayerTransitionStats result = transition_stats;
+		Unlock();
+		return result;
+	}
 };
 
 #endif
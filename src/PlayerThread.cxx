@@ -21,12 +21,15 @@
 #include "PlayerThread.hxx"
 #include "DecoderThread.hxx"
 #include "DecoderControl.hxx"
+#include "DecoderList.hxx"
 #include "MusicPipe.hxx"
 #include "MusicBuffer.hxx"
 #include "MusicChunk.hxx"
 #include "Song.hxx"
 #include "Main.hxx"
 #include "system/FatalError.hxx"
+#include "system/ThreadFaults.hxx"
+#include "system/Clock.hxx"
 #include "CrossFade.hxx"
 #include "PlayerControl.hxx"
 #include "OutputAll.hxx"
@@ -34,12 +37,29 @@
 #include "Idle.hxx"
 #include "GlobalEvents.hxx"
 #include "util/Domain.hxx"
+#include "util/UriUtil.hxx"
 #include "Log.hxx"
 
+#include <algorithm>
+
 #include <string.h>
 
 static constexpr Domain player_domain("player");
 
+/**
+ * The look-ahead decoder opens the next song this many seconds
+ * before the main decoder is expected to finish the current one.
+ * Starting earlier would only keep the next song's input stream
+ * open and idle, and a remote server may give up on it.
+ */
+static constexpr double LOOKAHEAD_LEAD_TIME = 20;
+
+/**
+ * The #MusicBuffer limit never drops below this number of chunks,
+ * no matter how small the configured buffer time is.
+ */
+static constexpr unsigned MIN_BUFFER_CHUNKS = 16;
+
 enum class CrossFadeState : int8_t {
 	DISABLED = -1,
 	UNKNOWN = 0,
@@ -49,7 +69,19 @@ enum class CrossFadeState : int8_t {
 class Player {
 	PlayerControl &pc;
 
-	DecoderControl &dc;
+	/**
+	 * The decoder of the current song.  When it is finished, it
+	 * gets the next song.
+	 */
+	DecoderControl *dc;
+
+	/**
+	 * The second decoder which pre-decodes the queued song while
+	 * #dc is still busy with the current one; nullptr if the
+	 * look-ahead is disabled.  It gets swapped with #dc as soon as
+	 * #dc has finished.
+	 */
+	DecoderControl *lookahead;
 
 	MusicBuffer &buffer;
 
@@ -60,6 +92,12 @@ class Player {
 	 */
 	bool buffering;
 
+	/**
+	 * PlayerControl::buffered_before_play, scaled to the current
+	 * MusicBuffer::GetLimit().
+	 */
+	unsigned buffered_before_play;
+
 	/**
 	 * true if the decoder is starting and did not provide data
 	 * yet
@@ -82,6 +120,20 @@ class Player {
 	 */
 	bool queued;
 
+	/**
+	 * Was the next song (the one #dc is at after the swap) started
+	 * by the look-ahead decoder?  This is only used for
+	 * #PlayerTransitionStats.
+	 */
+	bool predecoded;
+
+	/**
+	 * The time stamp [us] of the most recent song border, or 0
+	 * if the first chunk of the new song has already been sent to
+	 * the audio outputs.
+	 */
+	uint64_t border_time;
+
 	/**
 	 * Was any audio output opened successfully?  It might have
 	 * failed meanwhile, but was not explicitly closed by the
@@ -133,13 +185,17 @@ class Player {
 
 public:
 	Player(PlayerControl &_pc, DecoderControl &_dc,
+	       DecoderControl *_lookahead,
 	       MusicBuffer &_buffer)
-		:pc(_pc), dc(_dc), buffer(_buffer),
+		:pc(_pc), dc(&_dc), lookahead(_lookahead), buffer(_buffer),
 		 buffering(true),
+		 buffered_before_play(ScaleBufferedBeforePlay(_pc, _buffer)),
 		 decoder_starting(false),
 		 decoder_woken(false),
 		 paused(false),
 		 queued(true),
+		 predecoded(false),
+		 border_time(0),
 		 output_open(false),
 		 song(nullptr),
 		 xfade_state(CrossFadeState::UNKNOWN),
@@ -149,6 +205,40 @@ public:
 		 elapsed_time(0.0) {}
 
 private:
+	gcc_pure
+	static unsigned ScaleBufferedBeforePlay(const PlayerControl &pc,
+						const MusicBuffer &buffer) {
+		return uint64_t(pc.buffered_before_play) * buffer.GetLimit()
+			/ buffer.GetSize();
+	}
+
+	/**
+	 * Returns the number of bytes of #play_audio_format which
+	 * fill one chunk; see music_chunk::CalcFillSize().
+	 */
+	gcc_pure
+	size_t GetChunkFillSize() const {
+		return music_chunk::CalcFillSize(play_audio_format,
+						 buffer.GetChunkSize());
+	}
+
+	/**
+	 * Converts a number of chunks holding #DEFAULT_CHUNK_SIZE
+	 * bytes (or less if the chunk capacity is smaller) to the
+	 * number of chunks of #play_audio_format holding the same
+	 * amount of data.  The #MusicBuffer and the look-ahead
+	 * quota were sized in the former unit, see
+	 * initialize_decoder_and_player().
+	 */
+	gcc_pure
+	unsigned ScaleChunkCount(unsigned n) const {
+		const size_t min_fill_size =
+			std::min(buffer.GetChunkSize(), DEFAULT_CHUNK_SIZE);
+		const uint64_t result =
+			uint64_t(n) * min_fill_size / GetChunkFillSize();
+		return result > 0 ? unsigned(result) : 1;
+	}
+
 	void ClearAndDeletePipe() {
 		pipe->Clear(buffer);
 		delete pipe;
@@ -187,6 +277,66 @@ private:
 	 */
 	void StopDecoder();
 
+	/**
+	 * Start the look-ahead decoder on the queued song.
+	 *
+	 * Player lock is not held.
+	 */
+	void StartLookahead();
+
+	/**
+	 * Stop the look-ahead decoder and clears (and frees) its
+	 * music pipe.
+	 *
+	 * Player lock is not held.
+	 */
+	void StopLookahead();
+
+	/**
+	 * The decoder has finished the current song, and the
+	 * look-ahead decoder is already at the next one: make it the
+	 * main decoder, and lift its #DecoderControl::pipe_limit.
+	 *
+	 * Player lock is not held.
+	 */
+	void SwapLookahead();
+
+	/**
+	 * Is the current song close enough to its end to start the
+	 * look-ahead decoder?  The main decoder finishes about one
+	 * #MusicBuffer worth of audio before the end; see
+	 * #LOOKAHEAD_LEAD_TIME.
+	 */
+	gcc_pure
+	bool IsLookaheadDue() const;
+
+	/**
+	 * May the current and the queued song be decoded at the same
+	 * time?  Only local files whose decoder plugins are all
+	 * reentrant qualify; a stream's plugin is chosen by its MIME
+	 * type, which is not known before it has been opened.
+	 */
+	gcc_pure
+	bool IsLookaheadPossible() const;
+
+	/**
+	 * Is the look-ahead decoder busy with (or done with) the
+	 * queued song?
+	 */
+	gcc_pure
+	bool IsLookaheadActive() const {
+		return lookahead != nullptr && lookahead->pipe != nullptr;
+	}
+
+	/**
+	 * Adjust the #MusicBuffer limit to the configured buffer time
+	 * (PlayerControl::buffer_time or
+	 * PlayerControl::stream_buffer_time) for the new song's audio
+	 * format.  This is called when the decoder of a new song has
+	 * been initialized.
+	 */
+	void ResizeBuffer();
+
 	/**
 	 * Is the decoder still busy on the same song as the player?
 	 *
@@ -197,7 +347,7 @@ private:
 	bool IsDecoderAtCurrentSong() const {
 		assert(pipe != nullptr);
 
-		return dc.pipe == pipe;
+		return dc->pipe == pipe;
 	}
 
 	/**
@@ -207,7 +357,7 @@ private:
 	 */
 	gcc_pure
 	bool IsDecoderAtNextSong() const {
-		return dc.pipe != nullptr && !IsDecoderAtCurrentSong();
+		return dc->pipe != nullptr && !IsDecoderAtCurrentSong();
 	}
 
 	/**
@@ -295,7 +445,7 @@ Player::StartDecoder(MusicPipe &_pipe)
 	if (pc.command == PlayerCommand::SEEK)
 		start_ms += (unsigned)(pc.seek_where * 1000);
 
-	dc.Start(pc.next_song->DupDetached(),
+	dc->Start(pc.next_song->DupDetached(),
 		 start_ms, pc.next_song->end_ms,
 		 buffer, _pipe);
 }
@@ -303,18 +453,156 @@ Player::StartDecoder(MusicPipe &_pipe)
 void
 Player::StopDecoder()
 {
-	dc.Stop();
+	dc->Stop();
 
-	if (dc.pipe != nullptr) {
+	if (dc->pipe != nullptr) {
 		/* clear and free the decoder pipe */
 
-		dc.pipe->Clear(buffer);
+		dc->pipe->Clear(buffer);
 
-		if (dc.pipe != pipe)
-			delete dc.pipe;
+		if (dc->pipe != pipe)
+			delete dc->pipe;
 
-		dc.pipe = nullptr;
+		dc->pipe = nullptr;
 	}
+
+	predecoded = false;
+}
+
+void
+Player::StartLookahead()
+{
+	assert(lookahead != nullptr);
+	assert(lookahead->pipe == nullptr);
+	assert(queued);
+	assert(pc.next_song != nullptr);
+
+	lookahead->Start(pc.next_song->DupDetached(),
+			 pc.next_song->start_ms, pc.next_song->end_ms,
+			 buffer, *new MusicPipe(),
+			 ScaleChunkCount(pc.lookahead_chunks));
+}
+
+void
+Player::StopLookahead()
+{
+	if (!IsLookaheadActive())
+		return;
+
+	lookahead->Stop();
+
+	lookahead->pipe->Clear(buffer);
+	delete lookahead->pipe;
+	lookahead->pipe = nullptr;
+}
+
+void
+Player::ResizeBuffer()
+{
+	assert(song != nullptr);
+	assert(play_audio_format.IsDefined());
+
+	/* with chunks filled beyond the default size, fewer of them
+	   fit into audio_buffer_size */
+	const unsigned capacity =
+		std::min(ScaleChunkCount(buffer.GetSize()), buffer.GetSize());
+	const unsigned ms = song->IsFile()
+		? pc.buffer_time
+		: pc.stream_buffer_time;
+
+	unsigned limit = capacity;
+	if (ms > 0) {
+		const double chunks = play_audio_format.GetTimeToSize() *
+			ms / 1000 / GetChunkFillSize();
+		const unsigned lookahead_chunks =
+			ScaleChunkCount(pc.lookahead_chunks);
+		if (chunks < capacity)
+			limit = std::max(unsigned(chunks) + 1,
+					 std::max(MIN_BUFFER_CHUNKS,
+						  2 * lookahead_chunks));
+		if (limit > capacity)
+			limit = capacity;
+	}
+
+	if (limit == buffer.GetLimit())
+		return;
+
+	FormatDebug(player_domain, "audio buffer: %u of %u chunks",
+		    limit, capacity);
+
+	buffer.SetLimit(limit);
+	buffered_before_play = ScaleBufferedBeforePlay(pc, buffer);
+
+	/* the decoder may be waiting for a chunk */
+	pc.Lock();
+	dc->Signal();
+	pc.Unlock();
+}
+
+bool
+Player::IsLookaheadDue() const
+{
+	if (pc.total_time <= 0 || !play_audio_format.IsDefined())
+		/* unknown duration, e.g. a radio stream */
+		return false;
+
+	float elapsed = audio_output_all_get_elapsed_time();
+	if (elapsed < 0.0)
+		elapsed = elapsed_time;
+
+	const double buffer_time = double(buffer.GetLimit()) *
+		GetChunkFillSize() / play_audio_format.GetTimeToSize();
+
+	return pc.total_time - elapsed <= buffer_time + LOOKAHEAD_LEAD_TIME;
+}
+
+/**
+ * May the specified song be decoded while another decoder thread is
+ * running?
+ */
+gcc_pure
+static bool
+song_decoder_reentrant(const Song &song)
+{
+	if (!song.IsFile())
+		return false;
+
+	const char *suffix = uri_get_suffix(song.GetURI().c_str());
+	return suffix != nullptr && decoder_plugins_reentrant(suffix);
+}
+
+bool
+Player::IsLookaheadPossible() const
+{
+	assert(pc.next_song != nullptr);
+
+	return dc->song != nullptr && song_decoder_reentrant(*dc->song) &&
+		song_decoder_reentrant(*pc.next_song);
+}
+
+void
+Player::SwapLookahead()
+{
+	assert(IsLookaheadActive());
+	assert(dc->pipe == pipe);
+
+	/* the player keeps owning the current pipe */
+	dc->pipe = nullptr;
+
+	pc.Lock();
+
+	/* each DecoderControl remembers the MixRamp and ReplayGain
+	   values of its own previous song, which is two songs back
+	   for the look-ahead decoder; replace them with the values
+	   of the song which is ending now */
+	lookahead->previous_mix_ramp = dc->mix_ramp;
+	lookahead->replay_gain_prev_db = dc->replay_gain_db;
+
+	std::swap(dc, lookahead);
+	predecoded = true;
+
+	dc->Unthrottle();
+	pc.Unlock();
 }
 
 bool
@@ -326,7 +614,7 @@ Player::WaitForDecoder()
 	queued = false;
 
 	pc.Lock();
-	Error error = dc.GetError();
+	Error error = dc->GetError();
 	if (error.IsDefined()) {
 		pc.SetError(PlayerError::DECODER, std::move(error));
 
@@ -432,14 +720,14 @@ Player::CheckDecoderStartup()
 
 	pc.Lock();
 
-	Error error = dc.GetError();
+	Error error = dc->GetError();
 	if (error.IsDefined()) {
 		/* the decoder failed */
 		pc.SetError(PlayerError::DECODER, std::move(error));
 		pc.Unlock();
 
 		return false;
-	} else if (!dc.IsStarting()) {
+	} else if (!dc->IsStarting()) {
 		/* the decoder is ready and ok */
 
 		pc.Unlock();
@@ -451,17 +739,19 @@ Player::CheckDecoderStartup()
 			return true;
 
 		pc.Lock();
-		pc.total_time = real_song_duration(dc.song, dc.total_time);
-		pc.audio_format = dc.in_audio_format;
+		pc.total_time = real_song_duration(dc->song, dc->total_time);
+		pc.audio_format = dc->in_audio_format;
 		pc.Unlock();
 
 		idle_add(IDLE_PLAYER);
 
-		play_audio_format = dc.out_audio_format;
+		play_audio_format = dc->out_audio_format;
 		decoder_starting = false;
 
+		ResizeBuffer();
+
 		if (!paused && !OpenOutput()) {
-			const auto uri = dc.song->GetURI();
+			const auto uri = dc->song->GetURI();
 			FormatError(player_domain,
 				    "problems opening audio device "
 				    "while playing \"%s\"", uri.c_str());
@@ -472,7 +762,7 @@ Player::CheckDecoderStartup()
 	} else {
 		/* the decoder is not yet ready; wait
 		   some more */
-		dc.WaitForDecoder();
+		dc->WaitForDecoder();
 		pc.Unlock();
 
 		return true;
@@ -485,7 +775,7 @@ Player::SendSilence()
 	assert(output_open);
 	assert(play_audio_format.IsDefined());
 
-	struct music_chunk *chunk = buffer.Allocate();
+	struct music_chunk *chunk = buffer.AllocateBeyondLimit();
 	if (chunk == nullptr) {
 		LogError(player_domain, "Failed to allocate silence buffer");
 		return false;
@@ -498,7 +788,8 @@ Player::SendSilence()
 	const size_t frame_size = play_audio_format.GetFrameSize();
 	/* this formula ensures that we don't send
 	   partial frames */
-	unsigned num_frames = sizeof(chunk->data) / frame_size;
+	unsigned num_frames = chunk->GetFillSize(play_audio_format)
+		/ frame_size;
 
 	chunk->times = -1.0; /* undefined time stamp */
 	chunk->length = num_frames * frame_size;
@@ -521,7 +812,12 @@ Player::SeekDecoder()
 
 	const unsigned start_ms = pc.next_song->start_ms;
 
-	if (!dc.LockIsCurrentSong(*pc.next_song)) {
+	/* the seek has replaced the queued song */
+	StopLookahead();
+	border_time = 0;
+	predecoded = false;
+
+	if (!dc->LockIsCurrentSong(*pc.next_song)) {
 		/* the decoder is already decoding the "next" song -
 		   stop it and start the previous song again */
 
@@ -542,7 +838,7 @@ Player::SeekDecoder()
 		if (!IsDecoderAtCurrentSong()) {
 			/* the decoder is already decoding the "next" song,
 			   but it is the same song file; exchange the pipe */
-			ClearAndReplacePipe(dc.pipe);
+			ClearAndReplacePipe(dc->pipe);
 		}
 
 		pc.next_song->Free();
@@ -568,7 +864,7 @@ Player::SeekDecoder()
 	if (where < 0.0)
 		where = 0.0;
 
-	if (!dc.Seek(where + start_ms / 1000.0)) {
+	if (!dc->Seek(where + start_ms / 1000.0)) {
 		/* decoder failure */
 		player_command_finished(pc);
 		return false;
@@ -609,6 +905,7 @@ Player::ProcessCommand()
 		assert(pc.next_song != nullptr);
 		assert(!queued);
 		assert(!IsDecoderAtNextSong());
+		assert(!IsLookaheadActive());
 
 		queued = true;
 		pc.CommandFinished();
@@ -659,6 +956,10 @@ Player::ProcessCommand()
 			pc.Unlock();
 			StopDecoder();
 			pc.Lock();
+		} else if (IsLookaheadActive()) {
+			pc.Unlock();
+			StopLookahead();
+			pc.Lock();
 		}
 
 		pc.next_song->Free();
@@ -758,7 +1059,7 @@ Player::PlayNextChunk()
 	if (xfade_state == CrossFadeState::ENABLED && IsDecoderAtNextSong() &&
 	    (cross_fade_position = pipe->GetSize()) <= cross_fade_chunks) {
 		/* perform cross fade */
-		music_chunk *other_chunk = dc.pipe->Shift();
+		music_chunk *other_chunk = dc->pipe->Shift();
 
 		if (!cross_fading) {
 			/* beginning of the cross fade - adjust
@@ -807,7 +1108,7 @@ Player::PlayNextChunk()
 
 			pc.Lock();
 
-			if (dc.IsIdle()) {
+			if (dc->IsIdle()) {
 				/* the decoder isn't running, abort
 				   cross fading */
 				pc.Unlock();
@@ -815,8 +1116,8 @@ Player::PlayNextChunk()
 				xfade_state = CrossFadeState::DISABLED;
 			} else {
 				/* wait for the decoder */
-				dc.Signal();
-				dc.WaitForDecoder();
+				dc->Signal();
+				dc->WaitForDecoder();
 				pc.Unlock();
 
 				return true;
@@ -864,12 +1165,21 @@ Player::PlayNextChunk()
 	   with each chunk; it is more efficient to make it decode a
 	   larger block at a time */
 	pc.Lock();
-	if (!dc.IsIdle() &&
-	    dc.pipe->GetSize() <= (pc.buffered_before_play +
-				   buffer.GetSize() * 3) / 4) {
+
+	if (border_time != 0) {
+		/* this was the first chunk of the new song */
+		pc.transition_stats.Add(MonotonicClockUS() - border_time,
+					predecoded);
+		border_time = 0;
+		predecoded = false;
+	}
+
+	if (!dc->IsIdle() &&
+	    dc->pipe->GetSize() <= (buffered_before_play +
+				    buffer.GetLimit() * 3) / 4) {
 		if (!decoder_woken) {
 			decoder_woken = true;
-			dc.Signal();
+			dc->Signal();
 		}
 	} else
 		decoder_woken = false;
@@ -888,7 +1198,9 @@ Player::SongBorder()
 		FormatDefault(player_domain, "played \"%s\"", uri.c_str());
 	}
 
-	ReplacePipe(dc.pipe);
+	border_time = MonotonicClockUS();
+
+	ReplacePipe(dc->pipe);
 
 	audio_output_all_song_border();
 
@@ -899,6 +1211,8 @@ Player::SongBorder()
 
 	const bool border_pause = pc.border_pause;
 	if (border_pause) {
+		/* don't count the pause as transition latency */
+		border_time = 0;
 		paused = true;
 		pc.state = PlayerState::PAUSE;
 	}
@@ -946,13 +1260,15 @@ Player::Run()
 
 		pc.Unlock();
 
+		UpdateThreadFaults();
+
 		if (buffering) {
 			/* buffering at the start of the song - wait
 			   until the buffer is large enough, to
 			   prevent stuttering on slow machines */
 
-			if (pipe->GetSize() < pc.buffered_before_play &&
-			    !dc.LockIsIdle()) {
+			if (pipe->GetSize() < buffered_before_play &&
+			    !dc->LockIsIdle()) {
 				/* not enough decoded buffer space yet */
 
 				if (!paused && output_open &&
@@ -962,7 +1278,7 @@ Player::Run()
 
 				pc.Lock();
 				/* XXX race condition: check decoder again */
-				dc.WaitForDecoder();
+				dc->WaitForDecoder();
 				continue;
 			} else {
 				/* buffering is complete */
@@ -984,17 +1300,29 @@ Player::Run()
 		/*
 		music_pipe_check_format(&play_audio_format,
 					next_song_chunk,
-					&dc.out_audio_format);
+					&dc->out_audio_format);
 		*/
 #endif
 
-		if (dc.LockIsIdle() && queued && dc.pipe == pipe) {
+		if (dc->LockIsIdle() && queued && dc->pipe == pipe) {
 			/* the decoder has finished the current song;
 			   make it decode the next song */
 
-			assert(dc.pipe == nullptr || dc.pipe == pipe);
-
-			StartDecoder(*new MusicPipe());
+			assert(dc->pipe == nullptr || dc->pipe == pipe);
+
+			if (IsLookaheadActive())
+				/* the look-ahead decoder is already
+				   at it */
+				SwapLookahead();
+			else
+				StartDecoder(*new MusicPipe());
+		} else if (queued && lookahead != nullptr &&
+			   !IsLookaheadActive() && IsDecoderAtCurrentSong() &&
+			   IsLookaheadDue() && IsLookaheadPossible()) {
+			/* the decoder is still busy with the current
+			   song; let the look-ahead decoder open the
+			   next one and pre-decode its beginning */
+			StartLookahead();
 		}
 
 		if (/* no cross-fading if MPD is going to pause at the
@@ -1002,20 +1330,21 @@ Player::Run()
 		    !pc.border_pause &&
 		    IsDecoderAtNextSong() &&
 		    xfade_state == CrossFadeState::UNKNOWN &&
-		    !dc.LockIsStarting()) {
+		    !dc->LockIsStarting()) {
 			/* enable cross fading in this song?  if yes,
 			   calculate how many chunks will be required
 			   for it */
 			cross_fade_chunks =
-				pc.cross_fade.Calculate(dc.total_time,
-							dc.replay_gain_db,
-							dc.replay_gain_prev_db,
-							dc.GetMixRampStart(),
-							dc.GetMixRampPreviousEnd(),
-							dc.out_audio_format,
+				pc.cross_fade.Calculate(dc->total_time,
+							dc->replay_gain_db,
+							dc->replay_gain_prev_db,
+							dc->GetMixRampStart(),
+							dc->GetMixRampPreviousEnd(),
+							dc->out_audio_format,
 							play_audio_format,
-							buffer.GetSize() -
-							pc.buffered_before_play);
+							buffer.GetChunkSize(),
+							buffer.GetLimit() -
+							buffered_before_play);
 			if (cross_fade_chunks > 0) {
 				xfade_state = CrossFadeState::ENABLED;
 				cross_fading = false;
@@ -1046,15 +1375,15 @@ Player::Run()
 			/* wake up the decoder (just in case it's
 			   waiting for space in the MusicBuffer) and
 			   wait for it */
-			dc.Signal();
-			dc.WaitForDecoder();
+			dc->Signal();
+			dc->WaitForDecoder();
 			continue;
 		} else if (IsDecoderAtNextSong()) {
 			/* at the beginning of a new song */
 
 			if (!SongBorder())
 				break;
-		} else if (dc.LockIsIdle()) {
+		} else if (dc->LockIsIdle()) {
 			/* check the size of the pipe again, because
 			   the decoder thread may have added something
 			   since we last checked */
@@ -1076,6 +1405,7 @@ Player::Run()
 	}
 
 	StopDecoder();
+	StopLookahead();
 
 	ClearAndDeletePipe();
 
@@ -1103,10 +1433,10 @@ Player::Run()
 }
 
 static void
-do_play(PlayerControl &pc, DecoderControl &dc,
+do_play(PlayerControl &pc, DecoderControl &dc, DecoderControl *lookahead,
 	MusicBuffer &buffer)
 {
-	Player player(pc, dc, buffer);
+	Player player(pc, dc, lookahead, buffer);
 	player.Run();
 }
 
@@ -1118,7 +1448,13 @@ player_task(void *arg)
 	DecoderControl dc(pc.mutex, pc.cond);
 	decoder_thread_start(dc);
 
-	MusicBuffer buffer(pc.buffer_chunks);
+	DecoderControl *lookahead = nullptr;
+	if (pc.lookahead_chunks > 0) {
+		lookahead = new DecoderControl(pc.mutex, pc.cond);
+		decoder_thread_start(*lookahead);
+	}
+
+	MusicBuffer buffer(pc.buffer_chunks, pc.chunk_size, pc.buffer_policy);
 
 	pc.Lock();
 
@@ -1129,7 +1465,7 @@ player_task(void *arg)
 			assert(pc.next_song != nullptr);
 
 			pc.Unlock();
-			do_play(pc, dc, buffer);
+			do_play(pc, dc, lookahead, buffer);
 			GlobalEvents::Emit(GlobalEvents::PLAYLIST);
 			pc.Lock();
 			break;
@@ -1174,6 +1510,11 @@ player_task(void *arg)
 
 			dc.Quit();
 
+			if (lookahead != nullptr) {
+				lookahead->Quit();
+				delete lookahead;
+			}
+
 			audio_output_all_close();
 
 			player_command_finished(pc);
@@ -1206,6 +1547,6 @@ player_create(PlayerControl &pc)
 	assert(!pc.thread.IsDefined());
 
 	Error error;
-	if (!pc.thread.Start(player_task, &pc, error))
+	if (!pc.thread.Start(player_task, &pc, "player", error))
 		FatalError(error);
 }
@@ -39,7 +39,7 @@ PlaylistVector::find(const char *name)
 bool
 PlaylistVector::UpdateOrInsert(PlaylistInfo &&pi)
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 
 	auto i = find(pi.name.c_str());
 	if (i != end()) {
@@ -56,7 +56,7 @@ PlaylistVector::UpdateOrInsert(PlaylistInfo &&pi)
 bool
 PlaylistVector::erase(const char *name)
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 
 	auto i = find(name);
 	if (i == end())
@@ -28,6 +28,8 @@ Queue::Queue(unsigned _max_length)
 	 version(1),
 	 items(new Item[max_length]),
 	 order(new unsigned[max_length]),
+	 position_order(new unsigned[max_length]),
+	 changes_since(version),
 	 id_table(max_length * HASH_MULT),
 	 repeat(false),
 	 single(false),
@@ -42,6 +44,7 @@ Queue::~Queue()
 
 	delete[] items;
 	delete[] order;
+	delete[] position_order;
 }
 
 int
@@ -73,9 +76,56 @@ Queue::IncrementVersion()
 			items[i].version = 0;
 
 		version = 1;
+
+		/* items with version 0 are always reported, the
+		   change log cannot help until the queue is
+		   cleared */
+		changes.clear();
+		changes_since = max;
+	}
+}
+
+void
+Queue::LogChange(unsigned position)
+{
+	if (!changes.empty() && changes.back().version == version &&
+	    changes.back().position == position)
+		return;
+
+	changes.push_back({version, position});
+
+	if (changes.size() > max_length) {
+		changes_since = std::max(changes_since,
+					 changes.front().version + 1);
+		changes.pop_front();
 	}
 }
 
+void
+Queue::GetChanges(uint32_t _version, std::vector<unsigned> &positions) const
+{
+	if (_version > version || _version < changes_since) {
+		for (unsigned i = 0; i < length; i++)
+			if (IsNewerAtPosition(i, _version))
+				positions.push_back(i);
+		return;
+	}
+
+	auto i = std::lower_bound(changes.begin(), changes.end(), _version,
+				  [](const Change &change, uint32_t v){
+					  return change.version < v;
+				  });
+
+	for (; i != changes.end(); ++i)
+		/* skip positions which were deleted later */
+		if (i->position < length)
+			positions.push_back(i->position);
+
+	std::sort(positions.begin(), positions.end());
+	positions.erase(std::unique(positions.begin(), positions.end()),
+			positions.end());
+}
+
 void
 Queue::ModifyAtOrder(unsigned _order)
 {
@@ -96,10 +146,11 @@ Queue::Append(Song *song, uint8_t priority)
 	auto &item = items[position];
 	item.song = song->DupDetached();
 	item.id = id;
-	item.version = version;
 	item.priority = priority;
+	ModifyAtPosition(position);
 
 	order[position] = position;
+	position_order[position] = position;
 
 	return id;
 }
@@ -112,8 +163,8 @@ Queue::SwapPositions(unsigned position1, unsigned position2)
 
 	std::swap(items[position1], items[position2]);
 
-	items[position1].version = version;
-	items[position2].version = version;
+	ModifyAtPosition(position1);
+	ModifyAtPosition(position2);
 
 	id_table.Move(id1, position2);
 	id_table.Move(id2, position1);
@@ -138,20 +189,15 @@ Queue::MovePostion(unsigned from, unsigned to)
 
 	id_table.Move(tmp.id, to);
 	items[to] = tmp;
-	items[to].version = version;
+	ModifyAtPosition(to);
 
 	/* now deal with order */
 
 	if (random) {
-		for (unsigned i = 0; i < length; i++) {
-			if (order[i] > from && order[i] <= to)
-				order[i]--;
-			else if (order[i] < from &&
-				 order[i] >= to)
-				order[i]++;
-			else if (from == order[i])
-				order[i] = to;
-		}
+		if (from < to)
+			RotateOrder(from, from + 1, to + 1);
+		else if (from > to)
+			RotateOrder(to, from, from + 1);
 	}
 }
 
@@ -178,25 +224,37 @@ Queue::MoveRange(unsigned start, unsigned end, unsigned to)
 	{
 		id_table.Move(tmp[i - start].id, to + i - start);
 		items[to + i - start] = tmp[i-start];
-		items[to + i - start].version = version;
+		ModifyAtPosition(to + i - start);
 	}
 
 	if (random) {
-		// Update the positions in the queue.
-		// Note that the ranges for these cases are the same as the ranges of
-		// the loops above.
-		for (unsigned i = 0; i < length; i++) {
-			if (order[i] >= end && order[i] < to + end - start)
-				order[i] -= end - start;
-			else if (order[i] < start &&
-				 order[i] >= to)
-				order[i] += end - start;
-			else if (start <= order[i] && order[i] < end)
-				order[i] += to - start;
-		}
+		// Update the positions in the queue; the items in
+		// [min(start,to), max(end,to+end-start)) were rotated.
+		if (to > start)
+			RotateOrder(start, end, to + end - start);
+		else if (to < start)
+			RotateOrder(to, start, end);
 	}
 }
 
+void
+Queue::RotateOrder(unsigned start, unsigned middle, unsigned end)
+{
+	assert(start <= middle);
+	assert(middle <= end);
+	assert(end <= length);
+
+	/* the order numbers stay, only the positions they refer to
+	   move */
+	for (unsigned i = start; i < end; ++i)
+		order[position_order[i]] = i >= middle
+			? i - (middle - start)
+			: i + (end - middle);
+
+	std::rotate(position_order + start, position_order + middle,
+		    position_order + end);
+}
+
 void
 Queue::MoveOrder(unsigned from_order, unsigned to_order)
 {
@@ -214,6 +272,11 @@ Queue::MoveOrder(unsigned from_order, unsigned to_order)
 	}
 
 	order[to_order] = from_position;
+
+	if (from_order < to_order)
+		UpdatePositionOrder(from_order, to_order + 1);
+	else
+		UpdatePositionOrder(to_order, from_order + 1);
 }
 
 void
@@ -248,9 +311,12 @@ Queue::DeletePosition(unsigned position)
 
 	/* readjust values in the order array */
 
-	for (unsigned i = 0; i < length; i++)
+	for (unsigned i = 0; i < length; i++) {
 		if (order[i] > position)
 			--order[i];
+
+		position_order[order[i]] = i;
+	}
 }
 
 void
@@ -267,6 +333,9 @@ Queue::Clear()
 	}
 
 	length = 0;
+
+	changes.clear();
+	changes_since = version;
 }
 
 static void
@@ -296,6 +365,7 @@ Queue::ShuffleOrderRange(unsigned start, unsigned end)
 
 	rand.AutoCreate();
 	std::shuffle(order + start, order + end, rand);
+	UpdatePositionOrder(start, end);
 }
 
 /**
@@ -419,8 +489,8 @@ Queue::SetPriority(unsigned position, uint8_t priority, int after_order)
 	if (old_priority == priority)
 		return false;
 
-	item->version = version;
 	item->priority = priority;
+	ModifyAtPosition(position);
 
 	if (!random)
 		/* don't reorder if not in random mode */
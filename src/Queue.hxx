@@ -25,6 +25,8 @@
 #include "util/LazyRandomEngine.hxx"
 
 #include <algorithm>
+#include <deque>
+#include <vector>
 
 #include <assert.h>
 #include <stdint.h>
@@ -69,6 +71,15 @@ struct Queue {
 		uint8_t priority;
 	};
 
+	/**
+	 * An entry in the change log: the item at this position was
+	 * modified in this version.
+	 */
+	struct Change {
+		uint32_t version;
+		unsigned position;
+	};
+
 	/** configured maximum length of the queue */
 	unsigned max_length;
 
@@ -84,6 +95,22 @@ struct Queue {
 	/** map order numbers to positions */
 	unsigned *order;
 
+	/** map positions to order numbers; the inverse of #order */
+	unsigned *position_order;
+
+	/**
+	 * All modifications with a version number of at least
+	 * #changes_since, ordered by version.  It allows
+	 * GetChanges() to skip the items which were not modified.
+	 * Its size is limited to #max_length.
+	 */
+	std::deque<Change> changes;
+
+	/**
+	 * The oldest version covered completely by #changes.
+	 */
+	uint32_t changes_since;
+
 	/** map song ids to positions */
 	IdTable id_table;
 
@@ -171,13 +198,9 @@ struct Queue {
 	gcc_pure
 	unsigned PositionToOrder(unsigned position) const {
 		assert(position < length);
+		assert(order[position_order[position]] == position);
 
-		for (unsigned i = 0;; ++i) {
-			assert(i < length);
-
-			if (order[i] == position)
-				return i;
-		}
+		return position_order[position];
 	}
 
 	gcc_pure
@@ -225,6 +248,15 @@ struct Queue {
 			items[position].version == 0;
 	}
 
+	/**
+	 * Collect the positions of all items which are newer than the
+	 * specified version (see IsNewerAtPosition()), in ascending
+	 * order.  This uses the change log if it reaches back far
+	 * enough, and scans the whole queue otherwise.
+	 */
+	void GetChanges(uint32_t _version,
+			std::vector<unsigned> &positions) const;
+
 	/**
 	 * Returns the order number following the specified one.  This takes
 	 * end of queue and "repeat" mode into account.
@@ -249,6 +281,7 @@ struct Queue {
 		assert(position < length);
 
 		items[position].version = version;
+		LogChange(position);
 	}
 
 	/**
@@ -280,6 +313,8 @@ struct Queue {
 	 */
 	void SwapOrders(unsigned order1, unsigned order2) {
 		std::swap(order[order1], order[order2]);
+		position_order[order[order1]] = order1;
+		position_order[order[order2]] = order2;
 	}
 
 	/**
@@ -307,7 +342,7 @@ struct Queue {
 	 */
 	void RestoreOrder() {
 		for (unsigned i = 0; i < length; ++i)
-			order[i] = i;
+			order[i] = position_order[i] = i;
 	}
 
 	/**
@@ -349,6 +384,15 @@ struct Queue {
 			      uint8_t priority, int after_order);
 
 private:
+	/**
+	 * Update #position_order after the "order" range [start, end)
+	 * has been modified.
+	 */
+	void UpdatePositionOrder(unsigned start, unsigned end) {
+		for (unsigned i = start; i < end; ++i)
+			position_order[order[i]] = i;
+	}
+
 	/**
 	 * Moves a song to a new position in the "order" list.
 	 */
@@ -358,10 +402,22 @@ private:
 		unsigned from_id = items[from].id;
 
 		items[to] = items[from];
-		items[to].version = version;
+		ModifyAtPosition(to);
 		id_table.Move(from_id, to);
 	}
 
+	/**
+	 * Adjust the "order" mapping after the items in the position
+	 * range [start, end) have been rotated (like std::rotate()),
+	 * so the item at "middle" is now at "start".
+	 */
+	void RotateOrder(unsigned start, unsigned middle, unsigned end);
+
+	/**
+	 * Add an entry to the change log.
+	 */
+	void LogChange(unsigned position);
+
 	/**
 	 * Find the first item that has this specified priority or
 	 * higher.
@@ -45,6 +45,9 @@ song_alloc(const char *uri, Directory *parent)
 	memcpy(song->uri, uri, uri_length + 1);
 	song->parent = parent;
 	song->mtime = 0;
+	song->size = song->inode = 0;
+	song->mtime_ns = 0;
+	song->hash = 0;
 	song->start_ms = song->end_ms = 0;
 
 	return song;
@@ -70,6 +73,10 @@ Song::ReplaceURI(const char *new_uri)
 	Song *new_song = song_alloc(new_uri, parent);
 	new_song->tag = tag;
 	new_song->mtime = mtime;
+	new_song->size = size;
+	new_song->inode = inode;
+	new_song->mtime_ns = mtime_ns;
+	new_song->hash = hash;
 	new_song->start_ms = start_ms;
 	new_song->end_ms = end_ms;
 	g_free(this);
@@ -26,11 +26,13 @@
 #include <string>
 
 #include <assert.h>
+#include <stdint.h>
 #include <sys/time.h>
 
 #define SONG_FILE	"file: "
 #define SONG_TIME	"Time: "
 
+struct stat;
 struct Tag;
 
 /**
@@ -54,6 +56,21 @@ struct Song {
 	Directory *parent;
 	time_t mtime;
 
+	/**
+	 * More of the file's stat() result, to detect modifications
+	 * which keep the #mtime.  All zero if unknown (e.g. loaded
+	 * from an old database file).
+	 */
+	uint64_t size;
+	uint64_t inode;
+	unsigned mtime_ns;
+
+	/**
+	 * The PartialFileHash() of the file, which allows "rescan" to
+	 * skip files whose content has not changed.  Zero if unknown.
+	 */
+	uint64_t hash;
+
 	/**
 	 * Start of this sub-song within the file in milliseconds.
 	 */
@@ -129,6 +146,20 @@ struct Song {
 	void ReplaceTag(Tag &&tag);
 
 	bool UpdateFile();
+
+	/**
+	 * Copies the fingerprint (#mtime, #size, #inode, #mtime_ns)
+	 * from the file's stat() result.
+	 */
+	void SetStat(const struct stat &st);
+
+	/**
+	 * Compares the file's stat() result with the fingerprint
+	 * stored in this object.  Only #mtime is compared if the rest
+	 * is unknown.
+	 */
+	gcc_pure
+	bool IsModified(const struct stat &st) const;
 	bool UpdateFileInArchive();
 
 	/**
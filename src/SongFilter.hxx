@@ -87,6 +87,7 @@ private:
 
 public:
 	SongFilter() = default;
+	SongFilter(SongFilter &&) = default;
 
 	gcc_nonnull(3)
 	SongFilter(unsigned tag, const char *value, bool fold_case=false);
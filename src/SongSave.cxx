@@ -33,6 +33,10 @@
 #include <stdlib.h>
 
 #define SONG_MTIME "mtime"
+#define SONG_MTIME_NS "mtime_ns"
+#define SONG_SIZE "size"
+#define SONG_INODE "inode"
+#define SONG_HASH "hash"
 #define SONG_END "song_end"
 
 static constexpr Domain song_save_domain("song_save");
@@ -51,6 +55,16 @@ song_save(FILE *fp, const Song &song)
 		tag_save(fp, *song.tag);
 
 	fprintf(fp, SONG_MTIME ": %li\n", (long)song.mtime);
+
+	if (song.inode != 0) {
+		fprintf(fp, SONG_MTIME_NS ": %u\n", song.mtime_ns);
+		fprintf(fp, SONG_SIZE ": %llu\n",
+			(unsigned long long)song.size);
+		fprintf(fp, SONG_INODE ": %llu\n",
+			(unsigned long long)song.inode);
+		fprintf(fp, SONG_HASH ": %llx\n",
+			(unsigned long long)song.hash);
+	}
 	fprintf(fp, SONG_END "\n");
 }
 
@@ -89,6 +103,14 @@ song_load(TextFile &file, Directory *parent, const char *uri,
 			tag.SetHasPlaylist(strcmp(value, "yes") == 0);
 		} else if (strcmp(line, SONG_MTIME) == 0) {
 			song->mtime = atoi(value);
+		} else if (strcmp(line, SONG_MTIME_NS) == 0) {
+			song->mtime_ns = strtoul(value, nullptr, 10);
+		} else if (strcmp(line, SONG_SIZE) == 0) {
+			song->size = strtoull(value, nullptr, 10);
+		} else if (strcmp(line, SONG_INODE) == 0) {
+			song->inode = strtoull(value, nullptr, 10);
+		} else if (strcmp(line, SONG_HASH) == 0) {
+			song->hash = strtoull(value, nullptr, 16);
 		} else if (strcmp(line, "Range") == 0) {
 			char *endptr;
 
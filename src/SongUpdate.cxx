@@ -26,6 +26,7 @@
 #include "fs/AllocatedPath.hxx"
 #include "fs/Traits.hxx"
 #include "fs/FileSystem.hxx"
+#include "fs/FileFingerprint.hxx"
 #include "InputStream.hxx"
 #include "DecoderPlugin.hxx"
 #include "DecoderList.hxx"
@@ -102,13 +103,38 @@ Song::UpdateFile()
 		tag_scan_fallback(path_fs, &full_tag_handler,
 				  &tag_builder);
 
-	mtime = st.st_mtime;
+	SetStat(st);
+	hash = PartialFileHash(path_fs, st.st_size);
 
 	delete tag;
 	tag = tag_builder.Commit();
 	return true;
 }
 
+void
+Song::SetStat(const struct stat &st)
+{
+	mtime = st.st_mtime;
+	size = st.st_size;
+	inode = st.st_ino;
+	mtime_ns = GetStatMtimeNs(st);
+}
+
+bool
+Song::IsModified(const struct stat &st) const
+{
+	if (st.st_mtime != mtime)
+		return true;
+
+	if (inode == 0)
+		/* no fingerprint; loaded from an old database */
+		return false;
+
+	return uint64_t(st.st_size) != size ||
+		uint64_t(st.st_ino) != inode ||
+		GetStatMtimeNs(st) != mtime_ns;
+}
+
 bool
 Song::UpdateFileInArchive()
 {
@@ -25,6 +25,10 @@
 #include "DatabaseGlue.hxx"
 #include "DatabasePlugin.hxx"
 #include "DatabaseSimple.hxx"
+#include "UpdateScan.hxx"
+#include "pcm/PcmCopyStats.hxx"
+#include "tag/TagPool.hxx"
+#include "system/ThreadFaults.hxx"
 #include "util/Error.hxx"
 #include "Log.hxx"
 
@@ -88,6 +92,17 @@ db_stats_print(Client &client)
 		client_printf(client,
 			      "db_update: %lu\n",
 			      (unsigned long)update_stamp);
+
+	if (db_is_simple()) {
+		const UpdateScanStats scan = update_scan_get_stats();
+		client_printf(client,
+			      "db_scan_files: %u\n"
+			      "db_scan_file_size: %llu\n"
+			      "db_scan_time: %u\n",
+			      scan.files,
+			      (unsigned long long)scan.file_size,
+			      scan.duration_ms);
+	}
 }
 
 void
@@ -99,6 +114,48 @@ stats_print(Client &client)
 		      (unsigned long)g_timer_elapsed(uptime, NULL),
 		      (unsigned long)(client.player_control.GetTotalPlayTime() + 0.5));
 
+	const PlayerTransitionStats transitions =
+		client.player_control.GetTransitionStats();
+	client_printf(client,
+		      "transitions: %u\n"
+		      "transitions_predecoded: %u\n"
+		      "transition_latency_avg_us: %llu\n"
+		      "transition_latency_max_us: %u\n",
+		      transitions.count, transitions.predecoded,
+		      transitions.count > 0
+		      ? (unsigned long long)(transitions.total_us /
+					     transitions.count)
+		      : 0ULL,
+		      transitions.max_us);
+
+	client_printf(client,
+		      "copy_decoder: %llu\n"
+		      "copy_export: %llu\n"
+		      "copy_output: %llu\n"
+		      "copy_mmap: %llu\n",
+		      (unsigned long long)pcm_copy_get(PcmCopyPath::DECODER),
+		      (unsigned long long)pcm_copy_get(PcmCopyPath::EXPORT),
+		      (unsigned long long)pcm_copy_get(PcmCopyPath::OUTPUT),
+		      (unsigned long long)pcm_copy_get(PcmCopyPath::MMAP));
+
+	const PageFaults faults = GetThreadFaults();
+	client_printf(client,
+		      "audio_minor_faults: %llu\n"
+		      "audio_major_faults: %llu\n",
+		      (unsigned long long)faults.minor,
+		      (unsigned long long)faults.major);
+
+	const TagPoolStats pool = tag_pool_get_stats();
+	client_printf(client,
+		      "tag_pool_items: %u\n"
+		      "tag_pool_references: %llu\n"
+		      "tag_pool_bytes: %lu\n"
+		      "tag_pool_max_probe: %u\n"
+		      "tag_pool_mean_probe: %.2f\n",
+		      pool.items, pool.references,
+		      (unsigned long)pool.bytes,
+		      pool.max_probe, pool.mean_probe);
+
 	if (GetDatabase() != nullptr)
 		db_stats_print(client);
 }
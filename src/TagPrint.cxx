@@ -40,9 +40,8 @@ void tag_print(Client &client, const Tag &tag)
 	if (tag.time >= 0)
 		client_printf(client, SONG_TIME "%i\n", tag.time);
 
-	for (unsigned i = 0; i < tag.num_items; i++) {
-		client_printf(client, "%s: %s\n",
-			      tag_item_names[tag.items[i]->type],
-			      tag.items[i]->value);
-	}
+	for (unsigned i = 0; i < tag.num_items; i++)
+		client_write_pair(client,
+				  tag_item_names[tag.items[i]->type],
+				  tag.items[i]->value);
 }
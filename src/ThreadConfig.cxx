@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "ThreadConfig.hxx"
+#include "thread/Thread.hxx"
+#include "thread/Schedule.hxx"
+#include "ConfigData.hxx"
+#include "ConfigGlobal.hxx"
+#include "ConfigOption.hxx"
+#include "ConfigError.hxx"
+#include "util/Error.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#ifndef WIN32
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr Domain thread_config_domain("thread_config");
+
+#ifndef WIN32
+
+static bool
+ParsePolicy(const char *s, int &policy_r)
+{
+	if (strcmp(s, "other") == 0)
+		policy_r = SCHED_OTHER;
+	else if (strcmp(s, "fifo") == 0)
+		policy_r = SCHED_FIFO;
+	else if (strcmp(s, "rr") == 0)
+		policy_r = SCHED_RR;
+#ifdef SCHED_BATCH
+	else if (strcmp(s, "batch") == 0)
+		policy_r = SCHED_BATCH;
+#endif
+#ifdef SCHED_IDLE
+	else if (strcmp(s, "idle") == 0)
+		policy_r = SCHED_IDLE;
+#endif
+	else
+		return false;
+
+	return true;
+}
+
+#endif
+
+#ifdef __linux__
+
+/**
+ * Parses a list of CPU numbers and ranges, e.g. "0,2-3".
+ */
+static bool
+ParseCpuList(const char *s, cpu_set_t &cpus)
+{
+	CPU_ZERO(&cpus);
+
+	while (true) {
+		char *endptr;
+		const unsigned long first = strtoul(s, &endptr, 10);
+		if (endptr == s)
+			return false;
+
+		unsigned long last = first;
+		s = endptr;
+		if (*s == '-') {
+			++s;
+			last = strtoul(s, &endptr, 10);
+			if (endptr == s || last < first)
+				return false;
+
+			s = endptr;
+		}
+
+		if (last >= CPU_SETSIZE)
+			return false;
+
+		for (unsigned long i = first; i <= last; ++i)
+			CPU_SET(i, &cpus);
+
+		if (*s == 0)
+			return true;
+
+		if (*s != ',')
+			return false;
+
+		++s;
+	}
+}
+
+#endif
+
+static bool
+ParseThreadBlock(const config_param &param, Error &error)
+{
+	const char *name = param.GetBlockValue("name");
+	if (name == nullptr) {
+		error.Format(config_domain,
+			     "thread configuration without 'name' in line %d",
+			     param.line);
+		return false;
+	}
+
+	ThreadSchedule schedule;
+
+	const char *policy = param.GetBlockValue("policy");
+	if (policy != nullptr) {
+#ifdef WIN32
+		error.Format(config_domain,
+			     "scheduling policies are not supported on this platform (line %d)",
+			     param.line);
+		return false;
+#else
+		if (!ParsePolicy(policy, schedule.policy)) {
+			error.Format(config_domain,
+				     "unknown scheduling policy \"%s\" in line %d",
+				     policy, param.line);
+			return false;
+		}
+
+		schedule.priority = param.GetBlockValue("priority", 0);
+
+		const int min = sched_get_priority_min(schedule.policy);
+		const int max = sched_get_priority_max(schedule.policy);
+		if (schedule.priority < min || schedule.priority > max) {
+			error.Format(config_domain,
+				     "priority %d is out of range (%d..%d) for policy \"%s\" in line %d",
+				     schedule.priority, min, max,
+				     policy, param.line);
+			return false;
+		}
+#endif
+	} else if (param.GetBlockValue("priority") != nullptr) {
+		error.Format(config_domain,
+			     "'priority' requires 'policy' in line %d",
+			     param.line);
+		return false;
+	}
+
+	schedule.timer_slack_ns =
+		param.GetBlockValue("timer_slack", 0u) * 1000ul;
+
+	const char *cpus = param.GetBlockValue("cpus");
+	if (cpus != nullptr) {
+#ifdef __linux__
+		if (!ParseCpuList(cpus, schedule.cpus)) {
+			error.Format(config_domain,
+				     "malformed CPU list \"%s\" in line %d",
+				     cpus, param.line);
+			return false;
+		}
+#else
+		FormatWarning(thread_config_domain,
+			      "CPU affinity is not supported on this platform (line %d)",
+			      param.line);
+#endif
+	}
+
+	Thread::SetSchedule(name, schedule);
+	return true;
+}
+
+bool
+ThreadConfigInit(Error &error)
+{
+	const struct config_param *param = nullptr;
+	while ((param = config_get_next_param(CONF_THREAD, param)) != nullptr)
+		if (!ParseThreadBlock(*param, error))
+			return false;
+
+	return true;
+}
+
+void
+ThreadConfigLockMemory()
+{
+	if (!config_get_bool(CONF_MEMORY_LOCK, false))
+		return;
+
+#ifdef WIN32
+	LogWarning(thread_config_domain,
+		   "memory_lock is not supported on this platform");
+#else
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+		LogErrno(thread_config_domain, "Failed to lock memory");
+#endif
+}
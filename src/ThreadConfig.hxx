@@ -1,5 +1,6 @@
 /*
- * Copyright (C) 2014-2015 Jurgen Kramer
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
  *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -16,23 +17,25 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
-#ifndef MPD_PCM_DSD_NATIVE_HXX
-#define MPD_PCM_DSD_NATIVE_HXX
+#ifndef MPD_THREAD_CONFIG_HXX
+#define MPD_THREAD_CONFIG_HXX
 
-#include "check.h"
+class Error;
 
-#include <stdint.h>
-#include <stddef.h>
-
-class PcmBuffer;
+/**
+ * Parses the "thread" blocks from the configuration file, and
+ * registers their scheduling parameters with Thread::SetSchedule().
+ * Must be called before any thread is started.
+ */
+bool
+ThreadConfigInit(Error &error);
 
 /**
- * Pack DSD 1 bit samples into DSD_U32_LE samples for
- * native DSD playback
+ * Locks all current and future memory pages of the process into RAM,
+ * if "memory_lock" is enabled.  Memory locks are not inherited by a
+ * child process, so this must be called after daemonizing.
  */
-const uint32_t *
-pcm_dsd_native(PcmBuffer &buffer, unsigned channels,
-	       const uint8_t *src, size_t src_size,
-	       size_t *dest_size_r, unsigned dsd_native_type);
+void
+ThreadConfigLockMemory();
 
 #endif
@@ -22,6 +22,7 @@
 #include "UpdateInternal.hxx"
 #include "UpdateDomain.hxx"
 #include "DatabaseLock.hxx"
+#include "DatabaseSimple.hxx"
 #include "Directory.hxx"
 #include "Song.hxx"
 #include "Mapper.hxx"
@@ -68,6 +69,7 @@ update_archive_tree(Directory &directory, const char *name)
 			if (song != nullptr) {
 				db_lock();
 				directory.AddSong(song);
+				db_index_add_song(*song);
 				db_unlock();
 
 				modified = true;
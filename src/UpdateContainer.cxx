@@ -23,6 +23,7 @@
 #include "UpdateDatabase.hxx"
 #include "UpdateDomain.hxx"
 #include "DatabaseLock.hxx"
+#include "DatabaseSimple.hxx"
 #include "Directory.hxx"
 #include "Song.hxx"
 #include "DecoderPlugin.hxx"
@@ -108,6 +109,7 @@ update_container_file(Directory &directory,
 
 		db_lock();
 		contdir->AddSong(song);
+		db_index_add_song(*song);
 		db_unlock();
 
 		modified = true;
@@ -24,6 +24,7 @@
 #include "Directory.hxx"
 #include "Song.hxx"
 #include "DatabaseLock.hxx"
+#include "DatabaseSimple.hxx"
 
 #include <assert.h>
 #include <stddef.h>
@@ -35,6 +36,7 @@ delete_song(Directory &dir, Song *del)
 
 	/* first, prevent traversers in main task from getting this */
 	dir.RemoveSong(del);
+	db_index_remove_song(*del);
 
 	db_unlock(); /* temporary unlock, because update_remove_song() blocks */
 
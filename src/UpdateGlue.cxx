@@ -21,6 +21,7 @@
 #include "UpdateGlue.hxx"
 #include "UpdateQueue.hxx"
 #include "UpdateWalk.hxx"
+#include "UpdateScan.hxx"
 #include "UpdateRemove.hxx"
 #include "UpdateDomain.hxx"
 #include "Mapper.hxx"
@@ -69,9 +70,10 @@ update_task(gcc_unused void *ctx)
 	else
 		LogDebug(update_domain, "starting");
 
-	modified = update_walk(next.path_utf8.c_str(), next.discard);
+	bool save = false;
+	modified = update_walk(next.path_utf8.c_str(), next.discard, save);
 
-	if (modified || !db_exists()) {
+	if (modified || save || !db_exists()) {
 		Error error;
 		if (!db_save(error))
 			LogError(error, "Failed to save database");
@@ -98,7 +100,7 @@ spawn_update_task(UpdateQueueItem &&i)
 	next = std::move(i);
 
 	Error error;
-	if (!update_thread.Start(update_task, nullptr, error))
+	if (!update_thread.Start(update_task, nullptr, "update", error))
 		FatalError(error);
 
 	FormatDebug(update_domain,
@@ -173,6 +175,7 @@ void update_global_init(void)
 
 	update_remove_global_init();
 	update_walk_global_init();
+	update_scan_global_init();
 }
 
 void update_global_finish(void)
@@ -25,4 +25,12 @@
 extern bool walk_discard;
 extern bool modified;
 
+/**
+ * Set when a directory entry was rejected for a reason which may go
+ * away without touching the directory's modification time (missing
+ * read permissions, unsupported suffix, symlink configuration).  The
+ * directory's listing must then not be skipped by the next update.
+ */
+extern bool walk_incomplete;
+
 #endif
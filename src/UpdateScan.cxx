@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h" /* must be first for large file support */
+#include "UpdateScan.hxx"
+#include "UpdateSong.hxx"
+#include "UpdateDomain.hxx"
+#include "DatabaseLock.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+#include "DecoderList.hxx"
+#include "ConfigGlobal.hxx"
+#include "ConfigOption.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+#include "system/Clock.hxx"
+#include "util/Error.hxx"
+#include "util/UriUtil.hxx"
+#include "Log.hxx"
+
+#include <list>
+#include <string>
+
+#include <assert.h>
+
+/*
+ * The update thread walks the tree (directory reads, stat() and the
+ * decisions based on them) and hands each file whose tags need to be
+ * read to this pool.  Song::LoadFile() runs in the scanner threads
+ * on a song object which is not yet part of the tree, so they never
+ * touch the database.  The update thread merges the finished songs
+ * in batches under the #db_mutex.
+ *
+ * A #Directory with a pending job is never deleted during the walk:
+ * the walk only deletes directories it has not descended into yet,
+ * and PruneEmpty() runs after update_scan_end().
+ */
+
+static constexpr unsigned DEFAULT_UPDATE_THREADS = 4;
+
+struct UpdateScanJob {
+	Directory *directory;
+	std::string name;
+
+	/**
+	 * The result: a new #Song with the tag (not yet added to the
+	 * #Directory), or nullptr if the file was not recognized.
+	 */
+	Song *song;
+
+	UpdateScanJob(Directory &_directory, const char *_name)
+		:directory(&_directory), name(_name), song(nullptr) {}
+};
+
+static unsigned n_threads;
+static Thread *threads;
+static unsigned n_started;
+
+static Mutex scan_mutex;
+
+/**
+ * Wakes up the scanner threads: a new job or #scan_quit.
+ */
+static Cond scan_cond;
+
+/**
+ * Wakes up the update thread: a job has finished.
+ */
+static Cond result_cond;
+
+static std::list<UpdateScanJob> pending, finished;
+
+/**
+ * The number of jobs being scanned right now.
+ */
+static unsigned n_running;
+
+static bool scan_quit;
+
+/**
+ * Held by a scanner thread while it scans a file with a decoder
+ * plugin which does not have DecoderPlugin::reentrant.
+ */
+static Mutex serial_scan_mutex;
+
+/**
+ * The counters of the current update, and whether it is still
+ * running.  Protected by #scan_mutex.
+ */
+static UpdateScanStats scan_stats;
+static unsigned scan_start_ms;
+static bool scan_running;
+
+void
+update_scan_global_init()
+{
+	n_threads = config_get_unsigned(CONF_UPDATE_THREADS,
+					DEFAULT_UPDATE_THREADS);
+}
+
+static void
+scan_thread_func(gcc_unused void *ctx)
+{
+	const ScopeLock protect(scan_mutex);
+
+	while (true) {
+		if (pending.empty()) {
+			if (scan_quit)
+				break;
+
+			scan_cond.wait(scan_mutex);
+			continue;
+		}
+
+		std::list<UpdateScanJob> current;
+		current.splice(current.end(), pending, pending.begin());
+		++n_running;
+
+		scan_mutex.unlock();
+
+		UpdateScanJob &job = current.front();
+		const char *suffix = uri_get_suffix(job.name.c_str());
+		if (decoder_plugins_reentrant(suffix))
+			job.song = Song::LoadFile(job.name.c_str(),
+						  job.directory);
+		else {
+			const ScopeLock serial(serial_scan_mutex);
+			job.song = Song::LoadFile(job.name.c_str(),
+						  job.directory);
+		}
+
+		scan_mutex.lock();
+
+		--n_running;
+		finished.splice(finished.end(), current);
+		result_cond.signal();
+	}
+}
+
+/**
+ * The maximum number of files which may be queued or waiting to be
+ * merged, to bound memory usage on huge directories.
+ */
+gcc_pure
+static unsigned
+max_outstanding()
+{
+	return n_started * 8 + 16;
+}
+
+void
+update_scan_begin()
+{
+	assert(n_started == 0);
+	assert(pending.empty());
+	assert(finished.empty());
+
+	scan_mutex.lock();
+	scan_stats = UpdateScanStats();
+	scan_start_ms = MonotonicClockMS();
+	scan_running = true;
+	scan_quit = false;
+	scan_mutex.unlock();
+
+	if (n_threads == 0)
+		return;
+
+	threads = new Thread[n_threads];
+	for (unsigned i = 0; i < n_threads; ++i) {
+		Error error;
+		if (!threads[i].Start(scan_thread_func, nullptr, "update:scan",
+				      error)) {
+			LogError(error);
+			break;
+		}
+
+		++n_started;
+	}
+}
+
+void
+update_scan_merge()
+{
+	std::list<UpdateScanJob> batch;
+
+	scan_mutex.lock();
+	batch.swap(finished);
+	scan_mutex.unlock();
+
+	if (batch.empty())
+		return;
+
+	db_lock();
+	for (auto &job : batch)
+		update_song_apply(*job.directory, job.name.c_str(), job.song);
+	db_unlock();
+}
+
+void
+update_scan_submit(Directory &directory, const char *name,
+		   const struct stat &st)
+{
+	scan_mutex.lock();
+	++scan_stats.files;
+	scan_stats.file_size += st.st_size;
+
+	if (n_started == 0) {
+		scan_mutex.unlock();
+
+		Song *song = Song::LoadFile(name, &directory);
+
+		db_lock();
+		update_song_apply(directory, name, song);
+		db_unlock();
+		return;
+	}
+
+	while (pending.size() + n_running + finished.size() >=
+	       max_outstanding()) {
+		if (finished.empty()) {
+			result_cond.wait(scan_mutex);
+			continue;
+		}
+
+		scan_mutex.unlock();
+		update_scan_merge();
+		scan_mutex.lock();
+	}
+
+	pending.emplace_back(directory, name);
+	scan_cond.signal();
+
+	const bool have_results = !finished.empty();
+	scan_mutex.unlock();
+
+	if (have_results)
+		update_scan_merge();
+}
+
+void
+update_scan_end()
+{
+	scan_mutex.lock();
+
+	while (!pending.empty() || n_running > 0 || !finished.empty()) {
+		if (finished.empty()) {
+			result_cond.wait(scan_mutex);
+			continue;
+		}
+
+		scan_mutex.unlock();
+		update_scan_merge();
+		scan_mutex.lock();
+	}
+
+	scan_quit = true;
+	scan_cond.broadcast();
+
+	scan_stats.duration_ms = MonotonicClockMS() - scan_start_ms;
+	scan_running = false;
+	const UpdateScanStats stats = scan_stats;
+
+	scan_mutex.unlock();
+
+	for (unsigned i = 0; i < n_started; ++i)
+		threads[i].Join();
+
+	delete[] threads;
+	threads = nullptr;
+	n_started = 0;
+
+	if (stats.files > 0)
+		FormatDebug(update_domain,
+			    "scanned %u files (%llu bytes total) in %u ms",
+			    stats.files, (unsigned long long)stats.file_size,
+			    stats.duration_ms);
+}
+
+UpdateScanStats
+update_scan_get_stats()
+{
+	const ScopeLock protect(scan_mutex);
+	UpdateScanStats stats = scan_stats;
+	if (scan_running)
+		stats.duration_ms = MonotonicClockMS() - scan_start_ms;
+	return stats;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_UPDATE_SCAN_HXX
+#define MPD_UPDATE_SCAN_HXX
+
+#include "check.h"
+#include "Compiler.h"
+
+#include <stdint.h>
+#include <sys/stat.h>
+
+struct Directory;
+
+/**
+ * Throughput counters of one database update.
+ */
+struct UpdateScanStats {
+	/**
+	 * The number of files whose tags were read.
+	 */
+	unsigned files;
+
+	/**
+	 * The total size of these files in bytes, according to
+	 * stat().  This is not the amount of data which was read:
+	 * most plugins read only the headers.
+	 */
+	uint64_t file_size;
+
+	/**
+	 * The duration of the update in milliseconds.
+	 */
+	unsigned duration_ms;
+};
+
+void
+update_scan_global_init();
+
+/**
+ * Starts the tag scanner threads for one update run.  Called by the
+ * update thread.
+ */
+void
+update_scan_begin();
+
+/**
+ * Waits until all submitted files have been scanned, merges the
+ * remaining results into the tree and stops the threads.  Called by
+ * the update thread.
+ */
+void
+update_scan_end();
+
+/**
+ * Reads the tags of a new or modified song file in one of the
+ * scanner threads.  The result is merged into the #Directory later,
+ * by update_scan_merge() or update_scan_end().  Without scanner
+ * threads, the file is scanned and merged right away.
+ *
+ * The #Directory must not be deleted before update_scan_end().
+ */
+void
+update_scan_submit(Directory &directory, const char *name,
+		   const struct stat &st);
+
+/**
+ * Merges the results which are finished so far into the tree, in
+ * one batch under the #db_mutex.  Does not block.
+ */
+void
+update_scan_merge();
+
+/**
+ * Returns the counters of the most recent update (or of the one
+ * which is running).  May be called from any thread.
+ */
+gcc_pure
+UpdateScanStats
+update_scan_get_stats();
+
+#endif
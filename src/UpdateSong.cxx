@@ -23,16 +23,39 @@
 #include "UpdateIO.hxx"
 #include "UpdateDatabase.hxx"
 #include "UpdateContainer.hxx"
+#include "UpdateScan.hxx"
 #include "UpdateDomain.hxx"
 #include "DatabaseLock.hxx"
+#include "DatabaseSimple.hxx"
 #include "Directory.hxx"
 #include "Song.hxx"
+#include "Mapper.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/FileFingerprint.hxx"
 #include "DecoderPlugin.hxx"
 #include "DecoderList.hxx"
 #include "Log.hxx"
 
+#include <algorithm>
+
 #include <unistd.h>
 
+/**
+ * Does the song file still have the contents it had when it was
+ * scanned?  Used by a "rescan" to avoid re-reading the tags of files
+ * whose fingerprint has not changed.
+ */
+static bool
+song_content_unchanged(const Song &song, const struct stat &st)
+{
+	if (song.hash == 0)
+		return false;
+
+	const auto path_fs = map_song_fs(song);
+	return !path_fs.IsNull() &&
+		PartialFileHash(path_fs, st.st_size) == song.hash;
+}
+
 static void
 update_song_file2(Directory &directory,
 		  const char *name, const struct stat *st,
@@ -46,6 +69,8 @@ update_song_file2(Directory &directory,
 		FormatError(update_domain,
 			    "no read permissions on %s/%s",
 			    directory.GetPath(), name);
+		walk_incomplete = true;
+
 		if (song != nullptr) {
 			db_lock();
 			delete_song(directory, song);
@@ -55,8 +80,10 @@ update_song_file2(Directory &directory,
 		return;
 	}
 
-	if (!(song != nullptr && st->st_mtime == song->mtime &&
-	      !walk_discard) &&
+	const bool unchanged = song != nullptr && !song->IsModified(*st) &&
+		(!walk_discard || song_content_unchanged(*song, *st));
+
+	if (!unchanged &&
 	    update_container_file(directory, name, st, plugin)) {
 		if (song != nullptr) {
 			db_lock();
@@ -70,7 +97,20 @@ update_song_file2(Directory &directory,
 	if (song == nullptr) {
 		FormatDebug(update_domain, "reading %s/%s",
 			    directory.GetPath(), name);
-		song = Song::LoadFile(name, &directory);
+		update_scan_submit(directory, name, *st);
+	} else if (!unchanged) {
+		FormatDefault(update_domain, "updating %s/%s",
+			      directory.GetPath(), name);
+		update_scan_submit(directory, name, *st);
+	}
+}
+
+void
+update_song_apply(Directory &directory, const char *name, Song *scanned)
+{
+	Song *song = directory.FindSong(name);
+
+	if (scanned == nullptr) {
 		if (song == nullptr) {
 			FormatDebug(update_domain,
 				    "ignoring unrecognized file %s/%s",
@@ -78,27 +118,36 @@ update_song_file2(Directory &directory,
 			return;
 		}
 
-		db_lock();
-		directory.AddSong(song);
-		db_unlock();
-
+		FormatDebug(update_domain,
+			    "deleting unrecognized file %s/%s",
+			    directory.GetPath(), name);
+		delete_song(directory, song);
 		modified = true;
+		return;
+	}
+
+	if (song == nullptr) {
+		directory.AddSong(scanned);
+		db_index_add_song(*scanned);
+
 		FormatDefault(update_domain, "added %s/%s",
 			      directory.GetPath(), name);
-	} else if (st->st_mtime != song->mtime || walk_discard) {
-		FormatDefault(update_domain, "updating %s/%s",
-			      directory.GetPath(), name);
-		if (!song->UpdateFile()) {
-			FormatDebug(update_domain,
-				    "deleting unrecognized file %s/%s",
-				    directory.GetPath(), name);
-			db_lock();
-			delete_song(directory, song);
-			db_unlock();
-		}
+	} else {
+		/* move the new tag into the existing object, which
+		   may be referenced by the queue */
+		db_index_remove_song(*song);
+		std::swap(song->tag, scanned->tag);
+		song->mtime = scanned->mtime;
+		song->size = scanned->size;
+		song->inode = scanned->inode;
+		song->mtime_ns = scanned->mtime_ns;
+		song->hash = scanned->hash;
+		db_index_add_song(*song);
 
-		modified = true;
+		scanned->Free();
 	}
+
+	modified = true;
 }
 
 bool
@@ -25,10 +25,22 @@
 #include <sys/stat.h>
 
 struct Directory;
+struct Song;
 
 bool
 update_song_file(Directory &directory,
 		 const char *name, const char *suffix,
 		 const struct stat *st);
 
+/**
+ * Merges the result of a tag scan (see UpdateScan.hxx) into the
+ * #Directory: adds the new song, replaces the tag of the existing
+ * one, or deletes the existing one if the file is no longer
+ * recognized.  Takes ownership of #scanned (which may be nullptr).
+ *
+ * Caller must lock the #db_mutex.
+ */
+void
+update_song_apply(Directory &directory, const char *name, Song *scanned);
+
 #endif
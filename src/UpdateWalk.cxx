@@ -22,6 +22,7 @@
 #include "UpdateIO.hxx"
 #include "UpdateDatabase.hxx"
 #include "UpdateSong.hxx"
+#include "UpdateScan.hxx"
 #include "UpdateArchive.hxx"
 #include "UpdateDomain.hxx"
 #include "DatabaseLock.hxx"
@@ -43,6 +44,10 @@
 
 #include <glib.h>
 
+#include <vector>
+#include <string>
+#include <algorithm>
+
 #include <assert.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -51,9 +56,18 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <time.h>
 
 bool walk_discard;
 bool modified;
+bool walk_incomplete;
+
+/**
+ * Set when a directory's scan time was recorded which allows skipping
+ * its listing next time; the database file needs to be saved even if
+ * nothing else was modified.
+ */
+static bool scan_times_modified;
 
 #ifndef WIN32
 
@@ -122,12 +136,74 @@ remove_excluded_from_directory(Directory &directory,
 	db_unlock();
 }
 
+/**
+ * An entry of a directory listing, see update_directory().
+ */
+struct ListingEntry {
+	/** the UTF-8 name */
+	std::string name;
+
+	/**
+	 * The result of stat_directory_child(); only valid if
+	 * #have_stat is set.
+	 */
+	struct stat st;
+
+	/**
+	 * False if the entry is a symlink which must be skipped, or
+	 * if stat_directory_child() has failed.
+	 */
+	bool have_stat;
+
+	bool operator<(const ListingEntry &other) const {
+		return name < other.name;
+	}
+};
+
+/**
+ * Look up a name in the sorted directory listing.
+ *
+ * @return the stat of the entry, or nullptr if it was not listed (or
+ * could not be stat'ed)
+ */
+gcc_pure
+static const struct stat *
+find_listed(const std::vector<ListingEntry> &listing, const char *name)
+{
+	auto i = std::lower_bound(listing.begin(), listing.end(), name,
+				  [](const ListingEntry &e, const char *n){
+					  return e.name < n;
+				  });
+	return i != listing.end() && i->name == name && i->have_stat
+		? &i->st
+		: nullptr;
+}
+
+/**
+ * Remove all entries from the database which are not in the
+ * directory listing, or whose type has changed (e.g. a directory
+ * which was replaced by a file of the same name).
+ *
+ * @param listing all directory entries, sorted by name
+ */
 static void
-purge_deleted_from_directory(Directory &directory)
+purge_deleted_from_directory(Directory &directory,
+			     const std::vector<ListingEntry> &listing)
 {
+	const auto is_regular = [&listing](const char *name){
+		const struct stat *st = find_listed(listing, name);
+		return st != nullptr && S_ISREG(st->st_mode);
+	};
+
 	Directory *child, *n;
 	directory_for_each_child_safe(child, n, directory) {
-		if (directory_exists(*child))
+		/* archives and containers are regular files */
+		const bool virtual_child = child->device == DEVICE_INARCHIVE ||
+			child->device == DEVICE_CONTAINER;
+		const struct stat *st = find_listed(listing,
+						   child->GetName());
+		if (st != nullptr &&
+		    (virtual_child ? S_ISREG(st->st_mode) : S_ISDIR(st->st_mode)))
 			continue;
 
 		db_lock();
@@ -139,8 +215,7 @@ purge_deleted_from_directory(Directory &directory)
 
 	Song *song, *ns;
 	directory_for_each_song_safe(song, ns, directory) {
-		const auto path = map_song_fs(*song);
-		if (path.IsNull() || !FileExists(path)) {
+		if (!is_regular(song->uri)) {
 			db_lock();
 			delete_song(directory, song);
 			db_unlock();
@@ -152,7 +227,7 @@ purge_deleted_from_directory(Directory &directory)
 	for (auto i = directory.playlists.begin(),
 		     end = directory.playlists.end();
 	     i != end;) {
-		if (!directory_child_is_regular(directory, i->name.c_str())) {
+		if (!is_regular(i->name.c_str())) {
 			db_lock();
 			i = directory.playlists.erase(i);
 			db_unlock();
@@ -220,12 +295,15 @@ update_regular_file(Directory &directory,
 		    const char *name, const struct stat *st)
 {
 	const char *suffix = uri_get_suffix(name);
-	if (suffix == nullptr)
-		return false;
+	if (suffix != nullptr &&
+	    (update_song_file(directory, name, suffix, st) ||
+	     update_archive_file(directory, name, suffix, st) ||
+	     update_playlist_file2(directory, name, suffix, st)))
+		return true;
 
-	return update_song_file(directory, name, suffix, st) ||
-		update_archive_file(directory, name, suffix, st) ||
-		update_playlist_file2(directory, name, suffix, st);
+	/* a plugin supporting this file may be enabled later */
+	walk_incomplete = true;
+	return false;
 }
 
 static bool
@@ -336,6 +414,70 @@ skip_symlink(const Directory *directory, const char *utf8_name)
 #endif
 }
 
+/**
+ * Can the directory listing be skipped?  This is true if the
+ * directory's modification time has not changed since it was last
+ * listed completely, and that modification was in an earlier second
+ * than the listing (otherwise a later change within the same second
+ * would go unnoticed).  An in-place edit of the ".mpdignore" file
+ * does not touch the directory, so its time stamp is checked, too.
+ */
+static bool
+directory_listing_unchanged(const Directory &directory,
+			    const struct stat &st)
+{
+	if (walk_discard || directory.scan_time == 0 ||
+	    directory.mtime != st.st_mtime ||
+	    st.st_mtime >= directory.scan_time)
+		return false;
+
+	const auto path_fs = map_directory_fs(directory);
+	if (path_fs.IsNull())
+		return false;
+
+	struct stat ignore_st;
+	return !StatFile(AllocatedPath::Build(path_fs, ".mpdignore"),
+			 ignore_st) ||
+		ignore_st.st_mtime < directory.scan_time;
+}
+
+/**
+ * Update a directory whose listing has not changed: instead of
+ * reading it and applying the exclude list again, check only the
+ * files and sub directories which are already in the database.
+ * Their contents may have changed without touching the directory's
+ * modification time.
+ */
+static void
+update_known_children(Directory &directory)
+{
+	/* copy the names first, because updating a child may delete
+	   it from the directory */
+	std::vector<std::string> names;
+
+	Directory *child;
+	directory_for_each_child(child, directory)
+		names.emplace_back(child->GetName());
+
+	Song *song;
+	directory_for_each_song(song, directory)
+		names.emplace_back(song->uri);
+
+	for (const auto &pi : directory.playlists)
+		names.emplace_back(pi.name);
+
+	for (const auto &name : names) {
+		/* the symlink configuration may have changed since
+		   the listing was recorded */
+		struct stat st;
+		if (!skip_symlink(&directory, name.c_str()) &&
+		    stat_directory_child(directory, name.c_str(), &st) == 0)
+			update_directory_child(directory, name.c_str(), &st);
+		else
+			modified |= delete_name_in(directory, name.c_str());
+	}
+}
+
 static bool
 update_directory(Directory &directory, const struct stat *st)
 {
@@ -343,6 +485,29 @@ update_directory(Directory &directory, const struct stat *st)
 
 	directory_set_stat(directory, st);
 
+	if (directory_listing_unchanged(directory, *st)) {
+		const bool parent_incomplete = walk_incomplete;
+		walk_incomplete = false;
+
+		update_known_children(directory);
+
+		if (walk_incomplete) {
+			/* a known entry is now rejected: list the
+			   directory again next time */
+			directory.scan_time = 0;
+			scan_times_modified = true;
+		}
+
+		walk_incomplete = parent_incomplete;
+
+		update_scan_merge();
+		return true;
+	}
+
+	/* obtain the time stamp before reading the directory, so
+	   modifications during the listing are never missed */
+	const time_t scan_time = time(nullptr);
+
 	const auto path_fs = map_directory_fs(directory);
 	if (path_fs.IsNull())
 		return false;
@@ -363,33 +528,63 @@ update_directory(Directory &directory, const struct stat *st)
 	if (!exclude_list.IsEmpty())
 		remove_excluded_from_directory(directory, exclude_list);
 
-	purge_deleted_from_directory(directory);
-
+	/* read (and stat) the whole listing first, so vanished
+	   entries can be purged without checking each known entry in
+	   the file system */
+	std::vector<ListingEntry> listing;
 	while (reader.ReadEntry()) {
-		std::string utf8;
-		struct stat st2;
-
 		const auto entry = reader.GetEntry();
 
 		if (skip_path(entry) || exclude_list.Check(entry))
 			continue;
 
-		utf8 = entry.ToUTF8();
+		std::string utf8 = entry.ToUTF8();
 		if (utf8.empty())
 			continue;
 
-		if (skip_symlink(&directory, utf8.c_str())) {
-			modified |= delete_name_in(directory, utf8.c_str());
-			continue;
-		}
+		listing.emplace_back();
+		ListingEntry &e = listing.back();
+		e.name = std::move(utf8);
+		e.have_stat = !skip_symlink(&directory, e.name.c_str()) &&
+			stat_directory_child(directory, e.name.c_str(),
+					     &e.st) == 0;
+	}
 
-		if (stat_directory_child(directory, utf8.c_str(), &st2) == 0)
-			update_directory_child(directory, utf8.c_str(), &st2);
-		else
-			modified |= delete_name_in(directory, utf8.c_str());
+	std::sort(listing.begin(), listing.end());
+
+	purge_deleted_from_directory(directory, listing);
+
+	/* the flag is per directory; sub directories updated from
+	   the loop below save and restore it */
+	const bool parent_incomplete = walk_incomplete;
+	walk_incomplete = false;
+
+	for (const auto &entry : listing) {
+		const char *utf8 = entry.name.c_str();
+
+		if (entry.have_stat)
+			update_directory_child(directory, utf8, &entry.st);
+		else {
+			modified |= delete_name_in(directory, utf8);
+			walk_incomplete = true;
+		}
 	}
 
+	/* record the listing time only if every entry was either
+	   accepted or rejected permanently; otherwise the next update
+	   needs to look at the rejected entries again */
+	const time_t new_scan_time = walk_incomplete ? 0 : scan_time;
+	walk_incomplete = parent_incomplete;
+
+	if ((directory.scan_time == 0) != (new_scan_time == 0) ||
+	    directory.mtime != st->st_mtime)
+		scan_times_modified = true;
+
 	directory.mtime = st->st_mtime;
+	directory.scan_time = new_scan_time;
+
+	/* merge what the scanner threads have finished so far */
+	update_scan_merge();
 
 	return true;
 }
@@ -469,10 +664,14 @@ update_uri(const char *uri)
 }
 
 bool
-update_walk(const char *path, bool discard)
+update_walk(const char *path, bool discard, bool &save_r)
 {
 	walk_discard = discard;
 	modified = false;
+	walk_incomplete = false;
+	scan_times_modified = false;
+
+	update_scan_begin();
 
 	if (path != nullptr && !isRootDirectory(path)) {
 		update_uri(path);
@@ -484,5 +683,8 @@ update_walk(const char *path, bool discard)
 			update_directory(*directory, &st);
 	}
 
+	update_scan_end();
+
+	save_r = scan_times_modified;
 	return modified;
 }
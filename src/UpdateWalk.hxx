@@ -30,8 +30,12 @@ update_walk_global_finish(void);
 
 /**
  * Returns true if the database was modified.
+ *
+ * @param save_r set to true if the database file should be saved
+ * even though it was not modified, e.g. because new directory scan
+ * times were recorded
  */
 bool
-update_walk(const char *path, bool discard);
+update_walk(const char *path, bool discard, bool &save_r);
 
 #endif
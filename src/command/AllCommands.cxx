@@ -33,13 +33,17 @@
 #include "Client.hxx"
 #include "util/Tokenizer.hxx"
 #include "util/Error.hxx"
+#include "system/Clock.hxx"
 
 #ifdef ENABLE_SQLITE
 #include "StickerCommands.hxx"
 #include "StickerDatabase.hxx"
 #endif
 
+#include <atomic>
+
 #include <assert.h>
+#include <stdint.h>
 #include <string.h>
 
 /*
@@ -57,6 +61,13 @@ struct command {
 	int min;
 	int max;
 	CommandResult (*handler)(Client &client, int argc, char **argv);
+
+	/**
+	 * May this command be executed by a worker thread?  This is
+	 * only allowed for commands which read nothing but the
+	 * database and the #Client's permissions.
+	 */
+	bool thread_safe;
 };
 
 /* don't be fooled, this is the command handler for "commands" command */
@@ -66,108 +77,160 @@ handle_commands(Client &client, int argc, char *argv[]);
 static CommandResult
 handle_not_commands(Client &client, int argc, char *argv[]);
 
+static CommandResult
+handle_commandstats(Client &client, int argc, char *argv[]);
+
 /**
  * The command registry.
  *
  * This array must be sorted!
  */
 static const struct command commands[] = {
-	{ "add", PERMISSION_ADD, 1, 1, handle_add },
-	{ "addid", PERMISSION_ADD, 1, 2, handle_addid },
-	{ "channels", PERMISSION_READ, 0, 0, handle_channels },
-	{ "clear", PERMISSION_CONTROL, 0, 0, handle_clear },
-	{ "clearerror", PERMISSION_CONTROL, 0, 0, handle_clearerror },
-	{ "close", PERMISSION_NONE, -1, -1, handle_close },
-	{ "commands", PERMISSION_NONE, 0, 0, handle_commands },
-	{ "config", PERMISSION_ADMIN, 0, 0, handle_config },
-	{ "consume", PERMISSION_CONTROL, 1, 1, handle_consume },
-	{ "count", PERMISSION_READ, 2, -1, handle_count },
-	{ "crossfade", PERMISSION_CONTROL, 1, 1, handle_crossfade },
-	{ "currentsong", PERMISSION_READ, 0, 0, handle_currentsong },
-	{ "decoders", PERMISSION_READ, 0, 0, handle_decoders },
-	{ "delete", PERMISSION_CONTROL, 1, 1, handle_delete },
-	{ "deleteid", PERMISSION_CONTROL, 1, 1, handle_deleteid },
-	{ "disableoutput", PERMISSION_ADMIN, 1, 1, handle_disableoutput },
-	{ "enableoutput", PERMISSION_ADMIN, 1, 1, handle_enableoutput },
-	{ "find", PERMISSION_READ, 2, -1, handle_find },
-	{ "findadd", PERMISSION_ADD, 2, -1, handle_findadd},
-	{ "idle", PERMISSION_READ, 0, -1, handle_idle },
-	{ "kill", PERMISSION_ADMIN, -1, -1, handle_kill },
-	{ "list", PERMISSION_READ, 1, -1, handle_list },
-	{ "listall", PERMISSION_READ, 0, 1, handle_listall },
-	{ "listallinfo", PERMISSION_READ, 0, 1, handle_listallinfo },
-	{ "listplaylist", PERMISSION_READ, 1, 1, handle_listplaylist },
-	{ "listplaylistinfo", PERMISSION_READ, 1, 1, handle_listplaylistinfo },
-	{ "listplaylists", PERMISSION_READ, 0, 0, handle_listplaylists },
-	{ "load", PERMISSION_ADD, 1, 2, handle_load },
-	{ "lsinfo", PERMISSION_READ, 0, 1, handle_lsinfo },
-	{ "mixrampdb", PERMISSION_CONTROL, 1, 1, handle_mixrampdb },
-	{ "mixrampdelay", PERMISSION_CONTROL, 1, 1, handle_mixrampdelay },
-	{ "move", PERMISSION_CONTROL, 2, 2, handle_move },
-	{ "moveid", PERMISSION_CONTROL, 2, 2, handle_moveid },
-	{ "next", PERMISSION_CONTROL, 0, 0, handle_next },
-	{ "notcommands", PERMISSION_NONE, 0, 0, handle_not_commands },
-	{ "outputs", PERMISSION_READ, 0, 0, handle_devices },
-	{ "password", PERMISSION_NONE, 1, 1, handle_password },
-	{ "pause", PERMISSION_CONTROL, 0, 1, handle_pause },
-	{ "ping", PERMISSION_NONE, 0, 0, handle_ping },
-	{ "play", PERMISSION_CONTROL, 0, 1, handle_play },
-	{ "playid", PERMISSION_CONTROL, 0, 1, handle_playid },
-	{ "playlist", PERMISSION_READ, 0, 0, handle_playlist },
-	{ "playlistadd", PERMISSION_CONTROL, 2, 2, handle_playlistadd },
-	{ "playlistclear", PERMISSION_CONTROL, 1, 1, handle_playlistclear },
-	{ "playlistdelete", PERMISSION_CONTROL, 2, 2, handle_playlistdelete },
-	{ "playlistfind", PERMISSION_READ, 2, -1, handle_playlistfind },
-	{ "playlistid", PERMISSION_READ, 0, 1, handle_playlistid },
-	{ "playlistinfo", PERMISSION_READ, 0, 1, handle_playlistinfo },
-	{ "playlistmove", PERMISSION_CONTROL, 3, 3, handle_playlistmove },
-	{ "playlistsearch", PERMISSION_READ, 2, -1, handle_playlistsearch },
-	{ "plchanges", PERMISSION_READ, 1, 1, handle_plchanges },
-	{ "plchangesposid", PERMISSION_READ, 1, 1, handle_plchangesposid },
-	{ "previous", PERMISSION_CONTROL, 0, 0, handle_previous },
-	{ "prio", PERMISSION_CONTROL, 2, -1, handle_prio },
-	{ "prioid", PERMISSION_CONTROL, 2, -1, handle_prioid },
-	{ "random", PERMISSION_CONTROL, 1, 1, handle_random },
-	{ "readcomments", PERMISSION_READ, 1, 1, handle_read_comments },
-	{ "readmessages", PERMISSION_READ, 0, 0, handle_read_messages },
-	{ "rename", PERMISSION_CONTROL, 2, 2, handle_rename },
-	{ "repeat", PERMISSION_CONTROL, 1, 1, handle_repeat },
+	{ "add", PERMISSION_ADD, 1, 1, handle_add, false },
+	{ "addid", PERMISSION_ADD, 1, 2, handle_addid, false },
+	{ "channels", PERMISSION_READ, 0, 0, handle_channels, false },
+	{ "clear", PERMISSION_CONTROL, 0, 0, handle_clear, false },
+	{ "clearerror", PERMISSION_CONTROL, 0, 0, handle_clearerror, false },
+	{ "close", PERMISSION_NONE, -1, -1, handle_close, false },
+	{ "commands", PERMISSION_NONE, 0, 0, handle_commands, false },
+	{ "commandstats", PERMISSION_READ, 0, 0, handle_commandstats, false },
+	{ "config", PERMISSION_ADMIN, 0, 0, handle_config, false },
+	{ "consume", PERMISSION_CONTROL, 1, 1, handle_consume, false },
+	{ "count", PERMISSION_READ, 2, -1, handle_count, true },
+	{ "crossfade", PERMISSION_CONTROL, 1, 1, handle_crossfade, false },
+	{ "currentsong", PERMISSION_READ, 0, 0, handle_currentsong, false },
+	{ "decoders", PERMISSION_READ, 0, 0, handle_decoders, false },
+	{ "delete", PERMISSION_CONTROL, 1, 1, handle_delete, false },
+	{ "deleteid", PERMISSION_CONTROL, 1, 1, handle_deleteid, false },
+	{ "disableoutput", PERMISSION_ADMIN, 1, 1,
+	  handle_disableoutput, false },
+	{ "enableoutput", PERMISSION_ADMIN, 1, 1, handle_enableoutput, false },
+	{ "find", PERMISSION_READ, 2, -1, handle_find, false },
+	{ "findadd", PERMISSION_ADD, 2, -1, handle_findadd, false },
+	{ "idle", PERMISSION_READ, 0, -1, handle_idle, false },
+	{ "kill", PERMISSION_ADMIN, -1, -1, handle_kill, false },
+	{ "list", PERMISSION_READ, 1, -1, handle_list, true },
+	{ "listall", PERMISSION_READ, 0, 1, handle_listall, false },
+	{ "listallinfo", PERMISSION_READ, 0, 1, handle_listallinfo, false },
+	{ "listplaylist", PERMISSION_READ, 1, 1, handle_listplaylist, false },
+	{ "listplaylistinfo", PERMISSION_READ, 1, 1,
+	  handle_listplaylistinfo, false },
+	{ "listplaylists", PERMISSION_READ, 0, 0, handle_listplaylists, false },
+	{ "load", PERMISSION_ADD, 1, 2, handle_load, false },
+	{ "lsinfo", PERMISSION_READ, 0, 1, handle_lsinfo, false },
+	{ "mixrampdb", PERMISSION_CONTROL, 1, 1, handle_mixrampdb, false },
+	{ "mixrampdelay", PERMISSION_CONTROL, 1, 1,
+	  handle_mixrampdelay, false },
+	{ "move", PERMISSION_CONTROL, 2, 2, handle_move, false },
+	{ "moveid", PERMISSION_CONTROL, 2, 2, handle_moveid, false },
+	{ "next", PERMISSION_CONTROL, 0, 0, handle_next, false },
+	{ "notcommands", PERMISSION_NONE, 0, 0, handle_not_commands, false },
+	{ "outputs", PERMISSION_READ, 0, 0, handle_devices, false },
+	{ "password", PERMISSION_NONE, 1, 1, handle_password, false },
+	{ "pause", PERMISSION_CONTROL, 0, 1, handle_pause, false },
+	{ "ping", PERMISSION_NONE, 0, 0, handle_ping, false },
+	{ "play", PERMISSION_CONTROL, 0, 1, handle_play, false },
+	{ "playid", PERMISSION_CONTROL, 0, 1, handle_playid, false },
+	{ "playlist", PERMISSION_READ, 0, 0, handle_playlist, false },
+	{ "playlistadd", PERMISSION_CONTROL, 2, 2, handle_playlistadd, false },
+	{ "playlistclear", PERMISSION_CONTROL, 1, 1,
+	  handle_playlistclear, false },
+	{ "playlistdelete", PERMISSION_CONTROL, 2, 2,
+	  handle_playlistdelete, false },
+	{ "playlistfind", PERMISSION_READ, 2, -1, handle_playlistfind, false },
+	{ "playlistid", PERMISSION_READ, 0, 1, handle_playlistid, false },
+	{ "playlistinfo", PERMISSION_READ, 0, 1, handle_playlistinfo, false },
+	{ "playlistmove", PERMISSION_CONTROL, 3, 3,
+	  handle_playlistmove, false },
+	{ "playlistsearch", PERMISSION_READ, 2, -1,
+	  handle_playlistsearch, false },
+	{ "plchanges", PERMISSION_READ, 1, 1, handle_plchanges, false },
+	{ "plchangesposid", PERMISSION_READ, 1, 1,
+	  handle_plchangesposid, false },
+	{ "previous", PERMISSION_CONTROL, 0, 0, handle_previous, false },
+	{ "prio", PERMISSION_CONTROL, 2, -1, handle_prio, false },
+	{ "prioid", PERMISSION_CONTROL, 2, -1, handle_prioid, false },
+	{ "random", PERMISSION_CONTROL, 1, 1, handle_random, false },
+	{ "readcomments", PERMISSION_READ, 1, 1, handle_read_comments, false },
+	{ "readmessages", PERMISSION_READ, 0, 0, handle_read_messages, false },
+	{ "rename", PERMISSION_CONTROL, 2, 2, handle_rename, false },
+	{ "repeat", PERMISSION_CONTROL, 1, 1, handle_repeat, false },
 	{ "replay_gain_mode", PERMISSION_CONTROL, 1, 1,
-	  handle_replay_gain_mode },
+	  handle_replay_gain_mode, false },
 	{ "replay_gain_status", PERMISSION_READ, 0, 0,
-	  handle_replay_gain_status },
-	{ "rescan", PERMISSION_CONTROL, 0, 1, handle_rescan },
-	{ "rm", PERMISSION_CONTROL, 1, 1, handle_rm },
-	{ "save", PERMISSION_CONTROL, 1, 1, handle_save },
-	{ "search", PERMISSION_READ, 2, -1, handle_search },
-	{ "searchadd", PERMISSION_ADD, 2, -1, handle_searchadd },
-	{ "searchaddpl", PERMISSION_CONTROL, 3, -1, handle_searchaddpl },
-	{ "seek", PERMISSION_CONTROL, 2, 2, handle_seek },
-	{ "seekcur", PERMISSION_CONTROL, 1, 1, handle_seekcur },
-	{ "seekid", PERMISSION_CONTROL, 2, 2, handle_seekid },
-	{ "sendmessage", PERMISSION_CONTROL, 2, 2, handle_send_message },
-	{ "setvol", PERMISSION_CONTROL, 1, 1, handle_setvol },
-	{ "shuffle", PERMISSION_CONTROL, 0, 1, handle_shuffle },
-	{ "single", PERMISSION_CONTROL, 1, 1, handle_single },
-	{ "stats", PERMISSION_READ, 0, 0, handle_stats },
-	{ "status", PERMISSION_READ, 0, 0, handle_status },
+	  handle_replay_gain_status, false },
+	{ "rescan", PERMISSION_CONTROL, 0, 1, handle_rescan, false },
+	{ "rm", PERMISSION_CONTROL, 1, 1, handle_rm, false },
+	{ "save", PERMISSION_CONTROL, 1, 1, handle_save, false },
+	{ "search", PERMISSION_READ, 2, -1, handle_search, false },
+	{ "searchadd", PERMISSION_ADD, 2, -1, handle_searchadd, false },
+	{ "searchaddpl", PERMISSION_CONTROL, 3, -1, handle_searchaddpl, false },
+	{ "seek", PERMISSION_CONTROL, 2, 2, handle_seek, false },
+	{ "seekcur", PERMISSION_CONTROL, 1, 1, handle_seekcur, false },
+	{ "seekid", PERMISSION_CONTROL, 2, 2, handle_seekid, false },
+	{ "sendmessage", PERMISSION_CONTROL, 2, 2, handle_send_message, false },
+	{ "setvol", PERMISSION_CONTROL, 1, 1, handle_setvol, false },
+	{ "shuffle", PERMISSION_CONTROL, 0, 1, handle_shuffle, false },
+	{ "single", PERMISSION_CONTROL, 1, 1, handle_single, false },
+	{ "stats", PERMISSION_READ, 0, 0, handle_stats, false },
+	{ "status", PERMISSION_READ, 0, 0, handle_status, false },
 #ifdef ENABLE_SQLITE
-	{ "sticker", PERMISSION_ADMIN, 3, -1, handle_sticker },
+	{ "sticker", PERMISSION_ADMIN, 3, -1, handle_sticker, false },
 #endif
-	{ "stop", PERMISSION_CONTROL, 0, 0, handle_stop },
-	{ "subscribe", PERMISSION_READ, 1, 1, handle_subscribe },
-	{ "swap", PERMISSION_CONTROL, 2, 2, handle_swap },
-	{ "swapid", PERMISSION_CONTROL, 2, 2, handle_swapid },
-	{ "tagtypes", PERMISSION_READ, 0, 0, handle_tagtypes },
-	{ "toggleoutput", PERMISSION_ADMIN, 1, 1, handle_toggleoutput },
-	{ "unsubscribe", PERMISSION_READ, 1, 1, handle_unsubscribe },
-	{ "update", PERMISSION_CONTROL, 0, 1, handle_update },
-	{ "urlhandlers", PERMISSION_READ, 0, 0, handle_urlhandlers },
-	{ "volume", PERMISSION_CONTROL, 1, 1, handle_volume },
+	{ "stop", PERMISSION_CONTROL, 0, 0, handle_stop, false },
+	{ "subscribe", PERMISSION_READ, 1, 1, handle_subscribe, false },
+	{ "swap", PERMISSION_CONTROL, 2, 2, handle_swap, false },
+	{ "swapid", PERMISSION_CONTROL, 2, 2, handle_swapid, false },
+	{ "tagtypes", PERMISSION_READ, 0, 0, handle_tagtypes, false },
+	{ "toggleoutput", PERMISSION_ADMIN, 1, 1, handle_toggleoutput, false },
+	{ "unsubscribe", PERMISSION_READ, 1, 1, handle_unsubscribe, false },
+	{ "update", PERMISSION_CONTROL, 0, 1, handle_update, false },
+	{ "urlhandlers", PERMISSION_READ, 0, 0, handle_urlhandlers, false },
+	{ "volume", PERMISSION_CONTROL, 1, 1, handle_volume, false },
 };
 
 static const unsigned num_commands = sizeof(commands) / sizeof(commands[0]);
 
+/**
+ * The number of buckets in the latency histogram.  Bucket i counts
+ * the calls which took 2^i to 2^(i+1)-1 microseconds (bucket 0 also
+ * counts 0us); the last bucket counts all slower calls.
+ */
+static constexpr unsigned LATENCY_BUCKETS = 24;
+
+/**
+ * Execution statistics of one command.  Updated by the main thread
+ * and the worker threads concurrently.
+ */
+struct CommandStats {
+	std::atomic<unsigned> calls;
+	std::atomic<uint64_t> total_us;
+	std::atomic<unsigned> max_us;
+	std::atomic<unsigned> histogram[LATENCY_BUCKETS];
+
+	void Add(unsigned us) {
+		++calls;
+		total_us += us;
+
+		unsigned max = max_us.load(std::memory_order_relaxed);
+		while (us > max &&
+		       !max_us.compare_exchange_weak(max, us,
+						     std::memory_order_relaxed)) {}
+
+		unsigned bucket = 0;
+		while (bucket < LATENCY_BUCKETS - 1 && (us >> (bucket + 1)) != 0)
+			++bucket;
+
+		++histogram[bucket];
+	}
+};
+
+/**
+ * Statistics for each command; the index is the same as in
+ * #commands.
+ */
+static CommandStats command_stats[num_commands];
+
 static bool
 command_available(gcc_unused const struct command *cmd)
 {
@@ -215,6 +278,35 @@ handle_not_commands(Client &client,
 	return CommandResult::OK;
 }
 
+static CommandResult
+handle_commandstats(Client &client,
+		    gcc_unused int argc, gcc_unused char *argv[])
+{
+	for (unsigned i = 0; i < num_commands; ++i) {
+		const CommandStats &stats = command_stats[i];
+		const unsigned calls = stats.calls;
+		if (calls == 0)
+			continue;
+
+		client_printf(client,
+			      "command: %s\n"
+			      "calls: %u\n"
+			      "time_us: %llu\n"
+			      "max_us: %u\n"
+			      "histogram:",
+			      commands[i].cmd, calls,
+			      (unsigned long long)stats.total_us,
+			      unsigned(stats.max_us));
+
+		for (const auto &bucket : stats.histogram)
+			client_printf(client, " %u", unsigned(bucket));
+
+		client_puts(client, "\n");
+	}
+
+	return CommandResult::OK;
+}
+
 void command_init(void)
 {
 #ifndef NDEBUG
@@ -250,6 +342,21 @@ command_lookup(const char *name)
 	return nullptr;
 }
 
+bool
+command_is_thread_safe(const char *line)
+{
+	char name[32];
+	const size_t length = strcspn(line, " \t");
+	if (length >= sizeof(name))
+		return false;
+
+	memcpy(name, line, length);
+	name[length] = 0;
+
+	const struct command *cmd = command_lookup(name);
+	return cmd != nullptr && cmd->thread_safe;
+}
+
 static bool
 command_check_request(const struct command *cmd, Client &client,
 		      unsigned permission, int argc, char *argv[])
@@ -368,8 +475,11 @@ command_process(Client &client, unsigned num, char *line)
 
 	cmd = command_checked_lookup(client, client.GetPermission(),
 				     argc, argv);
-	if (cmd)
+	if (cmd) {
+		const uint64_t start = MonotonicClockUS();
 		ret = cmd->handler(client, argc, argv);
+		command_stats[cmd - commands].Add(MonotonicClockUS() - start);
+	}
 
 	current_command = nullptr;
 	command_list_num = 0;
@@ -21,6 +21,7 @@
 #define MPD_ALL_COMMANDS_HXX
 
 #include "CommandResult.hxx"
+#include "Compiler.h"
 
 class Client;
 
@@ -31,4 +32,12 @@ void command_finish(void);
 CommandResult
 command_process(Client &client, unsigned num, char *line);
 
+/**
+ * May the given command line be passed to command_process() in a
+ * worker thread?  Only the command name is checked.
+ */
+gcc_pure
+bool
+command_is_thread_safe(const char *line);
+
 #endif
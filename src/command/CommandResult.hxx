@@ -41,6 +41,13 @@ enum class CommandResult {
 	 */
 	IDLE,
 
+	/**
+	 * The response is being generated incrementally by a
+	 * #ClientCursor; the "OK" response will be sent when it is
+	 * finished.
+	 */
+	DEFERRED,
+
 	/**
 	 * There was an error.  The "ACK" response was sent to the
 	 * client.
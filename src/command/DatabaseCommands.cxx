@@ -22,6 +22,7 @@
 #include "DatabaseQueue.hxx"
 #include "DatabasePlaylist.hxx"
 #include "DatabasePrint.hxx"
+#include "ClientCursor.hxx"
 #include "DatabaseSelection.hxx"
 #include "CommandError.hxx"
 #include "Client.hxx"
@@ -64,6 +65,11 @@ handle_match(Client &client, int argc, char *argv[], bool fold_case)
 		return CommandResult::ERROR;
 	}
 
+	ClientCursor *cursor =
+		db_selection_print_cursor(client, "", true, &filter);
+	if (cursor != nullptr)
+		return client.StartCursor(cursor);
+
 	const DatabaseSelection selection("", true, &filter);
 
 	Error error;
@@ -154,6 +160,11 @@ handle_listall(Client &client, gcc_unused int argc, char *argv[])
 	if (argc == 2)
 		directory = argv[1];
 
+	ClientCursor *cursor =
+		db_selection_print_cursor(client, directory, false);
+	if (cursor != nullptr)
+		return client.StartCursor(cursor);
+
 	Error error;
 	return printAllIn(client, directory, error)
 		? CommandResult::OK
@@ -217,6 +228,11 @@ handle_listallinfo(Client &client, gcc_unused int argc, char *argv[])
 	if (argc == 2)
 		directory = argv[1];
 
+	ClientCursor *cursor =
+		db_selection_print_cursor(client, directory, true);
+	if (cursor != nullptr)
+		return client.StartCursor(cursor);
+
 	Error error;
 	return printInfoForAllIn(client, directory, error)
 		? CommandResult::OK
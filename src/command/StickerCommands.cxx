@@ -132,10 +132,10 @@ handle_sticker_song(Client &client, int argc, char *argv[])
 			argv[4],
 		};
 
-		db_lock();
+		db_lock_shared();
 		Directory *directory = db_get_directory(argv[3]);
 		if (directory == nullptr) {
-			db_unlock();
+			db_unlock_shared();
 			command_error(client, ACK_ERROR_NO_EXIST,
 				      "no such directory");
 			return CommandResult::ERROR;
@@ -143,7 +143,7 @@ handle_sticker_song(Client &client, int argc, char *argv[])
 
 		success = sticker_song_find(*directory, data.name,
 					    sticker_song_find_print_cb, &data);
-		db_unlock();
+		db_unlock_shared();
 		if (!success) {
 			command_error(client, ACK_ERROR_SYSTEM,
 				      "failed to set search sticker database");
@@ -22,8 +22,10 @@
 #include "DatabaseSelection.hxx"
 #include "DatabaseHelpers.hxx"
 #include "Directory.hxx"
+#include "Song.hxx"
 #include "SongFilter.hxx"
 #include "DatabaseSave.hxx"
+#include "DatabaseBinary.hxx"
 #include "DatabaseLock.hxx"
 #include "DatabaseError.hxx"
 #include "TextFile.hxx"
@@ -35,6 +37,7 @@
 
 #include <sys/types.h>
 #include <errno.h>
+#include <string.h>
 
 static constexpr Domain simple_db_domain("simple_db");
 
@@ -63,6 +66,17 @@ SimpleDatabase::Configure(const config_param &param, Error &error)
 
 	path_utf8 = path.ToUTF8();
 
+	const char *format = param.GetBlockValue("format", "text");
+	if (strcmp(format, "text") == 0)
+		binary = false;
+	else if (strcmp(format, "binary") == 0)
+		binary = true;
+	else {
+		error.Format(simple_db_domain,
+			     "Unknown database format: \"%s\"", format);
+		return false;
+	}
+
 	return true;
 }
 
@@ -138,15 +152,24 @@ SimpleDatabase::Load(Error &error)
 	assert(!path.IsNull());
 	assert(root != nullptr);
 
-	TextFile file(path);
-	if (file.HasFailed()) {
-		error.FormatErrno("Failed to open database file \"%s\"",
-				  path_utf8.c_str());
-		return false;
+	if (db_binary_probe(path)) {
+		if (!db_load_binary(path, *root, error))
+			return false;
+	} else {
+		TextFile file(path);
+		if (file.HasFailed()) {
+			error.FormatErrno("Failed to open database file \"%s\"",
+					  path_utf8.c_str());
+			return false;
+		}
+
+		if (!db_load_internal(file, *root, error))
+			return false;
 	}
 
-	if (!db_load_internal(file, *root, error))
-		return false;
+	db_lock();
+	tag_index.Rebuild(*root);
+	db_unlock();
 
 	struct stat st;
 	if (StatFile(path, st))
@@ -186,6 +209,7 @@ SimpleDatabase::Close()
 	assert(root != nullptr);
 	assert(borrowed_song_count == 0);
 
+	tag_index.Clear();
 	root->Free();
 }
 
@@ -194,9 +218,9 @@ SimpleDatabase::GetSong(const char *uri, Error &error) const
 {
 	assert(root != nullptr);
 
-	db_lock();
+	db_lock_shared();
 	Song *song = root->LookupSong(uri);
-	db_unlock();
+	db_unlock_shared();
 	if (song == nullptr)
 		error.Format(db_domain, DB_NOT_FOUND,
 			     "No such song: %s", uri);
@@ -226,10 +250,59 @@ SimpleDatabase::LookupDirectory(const char *uri) const
 	assert(root != nullptr);
 	assert(uri != nullptr);
 
-	ScopeDatabaseLock protect;
+	ScopeDatabaseReadLock protect;
 	return root->LookupDirectory(uri);
 }
 
+/**
+ * Is the song inside the given directory (or, if not recursive,
+ * directly inside it)?
+ */
+gcc_pure
+static bool
+IsInScope(const Song &song, const Directory &directory, bool recursive)
+{
+	const Directory *parent = song.parent;
+	if (!recursive)
+		return parent == &directory;
+
+	for (; parent != nullptr; parent = parent->parent)
+		if (parent == &directory)
+			return true;
+
+	return false;
+}
+
+bool
+SimpleDatabase::VisitIndexed(const Directory &directory,
+			     const DatabaseSelection &selection,
+			     VisitSong visit_song,
+			     bool &result, Error &error) const
+{
+	if (selection.filter == nullptr)
+		return false;
+
+	std::vector<Song *> songs;
+	if (!tag_index.Lookup(*selection.filter, songs))
+		return false;
+
+	const bool check_scope = !directory.IsRoot() || !selection.recursive;
+	for (Song *song : songs) {
+		if ((check_scope &&
+		     !IsInScope(*song, directory, selection.recursive)) ||
+		    !selection.filter->Match(*song))
+			continue;
+
+		if (!visit_song(*song, error)) {
+			result = false;
+			return true;
+		}
+	}
+
+	result = true;
+	return true;
+}
+
 bool
 SimpleDatabase::Visit(const DatabaseSelection &selection,
 		      VisitDirectory visit_directory,
@@ -237,7 +310,7 @@ SimpleDatabase::Visit(const DatabaseSelection &selection,
 		      VisitPlaylist visit_playlist,
 		      Error &error) const
 {
-	ScopeDatabaseLock protect;
+	ScopeDatabaseReadLock protect;
 
 	const Directory *directory = root->LookupDirectory(selection.uri.c_str());
 	if (directory == nullptr) {
@@ -252,6 +325,13 @@ SimpleDatabase::Visit(const DatabaseSelection &selection,
 		return false;
 	}
 
+	if (!visit_directory && !visit_playlist && visit_song) {
+		bool result;
+		if (VisitIndexed(*directory, selection, visit_song,
+				 result, error))
+			return result;
+	}
+
 	if (selection.recursive && visit_directory &&
 	    !visit_directory(*directory, error))
 		return false;
@@ -267,6 +347,15 @@ SimpleDatabase::VisitUniqueTags(const DatabaseSelection &selection,
 				VisitString visit_string,
 				Error &error) const
 {
+	if (selection.uri.empty() && selection.recursive &&
+	    (selection.filter == nullptr || selection.filter->IsEmpty()) &&
+	    tag_type < TAG_NUM_OF_ITEM_TYPES) {
+		/* "list" on the whole database: the index keys are
+		   the answer */
+		ScopeDatabaseReadLock protect;
+		return tag_index.VisitValues(tag_type, visit_string, error);
+	}
+
 	return ::VisitUniqueTags(*this, selection, tag_type, visit_string,
 				 error);
 }
@@ -289,18 +378,26 @@ SimpleDatabase::Save(Error &error)
 	LogDebug(simple_db_domain, "sorting DB");
 	root->Sort();
 
+	/* renumber the index in the new walk order */
+	tag_index.Rebuild(*root);
+
 	db_unlock();
 
 	LogDebug(simple_db_domain, "writing DB");
 
-	FILE *fp = FOpen(path, FOpenMode::WriteText);
+	FILE *fp = FOpen(path, binary
+			 ? FOpenMode::WriteBinary
+			 : FOpenMode::WriteText);
 	if (!fp) {
 		error.FormatErrno("unable to write to db file \"%s\"",
 				  path_utf8.c_str());
 		return false;
 	}
 
-	db_save_internal(fp, *root);
+	if (binary)
+		db_save_binary(fp, *root);
+	else
+		db_save_internal(fp, *root);
 
 	if (ferror(fp)) {
 		error.SetErrno("Failed to write to database file");
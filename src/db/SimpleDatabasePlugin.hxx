@@ -21,6 +21,7 @@
 #define MPD_SIMPLE_DATABASE_PLUGIN_HXX
 
 #include "DatabasePlugin.hxx"
+#include "TagIndex.hxx"
 #include "fs/AllocatedPath.hxx"
 #include "Compiler.h"
 
@@ -32,8 +33,22 @@ class SimpleDatabase : public Database {
 	AllocatedPath path;
 	std::string path_utf8;
 
+	/**
+	 * Write the database file in the binary format (see
+	 * DatabaseBinary.hxx) instead of the text format?  Loading
+	 * detects the format automatically.
+	 */
+	bool binary;
+
 	Directory *root;
 
+	/**
+	 * The inverted tag index for #root.  It is rebuilt after
+	 * loading and saving, and the update thread maintains it
+	 * incrementally in between.  Protected by #db_mutex.
+	 */
+	TagIndex tag_index;
+
 	time_t mtime;
 
 #ifndef NDEBUG
@@ -51,6 +66,13 @@ public:
 		return root;
 	}
 
+	/**
+	 * Caller must lock the #db_mutex.
+	 */
+	TagIndex &GetTagIndex() {
+		return tag_index;
+	}
+
 	bool Save(Error &error);
 
 	static Database *Create(const config_param &param,
@@ -90,6 +112,18 @@ protected:
 
 	bool Load(Error &error);
 
+	/**
+	 * Attempts to answer a Visit() call with the #tag_index.
+	 * Caller must lock the #db_mutex.
+	 *
+	 * @return false if the index cannot be used for this
+	 * selection
+	 */
+	bool VisitIndexed(const Directory &directory,
+			  const DatabaseSelection &selection,
+			  VisitSong visit_song,
+			  bool &result, Error &error) const;
+
 	gcc_pure
 	const Directory *LookupDirectory(const char *uri) const;
 };
@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "TagIndex.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+#include "SongFilter.hxx"
+#include "tag/Tag.hxx"
+
+#include <glib.h>
+
+#include <algorithm>
+
+#include <assert.h>
+#include <string.h>
+
+gcc_pure
+static std::string
+CaseFold(const char *p)
+{
+	char *q = g_utf8_casefold(p, -1);
+	std::string result(q);
+	g_free(q);
+	return result;
+}
+
+void
+TagIndex::Clear()
+{
+	for (auto &map : maps)
+		map.clear();
+
+	std::fill_n(type_counts, size_t(TAG_NUM_OF_ITEM_TYPES), 0u);
+	n_songs = 0;
+	next_ordinal = 0;
+	ordinals.clear();
+}
+
+void
+TagIndex::Add(Song &song, unsigned ordinal)
+{
+	const Tag *tag = song.tag;
+	if (tag == nullptr)
+		return;
+
+	assert(ordinals.find(&song) == ordinals.end());
+	ordinals.insert(std::make_pair(&song, ordinal));
+
+	bool visited_types[TAG_NUM_OF_ITEM_TYPES];
+	std::fill_n(visited_types, size_t(TAG_NUM_OF_ITEM_TYPES), false);
+
+	for (unsigned i = 0; i < tag->num_items; ++i) {
+		const TagItem &item = *tag->items[i];
+		visited_types[item.type] = true;
+
+		auto r = maps[item.type].insert(std::make_pair(item.value,
+							       Entry()));
+		Entry &entry = r.first->second;
+		if (r.second)
+			entry.folded = CaseFold(item.value);
+
+		/* the same value may appear twice in one tag */
+		if (!entry.songs.empty() && entry.songs.back().song == &song)
+			continue;
+
+		entry.songs.push_back({&song, ordinal});
+	}
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		if (visited_types[i])
+			++type_counts[i];
+
+	++n_songs;
+}
+
+void
+TagIndex::Add(Song &song)
+{
+	Add(song, next_ordinal++);
+}
+
+void
+TagIndex::Remove(const Song &song)
+{
+	const Tag *tag = song.tag;
+	if (tag == nullptr)
+		return;
+
+	const auto o = ordinals.find(&song);
+	assert(o != ordinals.end());
+	const unsigned ordinal = o->second;
+	ordinals.erase(o);
+
+	bool visited_types[TAG_NUM_OF_ITEM_TYPES];
+	std::fill_n(visited_types, size_t(TAG_NUM_OF_ITEM_TYPES), false);
+
+	for (unsigned i = 0; i < tag->num_items; ++i) {
+		const TagItem &item = *tag->items[i];
+		visited_types[item.type] = true;
+
+		Map &map = maps[item.type];
+		auto e = map.find(item.value);
+		if (e == map.end())
+			/* already removed (duplicate value) */
+			continue;
+
+		/* the postings are sorted by ordinal */
+		auto &songs = e->second.songs;
+		auto p = std::lower_bound(songs.begin(), songs.end(), ordinal,
+					  [](const Posting &a, unsigned b){
+						  return a.ordinal < b;
+					  });
+		if (p == songs.end() || p->song != &song)
+			/* already removed (duplicate value) */
+			continue;
+
+		songs.erase(p);
+		if (songs.empty())
+			map.erase(e);
+	}
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i) {
+		if (visited_types[i]) {
+			assert(type_counts[i] > 0);
+			--type_counts[i];
+		}
+	}
+
+	assert(n_songs > 0);
+	--n_songs;
+}
+
+static void
+RebuildDirectory(TagIndex &index, const Directory &directory)
+{
+	Song *song;
+	directory_for_each_song(song, directory)
+		index.Add(*song);
+
+	Directory *child;
+	directory_for_each_child(child, directory)
+		RebuildDirectory(index, *child);
+}
+
+void
+TagIndex::Rebuild(const Directory &root)
+{
+	Clear();
+	RebuildDirectory(*this, root);
+}
+
+const std::vector<TagIndex::Posting> *
+TagIndex::Find(TagType type, const std::string &value) const
+{
+	const Map &map = maps[type];
+	auto e = map.find(value);
+	return e != map.end()
+		? &e->second.songs
+		: nullptr;
+}
+
+void
+TagIndex::CollectExact(TagType type, const std::string &value,
+		       std::vector<Posting> &result) const
+{
+	const auto *songs = Find(type, value);
+	if (songs != nullptr)
+		result.insert(result.end(), songs->begin(), songs->end());
+}
+
+void
+TagIndex::CollectFolded(TagType type, const std::string &value,
+			std::vector<Posting> &result) const
+{
+	for (const auto &i : maps[type])
+		if (strstr(i.second.folded.c_str(), value.c_str()) != nullptr)
+			result.insert(result.end(), i.second.songs.begin(),
+				      i.second.songs.end());
+}
+
+/**
+ * Can this #SongFilter::Item be answered from the index?  "base" and
+ * "file" refer to the URI, and an empty value matches songs which
+ * lack the tag, which are not in the index.
+ */
+gcc_pure
+static bool
+IsIndexable(const SongFilter::Item &item)
+{
+	const unsigned tag = item.GetTag();
+	return (tag < TAG_NUM_OF_ITEM_TYPES || tag == LOCATE_TAG_ANY_TYPE) &&
+		!item.GetValue().empty();
+}
+
+bool
+TagIndex::Lookup(const SongFilter &filter, std::vector<Song *> &result) const
+{
+	/* all items must match, so the candidates of any single item
+	   are enough; prefer the exact item with the fewest songs,
+	   and fall back to a case-folded one */
+
+	const SongFilter::Item *best = nullptr;
+	size_t best_size = 0;
+
+	for (const auto &item : filter.GetItems()) {
+		if (!IsIndexable(item))
+			continue;
+
+		if (item.GetFoldCase()) {
+			if (best == nullptr)
+				best = &item;
+			continue;
+		}
+
+		size_t size = 0;
+		const unsigned tag = item.GetTag();
+		for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i) {
+			if (tag != LOCATE_TAG_ANY_TYPE && tag != i &&
+			    !(tag == TAG_ALBUM_ARTIST && i == TAG_ARTIST))
+				continue;
+
+			const auto *songs = Find(TagType(i), item.GetValue());
+			if (songs != nullptr)
+				size += songs->size();
+		}
+
+		if (best == nullptr || best->GetFoldCase() || size < best_size) {
+			best = &item;
+			best_size = size;
+		}
+	}
+
+	if (best == nullptr)
+		return false;
+
+	std::vector<Posting> postings;
+	const unsigned tag = best->GetTag();
+	unsigned n_lists = 0;
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i) {
+		if (tag != LOCATE_TAG_ANY_TYPE && tag != i &&
+		    /* SongFilter falls back from "album artist" to
+		       "artist" */
+		    !(tag == TAG_ALBUM_ARTIST && i == TAG_ARTIST))
+			continue;
+
+		const size_t old_size = postings.size();
+		if (best->GetFoldCase())
+			CollectFolded(TagType(i), best->GetValue(), postings);
+		else
+			CollectExact(TagType(i), best->GetValue(), postings);
+
+		if (postings.size() > old_size)
+			++n_lists;
+	}
+
+	if (n_lists > 1 || best->GetFoldCase()) {
+		/* merge the posting lists back into walk order */
+		std::sort(postings.begin(), postings.end(),
+			  [](const Posting &a, const Posting &b){
+				  return a.ordinal < b.ordinal;
+			  });
+		postings.erase(std::unique(postings.begin(), postings.end(),
+					   [](const Posting &a,
+					      const Posting &b){
+						   return a.song == b.song;
+					   }),
+			       postings.end());
+	}
+
+	result.reserve(result.size() + postings.size());
+	for (const auto &p : postings)
+		result.push_back(p.song);
+
+	return true;
+}
+
+bool
+TagIndex::VisitValues(TagType type, VisitString visit_string,
+		      Error &error) const
+{
+	assert(type < TAG_NUM_OF_ITEM_TYPES);
+
+	const Map &map = maps[type];
+
+	/* songs with a tag but without this type are reported as
+	   the empty string, just like VisitUniqueTags() does */
+	if (type_counts[type] < n_songs &&
+	    map.find(std::string()) == map.end() &&
+	    !visit_string("", error))
+		return false;
+
+	for (const auto &i : map)
+		if (!visit_string(i.first.c_str(), error))
+			return false;
+
+	return true;
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_TAG_INDEX_HXX
+#define MPD_TAG_INDEX_HXX
+
+#include "DatabaseVisitor.hxx"
+#include "tag/TagType.h"
+#include "Compiler.h"
+
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <vector>
+
+struct Song;
+struct Directory;
+class SongFilter;
+class Error;
+
+/**
+ * An inverted index from tag values to songs, used by
+ * #SimpleDatabase to answer "find", "search" and "list" without
+ * walking the whole directory tree.
+ *
+ * Each song gets an ordinal number; Rebuild() assigns them in the
+ * order of Directory::Walk(), and songs added later get higher
+ * numbers.  Lookup() returns songs in this order, so the result is
+ * the same as with a tree walk (as long as the tree is sorted).
+ *
+ * All methods must be called with the #db_mutex locked.
+ */
+class TagIndex {
+	struct Posting {
+		Song *song;
+		unsigned ordinal;
+	};
+
+	struct Entry {
+		/**
+		 * The case-folded value, for SongFilter items with
+		 * "fold_case".
+		 */
+		std::string folded;
+
+		/**
+		 * All songs with this value, sorted by ordinal.
+		 */
+		std::vector<Posting> songs;
+	};
+
+	typedef std::map<std::string, Entry> Map;
+
+	Map maps[TAG_NUM_OF_ITEM_TYPES];
+
+	/**
+	 * The number of indexed songs which have at least one item of
+	 * each type.
+	 */
+	unsigned type_counts[TAG_NUM_OF_ITEM_TYPES];
+
+	/**
+	 * The number of indexed songs (i.e. songs with a tag).
+	 */
+	unsigned n_songs;
+
+	unsigned next_ordinal;
+
+	/**
+	 * The ordinal of each indexed song, which allows Remove() to
+	 * find its postings with a binary search.
+	 */
+	std::unordered_map<const Song *, unsigned> ordinals;
+
+public:
+	TagIndex() {
+		Clear();
+	}
+
+	TagIndex(const TagIndex &) = delete;
+	TagIndex &operator=(const TagIndex &) = delete;
+
+	void Clear();
+
+	/**
+	 * Clears the index and adds all songs of the given tree.
+	 */
+	void Rebuild(const Directory &root);
+
+	/**
+	 * Adds a song which was just added to the database, or whose
+	 * tag was just replaced.
+	 */
+	void Add(Song &song);
+
+	/**
+	 * Removes a song before it is removed from the database, or
+	 * before its tag is replaced.
+	 */
+	void Remove(const Song &song);
+
+	/**
+	 * Determines the songs which may match the given filter.  The
+	 * caller must still call SongFilter::Match() on each one.
+	 *
+	 * @return false if the filter has no item which can be looked
+	 * up in the index (and the caller must fall back to walking
+	 * the tree)
+	 */
+	bool Lookup(const SongFilter &filter,
+		    std::vector<Song *> &result) const;
+
+	/**
+	 * Invokes #visit_string for each distinct value of the given
+	 * type in the whole database, sorted, like VisitUniqueTags()
+	 * does.
+	 */
+	bool VisitValues(TagType type, VisitString visit_string,
+			 Error &error) const;
+
+private:
+	void Add(Song &song, unsigned ordinal);
+
+	gcc_pure
+	const std::vector<Posting> *Find(TagType type,
+					 const std::string &value) const;
+
+	void CollectExact(TagType type, const std::string &value,
+			  std::vector<Posting> &result) const;
+
+	void CollectFolded(TagType type, const std::string &value,
+			   std::vector<Posting> &result) const;
+};
+
+#endif
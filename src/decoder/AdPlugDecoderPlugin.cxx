@@ -138,4 +138,5 @@ const struct DecoderPlugin adplug_decoder_plugin = {
 	nullptr,
 	adplug_suffixes,
 	nullptr,
+	false,
 };
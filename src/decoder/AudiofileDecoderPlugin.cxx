@@ -280,4 +280,5 @@ const struct DecoderPlugin audiofile_decoder_plugin = {
 	nullptr,
 	audiofile_suffixes,
 	audiofile_mime_types,
+	false,
 };
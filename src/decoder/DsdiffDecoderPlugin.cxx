@@ -554,4 +554,5 @@ const struct DecoderPlugin dsdiff_decoder_plugin = {
 	nullptr,
 	dsdiff_suffixes,
 	dsdiff_mime_types,
+	true,
 };
@@ -42,9 +42,21 @@
 
 #include <unistd.h>
 #include <stdio.h> /* for SEEK_SET, SEEK_CUR */
+#include <assert.h>
 
 static constexpr Domain dsf_domain("dsf");
 
+/**
+ * The size of one DSF data block per channel.
+ */
+static constexpr size_t DSF_BLOCK_SIZE = 4096;
+
+/**
+ * The maximum number of channels supported by this plugin.
+ * dsf_decode_chunk() has a buffer for this many blocks.
+ */
+static constexpr unsigned DSF_MAX_CHANNELS = 2;
+
 struct DsfMetaData {
 	unsigned sample_rate, channels, block_size;
 	bool bitreverse;
@@ -137,13 +149,13 @@ dsf_read_metadata(Decoder *decoder, InputStream &is,
 
 	if (dsf_fmt_chunk.version != 1 || dsf_fmt_chunk.formatid != 0
 	    || dsf_fmt_chunk.channeltype != 2
-	    || dsf_fmt_chunk.channelnum != 2
+	    || dsf_fmt_chunk.channelnum != DSF_MAX_CHANNELS
 	    || (!dsdlib_valid_freq(samplefreq)))
 		return false;
 
 	uint32_t chblksize = FromLE32(dsf_fmt_chunk.block_size);
 	/* according to the spec block size should always be 4096 */
-	if (chblksize != 4096)
+	if (chblksize != DSF_BLOCK_SIZE)
 		return false;
 
 	/* read the 'data' chunk of the DSF file */
@@ -196,35 +208,34 @@ dsf_read_metadata(Decoder *decoder, InputStream &is,
 	return true;
 }
 
-static void
-bit_reverse_buffer(uint8_t *p, uint8_t *end)
-{
-	for (; p < end; ++p)
-		*p = bit_reverse(*p);
-}
+
+struct DsfWriteContext {
+	const uint8_t *src;
+	unsigned channels;
+	bool bitreverse;
+};
 
 /**
  * DSF data is build up of alternating 4096 blocks of DSD samples for left and
- * right. Convert the buffer holding 1 block of 4096 DSD left samples and 1
- * block of 4096 DSD right samples to 8k of samples in normal PCM left/right
- * order.
+ * right.  Convert the given range of a buffer holding 1 block of 4096
+ * DSD left samples and 1 block of 4096 DSD right samples to normal
+ * PCM left/right order, writing it directly into the music pipe.
+ * The bit order is fixed in the same pass.
  */
 static void
-dsf_to_pcm_order(uint8_t *dest, uint8_t *scratch, size_t nrbytes)
+dsf_write_pcm_order(void *_dest, size_t offset, size_t length, void *_ctx)
 {
-	for (unsigned i = 0, j = 0; i < (unsigned)nrbytes; i += 2) {
-		scratch[i] = *(dest+j);
-		j++;
-	}
+	const DsfWriteContext &ctx = *(const DsfWriteContext *)_ctx;
+	uint8_t *dest = (uint8_t *)_dest;
 
-	for (unsigned i = 1, j = 0; i < (unsigned) nrbytes; i += 2) {
-		scratch[i] = *(dest+4096+j);
-		j++;
-	}
+	const size_t first_frame = offset / ctx.channels;
+	const size_t n_frames = length / ctx.channels;
 
-	for (unsigned i = 0; i < (unsigned)nrbytes; i++) {
-		*dest = scratch[i];
-		dest++;
+	for (size_t i = first_frame; i < first_frame + n_frames; ++i) {
+		for (unsigned c = 0; c < ctx.channels; ++c) {
+			const uint8_t x = ctx.src[c * DSF_BLOCK_SIZE + i];
+			*dest++ = ctx.bitreverse ? bit_reverse(x) : x;
+		}
 	}
 }
 
@@ -240,17 +251,19 @@ dsf_decode_chunk(Decoder &decoder, InputStream &is,
 		    unsigned sample_rate,
 		    unsigned block_size)
 {
-	uint8_t buffer[8192];
+	/* one block per channel; dsf_write_pcm_order() reads channel
+	   c at offset c*DSF_BLOCK_SIZE */
+	assert(channels > 0 && channels <= DSF_MAX_CHANNELS);
+	uint8_t buffer[DSF_MAX_CHANNELS * DSF_BLOCK_SIZE];
 
-	/* scratch buffer for DSF samples to convert to the needed
-	   normal left/right regime of samples */
-	uint8_t dsf_scratch_buffer[8192];
+	DsfWriteContext ctx;
+	ctx.src = buffer;
+	ctx.channels = channels;
+	ctx.bitreverse = bitreverse;
 
 	const size_t sample_size = sizeof(buffer[0]);
 	const size_t frame_size = channels * sample_size;
-	const unsigned buffer_frames = sizeof(buffer) / frame_size;
-	const unsigned buffer_samples = buffer_frames * frame_size;
-	const size_t buffer_size = buffer_samples * sample_size;
+	const size_t buffer_size = channels * DSF_BLOCK_SIZE;
 
 	const uint64_t stream_end_offset = chunk_size + (uint64_t) stream_start_offset;
 
@@ -270,12 +283,11 @@ dsf_decode_chunk(Decoder &decoder, InputStream &is,
 		const size_t nbytes = now_size;
 		chunk_size -= nbytes;
 
-		if (bitreverse)
-			bit_reverse_buffer(buffer, buffer + nbytes);
-
-		dsf_to_pcm_order(buffer, dsf_scratch_buffer, nbytes);
-
-		const auto cmd = decoder_data(decoder, is, buffer, nbytes, sample_rate / 1000);
+		/* reorder and bit-reverse while copying into the
+		   music pipe */
+		const auto cmd = decoder_data_direct(decoder, is, nbytes,
+						     sample_rate / 1000,
+						     dsf_write_pcm_order, &ctx);
 		switch (cmd) {
 		case DecoderCommand::NONE:
 			break;
@@ -410,4 +422,5 @@ const struct DecoderPlugin dsf_decoder_plugin = {
 	nullptr,
 	dsf_suffixes,
 	dsf_mime_types,
+	true,
 };
@@ -487,4 +487,5 @@ const struct DecoderPlugin faad_decoder_plugin = {
 	nullptr,
 	faad_suffixes,
 	faad_mime_types,
+	true,
 };
@@ -737,5 +737,6 @@ const struct DecoderPlugin ffmpeg_decoder_plugin = {
 	ffmpeg_scan_stream,
 	nullptr,
 	ffmpeg_suffixes,
-	ffmpeg_mime_types
+	ffmpeg_mime_types,
+	false,
 };
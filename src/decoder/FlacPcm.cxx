@@ -105,6 +105,8 @@ flac_convert(void *dest,
 	case SampleFormat::DSD:
 	case SampleFormat::UNDEFINED:
 	case SampleFormat::DSD_U8:
+	case SampleFormat::DSD_U16_LE:
+	case SampleFormat::DSD_U16_BE:
 	case SampleFormat::DSD_U32_BE:
 	case SampleFormat::DSD_U32_LE:
 		assert(false);
@@ -221,4 +221,5 @@ const struct DecoderPlugin fluidsynth_decoder_plugin = {
 	nullptr,
 	fluidsynth_suffixes,
 	nullptr,
+	false,
 };
@@ -292,4 +292,5 @@ const struct DecoderPlugin gme_decoder_plugin = {
 	gme_container_scan,
 	gme_suffixes,
 	nullptr,
+	true,
 };
@@ -1152,4 +1152,5 @@ const struct DecoderPlugin mad_decoder_plugin = {
 	nullptr,
 	mp3_suffixes,
 	mp3_mime_types,
+	true,
 };
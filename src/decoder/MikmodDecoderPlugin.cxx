@@ -245,4 +245,5 @@ const struct DecoderPlugin mikmod_decoder_plugin = {
 	nullptr,
 	mikmod_decoder_suffixes,
 	nullptr,
+	false,
 };
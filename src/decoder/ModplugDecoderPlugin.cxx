@@ -212,4 +212,5 @@ const struct DecoderPlugin modplug_decoder_plugin = {
 	nullptr,
 	mod_suffixes,
 	nullptr,
+	false,
 };
@@ -277,4 +277,5 @@ const struct DecoderPlugin mpcdec_decoder_plugin = {
 	nullptr,
 	mpcdec_suffixes,
 	nullptr,
+	true,
 };
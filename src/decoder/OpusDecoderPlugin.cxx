@@ -486,4 +486,5 @@ const struct DecoderPlugin opus_decoder_plugin = {
 	nullptr,
 	opus_suffixes,
 	opus_mime_types,
+	true,
 };
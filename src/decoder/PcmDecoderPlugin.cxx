@@ -111,4 +111,5 @@ const struct DecoderPlugin pcm_decoder_plugin = {
 	nullptr,
 	nullptr,
 	pcm_mime_types,
+	true,
 };
@@ -431,5 +431,6 @@ const struct DecoderPlugin sidplay_decoder_plugin = {
 	nullptr, /* stream_tag() */
 	sidplay_container_scan,
 	sidplay_suffixes,
-	nullptr, /* mime_types */
+	nullptr, /* mime_types */,
+	false,
 };
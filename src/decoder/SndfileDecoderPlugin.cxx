@@ -270,4 +270,5 @@ const struct DecoderPlugin sndfile_decoder_plugin = {
 	nullptr,
 	sndfile_suffixes,
 	sndfile_mime_types,
+	true,
 };
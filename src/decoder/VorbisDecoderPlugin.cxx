@@ -348,5 +348,6 @@ const struct DecoderPlugin vorbis_decoder_plugin = {
 	vorbis_scan_stream,
 	nullptr,
 	vorbis_suffixes,
-	vorbis_mime_types
+	vorbis_mime_types,
+	true,
 };
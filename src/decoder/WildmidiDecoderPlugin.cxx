@@ -155,4 +155,5 @@ const struct DecoderPlugin wildmidi_decoder_plugin = {
 	nullptr,
 	wildmidi_suffixes,
 	nullptr,
+	false,
 };
@@ -31,12 +31,12 @@
 #ifndef WIN32
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #endif
 
 FullyBufferedSocket::ssize_t
-FullyBufferedSocket::DirectWrite(const void *data, size_t length)
+FullyBufferedSocket::CheckWriteResult(ssize_t nbytes)
 {
-	const auto nbytes = SocketMonitor::Write((const char *)data, length);
 	if (gcc_unlikely(nbytes < 0)) {
 		const auto code = GetSocketError();
 		if (IsSocketErrorAgain(code))
@@ -54,20 +54,62 @@ FullyBufferedSocket::DirectWrite(const void *data, size_t length)
 	return nbytes;
 }
 
+FullyBufferedSocket::ssize_t
+FullyBufferedSocket::DirectWrite(const void *data, size_t length)
+{
+	return CheckWriteResult(SocketMonitor::Write((const char *)data,
+						     length));
+}
+
+FullyBufferedSocket::ssize_t
+FullyBufferedSocket::DirectWrite(const void *const*data,
+				 const size_t *length, unsigned n)
+{
+	assert(n > 0);
+
+#ifdef WIN32
+	(void)n;
+	return DirectWrite(data[0], length[0]);
+#else
+	struct iovec iov[2];
+	assert(n <= 2);
+	for (unsigned i = 0; i < n; ++i) {
+		iov[i].iov_base = const_cast<void *>(data[i]);
+		iov[i].iov_len = length[i];
+	}
+
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = n;
+
+	int flags = 0;
+#ifdef MSG_NOSIGNAL
+	flags |= MSG_NOSIGNAL;
+#endif
+#ifdef MSG_DONTWAIT
+	flags |= MSG_DONTWAIT;
+#endif
+
+	return CheckWriteResult(sendmsg(SocketMonitor::Get(), &msg, flags));
+#endif
+}
+
 bool
 FullyBufferedSocket::Flush()
 {
 	assert(IsDefined());
 
-	size_t length;
-	const void *data = output.Read(&length);
-	if (data == nullptr) {
+	const void *data[2];
+	size_t length[2];
+	const unsigned n = output.Read(data, length);
+	if (n == 0) {
 		IdleMonitor::Cancel();
 		CancelWrite();
 		return true;
 	}
 
-	auto nbytes = DirectWrite(data, length);
+	auto nbytes = DirectWrite(data, length, n);
 	if (gcc_unlikely(nbytes <= 0))
 		return nbytes == 0;
 
@@ -100,8 +142,37 @@ FullyBufferedSocket::Write(const void *data, size_t length)
 		return false;
 	}
 
+	return OnAppended(was_empty);
+}
+
+bool
+FullyBufferedSocket::CommitWrite(size_t length)
+{
+	assert(IsDefined());
+
+	if (length == 0)
+		return true;
+
+	const bool was_empty = output.IsEmpty();
+	output.Append(length);
+	return OnAppended(was_empty);
+}
+
+bool
+FullyBufferedSocket::OnAppended(bool was_empty)
+{
 	if (was_empty)
 		IdleMonitor::Schedule();
+
+	if (output.GetSize() >= flush_threshold) {
+		/* don't let large responses pile up in the buffer */
+		if (!Flush())
+			return false;
+
+		if (!output.IsEmpty() && !IdleMonitor::IsActive())
+			ScheduleWrite();
+	}
+
 	return true;
 }
 
@@ -114,6 +185,9 @@ FullyBufferedSocket::OnSocketReady(unsigned flags)
 
 		if (!Flush())
 			return false;
+
+		if (output.IsEmpty() && !OnSocketDrained())
+			return false;
 	}
 
 	if (!BufferedSocket::OnSocketReady(flags))
@@ -125,6 +199,11 @@ FullyBufferedSocket::OnSocketReady(unsigned flags)
 void
 FullyBufferedSocket::OnIdle()
 {
-	if (Flush() && !output.IsEmpty())
+	if (!Flush())
+		return;
+
+	if (!output.IsEmpty())
 		ScheduleWrite();
+	else
+		OnSocketDrained();
 }
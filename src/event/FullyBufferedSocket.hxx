@@ -32,11 +32,20 @@
 class FullyBufferedSocket : protected BufferedSocket, private IdleMonitor {
 	PeakBuffer output;
 
+	/**
+	 * If more than this number of bytes is buffered, Write()
+	 * attempts to send them right away instead of waiting for the
+	 * response to be complete.  This bounds the memory used by
+	 * large responses if the peer reads quickly.
+	 */
+	const size_t flush_threshold;
+
 public:
 	FullyBufferedSocket(int _fd, EventLoop &_loop,
 			    size_t normal_size, size_t peak_size=0)
 		:BufferedSocket(_fd, _loop), IdleMonitor(_loop),
-		 output(normal_size, peak_size) {
+		 output(normal_size, peak_size),
+		 flush_threshold(normal_size) {
 	}
 
 	using BufferedSocket::IsDefined;
@@ -47,8 +56,31 @@ public:
 	}
 
 private:
+	/**
+	 * Handle the return value of a send() call.
+	 *
+	 * @return the number of bytes sent, 0 if the socket is not
+	 * ready, or -1 on error (the socket has been closed)
+	 */
+	ssize_t CheckWriteResult(ssize_t nbytes);
+
 	ssize_t DirectWrite(const void *data, size_t length);
 
+	/**
+	 * Like DirectWrite(), but sends multiple buffers with one
+	 * system call.
+	 */
+	ssize_t DirectWrite(const void *const*data, const size_t *length,
+			    unsigned n);
+
+	/**
+	 * Schedule sending the buffer after new data has been
+	 * appended, and send it right away if it has become large.
+	 *
+	 * @return false if the socket has been closed
+	 */
+	bool OnAppended(bool was_empty);
+
 protected:
 	/**
 	 * Send data from the output buffer to the socket.
@@ -62,6 +94,51 @@ protected:
 	 */
 	bool Write(const void *data, size_t length);
 
+	/**
+	 * Obtain a writable area at the end of the output buffer, for
+	 * formatting data directly into it.  Call CommitWrite()
+	 * afterwards.
+	 *
+	 * @return nullptr if the buffer has no room; use Write() then
+	 */
+	void *PrepareWrite(size_t *max_length_r) {
+		return output.Write(max_length_r);
+	}
+
+	/**
+	 * Commit data written into the area returned by
+	 * PrepareWrite().
+	 *
+	 * @return false if the socket has been closed
+	 */
+	bool CommitWrite(size_t length);
+
+	/**
+	 * Returns the number of bytes waiting in the output buffer.
+	 */
+	gcc_pure
+	size_t GetOutputSize() const {
+		return output.GetSize();
+	}
+
+	/**
+	 * Flush the output buffer (if any) in the next main loop
+	 * iteration, and invoke OnSocketDrained() afterwards.
+	 */
+	void ScheduleFlush() {
+		IdleMonitor::Schedule();
+	}
+
+	/**
+	 * The output buffer has been sent completely.  The method may
+	 * write more data.
+	 *
+	 * @return false if the socket has been closed
+	 */
+	virtual bool OnSocketDrained() {
+		return true;
+	}
+
 	virtual bool OnSocketReady(unsigned flags) override;
 	virtual void OnIdle() override;
 };
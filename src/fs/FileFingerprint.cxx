@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "FileFingerprint.hxx"
+#include "FileSystem.hxx"
+#include "Path.hxx"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * The number of bytes hashed at the beginning and at the end of the
+ * file.  Tags usually live there.
+ */
+static constexpr size_t PARTIAL_HASH_SIZE = 4096;
+
+static constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+static uint64_t
+FnvHash(uint64_t hash, const void *_p, size_t size)
+{
+	const uint8_t *p = (const uint8_t *)_p;
+	for (size_t i = 0; i < size; ++i)
+		hash = (hash ^ p[i]) * FNV_PRIME;
+	return hash;
+}
+
+/**
+ * Read exactly #size bytes at the given offset.
+ */
+static bool
+ReadAt(int fd, void *_buffer, size_t size, off_t offset)
+{
+	uint8_t *buffer = (uint8_t *)_buffer;
+
+	while (size > 0) {
+		ssize_t nbytes = pread(fd, buffer, size, offset);
+		if (nbytes <= 0)
+			return false;
+
+		buffer += nbytes;
+		size -= nbytes;
+		offset += nbytes;
+	}
+
+	return true;
+}
+
+uint64_t
+PartialFileHash(Path path, uint64_t size)
+{
+	int fd = OpenFile(path, O_RDONLY, 0);
+	if (fd < 0)
+		return 0;
+
+	uint8_t buffer[PARTIAL_HASH_SIZE];
+	uint64_t hash = FnvHash(FNV_OFFSET, &size, sizeof(size));
+
+	const size_t head = size < PARTIAL_HASH_SIZE
+		? size_t(size)
+		: PARTIAL_HASH_SIZE;
+	bool success = ReadAt(fd, buffer, head, 0);
+	if (success) {
+		hash = FnvHash(hash, buffer, head);
+
+		if (size > head) {
+			const size_t tail = size - head < PARTIAL_HASH_SIZE
+				? size_t(size - head)
+				: PARTIAL_HASH_SIZE;
+			success = ReadAt(fd, buffer, tail, size - tail);
+			if (success)
+				hash = FnvHash(hash, buffer, tail);
+		}
+	}
+
+	close(fd);
+
+	if (!success)
+		return 0;
+
+	return hash != 0 ? hash : 1;
+}
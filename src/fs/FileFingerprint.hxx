@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_FS_FILE_FINGERPRINT_HXX
+#define MPD_FS_FILE_FINGERPRINT_HXX
+
+#include "check.h"
+#include "Compiler.h"
+
+#include <stdint.h>
+#include <sys/stat.h>
+
+class Path;
+
+/**
+ * Returns the sub-second part of the modification time in
+ * nanoseconds, or 0 if the platform does not provide it.
+ */
+static inline unsigned
+GetStatMtimeNs(const struct stat &st)
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+	return st.st_mtim.tv_nsec;
+#else
+	(void)st;
+	return 0;
+#endif
+}
+
+/**
+ * Calculates a 64 bit hash of the first and the last few kilobytes
+ * of a file and its size.  It is cheap even on slow file systems and
+ * detects almost all content changes which keep the file's
+ * modification time.
+ *
+ * @param size the size of the file, from stat()
+ * @return the hash, or 0 on error (never 0 on success)
+ */
+uint64_t
+PartialFileHash(Path path, uint64_t size);
+
+#endif
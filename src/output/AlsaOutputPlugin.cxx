@@ -22,6 +22,7 @@
 #include "OutputAPI.hxx"
 #include "MixerList.hxx"
 #include "pcm/PcmExport.hxx"
+#include "pcm/PcmCopyStats.hxx"
 #include "util/Manual.hxx"
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
@@ -76,9 +77,10 @@ struct AlsaOutput {
 	/**
 	 * dsd_native_type
 	 * 0 = regular, uses DSD_U8
-	 * 1 = reserved. 
+	 * 1 = uses DSD_U16_LE
 	 * 2 = XMOS mode/Denon/Marantz, uses DSD_U32_BE
 	 * 3 = BeagleBone Black with botic driver
+	 * 4 = uses DSD_U16_BE
 	 */
 	unsigned int dsd_native_type;
 
@@ -121,6 +123,14 @@ struct AlsaOutput {
 	 */
 	snd_pcm_uframes_t period_position;
 
+	/**
+	 * The size of the hardware buffer, and the number of frames
+	 * which must be in it before playback starts, in number of
+	 * frames.  Used by alsa_play_mmap(), which must start the PCM
+	 * itself.
+	 */
+	snd_pcm_uframes_t buffer_frames, start_threshold;
+
 	/**
 	 * Do we need to call snd_pcm_prepare() before the next write?
 	 * It means that we put the device to SND_PCM_STATE_SETUP by
@@ -179,11 +189,11 @@ alsa_configure(AlsaOutput *ad, const config_param &param)
 		ad->dsd_native_type = param.GetBlockValue("dsd_native_type", 255);
 		switch (ad->dsd_native_type) {
 			case 0:
+			case 1:
 			case 2:
 			case 3:
+			case 4:
 				break;
-			case 1:
-				ad->dsd_native = false;
 			default:
 				ad->dsd_native = false;
 		}
@@ -301,6 +311,12 @@ get_bitformat(SampleFormat sample_format)
 	case SampleFormat::DSD_U8:
 		return SND_PCM_FORMAT_DSD_U8;
 
+	case SampleFormat::DSD_U16_LE:
+		return SND_PCM_FORMAT_DSD_U16_LE;
+
+	case SampleFormat::DSD_U16_BE:
+		return SND_PCM_FORMAT_DSD_U16_BE;
+
 	case SampleFormat::DSD_U32_BE:
 		return SND_PCM_FORMAT_DSD_U32_BE;
 
@@ -645,6 +661,8 @@ configure_hw:
 
 	ad->period_frames = alsa_period_size;
 	ad->period_position = 0;
+	ad->buffer_frames = alsa_buffer_size;
+	ad->start_threshold = alsa_buffer_size - alsa_period_size;
 
 	ad->silence = g_malloc(snd_pcm_frames_to_bytes(ad->pcm,
 						       alsa_period_size));
@@ -665,7 +683,7 @@ alsa_setup_dsd(AlsaOutput *ad, const AudioFormat audio_format,
 	       bool *shift8_r, bool *packed_r, bool *reverse_endian_r,
 	       Error &error)
 {
-	assert(ad->dsd_usb);
+	assert(ad->dsd_usb || ad->dsd_native);
 	assert(audio_format.format == SampleFormat::DSD);
 
 	AudioFormat usb_format = audio_format;
@@ -685,16 +703,34 @@ alsa_setup_dsd(AlsaOutput *ad, const AudioFormat audio_format,
 		return true;
 	}
 
-	if (ad->dsd_native && (ad->dsd_native_type == 2 || ad->dsd_native_type == 3)) {
+	if (ad->dsd_native) {
+
+		switch (ad->dsd_native_type) {
+		case 1:
+			/* DSD native type 1 -> DSD_U16_LE */
+			usb_format.format = SampleFormat::DSD_U16_LE;
+			usb_format.sample_rate /= 2;
+			break;
 
-		if (ad->dsd_native_type == 2) {
+		case 2:
 			/* DSD native type 2 -> DSD_U32_BE */
 			usb_format.format = SampleFormat::DSD_U32_BE;
-		} else {
+			usb_format.sample_rate /= 4;
+			break;
+
+		case 3:
 			/* DSD native type 3 -> DSD_U32_LE */
 			usb_format.format = SampleFormat::DSD_U32_LE;
+			usb_format.sample_rate /= 4;
+			break;
+
+		default:
+			/* DSD native type 4 -> DSD_U16_BE */
+			assert(ad->dsd_native_type == 4);
+			usb_format.format = SampleFormat::DSD_U16_BE;
+			usb_format.sample_rate /= 2;
+			break;
 		}
-		usb_format.sample_rate /= 4;
 
 		if (!alsa_setup(ad, usb_format, packed_r, reverse_endian_r, error)) {
 
@@ -878,6 +914,10 @@ alsa_cancel(struct audio_output *ao)
 	ad->period_position = 0;
 	ad->must_prepare = true;
 
+	/* discard DSD frames carried over by the DoP/native
+	   packer */
+	ad->pcm_export->Reset();
+
 	snd_pcm_drop(ad->pcm);
 }
 
@@ -890,6 +930,118 @@ alsa_close(struct audio_output *ao)
 	g_free(ad->silence);
 }
 
+/**
+ * Start the PCM if it is still in the PREPARED state and the start
+ * threshold has been reached, like snd_pcm_writei() does.
+ */
+static int
+alsa_start_mmap(AlsaOutput *ad)
+{
+	if (snd_pcm_state(ad->pcm) != SND_PCM_STATE_PREPARED)
+		return 0;
+
+	const snd_pcm_sframes_t avail = snd_pcm_avail_update(ad->pcm);
+	if (avail < 0)
+		return (int)avail;
+
+	if (ad->buffer_frames - (snd_pcm_uframes_t)avail < ad->start_threshold)
+		return 0;
+
+	return snd_pcm_start(ad->pcm);
+}
+
+/**
+ * Export the chunk directly into the memory-mapped ALSA buffer,
+ * saving the copy to the intermediate #PcmExport buffer and the copy
+ * done by snd_pcm_mmap_writei().  This is only used for DSD export
+ * (DoP or native DSD).
+ */
+static size_t
+alsa_play_mmap(AlsaOutput *ad, const void *chunk, size_t size,
+	       Error &error)
+{
+	while (true) {
+		snd_pcm_sframes_t avail = snd_pcm_avail_update(ad->pcm);
+		if (avail == 0) {
+			/* the buffer is full; wait like
+			   snd_pcm_writei() would */
+			int err = snd_pcm_wait(ad->pcm, 1000);
+			if (err >= 0)
+				continue;
+
+			avail = err;
+		}
+
+		if (avail < 0) {
+			if (avail != -EAGAIN && avail != -EINTR &&
+			    alsa_recover(ad, avail) < 0) {
+				error.Set(alsa_output_domain, avail,
+					  snd_strerror(-avail));
+				return 0;
+			}
+
+			continue;
+		}
+
+		const snd_pcm_channel_area_t *areas;
+		snd_pcm_uframes_t offset, frames = avail;
+		int err = snd_pcm_mmap_begin(ad->pcm, &areas, &offset,
+					     &frames);
+		if (err < 0) {
+			if (alsa_recover(ad, err) < 0) {
+				error.Set(alsa_output_domain, err,
+					  snd_strerror(-err));
+				return 0;
+			}
+
+			continue;
+		}
+
+		/* with interleaved access, all channels share one
+		   area */
+		uint8_t *dest = (uint8_t *)areas[0].addr +
+			areas[0].first / 8 + offset * ad->out_frame_size;
+
+		size_t dest_size;
+		const size_t consumed =
+			ad->pcm_export->ExportTo(chunk, size, dest,
+						 frames * ad->out_frame_size,
+						 dest_size);
+		assert(dest_size % ad->out_frame_size == 0);
+
+		const snd_pcm_uframes_t n = dest_size / ad->out_frame_size;
+		const snd_pcm_sframes_t ret =
+			snd_pcm_mmap_commit(ad->pcm, offset, n);
+		if (ret < 0 || (snd_pcm_uframes_t)ret != n) {
+			/* the frames have been consumed by the
+			   export filter, there is no way to submit
+			   them again; treat this like an underrun */
+			err = ret < 0 ? (int)ret : -EPIPE;
+			if (alsa_recover(ad, err) < 0) {
+				error.Set(alsa_output_domain, err,
+					  snd_strerror(-err));
+				return 0;
+			}
+		} else {
+			ad->period_position = (ad->period_position + n)
+				% ad->period_frames;
+			pcm_copy_count(PcmCopyPath::MMAP, dest_size);
+
+			/* unlike snd_pcm_writei(), committing does
+			   not start the PCM automatically */
+			err = alsa_start_mmap(ad);
+			if (err < 0 && alsa_recover(ad, err) < 0) {
+				error.Set(alsa_output_domain, err,
+					  snd_strerror(-err));
+				return 0;
+			}
+		}
+
+		if (consumed > 0)
+			return consumed;
+	}
+}
+
 static size_t
 alsa_play(struct audio_output *ao, const void *chunk, size_t size,
 	  Error &error)
@@ -909,15 +1061,22 @@ alsa_play(struct audio_output *ao, const void *chunk, size_t size,
 		}
 	}
 
+	if (ad->use_mmap && ad->pcm_export->CanExportTo())
+		return alsa_play_mmap(ad, chunk, size, error);
+
 	const size_t original_size = size;
+	const void *const original_chunk = chunk;
 	chunk = ad->pcm_export->Export(chunk, size, size);
+	if (chunk != original_chunk)
+		pcm_copy_count(PcmCopyPath::EXPORT, size);
+
 	if (size == 0)
-		/* the DoP (DSD over PCM) filter converts two frames
-		   at a time and ignores the last odd frame; if there
-		   was only one frame (e.g. the last frame in the
-		   file), the result is empty; to avoid an endless
-		   loop, bail out here, and pretend the one frame has
-		   been played */
+		/* the DoP (DSD over PCM) and native DSD filters
+		   convert two or four frames at a time and carry the
+		   remaining frames over to the next call; if there
+		   were not enough frames for one output frame, the
+		   result is empty, but the frames have been consumed
+		   by the carry-over buffer */
 		return original_size;
 
 	assert(size % ad->out_frame_size == 0);
@@ -932,6 +1091,7 @@ alsa_play(struct audio_output *ao, const void *chunk, size_t size,
 				% ad->period_frames;
 
 			size_t bytes_written = ret * ad->out_frame_size;
+			pcm_copy_count(PcmCopyPath::OUTPUT, bytes_written);
 			return ad->pcm_export->CalcSourceSize(bytes_written);
 		}
 
@@ -423,6 +423,8 @@ sample_format_to_oss(SampleFormat format)
 	case SampleFormat::FLOAT:
 	case SampleFormat::DSD:
 	case SampleFormat::DSD_U8:
+	case SampleFormat::DSD_U16_LE:
+	case SampleFormat::DSD_U16_BE:
 	case SampleFormat::DSD_U32_BE:
 	case SampleFormat::DSD_U32_LE:
 		return AFMT_QUERY;
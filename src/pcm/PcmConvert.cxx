@@ -22,15 +22,46 @@
 #include "PcmChannels.hxx"
 #include "PcmFormat.hxx"
 #include "AudioFormat.hxx"
+#include "ConfigGlobal.hxx"
+#include "ConfigOption.hxx"
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
 
+#include <algorithm>
+
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 
 const Domain pcm_convert_domain("pcm_convert");
 
+/**
+ * Decimate DSD to the output sample rate with #PcmDsdDecimator
+ * instead of resampling the dsd2pcm output?
+ */
+static bool dsd_decimator_enabled = true;
+
+/**
+ * Quantize decimated DSD to S16/S24 with the dsd2pcm noise shaper?
+ */
+static bool dsd_noise_shaping = false;
+
+/**
+ * The size of the intermediate buffers of the generic fused
+ * conversion.  Both of them together should fit in the L1 cache.
+ */
+static constexpr size_t FUSED_BLOCK_SIZE = 8192;
+
+void
+pcm_convert_global_init()
+{
+	dsd_decimator_enabled = config_get_bool(CONF_DSD_DECIMATOR, true);
+	dsd_noise_shaping = config_get_bool(CONF_DSD_NOISE_SHAPING, false);
+}
+
 PcmConvert::PcmConvert()
+	:plan_src_format(AudioFormat::Undefined()),
+	 plan_dest_format(AudioFormat::Undefined())
 {
 }
 
@@ -42,9 +73,168 @@ void
 PcmConvert::Reset()
 {
 	dsd.Reset();
+	dsd_decimator.Reset();
 	resampler.Reset();
 }
 
+void
+PcmConvert::Plan(const AudioFormat src_format, const AudioFormat dest_format)
+{
+	plan_src_format = src_format;
+	plan_dest_format = dest_format;
+
+	/* if only one of the two changes, the conversion functions
+	   already need just one pass */
+	fused = src_format.format != dest_format.format &&
+		src_format.channels != dest_format.channels;
+	if (!fused)
+		return;
+
+	fused_kernel = pcm_fused_kernel(src_format.format,
+					src_format.channels,
+					dest_format.format,
+					dest_format.channels);
+
+	const size_t intermediate_frame_size =
+		sample_format_size(dest_format.format) *
+		std::max(src_format.channels, dest_format.channels);
+	fused_block_frames =
+		std::max<size_t>(FUSED_BLOCK_SIZE / intermediate_frame_size, 1);
+}
+
+/**
+ * Converts the sample format with the function for #dest_format.
+ */
+static const void *
+pcm_convert_format(PcmBuffer &buffer, PcmDither &dither,
+		   SampleFormat src_format, SampleFormat dest_format,
+		   const void *src, size_t src_size, size_t *dest_size_r)
+{
+	switch (dest_format) {
+	case SampleFormat::S16:
+		return pcm_convert_to_16(buffer, dither, src_format,
+					 src, src_size, dest_size_r);
+
+	case SampleFormat::S24_P32:
+		return pcm_convert_to_24(buffer, src_format,
+					 src, src_size, dest_size_r);
+
+	case SampleFormat::S32:
+		return pcm_convert_to_32(buffer, src_format,
+					 src, src_size, dest_size_r);
+
+	case SampleFormat::FLOAT:
+		return pcm_convert_to_float(buffer, src_format,
+					    src, src_size, dest_size_r);
+
+	default:
+		return nullptr;
+	}
+}
+
+/**
+ * Converts the channel count with the function for #format.
+ */
+static const void *
+pcm_convert_channels(PcmBuffer &buffer, SampleFormat format,
+		     unsigned dest_channels, unsigned src_channels,
+		     const void *src, size_t src_size, size_t *dest_size_r)
+{
+	switch (format) {
+	case SampleFormat::S16:
+		return pcm_convert_channels_16(buffer, dest_channels,
+					       src_channels,
+					       (const int16_t *)src, src_size,
+					       dest_size_r);
+
+	case SampleFormat::S24_P32:
+		return pcm_convert_channels_24(buffer, dest_channels,
+					       src_channels,
+					       (const int32_t *)src, src_size,
+					       dest_size_r);
+
+	case SampleFormat::S32:
+		return pcm_convert_channels_32(buffer, dest_channels,
+					       src_channels,
+					       (const int32_t *)src, src_size,
+					       dest_size_r);
+
+	case SampleFormat::FLOAT:
+		return pcm_convert_channels_float(buffer, dest_channels,
+						  src_channels,
+						  (const float *)src, src_size,
+						  dest_size_r);
+
+	default:
+		return nullptr;
+	}
+}
+
+const void *
+PcmConvert::ConvertFused(const AudioFormat src_format,
+			 const void *src_buffer, size_t src_size,
+			 const AudioFormat dest_format, size_t *dest_size_r,
+			 Error &error)
+{
+	const size_t src_frame_size = src_format.GetFrameSize();
+	const size_t dest_frame_size = sample_format_size(dest_format.format) *
+		dest_format.channels;
+
+	assert(src_size % src_frame_size == 0);
+
+	const size_t n_frames = src_size / src_frame_size;
+	*dest_size_r = n_frames * dest_frame_size;
+	uint8_t *const dest = (uint8_t *)fused_buffer.Get(*dest_size_r);
+
+	if (fused_kernel != nullptr) {
+		fused_kernel(dither, dest, src_buffer, n_frames);
+		return dest;
+	}
+
+	/* no specialized kernel: run both conversion functions on
+	   small blocks, so the intermediate data never leaves the
+	   cache */
+
+	const uint8_t *src = (const uint8_t *)src_buffer;
+	for (size_t i = 0; i < n_frames; i += fused_block_frames) {
+		const size_t n = std::min(fused_block_frames, n_frames - i);
+
+		size_t size;
+		const void *block =
+			pcm_convert_format(format_buffer, dither,
+					   src_format.format,
+					   dest_format.format,
+					   src + i * src_frame_size,
+					   n * src_frame_size, &size);
+		if (block == nullptr) {
+			error.Format(pcm_convert_domain,
+				     "Conversion from %s to %s is not implemented",
+				     sample_format_to_string(src_format.format),
+				     sample_format_to_string(dest_format.format));
+			return nullptr;
+		}
+
+		block = pcm_convert_channels(channels_buffer,
+					     dest_format.format,
+					     dest_format.channels,
+					     src_format.channels,
+					     block, size, &size);
+		if (block == nullptr) {
+			error.Format(pcm_convert_domain,
+				     "Conversion from %u to %u channels "
+				     "is not implemented",
+				     src_format.channels,
+				     dest_format.channels);
+			return nullptr;
+		}
+
+		assert(size == n * dest_frame_size);
+		memcpy(dest + i * dest_frame_size, block, size);
+	}
+
+	return dest;
+}
+
 inline const int16_t *
 PcmConvert::Convert16(const AudioFormat src_format,
 		      const void *src_buffer, size_t src_size,
@@ -272,11 +462,56 @@ PcmConvert::Convert(AudioFormat src_format,
 		float_format = src_format;
 		float_format.format = SampleFormat::FLOAT;
 
+		if (dsd_decimator_enabled &&
+		    PcmDsdDecimator::CanDecimate(src_format.sample_rate,
+						 dest_format.sample_rate)) {
+			/* filter down to the output rate right here,
+			   which is much cheaper than running the
+			   resampler (and everything before it) at
+			   the dsd2pcm rate */
+			f = dsd_decimator.Decimate(src_format.channels,
+						   src_format.sample_rate,
+						   dest_format.sample_rate,
+						   f, f_size, &f_size);
+			float_format.sample_rate = dest_format.sample_rate;
+
+			if (dsd_noise_shaping &&
+			    dest_format.channels == src_format.channels &&
+			    dest_format.format != SampleFormat::FLOAT) {
+				const void *result =
+					dsd_decimator.ToInteger(dest_format.format,
+								f, f_size,
+								dest_size_r);
+				if (result != nullptr)
+					return result;
+			}
+		}
+
 		src_format = float_format;
 		src = f;
 		src_size = f_size;
 	}
 
+	if (src_format != plan_src_format || dest_format != plan_dest_format)
+		Plan(src_format, dest_format);
+
+	if (fused) {
+		src = ConvertFused(src_format, src, src_size,
+				   dest_format, &src_size, error);
+		if (src == nullptr)
+			return nullptr;
+
+		/* the rest is done by the functions below; all that
+		   may be left is resampling */
+		src_format.format = dest_format.format;
+		src_format.channels = dest_format.channels;
+
+		if (src_format == dest_format) {
+			*dest_size_r = src_size;
+			return src;
+		}
+	}
+
 	switch (dest_format.format) {
 	case SampleFormat::S16:
 		return Convert16(src_format, src, src_size,
@@ -22,12 +22,14 @@
 
 #include "PcmDither.hxx"
 #include "PcmDsd.hxx"
+#include "PcmDsdDecimate.hxx"
 #include "PcmResample.hxx"
 #include "PcmBuffer.hxx"
+#include "PcmFused.hxx"
+#include "AudioFormat.hxx"
 
 #include <stddef.h>
 
-struct AudioFormat;
 class Error;
 
 /**
@@ -38,6 +40,8 @@ class Error;
 class PcmConvert {
 	PcmDsd dsd;
 
+	PcmDsdDecimator dsd_decimator;
+
 	PcmResampler resampler;
 
 	PcmDither dither;
@@ -48,6 +52,37 @@ class PcmConvert {
 	/** the buffer for converting the channel count */
 	PcmBuffer channels_buffer;
 
+	/**
+	 * The destination buffer of the fused sample format and
+	 * channel count conversion.
+	 */
+	PcmBuffer fused_buffer;
+
+	/**
+	 * The formats the current plan was made for; see Plan().
+	 */
+	AudioFormat plan_src_format, plan_dest_format;
+
+	/**
+	 * Convert the sample format and the channel count in one
+	 * pass (ConvertFused())?
+	 */
+	bool fused;
+
+	/**
+	 * The specialized kernel for the fused conversion, or
+	 * nullptr to run the generic conversion functions block by
+	 * block.
+	 */
+	PcmFusedKernel fused_kernel;
+
+	/**
+	 * The number of frames per block of the generic fused
+	 * conversion, chosen so the intermediate buffers stay in the
+	 * L1 cache.
+	 */
+	size_t fused_block_frames;
+
 public:
 	PcmConvert();
 	~PcmConvert();
@@ -79,6 +114,22 @@ public:
 			    Error &error);
 
 private:
+	/**
+	 * Decides how to convert from #src_format to #dest_format.
+	 * This is called whenever one of them changes.
+	 */
+	void Plan(AudioFormat src_format, AudioFormat dest_format);
+
+	/**
+	 * Converts the sample format and the channel count, but not
+	 * the sample rate.
+	 */
+	const void *ConvertFused(AudioFormat src_format,
+				 const void *src_buffer, size_t src_size,
+				 AudioFormat dest_format,
+				 size_t *dest_size_r,
+				 Error &error);
+
 	const int16_t *Convert16(AudioFormat src_format,
 				 const void *src_buffer, size_t src_size,
 				 AudioFormat dest_format,
@@ -106,4 +157,11 @@ private:
 
 extern const class Domain pcm_convert_domain;
 
+/**
+ * Load the DSD to PCM conversion settings from the configuration
+ * file.
+ */
+void
+pcm_convert_global_init();
+
 #endif
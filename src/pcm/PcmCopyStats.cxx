@@ -17,25 +17,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
-#ifndef MPD_PCM_DSD_USB_HXX
-#define MPD_PCM_DSD_USB_HXX
 
-#include "check.h"
+#include "config.h"
+#include "PcmCopyStats.hxx"
 
-#include <stdint.h>
-#include <stddef.h>
-
-class PcmBuffer;
-
-/**
- * Pack DSD 1 bit samples into (padded) 24 bit PCM samples for
- * playback over USB, according to the proposed standard by 
- * dCS and others:
- * http://www.sonore.us/DoP_openStandard_1v1.pdf
- */
-const uint32_t *
-pcm_dsd_to_usb(PcmBuffer &buffer, unsigned channels,
-	       const uint8_t *src, size_t src_size,
-	       size_t *dest_size_r);
-
-#endif
+std::atomic<uint64_t> pcm_copy_counters[unsigned(PcmCopyPath::COUNT)];
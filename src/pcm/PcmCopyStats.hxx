@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_PCM_COPY_STATS_HXX
+#define MPD_PCM_COPY_STATS_HXX
+
+#include <atomic>
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * The stages of the audio data path which copy sample data.  These
+ * counters allow measuring how many bytes are moved around per
+ * second, e.g. to verify that a zero-copy path is really used.
+ */
+enum class PcmCopyPath : unsigned {
+	/**
+	 * The decoder copies (and possibly rearranges) data into a
+	 * #music_chunk.
+	 */
+	DECODER,
+
+	/**
+	 * #PcmExport converts a chunk into its own buffer.
+	 */
+	EXPORT,
+
+	/**
+	 * The output plugin copies data into the device buffer
+	 * (e.g. snd_pcm_writei()).
+	 */
+	OUTPUT,
+
+	/**
+	 * #PcmExport writes directly into the memory-mapped device
+	 * buffer, replacing both #EXPORT and #OUTPUT.
+	 */
+	MMAP,
+
+	COUNT
+};
+
+extern std::atomic<uint64_t> pcm_copy_counters[unsigned(PcmCopyPath::COUNT)];
+
+static inline void
+pcm_copy_count(PcmCopyPath path, size_t nbytes)
+{
+	pcm_copy_counters[unsigned(path)].fetch_add(nbytes,
+						     std::memory_order_relaxed);
+}
+
+static inline uint64_t
+pcm_copy_get(PcmCopyPath path)
+{
+	return pcm_copy_counters[unsigned(path)].load(std::memory_order_relaxed);
+}
+
+#endif
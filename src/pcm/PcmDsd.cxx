@@ -20,31 +20,25 @@
 #include "config.h"
 #include "PcmDsd.hxx"
 #include "dsd2pcm/dsd2pcm.h"
-#include "util/Macros.hxx"
-
-#include <algorithm>
 
 #include <assert.h>
-#include <string.h>
 
 PcmDsd::PcmDsd()
+	:dsd2pcm(nullptr)
 {
-	std::fill_n(dsd2pcm, ARRAY_SIZE(dsd2pcm), nullptr);
 }
 
 PcmDsd::~PcmDsd()
 {
-	for (unsigned i = 0; i < ARRAY_SIZE(dsd2pcm); ++i)
-		if (dsd2pcm[i] != nullptr)
-			dsd2pcm_destroy(dsd2pcm[i]);
+	if (dsd2pcm != nullptr)
+		dsd2pcm_multi_destroy(dsd2pcm);
 }
 
 void
 PcmDsd::Reset()
 {
-	for (unsigned i = 0; i < ARRAY_SIZE(dsd2pcm); ++i)
-		if (dsd2pcm[i] != nullptr)
-			dsd2pcm_reset(dsd2pcm[i]);
+	if (dsd2pcm != nullptr)
+		dsd2pcm_multi_reset(dsd2pcm);
 }
 
 const float *
@@ -55,7 +49,6 @@ PcmDsd::ToFloat(unsigned channels, bool lsbfirst,
 	assert(src != nullptr);
 	assert(src_size > 0);
 	assert(src_size % channels == 0);
-	assert(channels <= ARRAY_SIZE(dsd2pcm));
 
 	const unsigned num_samples = src_size;
 	const unsigned num_frames = src_size / channels;
@@ -65,17 +58,17 @@ PcmDsd::ToFloat(unsigned channels, bool lsbfirst,
 	*dest_size_r = dest_size;
 	dest = (float *)buffer.Get(dest_size);
 
-	for (unsigned c = 0; c < channels; ++c) {
-		if (dsd2pcm[c] == nullptr) {
-			dsd2pcm[c] = dsd2pcm_init();
-			if (dsd2pcm[c] == nullptr)
-				return nullptr;
-		}
+	if (dsd2pcm != nullptr && dsd2pcm_multi_channels(dsd2pcm) != channels) {
+		dsd2pcm_multi_destroy(dsd2pcm);
+		dsd2pcm = nullptr;
+	}
 
-		dsd2pcm_translate(dsd2pcm[c], num_frames,
-				  src + c, channels,
-				  lsbfirst, dest + c, channels);
+	if (dsd2pcm == nullptr) {
+		dsd2pcm = dsd2pcm_multi_init(channels);
+		if (dsd2pcm == nullptr)
+			return nullptr;
 	}
 
+	dsd2pcm_multi_translate(dsd2pcm, num_frames, src, lsbfirst, dest);
 	return dest;
 }
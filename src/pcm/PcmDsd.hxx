@@ -31,7 +31,11 @@
 struct PcmDsd {
 	PcmBuffer buffer;
 
-	struct dsd2pcm_ctx_s *dsd2pcm[32];
+	/**
+	 * The multi-channel dsd2pcm engine; it is (re)created
+	 * lazily when the channel count changes.
+	 */
+	struct dsd2pcm_multi_s *dsd2pcm;
 
 	PcmDsd();
 	~PcmDsd();
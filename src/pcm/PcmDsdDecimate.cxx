@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+#include "PcmDsdDecimate.hxx"
+#include "PcmUtils.hxx"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+/**
+ * The number of taps of all stages but the last one.  These run at
+ * high rates where the band of interest is far below the new Nyquist
+ * frequency, so a short filter is good enough.
+ */
+static constexpr unsigned SHORT_TAPS = 27;
+
+/**
+ * The Kaiser window parameter for all stages (about 90 dB stopband
+ * attenuation).
+ */
+static constexpr double KAISER_BETA = 9.0;
+
+/**
+ * Noise shaping filter coefficients from the dsd2pcm sample program
+ * (two second order sections: b1, b2, a1, a2).
+ */
+static constexpr float noise_shape_coefficients[] = {
+	-1.62666423,  0.79410094,  0.61367127,  0.23311013,
+	-1.44870017,  0.54196219,  0.03373857,  0.70316556,
+};
+
+static constexpr int noise_shape_sos_count =
+	sizeof(noise_shape_coefficients) / (sizeof(noise_shape_coefficients[0]) * 4);
+
+/**
+ * The coefficients of a Kaiser-windowed half-band low-pass filter.
+ * Only the nonzero taps left of the center are stored; the center
+ * tap is 0.5.
+ */
+template<unsigned N>
+struct HalfBandFilter {
+	static_assert(N % 4 == 3, "Half-band filter length must be 4k-1");
+
+	float coefficients[(N + 1) / 4];
+
+	HalfBandFilter() {
+		constexpr int center = (N - 1) / 2;
+		const double i0_beta = BesselI0(KAISER_BETA);
+
+		double sum = 0;
+		for (unsigned k = 0; k < (N + 1) / 4; ++k) {
+			const int n = 2 * k;
+			const int x = n - center;
+			const double sinc = sin(M_PI * x / 2) / (M_PI * x);
+			const double r = 2.0 * n / (N - 1) - 1;
+			const double window =
+				BesselI0(KAISER_BETA * sqrt(1 - r * r)) / i0_beta;
+			const double h = sinc * window;
+			coefficients[k] = h;
+			sum += h;
+		}
+
+		/* normalize to unity DC gain: the side taps (twice
+		   this half) must add up to 0.5 */
+		for (auto &c : coefficients)
+			c *= 0.25 / sum;
+	}
+};
+
+static const float *
+GetHalfBandCoefficients(unsigned n_taps)
+{
+	static const HalfBandFilter<SHORT_TAPS> short_filter;
+	static const HalfBandFilter<PcmDsdDecimator::MAX_TAPS> long_filter;
+
+	switch (n_taps) {
+	case SHORT_TAPS:
+		return short_filter.coefficients;
+
+	default:
+		return long_filter.coefficients;
+	}
+}
+
+PcmDsdDecimator::PcmDsdDecimator()
+	:channels(0), n_stages(0), noise_shapers_initialized(false)
+{
+}
+
+PcmDsdDecimator::~PcmDsdDecimator()
+{
+	DeinitNoiseShapers();
+}
+
+bool
+PcmDsdDecimator::CanDecimate(unsigned src_rate, unsigned dest_rate)
+{
+	if (dest_rate == 0 || dest_rate >= src_rate ||
+	    src_rate % dest_rate != 0)
+		return false;
+
+	const unsigned factor = src_rate / dest_rate;
+	return (factor & (factor - 1)) == 0 && factor <= (1u << MAX_STAGES);
+}
+
+void
+PcmDsdDecimator::Configure(unsigned _channels, unsigned _n_stages)
+{
+	assert(_channels > 0 && _channels <= MAX_CHANNELS);
+	assert(_n_stages > 0 && _n_stages <= MAX_STAGES);
+
+	if (_channels != channels)
+		DeinitNoiseShapers();
+
+	channels = _channels;
+	n_stages = _n_stages;
+
+	for (unsigned i = 0; i < n_stages; ++i) {
+		Stage &stage = stages[i];
+		if (i == n_stages - 1)
+			stage.n_taps = MAX_TAPS;
+		else
+			stage.n_taps = SHORT_TAPS;
+		stage.coefficients = GetHalfBandCoefficients(stage.n_taps);
+	}
+
+	Reset();
+}
+
+void
+PcmDsdDecimator::Reset()
+{
+	for (unsigned i = 0; i < n_stages; ++i) {
+		Stage &stage = stages[i];
+		stage.phase = 0;
+		std::fill_n(stage.history, (stage.n_taps - 1) * channels, 0.f);
+	}
+
+	DeinitNoiseShapers();
+}
+
+bool
+PcmDsdDecimator::InitNoiseShapers()
+{
+	if (noise_shapers_initialized)
+		return true;
+
+	for (unsigned c = 0; c < channels; ++c) {
+		if (noise_shape_init(&noise_shapers[c], noise_shape_sos_count,
+				     noise_shape_coefficients) != 0) {
+			while (c-- > 0)
+				noise_shape_destroy(&noise_shapers[c]);
+			return false;
+		}
+	}
+
+	noise_shapers_initialized = true;
+	return true;
+}
+
+void
+PcmDsdDecimator::DeinitNoiseShapers()
+{
+	if (!noise_shapers_initialized)
+		return;
+
+	for (unsigned c = 0; c < channels; ++c)
+		noise_shape_destroy(&noise_shapers[c]);
+
+	noise_shapers_initialized = false;
+}
+
+inline const float *
+PcmDsdDecimator::DecimateStage(Stage &stage, PcmBuffer &dest_buffer,
+			       const float *src, size_t n_frames,
+			       size_t *n_frames_r)
+{
+	const unsigned n_taps = stage.n_taps;
+	const unsigned history_frames = n_taps - 1;
+	const unsigned center = history_frames / 2;
+	const unsigned n_coefficients = (n_taps + 1) / 4;
+	const float *const coefficients = stage.coefficients;
+
+	/* prepend the history to the new input */
+
+	const size_t total_frames = history_frames + n_frames;
+	float *work = (float *)
+		work_buffer.Get(total_frames * channels * sizeof(*work));
+	std::copy_n(stage.history, history_frames * channels, work);
+	std::copy_n(src, n_frames * channels,
+		    work + history_frames * channels);
+
+	const size_t n_out = n_frames > stage.phase
+		? (n_frames - stage.phase + 1) / 2
+		: 0;
+	float *const dest = (float *)
+		dest_buffer.Get(n_out * channels * sizeof(*dest));
+
+	size_t e = history_frames + stage.phase;
+	for (size_t i = 0; i < n_out; ++i, e += 2) {
+		for (unsigned c = 0; c < channels; ++c) {
+			const float *x = work + c;
+			float acc = 0.5f * x[(e - center) * channels];
+			for (unsigned k = 0; k < n_coefficients; ++k)
+				acc += coefficients[k] *
+					(x[(e - 2 * k) * channels] +
+					 x[(e - history_frames + 2 * k) * channels]);
+			dest[i * channels + c] = acc;
+		}
+	}
+
+	stage.phase = e - total_frames;
+	assert(stage.phase <= 1);
+
+	std::copy_n(work + n_frames * channels, history_frames * channels,
+		    stage.history);
+
+	*n_frames_r = n_out;
+	return dest;
+}
+
+const float *
+PcmDsdDecimator::Decimate(unsigned _channels,
+			  unsigned src_rate, unsigned dest_rate,
+			  const float *src, size_t src_size,
+			  size_t *dest_size_r)
+{
+	assert(CanDecimate(src_rate, dest_rate));
+	assert(src_size % (_channels * sizeof(*src)) == 0);
+
+	unsigned _n_stages = 0;
+	while ((dest_rate << _n_stages) < src_rate)
+		++_n_stages;
+
+	if (_channels != channels || _n_stages != n_stages)
+		Configure(_channels, _n_stages);
+
+	size_t n_frames = src_size / (channels * sizeof(*src));
+	for (unsigned i = 0; i < n_stages; ++i)
+		src = DecimateStage(stages[i], buffers[i % 2],
+				    src, n_frames, &n_frames);
+
+	*dest_size_r = n_frames * channels * sizeof(*src);
+	return src;
+}
+
+template<typename T>
+inline void
+PcmDsdDecimator::NoiseShape(T *dest, const float *src, const float *src_end,
+			    float scale, int32_t min, int32_t max)
+{
+	unsigned c = 0;
+	while (src < src_end) {
+		noise_shape_ctx &ns = noise_shapers[c];
+
+		const float r = *src++ * scale + noise_shape_get(&ns);
+		const int32_t sample = std::min(std::max(int32_t(lrintf(r)),
+							 min), max);
+		noise_shape_update(&ns, std::min(std::max(sample - r, -1.f),
+						 1.f));
+		*dest++ = sample;
+
+		if (++c == channels)
+			c = 0;
+	}
+}
+
+const void *
+PcmDsdDecimator::ToInteger(SampleFormat format,
+			   const float *src, size_t src_size,
+			   size_t *dest_size_r)
+{
+	assert(channels > 0);
+	assert(src_size % (channels * sizeof(*src)) == 0);
+
+	const float *const src_end = src + src_size / sizeof(*src);
+	const size_t n = src_end - src;
+
+	switch (format) {
+	case SampleFormat::S16: {
+		if (!InitNoiseShapers())
+			return nullptr;
+
+		int16_t *dest = (int16_t *)
+			integer_buffer.Get(n * sizeof(*dest));
+		NoiseShape(dest, src, src_end, 32768, -32768, 32767);
+		*dest_size_r = n * sizeof(*dest);
+		return dest;
+	}
+
+	case SampleFormat::S24_P32: {
+		if (!InitNoiseShapers())
+			return nullptr;
+
+		int32_t *dest = (int32_t *)
+			integer_buffer.Get(n * sizeof(*dest));
+		NoiseShape(dest, src, src_end, 8388608, -8388608, 8388607);
+		*dest_size_r = n * sizeof(*dest);
+		return dest;
+	}
+
+	case SampleFormat::S32: {
+		/* float has less precision than S32, no point in
+		   noise shaping here */
+		int32_t *dest = (int32_t *)
+			integer_buffer.Get(n * sizeof(*dest));
+		for (size_t i = 0; i < n; ++i) {
+			const double r = double(src[i]) * 2147483648.;
+			dest[i] = int32_t(std::min(std::max(r, -2147483648.),
+						   2147483647.));
+		}
+
+		*dest_size_r = n * sizeof(*dest);
+		return dest;
+	}
+
+	default:
+		return nullptr;
+	}
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_PCM_DSD_DECIMATE_HXX
+#define MPD_PCM_DSD_DECIMATE_HXX
+
+#include "check.h"
+#include "PcmBuffer.hxx"
+#include "AudioFormat.hxx"
+#include "dsd2pcm/noiseshape.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * A multi-stage polyphase decimator for the float output of
+ * #PcmDsd.  It is a cascade of half-band FIR filters, each of which
+ * halves the sample rate, so DSD64 (352.8 kHz after dsd2pcm) can be
+ * brought down to 176.4 or 88.2 kHz before it enters the rest of
+ * the PCM pipeline.
+ *
+ * Optionally, the output can be quantized to an integer format with
+ * the dsd2pcm noise shaper.
+ */
+class PcmDsdDecimator {
+public:
+	/**
+	 * The maximum number of half-band stages; this allows
+	 * decimating DSD1024 to 88.2 kHz.
+	 */
+	static constexpr unsigned MAX_STAGES = 7;
+
+	/**
+	 * The number of taps of the last (steepest) stage.  Must be
+	 * of the form 4k-1.
+	 */
+	static constexpr unsigned MAX_TAPS = 95;
+
+private:
+	struct Stage {
+		unsigned n_taps;
+
+		/**
+		 * The even taps of the left half of the symmetric
+		 * filter; the center tap is always 0.5.
+		 */
+		const float *coefficients;
+
+		/**
+		 * 0 if the next output frame ends on the first new
+		 * input frame, 1 if it ends on the second one.
+		 */
+		unsigned phase;
+
+		/**
+		 * The last (n_taps-1) input frames of the previous
+		 * call.
+		 */
+		float history[(MAX_TAPS - 1) * MAX_CHANNELS];
+	};
+
+	unsigned channels, n_stages;
+
+	Stage stages[MAX_STAGES];
+
+	PcmBuffer work_buffer, buffers[2], integer_buffer;
+
+	noise_shape_ctx noise_shapers[MAX_CHANNELS];
+	bool noise_shapers_initialized;
+
+public:
+	PcmDsdDecimator();
+	~PcmDsdDecimator();
+
+	PcmDsdDecimator(const PcmDsdDecimator &) = delete;
+	PcmDsdDecimator &operator=(const PcmDsdDecimator &) = delete;
+
+	/**
+	 * Can a stream with the given rate be decimated to the given
+	 * rate with this class?  This is the case if the ratio is a
+	 * power of two, and not larger than the maximum number of
+	 * stages allows.
+	 */
+	gcc_const
+	static bool CanDecimate(unsigned src_rate, unsigned dest_rate);
+
+	/**
+	 * Resets the filter state.  Use this at the boundary between
+	 * two distinct songs.
+	 */
+	void Reset();
+
+	/**
+	 * Decimates interleaved float samples.  The filter is
+	 * (re)configured automatically when the parameters change.
+	 *
+	 * @param src_rate the sample rate of #src
+	 * @param dest_rate the requested sample rate; CanDecimate()
+	 * must have returned true for this pair
+	 * @return the destination buffer (never nullptr)
+	 */
+	const float *Decimate(unsigned channels,
+			      unsigned src_rate, unsigned dest_rate,
+			      const float *src, size_t src_size,
+			      size_t *dest_size_r);
+
+	/**
+	 * Converts the output of the last Decimate() call to an
+	 * integer sample format, applying the dsd2pcm noise shaper
+	 * when converting to S16 or S24_P32.
+	 *
+	 * @return the destination buffer, or nullptr if the format
+	 * is not supported
+	 */
+	const void *ToInteger(SampleFormat format,
+			      const float *src, size_t src_size,
+			      size_t *dest_size_r);
+
+private:
+	void Configure(unsigned channels, unsigned n_stages);
+
+	bool InitNoiseShapers();
+	void DeinitNoiseShapers();
+
+	template<typename T>
+	void NoiseShape(T *dest, const float *src, const float *src_end,
+			float scale, int32_t min, int32_t max);
+
+	const float *DecimateStage(Stage &stage, PcmBuffer &dest_buffer,
+				   const float *src, size_t n_frames,
+				   size_t *n_frames_r);
+};
+
+#endif
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+#include "PcmDsdPack.hxx"
+#include "system/ByteOrder.hxx"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <string.h>
+
+#ifdef HAVE_X86_SIMD
+#include <tmmintrin.h>
+#endif
+
+#ifdef HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+/**
+ * Shuffle mask value which produces a zero byte (both in SSSE3's
+ * pshufb and in NEON's tbl).
+ */
+static constexpr uint8_t SHUFFLE_ZERO = 0x80;
+
+void
+PcmDsdPacker::Open(Type type, unsigned channels)
+{
+	assert(audio_valid_channel_count(channels));
+
+	const bool dop = type == Type::DOP;
+	const bool big_endian = type == Type::U16_BE || type == Type::U32_BE;
+
+	/* the number of source frames per group */
+	const unsigned frames = type == Type::U32_LE || type == Type::U32_BE
+		? 4
+		: 2;
+
+	in_group = frames * channels;
+	out_group = dop ? channels * 4 : in_group;
+	assert(out_group <= MAX_GROUP);
+
+	std::fill_n(constants[0], out_group, 0);
+	std::fill_n(constants[1], out_group, 0);
+
+	for (unsigned k = 0; k < frames; ++k) {
+		for (unsigned c = 0; c < channels; ++c) {
+			const unsigned j = k * channels + c;
+
+			if (dop) {
+				/* each 24 bit sample has 16 DSD
+				   sample bits (the older byte is the
+				   more significant one) plus the
+				   magic marker */
+				const unsigned shift = k == 0 ? 8 : 0;
+				map[j] = c * 4 + (IsLittleEndian()
+						  ? shift / 8
+						  : 3 - shift / 8);
+			} else
+				map[j] = c * frames +
+					(big_endian ? k : frames - 1 - k);
+		}
+	}
+
+	if (dop) {
+		for (unsigned c = 0; c < channels; ++c) {
+			uint8_t *marker0 = constants[0] + c * 4;
+			uint8_t *marker1 = constants[1] + c * 4;
+			const unsigned marker = IsLittleEndian() ? 2 : 1;
+			const unsigned padding = IsLittleEndian() ? 3 : 0;
+
+			marker0[marker] = 0x05;
+			marker1[marker] = 0xfa;
+			marker0[padding] = marker1[padding] = 0xff;
+		}
+	}
+
+	/* compile the layout of one 16 byte vector */
+
+	kernel = ScalarKernel;
+	groups_per_vector = 16 % out_group == 0 ? 16 / out_group : 0;
+
+	if (groups_per_vector > 0) {
+		std::fill_n(shuffle, 16, SHUFFLE_ZERO);
+
+		for (unsigned g = 0; g < groups_per_vector; ++g) {
+			for (unsigned j = 0; j < in_group; ++j)
+				shuffle[g * out_group + map[j]] =
+					g * in_group + j;
+
+			for (unsigned p = 0; p < 2; ++p)
+				std::copy_n(constants[p ^ (g & 1)], out_group,
+					    vector_constants[p] + g * out_group);
+		}
+
+#ifdef HAVE_X86_SIMD
+		if (CpuHasSSSE3())
+			kernel = SSSE3Kernel;
+#endif
+
+#ifdef HAVE_NEON
+		kernel = NeonKernel;
+#endif
+	}
+
+	Reset();
+}
+
+unsigned
+PcmDsdPacker::ScalarKernel(const PcmDsdPacker &packer,
+			   uint8_t *dest, const uint8_t *src,
+			   size_t n_groups, unsigned phase)
+{
+	const unsigned in_group = packer.in_group;
+	const unsigned out_group = packer.out_group;
+
+	for (; n_groups > 0; --n_groups) {
+		if (out_group != in_group)
+			memcpy(dest, packer.constants[phase], out_group);
+
+		for (unsigned j = 0; j < in_group; ++j)
+			dest[packer.map[j]] = src[j];
+
+		src += in_group;
+		dest += out_group;
+		phase ^= 1;
+	}
+
+	return phase;
+}
+
+/**
+ * How many 16 byte vectors can be loaded from a source buffer with
+ * the given number of groups, without reading beyond its end?
+ */
+static size_t
+CountVectors(size_t n_groups, unsigned in_group, unsigned groups_per_vector)
+{
+	const size_t src_size = n_groups * in_group;
+	if (src_size < 16)
+		return 0;
+
+	const size_t in_vector = groups_per_vector * in_group;
+	return std::min(n_groups / groups_per_vector,
+			(src_size - 16) / in_vector + 1);
+}
+
+#ifdef HAVE_X86_SIMD
+
+gcc_target("ssse3")
+unsigned
+PcmDsdPacker::SSSE3Kernel(const PcmDsdPacker &packer,
+			  uint8_t *dest, const uint8_t *src,
+			  size_t n_groups, unsigned phase)
+{
+	const unsigned groups_per_vector = packer.groups_per_vector;
+	const unsigned in_vector = groups_per_vector * packer.in_group;
+	const size_t n_vectors = CountVectors(n_groups, packer.in_group,
+					      groups_per_vector);
+
+	const __m128i mask = _mm_loadu_si128((const __m128i *)packer.shuffle);
+	const __m128i constants[2] = {
+		_mm_loadu_si128((const __m128i *)packer.vector_constants[0]),
+		_mm_loadu_si128((const __m128i *)packer.vector_constants[1]),
+	};
+
+	for (size_t i = 0; i < n_vectors; ++i) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)src);
+		_mm_storeu_si128((__m128i *)dest,
+				 _mm_or_si128(_mm_shuffle_epi8(x, mask),
+					      constants[phase]));
+
+		src += in_vector;
+		dest += 16;
+		phase ^= groups_per_vector & 1;
+	}
+
+	return ScalarKernel(packer, dest, src,
+			    n_groups - n_vectors * groups_per_vector, phase);
+}
+
+#endif
+
+#ifdef HAVE_NEON
+
+unsigned
+PcmDsdPacker::NeonKernel(const PcmDsdPacker &packer,
+			 uint8_t *dest, const uint8_t *src,
+			 size_t n_groups, unsigned phase)
+{
+	const unsigned groups_per_vector = packer.groups_per_vector;
+	const unsigned in_vector = groups_per_vector * packer.in_group;
+	const size_t n_vectors = CountVectors(n_groups, packer.in_group,
+					      groups_per_vector);
+
+	const uint8x16_t mask = vld1q_u8(packer.shuffle);
+	const uint8x16_t constants[2] = {
+		vld1q_u8(packer.vector_constants[0]),
+		vld1q_u8(packer.vector_constants[1]),
+	};
+
+	for (size_t i = 0; i < n_vectors; ++i) {
+		const uint8x16_t x = vld1q_u8(src);
+		vst1q_u8(dest, vorrq_u8(vqtbl1q_u8(x, mask),
+					constants[phase]));
+
+		src += in_vector;
+		dest += 16;
+		phase ^= groups_per_vector & 1;
+	}
+
+	return ScalarKernel(packer, dest, src,
+			    n_groups - n_vectors * groups_per_vector, phase);
+}
+
+#endif
+
+size_t
+PcmDsdPacker::PackTo(uint8_t *dest, size_t max_dest_size,
+		     const uint8_t *src, size_t src_size,
+		     size_t *dest_size_r)
+{
+	const uint8_t *const src0 = src;
+
+	const size_t available = (carry_size + src_size) / in_group;
+	size_t n_groups = std::min(available, max_dest_size / out_group);
+	*dest_size_r = n_groups * out_group;
+
+	if (carry_size > 0 && n_groups > 0) {
+		/* complete the group which was left over by the
+		   previous call */
+		const size_t n = in_group - carry_size;
+		std::copy_n(src, n, carry + carry_size);
+		src += n;
+		src_size -= n;
+		carry_size = 0;
+
+		phase = ScalarKernel(*this, dest, carry, 1, phase);
+		dest += out_group;
+		--n_groups;
+	}
+
+	phase = kernel(*this, dest, src, n_groups, phase);
+	src += n_groups * in_group;
+	src_size -= n_groups * in_group;
+
+	if (*dest_size_r == available * out_group) {
+		/* keep the remaining frames for the next call; if
+		   the destination was too small, they are not
+		   consumed, and the caller submits them again */
+		assert(carry_size + src_size < in_group);
+		std::copy_n(src, src_size, carry + carry_size);
+		carry_size += src_size;
+		src += src_size;
+	}
+
+	return src - src0;
+}
+
+const void *
+PcmDsdPacker::Pack(const uint8_t *src, size_t src_size, size_t *dest_size_r)
+{
+	previous_carry_size = carry_size;
+	previous_phase = phase;
+	last_src_size = src_size;
+
+	const size_t max_dest_size =
+		(carry_size + src_size) / in_group * out_group;
+	uint8_t *dest = (uint8_t *)buffer.Get(max_dest_size);
+
+	size_t consumed = PackTo(dest, max_dest_size, src, src_size,
+				 dest_size_r);
+	assert(consumed == src_size);
+	(void)consumed;
+
+	last_dest_size = *dest_size_r;
+	return dest;
+}
+
+size_t
+PcmDsdPacker::CalcSourceSize(size_t dest_size)
+{
+	assert(dest_size <= last_dest_size);
+	assert(dest_size % out_group == 0);
+
+	if (dest_size == last_dest_size)
+		return last_src_size;
+
+	/* the output plugins call this only after a successful
+	   play(), i.e. at least one group was consumed */
+	assert(dest_size > 0);
+
+	/* the caller will submit the rest again; forget everything
+	   after the last consumed group */
+	const size_t n_groups = dest_size / out_group;
+	phase = previous_phase ^ (n_groups & 1);
+	last_dest_size = dest_size;
+	carry_size = 0;
+	last_src_size = n_groups * in_group - previous_carry_size;
+
+	return last_src_size;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_PCM_DSD_PACK_HXX
+#define MPD_PCM_DSD_PACK_HXX
+
+#include "check.h"
+#include "PcmBuffer.hxx"
+#include "AudioFormat.hxx"
+#include "util/CpuFeatures.hxx"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Packs DSD 1 bit samples (one byte per channel and frame) into the
+ * wider transport formats understood by DACs: DSD over PCM (DoP) and
+ * the native DSD_U16/DSD_U32 formats.
+ *
+ * All of these take a fixed number of source frames (a "group") and
+ * rearrange their bytes, optionally adding marker bytes.  The byte
+ * layout of one group is compiled into a table by Open(), and the
+ * inner loop is either a SIMD byte shuffle or a table-driven scalar
+ * loop, chosen once per Open() call.
+ *
+ * Source frames which do not fill a whole group are kept in a
+ * carry-over buffer and prepended to the next Pack() call.
+ */
+class PcmDsdPacker {
+public:
+	enum class Type : uint8_t {
+		/**
+		 * DSD over PCM according to the proposed standard by
+		 * dCS and others:
+		 * http://www.sonore.us/DoP_openStandard_1v1.pdf
+		 *
+		 * The result is S24_P32 in host byte order.
+		 */
+		DOP,
+
+		U16_LE,
+		U16_BE,
+		U32_LE,
+		U32_BE,
+	};
+
+	/**
+	 * The largest possible group size in bytes (DSD_U32 or DoP
+	 * with #MAX_CHANNELS).
+	 */
+	static constexpr unsigned MAX_GROUP = 4 * MAX_CHANNELS;
+
+	/**
+	 * Packs the given number of groups, starting with the given
+	 * DoP marker phase; returns the phase after the last group.
+	 */
+	typedef unsigned (*Kernel)(const PcmDsdPacker &packer,
+				   uint8_t *dest, const uint8_t *src,
+				   size_t n_groups, unsigned phase);
+
+private:
+	Kernel kernel;
+
+	/**
+	 * The number of bytes per group in the source and in the
+	 * destination.  One group always makes one destination
+	 * frame.
+	 */
+	unsigned in_group, out_group;
+
+	/**
+	 * The number of groups handled by one SIMD shuffle.
+	 */
+	unsigned groups_per_vector;
+
+	/**
+	 * Source byte j of a group goes to destination byte map[j].
+	 */
+	uint8_t map[MAX_GROUP];
+
+	/**
+	 * The destination bytes not covered by #map (DoP markers and
+	 * padding) for each marker phase; all other bytes are zero.
+	 * DoP alternates between two markers from frame to frame.
+	 */
+	uint8_t constants[2][MAX_GROUP];
+
+	/**
+	 * The byte shuffle mask and the constant bytes (for each
+	 * phase) of one 16 byte SIMD vector.
+	 */
+	uint8_t shuffle[16], vector_constants[2][16];
+
+	/**
+	 * The marker phase of the next group, and its value before
+	 * the last Pack() call.
+	 */
+	unsigned phase, previous_phase;
+
+	uint8_t carry[MAX_GROUP];
+
+	/**
+	 * The number of bytes in #carry.
+	 */
+	unsigned carry_size;
+
+	/**
+	 * The value of #carry_size before the last Pack() call.
+	 */
+	unsigned previous_carry_size;
+
+	/**
+	 * The parameters of the last Pack() call, for
+	 * CalcSourceSize().
+	 */
+	size_t last_src_size, last_dest_size;
+
+	PcmBuffer buffer;
+
+public:
+	/**
+	 * Prepare for packing a stream with the given type and
+	 * channel count.  This cannot fail.
+	 */
+	void Open(Type type, unsigned channels);
+
+	/**
+	 * Discard the carry-over buffer, e.g. after seeking.
+	 */
+	void Reset() {
+		carry_size = previous_carry_size = 0;
+		phase = previous_phase = 0;
+		last_src_size = last_dest_size = 0;
+	}
+
+	/**
+	 * The size of one destination frame in bytes.
+	 */
+	unsigned GetFrameSize() const {
+		return out_group;
+	}
+
+	/**
+	 * Pack a buffer of DSD frames.  The last source frames which
+	 * do not fill a whole group are not lost: they are carried
+	 * over to the next call.
+	 *
+	 * @return the destination buffer; its size may be zero
+	 */
+	const void *Pack(const uint8_t *src, size_t src_size,
+			 size_t *dest_size_r);
+
+	/**
+	 * Pack DSD frames directly into a caller-supplied buffer
+	 * (e.g. a memory-mapped device buffer).  Unlike Pack(), this
+	 * may consume only a part of the source buffer if the
+	 * destination is too small; the rest must be submitted again.
+	 * Do not call CalcSourceSize() after this method.
+	 *
+	 * @param max_dest_size the size of the destination buffer
+	 * @param dest_size_r returns the number of bytes written to
+	 * the destination buffer
+	 * @return the number of source bytes consumed (including
+	 * those moved to the carry-over buffer)
+	 */
+	size_t PackTo(uint8_t *dest, size_t max_dest_size,
+		      const uint8_t *src, size_t src_size,
+		      size_t *dest_size_r);
+
+	/**
+	 * Converts the number of consumed bytes from the Pack()
+	 * destination buffer to the according number of source
+	 * bytes.  If not all of the destination buffer was consumed,
+	 * the carry-over buffer is discarded, because the caller will
+	 * submit the remaining source bytes again.
+	 */
+	size_t CalcSourceSize(size_t dest_size);
+
+private:
+	static unsigned ScalarKernel(const PcmDsdPacker &packer,
+				 uint8_t *dest, const uint8_t *src,
+				 size_t n_groups, unsigned phase);
+
+#ifdef HAVE_X86_SIMD
+	static unsigned SSSE3Kernel(const PcmDsdPacker &packer,
+				uint8_t *dest, const uint8_t *src,
+				size_t n_groups, unsigned phase);
+#endif
+
+#ifdef HAVE_NEON
+	static unsigned NeonKernel(const PcmDsdPacker &packer,
+			       uint8_t *dest, const uint8_t *src,
+			       size_t n_groups, unsigned phase);
+#endif
+};
+
+#endif
@@ -19,11 +19,13 @@
 
 #include "config.h"
 #include "PcmExport.hxx"
-#include "PcmDsdUsb.hxx"
-#include "PcmDsdNative.hxx"
 #include "PcmPack.hxx"
 #include "util/ByteReverse.hxx"
 
+#include <algorithm>
+
+#include <string.h>
+
 void
 PcmExport::Open(SampleFormat sample_format, unsigned _channels,
 		bool _dsd_usb, bool _shift8, bool _pack, bool _reverse_endian,
@@ -31,20 +33,53 @@ PcmExport::Open(SampleFormat sample_format, unsigned _channels,
 {
 	assert(audio_valid_sample_format(sample_format));
 	assert(!_dsd_usb || audio_valid_channel_count(_channels));
+	assert(!_dsd_native || audio_valid_channel_count(_channels));
 
 	channels = _channels;
 	dsd_usb = _dsd_usb && sample_format == SampleFormat::DSD;
 
-	dsd_native = _dsd_native;
+	dsd_native = _dsd_native && sample_format == SampleFormat::DSD;
 	dsd_native_type = _dsd_native_type;
 
-	if (dsd_usb)
+	dsd_pack = false;
+
+	if (dsd_usb) {
 		/* after the conversion to DSD-over-USB, the DSD
 		   samples are stuffed inside fake 24 bit samples */
+		dsd_packer.Open(PcmDsdPacker::Type::DOP, channels);
+		dsd_pack = true;
 		sample_format = SampleFormat::S24_P32;
-
-	if (dsd_native && (dsd_native_type == 2 || dsd_native_type == 3))
-		sample_format = SampleFormat::S32;
+	} else if (dsd_native) {
+		switch (dsd_native_type) {
+		case 1:
+			dsd_packer.Open(PcmDsdPacker::Type::U16_LE, channels);
+			dsd_pack = true;
+			sample_format = SampleFormat::DSD_U16_LE;
+			break;
+
+		case 2:
+			dsd_packer.Open(PcmDsdPacker::Type::U32_BE, channels);
+			dsd_pack = true;
+			sample_format = SampleFormat::DSD_U32_BE;
+			break;
+
+		case 3:
+			dsd_packer.Open(PcmDsdPacker::Type::U32_LE, channels);
+			dsd_pack = true;
+			sample_format = SampleFormat::DSD_U32_LE;
+			break;
+
+		case 4:
+			dsd_packer.Open(PcmDsdPacker::Type::U16_BE, channels);
+			dsd_pack = true;
+			sample_format = SampleFormat::DSD_U16_BE;
+			break;
+
+		default:
+			/* DSD_U8 is passed through */
+			break;
+		}
+	}
 
 	shift8 = _shift8 && sample_format == SampleFormat::S24_P32;
 	pack24 = _pack && sample_format == SampleFormat::S24_P32;
@@ -70,15 +105,13 @@ PcmExport::GetFrameSize(const AudioFormat &audio_format) const
 		/* packed 24 bit samples (3 bytes per sample) */
 		return audio_format.channels * 3;
 
-	if (dsd_usb)
+	if (dsd_pack)
 		/* the DSD-over-USB draft says that DSD 1-bit samples
 		   are enclosed within 24 bit samples, and MPD's
 		   representation of 24 bit is padded to 32 bit (4
-		   bytes per sample) */
-		return channels * 4;
-
-	if (dsd_native && (dsd_native_type == 2 || dsd_native_type == 3))
-		return channels * 4;
+		   bytes per sample); the native formats carry 2 or 4
+		   DSD bytes per channel */
+		return dsd_packer.GetFrameSize();
 
 	return audio_format.GetFrameSize();
 }
@@ -86,13 +119,8 @@ PcmExport::GetFrameSize(const AudioFormat &audio_format) const
 const void *
 PcmExport::Export(const void *data, size_t size, size_t &dest_size_r)
 {
-	if (dsd_usb)
-		data = pcm_dsd_to_usb(dsd_buffer, channels,
-				      (const uint8_t *)data, size, &size);
-
-	if (dsd_native && (dsd_native_type == 2 || dsd_native_type == 3))
-		data = pcm_dsd_native(dsd_buffer, channels,
-				      (const uint8_t *)data, size, &size, dsd_native_type);
+	if (dsd_pack)
+		data = dsd_packer.Pack((const uint8_t *)data, size, &size);
 
 	if (pack24) {
 		assert(size % 4 == 0);
@@ -144,15 +172,33 @@ PcmExport::Export(const void *data, size_t size, size_t &dest_size_r)
 }
 
 size_t
-PcmExport::CalcSourceSize(size_t size) const
+PcmExport::ExportTo(const void *src, size_t src_size,
+		    void *dest, size_t max_dest_size,
+		    size_t &dest_size_r)
+{
+	assert(CanExportTo());
+
+	if (dsd_pack)
+		return dsd_packer.PackTo((uint8_t *)dest, max_dest_size,
+					 (const uint8_t *)src, src_size,
+					 &dest_size_r);
+
+	/* native DSD_U8: a plain copy */
+	const size_t size = std::min(src_size, max_dest_size);
+	memcpy(dest, src, size);
+	dest_size_r = size;
+	return size;
+}
+
+size_t
+PcmExport::CalcSourceSize(size_t size)
 {
 	if (pack24)
 		/* 32 bit to 24 bit conversion (4 to 3 bytes) */
 		size = (size / 3) * 4;
 
-	if (dsd_usb)
-		/* DSD over USB doubles the transport size */
-		size /= 2;
+	if (dsd_pack)
+		size = dsd_packer.CalcSourceSize(size);
 
 	return size;
 }
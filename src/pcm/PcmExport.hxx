@@ -22,6 +22,7 @@
 
 #include "check.h"
 #include "PcmBuffer.hxx"
+#include "PcmDsdPack.hxx"
 #include "AudioFormat.hxx"
 
 struct AudioFormat;
@@ -33,12 +34,12 @@ struct AudioFormat;
  */
 struct PcmExport {
 	/**
-	 * The buffer is used to convert DSD samples to the
-	 * DSD-over-USB format.
+	 * Packs DSD samples into the DSD-over-USB format or a native
+	 * DSD_U16/DSD_U32 format.
 	 *
-	 * @see #dsd_usb
+	 * @see #dsd_pack
 	 */
-	PcmBuffer dsd_buffer;
+	PcmDsdPacker dsd_packer;
 
 	/**
 	 * The buffer is used to pack samples, removing padding.
@@ -75,12 +76,19 @@ struct PcmExport {
 	/**
 	 * DSD native output type
 	 * 0 = DSD_U8, no export needed
-	 * 1 = DSD_U16_LE, reserved. Not supported yet
+	 * 1 = DSD_U16_LE
 	 * 2 = DSD_U32_BE, e.g. XMOS based USB DACs
 	 * 3 = DSD_U32_LE, e.q. for BeagleBone Black with botic driver
+	 * 4 = DSD_U16_BE
 	 */
 	unsigned dsd_native_type;
 
+	/**
+	 * Is #dsd_packer used?  This is the case for DSD-over-USB
+	 * and for all native output types except DSD_U8.
+	 */
+	bool dsd_pack;
+
 	/**
 	 * Convert (padded) 24 bit samples to 32 bit by shifting 8
 	 * bits to the left?
@@ -107,12 +115,22 @@ struct PcmExport {
 	 *
 	 * This function cannot fail.
 	 *
-	 * @param channels the number of channels; ignored unless dsd_usb is set
+	 * @param channels the number of channels; ignored unless
+	 * dsd_usb or dsd_native is set
 	 */
 	void Open(SampleFormat sample_format, unsigned channels,
 		  bool dsd_usb, bool shift8, bool pack, bool reverse_endian,
 		  bool dsd_native, unsigned dsd_native_type);
 
+	/**
+	 * Discard DSD frames which were carried over from the last
+	 * Export() call.  Call this after the device was cancelled.
+	 */
+	void Reset() {
+		if (dsd_pack)
+			dsd_packer.Reset();
+	}
+
 	/**
 	 * Calculate the size of one output frame.
 	 */
@@ -131,13 +149,43 @@ struct PcmExport {
 	const void *Export(const void *src, size_t src_size,
 			   size_t &dest_size_r);
 
+	/**
+	 * Can ExportTo() be used with the current configuration?
+	 * This is only the case for DSD export (DSD-over-USB or
+	 * native DSD) without a second conversion step.
+	 */
+	gcc_pure
+	bool CanExportTo() const {
+		return (dsd_usb || dsd_native) &&
+			!shift8 && !pack24 && reverse_endian == 0;
+	}
+
+	/**
+	 * Export the PCM buffer directly into a caller-supplied
+	 * buffer, e.g. a memory-mapped device buffer.  This saves
+	 * one copy compared to Export().  Requires CanExportTo().
+	 *
+	 * @param max_dest_size the size of the destination buffer; a
+	 * multiple of the output frame size
+	 * @param dest_size_r returns the number of bytes written to
+	 * the destination buffer
+	 * @return the number of source bytes consumed; the rest must
+	 * be submitted again
+	 */
+	size_t ExportTo(const void *src, size_t src_size,
+			void *dest, size_t max_dest_size,
+			size_t &dest_size_r);
+
 	/**
 	 * Converts the number of consumed bytes from the pcm_export()
 	 * destination buffer to the according number of bytes from the
 	 * pcm_export() source buffer.
+	 *
+	 * This must be called after each Export() call which did not
+	 * return an empty buffer, because it updates the DSD
+	 * carry-over state if not everything was consumed.
 	 */
-	gcc_pure
-	size_t CalcSourceSize(size_t dest_size) const;
+	size_t CalcSourceSize(size_t dest_size);
 };
 
 #endif
@@ -188,6 +188,8 @@ pcm_convert_to_16(PcmBuffer &buffer, PcmDither &dither,
 	case SampleFormat::UNDEFINED:
 	case SampleFormat::DSD:
 	case SampleFormat::DSD_U8:
+	case SampleFormat::DSD_U16_LE:
+	case SampleFormat::DSD_U16_BE:
 	case SampleFormat::DSD_U32_BE:
 	case SampleFormat::DSD_U32_LE:
 		break;
@@ -296,6 +298,8 @@ pcm_convert_to_24(PcmBuffer &buffer,
 	case SampleFormat::UNDEFINED:
 	case SampleFormat::DSD:
 	case SampleFormat::DSD_U8:
+	case SampleFormat::DSD_U16_LE:
+	case SampleFormat::DSD_U16_BE:
 	case SampleFormat::DSD_U32_BE:
 	case SampleFormat::DSD_U32_LE:
 		break;
@@ -410,6 +414,8 @@ pcm_convert_to_32(PcmBuffer &buffer,
 	case SampleFormat::UNDEFINED:
 	case SampleFormat::DSD:
 	case SampleFormat::DSD_U8:
+	case SampleFormat::DSD_U16_LE:
+	case SampleFormat::DSD_U16_BE:
 	case SampleFormat::DSD_U32_BE:
 	case SampleFormat::DSD_U32_LE:
 		break;
@@ -523,6 +529,8 @@ pcm_convert_to_float(PcmBuffer &buffer,
 	case SampleFormat::UNDEFINED:
 	case SampleFormat::DSD:
 	case SampleFormat::DSD_U8:
+	case SampleFormat::DSD_U16_LE:
+	case SampleFormat::DSD_U16_BE:
 	case SampleFormat::DSD_U32_BE:
 	case SampleFormat::DSD_U32_LE:
 		break;
@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "PcmFused.hxx"
+#include "PcmDither.hxx"
+#include "PcmUtils.hxx"
+
+#include <stdint.h>
+
+/*
+ * Per-sample converters.  Each one must yield exactly the same
+ * result as the corresponding array function in PcmFormat.cxx.
+ */
+
+template<typename S, typename D, int shift>
+struct FusedShiftLeft {
+	typedef S src_type;
+	typedef D dest_type;
+
+	static D Convert(gcc_unused PcmDither &dither, S x) {
+		/* a multiplication instead of a left shift, which
+		   would be undefined for negative values */
+		return D(x) * (D(1) << shift);
+	}
+};
+
+template<int shift>
+struct FusedShiftRight {
+	typedef int32_t src_type;
+	typedef int32_t dest_type;
+
+	static int32_t Convert(gcc_unused PcmDither &dither, int32_t x) {
+		return x >> shift;
+	}
+};
+
+struct FusedDither24To16 {
+	typedef int32_t src_type;
+	typedef int16_t dest_type;
+
+	static int16_t Convert(PcmDither &dither, int32_t x) {
+		return dither.Dither24To16(x);
+	}
+};
+
+struct FusedDither32To16 {
+	typedef int32_t src_type;
+	typedef int16_t dest_type;
+
+	static int16_t Convert(PcmDither &dither, int32_t x) {
+		return dither.Dither32To16(x);
+	}
+};
+
+template<typename D, unsigned bits, int shift=0>
+struct FusedFromFloat {
+	typedef float src_type;
+	typedef D dest_type;
+
+	static D Convert(gcc_unused PcmDither &dither, float x) {
+		const float factor = 1 << (bits - 1);
+		int sample(x * factor);
+		return D(PcmClamp<D, int, bits>(sample)) * (D(1) << shift);
+	}
+};
+
+template<typename S, unsigned bits>
+struct FusedToFloat {
+	typedef S src_type;
+	typedef float dest_type;
+
+	static float Convert(gcc_unused PcmDither &dither, S x) {
+		constexpr float factor = 0.5 / (1 << (bits - 2));
+		return float(x) * factor;
+	}
+};
+
+/*
+ * Channel mixers, equivalent to the ones in PcmChannels.cxx.  The
+ * accumulator type (A) must match, too.
+ */
+
+template<typename T, typename A>
+struct FusedAverage {
+	static T Mix(T a, T b) {
+		return (A(a) + A(b)) / 2;
+	}
+};
+
+template<class C, class M>
+static void
+FusedStereoToMono(PcmDither &dither, void *_dest, const void *_src,
+		  size_t n_frames)
+{
+	typedef typename C::src_type S;
+	typedef typename C::dest_type D;
+
+	D *gcc_restrict dest = (D *)_dest;
+	const S *gcc_restrict src = (const S *)_src;
+
+	while (n_frames-- > 0) {
+		/* convert in sample order, because the dither state
+		   depends on it */
+		const D a = C::Convert(dither, *src++);
+		const D b = C::Convert(dither, *src++);
+		*dest++ = M::Mix(a, b);
+	}
+}
+
+template<class C>
+static void
+FusedMonoToStereo(PcmDither &dither, void *_dest, const void *_src,
+		  size_t n_frames)
+{
+	typedef typename C::src_type S;
+	typedef typename C::dest_type D;
+
+	D *gcc_restrict dest = (D *)_dest;
+	const S *gcc_restrict src = (const S *)_src;
+
+	while (n_frames-- > 0) {
+		const D value = C::Convert(dither, *src++);
+		*dest++ = value;
+		*dest++ = value;
+	}
+}
+
+/**
+ * The channel mixer of the destination format.
+ */
+template<SampleFormat F>
+struct FusedMixer;
+
+template<>
+struct FusedMixer<SampleFormat::S16> : FusedAverage<int16_t, int32_t> {};
+
+template<>
+struct FusedMixer<SampleFormat::S24_P32> : FusedAverage<int32_t, int32_t> {};
+
+template<>
+struct FusedMixer<SampleFormat::S32> : FusedAverage<int32_t, int64_t> {};
+
+template<>
+struct FusedMixer<SampleFormat::FLOAT> : FusedAverage<float, double> {};
+
+template<SampleFormat F, class C>
+static PcmFusedKernel
+FusedKernel(unsigned src_channels, unsigned dest_channels)
+{
+	if (src_channels == 1 && dest_channels == 2)
+		return FusedMonoToStereo<C>;
+	else if (src_channels == 2 && dest_channels == 1)
+		return FusedStereoToMono<C, FusedMixer<F>>;
+	else
+		return nullptr;
+}
+
+static PcmFusedKernel
+pcm_fused_kernel_16(SampleFormat src_format,
+		    unsigned src_channels, unsigned dest_channels)
+{
+	constexpr auto F = SampleFormat::S16;
+
+	switch (src_format) {
+	case SampleFormat::S24_P32:
+		return FusedKernel<F, FusedDither24To16>(src_channels,
+							 dest_channels);
+
+	case SampleFormat::S32:
+		return FusedKernel<F, FusedDither32To16>(src_channels,
+							 dest_channels);
+
+	case SampleFormat::FLOAT:
+		return FusedKernel<F, FusedFromFloat<int16_t, 16>>(src_channels,
+								   dest_channels);
+
+	default:
+		return nullptr;
+	}
+}
+
+static PcmFusedKernel
+pcm_fused_kernel_24(SampleFormat src_format,
+		    unsigned src_channels, unsigned dest_channels)
+{
+	constexpr auto F = SampleFormat::S24_P32;
+
+	switch (src_format) {
+	case SampleFormat::S16:
+		return FusedKernel<F, FusedShiftLeft<int16_t, int32_t, 8>>(src_channels,
+									   dest_channels);
+
+	case SampleFormat::S32:
+		return FusedKernel<F, FusedShiftRight<8>>(src_channels,
+							  dest_channels);
+
+	case SampleFormat::FLOAT:
+		return FusedKernel<F, FusedFromFloat<int32_t, 24>>(src_channels,
+								   dest_channels);
+
+	default:
+		return nullptr;
+	}
+}
+
+static PcmFusedKernel
+pcm_fused_kernel_32(SampleFormat src_format,
+		    unsigned src_channels, unsigned dest_channels)
+{
+	constexpr auto F = SampleFormat::S32;
+
+	switch (src_format) {
+	case SampleFormat::S16:
+		return FusedKernel<F, FusedShiftLeft<int16_t, int32_t, 16>>(src_channels,
+									    dest_channels);
+
+	case SampleFormat::S24_P32:
+		return FusedKernel<F, FusedShiftLeft<int32_t, int32_t, 8>>(src_channels,
+									   dest_channels);
+
+	case SampleFormat::FLOAT:
+		/* like pcm_allocate_float_to_32(): via S24_P32 */
+		return FusedKernel<F, FusedFromFloat<int32_t, 24, 8>>(src_channels,
+								      dest_channels);
+
+	default:
+		return nullptr;
+	}
+}
+
+static PcmFusedKernel
+pcm_fused_kernel_float(SampleFormat src_format,
+		       unsigned src_channels, unsigned dest_channels)
+{
+	constexpr auto F = SampleFormat::FLOAT;
+
+	switch (src_format) {
+	case SampleFormat::S16:
+		return FusedKernel<F, FusedToFloat<int16_t, 16>>(src_channels,
+								 dest_channels);
+
+	case SampleFormat::S24_P32:
+		return FusedKernel<F, FusedToFloat<int32_t, 24>>(src_channels,
+								 dest_channels);
+
+	case SampleFormat::S32:
+		return FusedKernel<F, FusedToFloat<int32_t, 32>>(src_channels,
+								 dest_channels);
+
+	default:
+		return nullptr;
+	}
+}
+
+PcmFusedKernel
+pcm_fused_kernel(SampleFormat src_format, unsigned src_channels,
+		 SampleFormat dest_format, unsigned dest_channels)
+{
+	switch (dest_format) {
+	case SampleFormat::S16:
+		return pcm_fused_kernel_16(src_format,
+					   src_channels, dest_channels);
+
+	case SampleFormat::S24_P32:
+		return pcm_fused_kernel_24(src_format,
+					   src_channels, dest_channels);
+
+	case SampleFormat::S32:
+		return pcm_fused_kernel_32(src_format,
+					   src_channels, dest_channels);
+
+	case SampleFormat::FLOAT:
+		return pcm_fused_kernel_float(src_format,
+					      src_channels, dest_channels);
+
+	default:
+		return nullptr;
+	}
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_FUSED_HXX
+#define MPD_PCM_FUSED_HXX
+
+#include "AudioFormat.hxx"
+#include "Compiler.h"
+
+#include <stddef.h>
+
+class PcmDither;
+
+/**
+ * A function which converts both the sample format and the channel
+ * count of #n_frames frames in a single pass, without an
+ * intermediate buffer.  The result is bit-exact with
+ * pcm_convert_to_16() (etc.) followed by pcm_convert_channels_16()
+ * (etc.).
+ */
+typedef void (*PcmFusedKernel)(PcmDither &dither, void *dest,
+			       const void *src, size_t n_frames);
+
+/**
+ * Looks up the specialized kernel for the given conversion.
+ *
+ * @return the kernel, or nullptr if there is no specialization for
+ * this combination
+ */
+gcc_const
+PcmFusedKernel
+pcm_fused_kernel(SampleFormat src_format, unsigned src_channels,
+		 SampleFormat dest_format, unsigned dest_channels);
+
+#endif
@@ -20,6 +20,7 @@
 #include "config.h"
 #include "PcmMix.hxx"
 #include "PcmVolume.hxx"
+#include "PcmVolumeSimd.hxx"
 #include "PcmUtils.hxx"
 #include "AudioFormat.hxx"
 
@@ -27,12 +28,12 @@
 
 template<typename T, typename U, unsigned bits>
 static T
-PcmAddVolume(T _a, T _b, int volume1, int volume2)
+PcmAddVolume(T _a, T _b, int volume1, int volume2, int dither)
 {
 	U a(_a), b(_b);
 
 	U c = ((a * volume1 + b * volume2) +
-	       pcm_volume_dither() + PCM_VOLUME_1 / 2)
+	       dither + PCM_VOLUME_1 / 2)
 		/ PCM_VOLUME_1;
 
 	return PcmClamp<T, U, bits>(c);
@@ -40,27 +41,339 @@ PcmAddVolume(T _a, T _b, int volume1, int volume2)
 
 template<typename T, typename U, unsigned bits>
 static void
-PcmAddVolume(T *a, const T *b, unsigned n, int volume1, int volume2)
+PcmAddVolume(T *a, const T *b, unsigned n, int volume1, int volume2,
+	     PcmVolumeDither &dither)
 {
 	for (size_t i = 0; i != n; ++i)
-		a[i] = PcmAddVolume<T, U, bits>(a[i], b[i], volume1, volume2);
+		a[i] = PcmAddVolume<T, U, bits>(a[i], b[i], volume1, volume2,
+						dither.Next(i % PCM_DITHER_LANES));
+}
+
+#ifdef HAVE_X86_SIMD
+
+/**
+ * Cross-fade 8 bit and 16 bit samples.
+ *
+ * @return the number of samples processed; the remaining samples
+ * (less than #PCM_DITHER_LANES) are left to the scalar code
+ */
+template<typename T, unsigned bits>
+gcc_target("avx2")
+static size_t
+PcmAddVolumeAVX2(T *a, const T *b, size_t n, int _volume1, int _volume2,
+		 PcmVolumeDither &dither)
+{
+	const __m256i volume1 = _mm256_set1_epi32(_volume1);
+	const __m256i volume2 = _mm256_set1_epi32(_volume2);
+	const __m256i round = _mm256_set1_epi32(PCM_VOLUME_1 / 2);
+	__m256i state = Avx2LoadDither(dither);
+
+	size_t i = 0;
+	for (; n - i >= PCM_DITHER_LANES; i += PCM_DITHER_LANES) {
+		__m256i t = _mm256_add_epi32(_mm256_mullo_epi32(Avx2Load8(a + i),
+								volume1),
+					     _mm256_mullo_epi32(Avx2Load8(b + i),
+								volume2));
+		t = _mm256_add_epi32(t, Avx2NextDither(state));
+		t = _mm256_add_epi32(t, round);
+		Avx2Store8(a + i, Avx2Scale<bits>(t));
+	}
+
+	Avx2StoreDither(dither, state);
+	return i;
+}
+
+/**
+ * Cross-fade 24 bit and 32 bit samples.
+ */
+template<unsigned bits>
+gcc_target("avx2")
+static size_t
+PcmAddVolumeWideAVX2(int32_t *a, const int32_t *b, size_t n,
+		     int _volume1, int _volume2,
+		     PcmVolumeDither &dither)
+{
+	const __m256d volume1 = _mm256_set1_pd(_volume1);
+	const __m256d volume2 = _mm256_set1_pd(_volume2);
+	const __m256i round = _mm256_set1_epi32(PCM_VOLUME_1 / 2);
+	__m256i state = Avx2LoadDither(dither);
+
+	size_t i = 0;
+	for (; n - i >= PCM_DITHER_LANES; i += PCM_DITHER_LANES) {
+		const __m256i x = Avx2Load8(a + i), y = Avx2Load8(b + i);
+		const __m256i d = _mm256_add_epi32(Avx2NextDither(state),
+						   round);
+
+		__m256d lo = _mm256_add_pd(_mm256_mul_pd(Avx2ToDouble(x, 0),
+							 volume1),
+					   _mm256_mul_pd(Avx2ToDouble(y, 0),
+							 volume2));
+		lo = _mm256_add_pd(lo, Avx2ToDouble(d, 0));
+
+		__m256d hi = _mm256_add_pd(_mm256_mul_pd(Avx2ToDouble(x, 1),
+							 volume1),
+					   _mm256_mul_pd(Avx2ToDouble(y, 1),
+							 volume2));
+		hi = _mm256_add_pd(hi, Avx2ToDouble(d, 1));
+
+		Avx2Store8(a + i, Avx2Combine(Avx2ScaleWide<bits>(lo),
+					      Avx2ScaleWide<bits>(hi)));
+	}
+
+	Avx2StoreDither(dither, state);
+	return i;
+}
+
+gcc_target("avx2")
+static size_t
+PcmAddVolumeFloatAVX2(float *a, const float *b, size_t n,
+		      float _volume1, float _volume2)
+{
+	const __m256 volume1 = _mm256_set1_ps(_volume1);
+	const __m256 volume2 = _mm256_set1_ps(_volume2);
+
+	size_t i = 0;
+	for (; n - i >= 8; i += 8)
+		_mm256_storeu_ps(a + i,
+				 _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(a + i),
+							     volume1),
+					       _mm256_mul_ps(_mm256_loadu_ps(b + i),
+							     volume2)));
+
+	return i;
+}
+
+#endif
+
+#ifdef HAVE_NEON
+
+template<typename T, unsigned bits>
+static size_t
+PcmAddVolumeNeon(T *a, const T *b, size_t n, int _volume1, int _volume2,
+		 PcmVolumeDither &dither)
+{
+	const int32x4_t volume1 = vdupq_n_s32(_volume1);
+	const int32x4_t volume2 = vdupq_n_s32(_volume2);
+	const int32x4_t round = vdupq_n_s32(PCM_VOLUME_1 / 2);
+	uint32x4_t state_lo = vld1q_u32(dither.state);
+	uint32x4_t state_hi = vld1q_u32(dither.state + 4);
+
+	size_t i = 0;
+	for (; n - i >= PCM_DITHER_LANES; i += PCM_DITHER_LANES) {
+		const NeonInt32x8 x = NeonLoad8(a + i), y = NeonLoad8(b + i);
+
+		int32x4_t lo = vmlaq_s32(NeonNextDither(state_lo),
+					 x.lo, volume1);
+		lo = vaddq_s32(vmlaq_s32(lo, y.lo, volume2), round);
+
+		int32x4_t hi = vmlaq_s32(NeonNextDither(state_hi),
+					 x.hi, volume1);
+		hi = vaddq_s32(vmlaq_s32(hi, y.hi, volume2), round);
+
+		NeonStore8(a + i, { NeonScale<bits>(lo), NeonScale<bits>(hi) });
+	}
+
+	vst1q_u32(dither.state, state_lo);
+	vst1q_u32(dither.state + 4, state_hi);
+	return i;
+}
+
+/**
+ * Cross-fade 4 samples in 64 bit lanes.
+ */
+template<unsigned bits>
+static inline int32x4_t
+NeonAddVolumeWide(int32x4_t x, int32x4_t y, int32x4_t d,
+		  int32x2_t volume1, int32x2_t volume2)
+{
+	int64x2_t lo = vmlal_s32(vmovl_s32(vget_low_s32(d)),
+				 vget_low_s32(x), volume1);
+	lo = vmlal_s32(lo, vget_low_s32(y), volume2);
+
+	int64x2_t hi = vmlal_s32(vmovl_s32(vget_high_s32(d)),
+				 vget_high_s32(x), volume1);
+	hi = vmlal_s32(hi, vget_high_s32(y), volume2);
+
+	return NeonClamp<bits>(vcombine_s32(NeonScaleWide(lo),
+					    NeonScaleWide(hi)));
+}
+
+template<unsigned bits>
+static size_t
+PcmAddVolumeWideNeon(int32_t *a, const int32_t *b, size_t n,
+		     int _volume1, int _volume2,
+		     PcmVolumeDither &dither)
+{
+	const int32x2_t volume1 = vdup_n_s32(_volume1);
+	const int32x2_t volume2 = vdup_n_s32(_volume2);
+	const int32x4_t round = vdupq_n_s32(PCM_VOLUME_1 / 2);
+	uint32x4_t state_lo = vld1q_u32(dither.state);
+	uint32x4_t state_hi = vld1q_u32(dither.state + 4);
+
+	size_t i = 0;
+	for (; n - i >= PCM_DITHER_LANES; i += PCM_DITHER_LANES) {
+		const NeonInt32x8 x = NeonLoad8(a + i), y = NeonLoad8(b + i);
+		const int32x4_t d_lo = vaddq_s32(NeonNextDither(state_lo),
+						 round);
+		const int32x4_t d_hi = vaddq_s32(NeonNextDither(state_hi),
+						 round);
+
+		NeonStore8(a + i,
+			   { NeonAddVolumeWide<bits>(x.lo, y.lo, d_lo,
+						     volume1, volume2),
+			     NeonAddVolumeWide<bits>(x.hi, y.hi, d_hi,
+						     volume1, volume2) });
+	}
+
+	vst1q_u32(dither.state, state_lo);
+	vst1q_u32(dither.state + 4, state_hi);
+	return i;
+}
+
+static size_t
+PcmAddVolumeFloatNeon(float *a, const float *b, size_t n,
+		      float _volume1, float _volume2)
+{
+	const float32x4_t volume1 = vdupq_n_f32(_volume1);
+	const float32x4_t volume2 = vdupq_n_f32(_volume2);
+
+	size_t i = 0;
+	for (; n - i >= 4; i += 4)
+		vst1q_f32(a + i,
+			  vaddq_f32(vmulq_f32(vld1q_f32(a + i), volume1),
+				    vmulq_f32(vld1q_f32(b + i), volume2)));
+
+	return i;
+}
+
+#endif
+
+/**
+ * Run the best vectorized cross-fade kernel for this CPU on the bulk
+ * of the buffer.
+ *
+ * @return the number of samples processed
+ */
+template<typename T, unsigned bits>
+static size_t
+PcmAddVolumeNarrowSIMD(T *a, const T *b, size_t n, int volume1, int volume2,
+		       PcmVolumeDither &dither)
+{
+	if (volume1 + volume2 > PCM_VOLUME_SIMD_MAX)
+		return 0;
+
+#ifdef HAVE_X86_SIMD
+	if (PcmHaveAVX2())
+		return PcmAddVolumeAVX2<T, bits>(a, b, n, volume1, volume2,
+						 dither);
+#endif
+
+#ifdef HAVE_NEON
+	return PcmAddVolumeNeon<T, bits>(a, b, n, volume1, volume2, dither);
+#else
+	(void)a;
+	(void)b;
+	(void)n;
+	(void)dither;
+	return 0;
+#endif
+}
+
+/**
+ * The variant of PcmAddVolumeNarrowSIMD() for 24 bit and 32 bit
+ * samples.
+ */
+template<unsigned bits>
+static size_t
+PcmAddVolumeSIMD(int32_t *a, const int32_t *b, size_t n,
+		 int volume1, int volume2,
+		 PcmVolumeDither &dither)
+{
+	if (volume1 + volume2 > PCM_VOLUME_SIMD_MAX)
+		return 0;
+
+#ifdef HAVE_X86_SIMD
+	if (PcmHaveAVX2())
+		return PcmAddVolumeWideAVX2<bits>(a, b, n, volume1, volume2,
+						  dither);
+#endif
+
+#ifdef HAVE_NEON
+	return PcmAddVolumeWideNeon<bits>(a, b, n, volume1, volume2,
+					  dither);
+#else
+	(void)a;
+	(void)b;
+	(void)n;
+	(void)dither;
+	return 0;
+#endif
+}
+
+template<unsigned bits>
+static size_t
+PcmAddVolumeSIMD(int8_t *a, const int8_t *b, size_t n,
+		 int volume1, int volume2,
+		 PcmVolumeDither &dither)
+{
+	return PcmAddVolumeNarrowSIMD<int8_t, bits>(a, b, n, volume1, volume2,
+						    dither);
+}
+
+template<unsigned bits>
+static size_t
+PcmAddVolumeSIMD(int16_t *a, const int16_t *b, size_t n,
+		 int volume1, int volume2,
+		 PcmVolumeDither &dither)
+{
+	return PcmAddVolumeNarrowSIMD<int16_t, bits>(a, b, n,
+						     volume1, volume2, dither);
 }
 
 template<typename T, typename U, unsigned bits>
 static void
-PcmAddVolumeVoid(void *a, const void *b, size_t size, int volume1, int volume2)
+PcmAddVolumeVoid(void *_a, const void *_b, size_t size,
+		 int volume1, int volume2)
 {
 	constexpr size_t sample_size = sizeof(T);
 	assert(size % sample_size == 0);
 
-	PcmAddVolume<T, U, bits>((T *)a, (const T *)b, size / sample_size,
-				 volume1, volume2);
+	T *a = (T *)_a;
+	const T *b = (const T *)_b;
+	const size_t n = size / sample_size;
+	PcmVolumeDither &dither = pcm_volume_dither();
+
+	const size_t done = PcmAddVolumeSIMD<bits>(a, b, n, volume1, volume2,
+						   dither);
+
+	PcmAddVolume<T, U, bits>(a + done, b + done, n - done,
+				 volume1, volume2, dither);
 }
 
 static void
 pcm_add_vol_float(float *buffer1, const float *buffer2,
 		  unsigned num_samples, float volume1, float volume2)
 {
+#ifdef HAVE_X86_SIMD
+	if (PcmHaveAVX2()) {
+		const size_t done = PcmAddVolumeFloatAVX2(buffer1, buffer2,
+							  num_samples,
+							  volume1, volume2);
+		buffer1 += done;
+		buffer2 += done;
+		num_samples -= done;
+	}
+#endif
+
+#ifdef HAVE_NEON
+	const size_t done = PcmAddVolumeFloatNeon(buffer1, buffer2,
+						  num_samples,
+						  volume1, volume2);
+	buffer1 += done;
+	buffer2 += done;
+	num_samples -= done;
+#endif
+
 	while (num_samples > 0) {
 		float sample1 = *buffer1;
 		float sample2 = *buffer2++;
@@ -80,6 +393,8 @@ pcm_add_vol(void *buffer1, const void *buffer2, size_t size,
 	case SampleFormat::UNDEFINED:
 	case SampleFormat::DSD:
 	case SampleFormat::DSD_U8:
+	case SampleFormat::DSD_U16_LE:
+	case SampleFormat::DSD_U16_BE:
 	case SampleFormat::DSD_U32_BE:
 	case SampleFormat::DSD_U32_LE:
 		/* not implemented */
@@ -133,19 +448,254 @@ PcmAdd(T *a, const T *b, unsigned n)
 		a[i] = PcmAdd<T, U, bits>(a[i], b[i]);
 }
 
+#ifdef HAVE_X86_SIMD
+
+/**
+ * Mix 8 bit samples with saturation.
+ *
+ * @return the number of samples processed
+ */
+gcc_target("avx2")
+static size_t
+PcmAddAVX2(int8_t *a, const int8_t *b, size_t n)
+{
+	size_t i = 0;
+	for (; n - i >= 32; i += 32)
+		_mm256_storeu_si256((__m256i *)(a + i),
+				    _mm256_adds_epi8(_mm256_loadu_si256((const __m256i *)(a + i)),
+						     _mm256_loadu_si256((const __m256i *)(b + i))));
+
+	return i;
+}
+
+gcc_target("avx2")
+static size_t
+PcmAddAVX2(int16_t *a, const int16_t *b, size_t n)
+{
+	size_t i = 0;
+	for (; n - i >= 16; i += 16)
+		_mm256_storeu_si256((__m256i *)(a + i),
+				    _mm256_adds_epi16(_mm256_loadu_si256((const __m256i *)(a + i)),
+						      _mm256_loadu_si256((const __m256i *)(b + i))));
+
+	return i;
+}
+
+/**
+ * Mix 24 bit samples; the sum cannot overflow 32 bits, it only needs
+ * to be clamped.
+ */
+gcc_target("avx2")
+static size_t
+PcmAdd24AVX2(int32_t *a, const int32_t *b, size_t n)
+{
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m256i sum = _mm256_add_epi32(Avx2Load8(a + i),
+						     Avx2Load8(b + i));
+		Avx2Store8(a + i, Avx2Clamp(sum, PcmSampleRange<24>::MIN,
+					    PcmSampleRange<24>::MAX));
+	}
+
+	return i;
+}
+
+/**
+ * Mix 32 bit samples.  AVX2 has no saturating 32 bit addition, so
+ * overflows are detected with the sign bits.
+ */
+gcc_target("avx2")
+static size_t
+PcmAdd32AVX2(int32_t *a, const int32_t *b, size_t n)
+{
+	const __m256i max = _mm256_set1_epi32(PcmSampleRange<32>::MAX);
+
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m256i x = Avx2Load8(a + i), y = Avx2Load8(b + i);
+		const __m256i sum = _mm256_add_epi32(x, y);
+
+		/* the sign bit is set where both operands have the
+		   same sign, but the sum does not */
+		const __m256i overflow =
+			_mm256_andnot_si256(_mm256_xor_si256(x, y),
+					    _mm256_xor_si256(x, sum));
+
+		/* INT32_MAX for positive x, INT32_MIN for negative x */
+		const __m256i saturated =
+			_mm256_xor_si256(_mm256_srai_epi32(x, 31), max);
+
+		const __m256 result =
+			_mm256_blendv_ps(_mm256_castsi256_ps(sum),
+					 _mm256_castsi256_ps(saturated),
+					 _mm256_castsi256_ps(overflow));
+		Avx2Store8(a + i, _mm256_castps_si256(result));
+	}
+
+	return i;
+}
+
+gcc_target("avx2")
+static size_t
+PcmAddFloatAVX2(float *a, const float *b, size_t n)
+{
+	size_t i = 0;
+	for (; n - i >= 8; i += 8)
+		_mm256_storeu_ps(a + i, _mm256_add_ps(_mm256_loadu_ps(a + i),
+						      _mm256_loadu_ps(b + i)));
+
+	return i;
+}
+
+#endif
+
+#ifdef HAVE_NEON
+
+static size_t
+PcmAddNeon(int8_t *a, const int8_t *b, size_t n)
+{
+	size_t i = 0;
+	for (; n - i >= 16; i += 16)
+		vst1q_s8(a + i, vqaddq_s8(vld1q_s8(a + i), vld1q_s8(b + i)));
+
+	return i;
+}
+
+static size_t
+PcmAddNeon(int16_t *a, const int16_t *b, size_t n)
+{
+	size_t i = 0;
+	for (; n - i >= 8; i += 8)
+		vst1q_s16(a + i, vqaddq_s16(vld1q_s16(a + i), vld1q_s16(b + i)));
+
+	return i;
+}
+
+static size_t
+PcmAdd24Neon(int32_t *a, const int32_t *b, size_t n)
+{
+	size_t i = 0;
+	for (; n - i >= 4; i += 4)
+		vst1q_s32(a + i,
+			  NeonClamp<24>(vaddq_s32(vld1q_s32(a + i),
+						  vld1q_s32(b + i))));
+
+	return i;
+}
+
+static size_t
+PcmAdd32Neon(int32_t *a, const int32_t *b, size_t n)
+{
+	size_t i = 0;
+	for (; n - i >= 4; i += 4)
+		vst1q_s32(a + i, vqaddq_s32(vld1q_s32(a + i), vld1q_s32(b + i)));
+
+	return i;
+}
+
+static size_t
+PcmAddFloatNeon(float *a, const float *b, size_t n)
+{
+	size_t i = 0;
+	for (; n - i >= 4; i += 4)
+		vst1q_f32(a + i, vaddq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+
+	return i;
+}
+
+#endif
+
+/**
+ * Run the best vectorized mixing kernel for this CPU on the bulk of
+ * the buffer.
+ *
+ * @return the number of samples processed
+ */
+template<unsigned bits, typename T>
+static size_t
+PcmAddSIMD(gcc_unused T *a, gcc_unused const T *b, gcc_unused size_t n)
+{
+#ifdef HAVE_X86_SIMD
+	if (PcmHaveAVX2())
+		return PcmAddAVX2(a, b, n);
+#endif
+
+#ifdef HAVE_NEON
+	return PcmAddNeon(a, b, n);
+#else
+	return 0;
+#endif
+}
+
+template<>
+size_t
+PcmAddSIMD<24, int32_t>(gcc_unused int32_t *a, gcc_unused const int32_t *b,
+			gcc_unused size_t n)
+{
+#ifdef HAVE_X86_SIMD
+	if (PcmHaveAVX2())
+		return PcmAdd24AVX2(a, b, n);
+#endif
+
+#ifdef HAVE_NEON
+	return PcmAdd24Neon(a, b, n);
+#else
+	return 0;
+#endif
+}
+
+template<>
+size_t
+PcmAddSIMD<32, int32_t>(gcc_unused int32_t *a, gcc_unused const int32_t *b,
+			gcc_unused size_t n)
+{
+#ifdef HAVE_X86_SIMD
+	if (PcmHaveAVX2())
+		return PcmAdd32AVX2(a, b, n);
+#endif
+
+#ifdef HAVE_NEON
+	return PcmAdd32Neon(a, b, n);
+#else
+	return 0;
+#endif
+}
+
 template<typename T, typename U, unsigned bits>
 static void
-PcmAddVoid(void *a, const void *b, size_t size)
+PcmAddVoid(void *_a, const void *_b, size_t size)
 {
 	constexpr size_t sample_size = sizeof(T);
 	assert(size % sample_size == 0);
 
-	PcmAdd<T, U, bits>((T *)a, (const T *)b, size / sample_size);
+	T *a = (T *)_a;
+	const T *b = (const T *)_b;
+	const size_t n = size / sample_size;
+
+	const size_t done = PcmAddSIMD<bits>(a, b, n);
+	PcmAdd<T, U, bits>(a + done, b + done, n - done);
 }
 
 static void
 pcm_add_float(float *buffer1, const float *buffer2, unsigned num_samples)
 {
+#ifdef HAVE_X86_SIMD
+	if (PcmHaveAVX2()) {
+		const size_t done = PcmAddFloatAVX2(buffer1, buffer2,
+						    num_samples);
+		buffer1 += done;
+		buffer2 += done;
+		num_samples -= done;
+	}
+#endif
+
+#ifdef HAVE_NEON
+	const size_t done = PcmAddFloatNeon(buffer1, buffer2, num_samples);
+	buffer1 += done;
+	buffer2 += done;
+	num_samples -= done;
+#endif
+
 	while (num_samples > 0) {
 		float sample1 = *buffer1;
 		float sample2 = *buffer2++;
@@ -162,6 +712,8 @@ pcm_add(void *buffer1, const void *buffer2, size_t size,
 	case SampleFormat::UNDEFINED:
 	case SampleFormat::DSD:
 	case SampleFormat::DSD_U8:
+	case SampleFormat::DSD_U16_LE:
+	case SampleFormat::DSD_U16_BE:
 	case SampleFormat::DSD_U32_BE:
 	case SampleFormat::DSD_U32_LE:
 		/* not implemented */
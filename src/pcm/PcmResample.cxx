@@ -19,13 +19,17 @@
 
 #include "config.h"
 #include "PcmResampleInternal.hxx"
+#include "util/Error.hxx"
+#include "util/Domain.hxx"
 
-#ifdef HAVE_LIBSAMPLERATE
-#include "ConfigGlobal.hxx"
-#include "ConfigOption.hxx"
+#include <string.h>
+
+#ifndef HAVE_LIBSAMPLERATE
+static constexpr Domain resample_domain("resample");
 #endif
 
-#include <string.h>
+static PcmSincResampler::Quality sinc_quality =
+	PcmSincResampler::Quality::MEDIUM;
 
 #ifdef HAVE_LIBSAMPLERATE
 static bool lsr_enabled;
@@ -39,26 +43,50 @@ pcm_resample_lsr_enabled(void)
 }
 #endif
 
+static bool
+pcm_resample_parse_internal(const char *converter,
+			    PcmSincResampler::Quality &quality_r)
+{
+	if (strcmp(converter, "internal") == 0)
+		quality_r = PcmSincResampler::Quality::MEDIUM;
+	else if (strcmp(converter, "internal-fast") == 0)
+		quality_r = PcmSincResampler::Quality::FAST;
+	else if (strcmp(converter, "internal-best") == 0)
+		quality_r = PcmSincResampler::Quality::BEST;
+	else
+		return false;
+
+	return true;
+}
+
 bool
-pcm_resample_global_init(Error &error)
+pcm_resample_global_init(const char *converter, Error &error)
 {
+	if (pcm_resample_parse_internal(converter, sinc_quality)) {
 #ifdef HAVE_LIBSAMPLERATE
-	const char *converter =
-		config_get_string(CONF_SAMPLERATE_CONVERTER, "");
-
-	lsr_enabled = strcmp(converter, "internal") != 0;
-	if (lsr_enabled)
-		return pcm_resample_lsr_global_init(converter, error);
-	else
+		lsr_enabled = false;
+#endif
 		return true;
+	}
+
+#ifdef HAVE_LIBSAMPLERATE
+	lsr_enabled = true;
+	return pcm_resample_lsr_global_init(converter, error);
 #else
-	(void)error;
+	if (*converter != 0) {
+		error.Format(resample_domain,
+			     "unknown samplerate converter '%s'", converter);
+		return false;
+	}
+
 	return true;
 #endif
 }
 
 PcmResampler::PcmResampler()
 {
+	sinc.SetQuality(sinc_quality);
+
 #ifdef HAVE_LIBSAMPLERATE
 	if (pcm_resample_lsr_enabled())
 		pcm_resample_lsr_init(this);
@@ -77,8 +105,13 @@ void
 PcmResampler::Reset()
 {
 #ifdef HAVE_LIBSAMPLERATE
-	pcm_resample_lsr_reset(this);
+	if (pcm_resample_lsr_enabled()) {
+		pcm_resample_lsr_reset(this);
+		return;
+	}
 #endif
+
+	sinc.Reset();
 }
 
 const float *
@@ -97,14 +130,8 @@ PcmResampler::ResampleFloat(unsigned channels, unsigned src_rate,
 	(void)error_r;
 #endif
 
-	/* sizeof(float)==sizeof(int32_t); the fallback resampler does
-	   not do any math on the sample values, so this hack is
-	   possible: */
-	return (const float *)
-		pcm_resample_fallback_32(this, channels,
-					 src_rate, (const int32_t *)src_buffer,
-					 src_size,
-					 dest_rate, dest_size_r);
+	return sinc.ResampleFloat(channels, src_rate, src_buffer, src_size,
+				  dest_rate, dest_size_r);
 }
 
 const int16_t *
@@ -123,9 +150,8 @@ PcmResampler::Resample16(unsigned channels,
 	(void)error_r;
 #endif
 
-	return pcm_resample_fallback_16(this, channels,
-					src_rate, src_buffer, src_size,
-					dest_rate, dest_size_r);
+	return sinc.Resample16(channels, src_rate, src_buffer, src_size,
+			       dest_rate, dest_size_r);
 }
 
 const int32_t *
@@ -144,9 +170,8 @@ PcmResampler::Resample32(unsigned channels, unsigned src_rate,
 	(void)error_r;
 #endif
 
-	return pcm_resample_fallback_32(this, channels,
-					src_rate, src_buffer, src_size,
-					dest_rate, dest_size_r);
+	return sinc.Resample32(channels, src_rate, src_buffer, src_size,
+			       dest_rate, dest_size_r);
 }
 
 const int32_t *
@@ -165,9 +190,6 @@ PcmResampler::Resample24(unsigned channels, unsigned src_rate,
 	(void)error_r;
 #endif
 
-	/* reuse the 32 bit code - the resampler code doesn't care if
-	   the upper 8 bits are actually used */
-	return pcm_resample_fallback_32(this, channels,
-					src_rate, src_buffer, src_size,
-					dest_rate, dest_size_r);
+	return sinc.Resample24(channels, src_rate, src_buffer, src_size,
+			       dest_rate, dest_size_r);
 }
@@ -22,6 +22,7 @@
 
 #include "check.h"
 #include "PcmBuffer.hxx"
+#include "PcmResampleSinc.hxx"
 
 #include <stdint.h>
 #include <stddef.h>
@@ -50,9 +51,15 @@ struct PcmResampler {
 	} prev;
 
 	int error;
-#endif
 
 	PcmBuffer buffer;
+#endif
+
+	/**
+	 * The built-in resampler, used if libsamplerate is not
+	 * available or disabled.
+	 */
+	PcmSincResampler sinc;
 
 	PcmResampler();
 	~PcmResampler();
@@ -127,7 +134,15 @@ struct PcmResampler {
 				  Error &error_r);
 };
 
+/**
+ * Selects the resampler.
+ *
+ * @param converter the "samplerate_converter" setting: "internal",
+ * "internal-fast" or "internal-best" for the built-in resampler, a
+ * libsamplerate converter name or number, or an empty string for
+ * the default
+ */
 bool
-pcm_resample_global_init(Error &error);
+pcm_resample_global_init(const char *converter, Error &error);
 
 #endif
@@ -19,9 +19,7 @@
 
 /** \file
  *
- * Internal declarations for the pcm_resample library.  The "internal"
- * resampler is called "fallback" in the MPD source, so the file name
- * of this header is somewhat unrelated to it.
+ * Internal declarations for the pcm_resample library.
  */
 
 #ifndef MPD_PCM_RESAMPLE_INTERNAL_HXX
@@ -80,21 +78,4 @@ pcm_resample_lsr_24(PcmResampler *state,
 
 #endif
 
-const int16_t *
-pcm_resample_fallback_16(PcmResampler *state,
-			 unsigned channels,
-			 unsigned src_rate,
-			 const int16_t *src_buffer, size_t src_size,
-			 unsigned dest_rate,
-			 size_t *dest_size_r);
-
-const int32_t *
-pcm_resample_fallback_32(PcmResampler *state,
-			 unsigned channels,
-			 unsigned src_rate,
-			 const int32_t *src_buffer,
-			 size_t src_size,
-			 unsigned dest_rate,
-			 size_t *dest_size_r);
-
 #endif
@@ -0,0 +1,463 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+#include "PcmResampleSinc.hxx"
+#include "PcmUtils.hxx"
+#include "util/CpuFeatures.hxx"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <math.h>
+
+#ifdef HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#ifdef HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+/**
+ * The number of taps per phase is rounded up to a multiple of this,
+ * so the SIMD kernels need no tail handling.
+ */
+static constexpr unsigned TAP_ALIGNMENT = 16;
+
+/**
+ * The number of fractional bits of the 16 bit coefficients.  The
+ * sum of the absolute coefficient values of one phase can be up to
+ * about 2.7, and Q14 guarantees that the 32 bit accumulator of the
+ * 16 bit kernels cannot overflow even with full-scale input.
+ */
+static constexpr unsigned COEFFICIENT16_BITS = 14;
+
+struct SincQualityParameters {
+	/**
+	 * The number of taps per phase (at the lower of the two
+	 * sample rates).
+	 */
+	unsigned taps;
+
+	/**
+	 * The Kaiser window parameter.
+	 */
+	double beta;
+};
+
+static constexpr SincQualityParameters sinc_quality_parameters[] = {
+	{ 32, 6.0 },
+	{ 64, 8.0 },
+	{ 128, 10.0 },
+};
+
+static unsigned
+gcd(unsigned a, unsigned b)
+{
+	while (b != 0) {
+		const unsigned t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+static float
+ScalarFloatKernel(const float *x, const float *c, unsigned n)
+{
+	float sum = 0;
+	for (unsigned i = 0; i < n; ++i)
+		sum += x[i] * c[i];
+	return sum;
+}
+
+static int32_t
+ScalarInt16Kernel(const int16_t *x, const int16_t *c, unsigned n)
+{
+	int32_t sum = 0;
+	for (unsigned i = 0; i < n; ++i)
+		sum += int32_t(x[i]) * int32_t(c[i]);
+	return sum;
+}
+
+#ifdef HAVE_X86_SIMD
+
+gcc_target("avx2")
+static float
+AVX2FloatKernel(const float *x, const float *c, unsigned n)
+{
+	__m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+
+	for (unsigned i = 0; i < n; i += 16) {
+		sum0 = _mm256_add_ps(sum0,
+				     _mm256_mul_ps(_mm256_loadu_ps(x + i),
+						   _mm256_loadu_ps(c + i)));
+		sum1 = _mm256_add_ps(sum1,
+				     _mm256_mul_ps(_mm256_loadu_ps(x + i + 8),
+						   _mm256_loadu_ps(c + i + 8)));
+	}
+
+	const __m256 sum = _mm256_add_ps(sum0, sum1);
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(sum),
+			      _mm256_extractf128_ps(sum, 1));
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	return _mm_cvtss_f32(s);
+}
+
+gcc_target("avx2")
+static int32_t
+AVX2Int16Kernel(const int16_t *x, const int16_t *c, unsigned n)
+{
+	__m256i sum = _mm256_setzero_si256();
+
+	for (unsigned i = 0; i < n; i += 16)
+		sum = _mm256_add_epi32(sum,
+				       _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *)(x + i)),
+							 _mm256_loadu_si256((const __m256i *)(c + i))));
+
+	__m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum),
+				  _mm256_extracti128_si256(sum, 1));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+	return _mm_cvtsi128_si32(s);
+}
+
+#endif
+
+#ifdef HAVE_NEON
+
+static float
+NeonFloatKernel(const float *x, const float *c, unsigned n)
+{
+	float32x4_t sum0 = vdupq_n_f32(0), sum1 = vdupq_n_f32(0);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		sum0 = vmlaq_f32(sum0, vld1q_f32(x + i), vld1q_f32(c + i));
+		sum1 = vmlaq_f32(sum1, vld1q_f32(x + i + 4),
+				 vld1q_f32(c + i + 4));
+	}
+
+	return vaddvq_f32(vaddq_f32(sum0, sum1));
+}
+
+static int32_t
+NeonInt16Kernel(const int16_t *x, const int16_t *c, unsigned n)
+{
+	int32x4_t sum = vdupq_n_s32(0);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		const int16x8_t a = vld1q_s16(x + i), b = vld1q_s16(c + i);
+		sum = vmlal_s16(sum, vget_low_s16(a), vget_low_s16(b));
+		sum = vmlal_s16(sum, vget_high_s16(a), vget_high_s16(b));
+	}
+
+	return vaddvq_s32(sum);
+}
+
+#endif
+
+PcmSincResampler::PcmSincResampler()
+	:quality(Quality::MEDIUM),
+	 channels(0), src_rate(0), dest_rate(0),
+	 float_kernel(ScalarFloatKernel), int16_kernel(ScalarInt16Kernel)
+{
+#ifdef HAVE_X86_SIMD
+	if (CpuHasAVX2()) {
+		float_kernel = AVX2FloatKernel;
+		int16_kernel = AVX2Int16Kernel;
+	}
+#endif
+
+#ifdef HAVE_NEON
+	float_kernel = NeonFloatKernel;
+	int16_kernel = NeonInt16Kernel;
+#endif
+}
+
+void
+PcmSincResampler::Configure(unsigned _channels, unsigned _src_rate,
+			    unsigned _dest_rate)
+{
+	assert(_channels > 0);
+	assert(_src_rate > 0);
+	assert(_dest_rate > 0);
+
+	channels = _channels;
+	src_rate = _src_rate;
+	dest_rate = _dest_rate;
+
+	const unsigned g = gcd(src_rate, dest_rate);
+	up = dest_rate / g;
+	down = src_rate / g;
+
+	const auto &p = sinc_quality_parameters[unsigned(quality)];
+
+	/* when downsampling, the cut-off frequency moves down, and
+	   the filter must become longer (in input frames) to keep
+	   its steepness */
+	const double scale = std::min(1.0, double(up) / double(down));
+
+	n_taps = unsigned(ceil(p.taps / scale));
+	n_taps = (n_taps + TAP_ALIGNMENT - 1) / TAP_ALIGNMENT * TAP_ALIGNMENT;
+	if (n_taps > MAX_TAPS)
+		n_taps = MAX_TAPS;
+
+	n_phases = up < MAX_PHASES ? up : MAX_PHASES;
+
+	/* the transition band width according to Kaiser's formula;
+	   it is placed just below the Nyquist frequency of the lower
+	   sample rate */
+	const double attenuation = p.beta / 0.1102 + 8.7;
+	const double transition = (attenuation - 7.95) / (14.36 * p.taps);
+	const double cutoff = (0.5 - transition / 2) * scale;
+
+	const size_t bank_size = size_t(n_phases + 1) * n_taps;
+	coefficients.resize(bank_size);
+	coefficients16.resize(bank_size);
+
+	const double center = n_taps / 2.0;
+	const double i0_beta = BesselI0(p.beta);
+
+	for (unsigned bank = 0; bank <= n_phases; ++bank) {
+		float *const row = coefficients.data() + bank * n_taps;
+		int16_t *const row16 = coefficients16.data() + bank * n_taps;
+
+		double sum = 0;
+		for (unsigned j = 0; j < n_taps; ++j) {
+			/* the distance between input frame j and the
+			   output position */
+			const double t = (n_taps - 1 - j) +
+				double(bank) / n_phases - center;
+			const double x = 2 * cutoff * t;
+			const double sinc = x == 0
+				? 1
+				: sin(M_PI * x) / (M_PI * x);
+			const double r = t / center;
+			const double window = r * r < 1
+				? BesselI0(p.beta * sqrt(1 - r * r)) / i0_beta
+				: 0;
+
+			const double h = 2 * cutoff * sinc * window;
+			row[j] = h;
+			sum += h;
+		}
+
+		/* normalize each phase to unity DC gain */
+		int sum16 = 0;
+		for (unsigned j = 0; j < n_taps; ++j) {
+			row[j] /= sum;
+			row16[j] = lrint(row[j] * (1 << COEFFICIENT16_BITS));
+			sum16 += row16[j];
+		}
+
+		/* move the rounding error of the 16 bit coefficients to
+		   the center tap, so DC passes unchanged */
+		row16[n_taps / 2] += (1 << COEFFICIENT16_BITS) - sum16;
+	}
+
+	history_int16 = false;
+	Reset();
+}
+
+void
+PcmSincResampler::Reset()
+{
+	position = 0;
+	phase = 0;
+
+	if (src_rate > 0)
+		/* a float is large enough for an int16_t, too */
+		history_buffer.assign(size_t(n_taps - 1) * channels, 0);
+}
+
+struct SincFloatTraits {
+	typedef float sample_type;
+	typedef float work_type;
+
+	static float ToWork(float x) {
+		return x;
+	}
+
+	static float FromWork(float y) {
+		return y;
+	}
+};
+
+/**
+ * Integer samples which are filtered as float.
+ */
+template<typename T, unsigned bits>
+struct SincIntegerTraits {
+	typedef T sample_type;
+	typedef float work_type;
+
+	static float ToWork(T x) {
+		return x;
+	}
+
+	static T FromWork(float y) {
+		return PcmClamp<T, long long, bits>(llrintf(y));
+	}
+};
+
+/**
+ * 16 bit samples filtered with the 16 bit integer kernel.
+ */
+struct SincInt16Traits {
+	typedef int16_t sample_type;
+	typedef int16_t work_type;
+
+	static int16_t ToWork(int16_t x) {
+		return x;
+	}
+
+	static int16_t FromWork(int32_t y) {
+		constexpr int32_t round = 1 << (COEFFICIENT16_BITS - 1);
+		return PcmClamp<int16_t, int32_t, 16>((y + round) >>
+						      COEFFICIENT16_BITS);
+	}
+};
+
+template<typename T>
+const typename T::sample_type *
+PcmSincResampler::Resample(unsigned _channels, unsigned _src_rate,
+			   const typename T::sample_type *src, size_t src_size,
+			   unsigned _dest_rate, size_t *dest_size_r)
+{
+	typedef typename T::sample_type S;
+	typedef typename T::work_type W;
+
+	assert(src_size % (sizeof(S) * _channels) == 0);
+
+	if (_channels != channels || _src_rate != src_rate ||
+	    _dest_rate != dest_rate)
+		Configure(_channels, _src_rate, _dest_rate);
+
+	constexpr bool is_int16 = sizeof(W) == sizeof(int16_t);
+	if (history_int16 != is_int16) {
+		/* the sample format has changed; the old history is
+		   useless */
+		history_int16 = is_int16;
+		Reset();
+	}
+
+	const size_t n_frames = src_size / (sizeof(S) * channels);
+	const size_t n_history = n_taps - 1;
+	const size_t stride = n_history + n_frames;
+
+	assert(history_buffer.size() == n_history * channels);
+	W *const history = (W *)history_buffer.data();
+
+	/* copy the history and the new input into one planar
+	   buffer, so the filter can run over contiguous memory */
+	W *const work = (W *)work_buffer.Get(stride * channels * sizeof(W));
+	for (unsigned c = 0; c < channels; ++c) {
+		W *const dest = work + c * stride;
+		std::copy_n(history + c * n_history, n_history, dest);
+
+		for (size_t i = 0; i < n_frames; ++i)
+			dest[n_history + i] = T::ToWork(src[i * channels + c]);
+	}
+
+	const size_t max_frames =
+		(n_frames * up + up - 1) / down + 2;
+	S *const dest = (S *)dest_buffer.Get(max_frames * channels * sizeof(S));
+	S *out = dest;
+
+	while (position < n_frames) {
+		/* with fewer phases than "up", round to the nearest
+		   one; this may be the extra row at the end of the
+		   bank, which is phase 0 of the next input frame */
+		const unsigned bank_phase = n_phases == up
+			? phase
+			: unsigned((uint64_t(phase) * n_phases + up / 2) / up);
+		const size_t offset = size_t(bank_phase) * n_taps;
+
+		for (unsigned c = 0; c < channels; ++c)
+			*out++ = T::FromWork(Dot(work + c * stride + position,
+						 offset));
+
+		phase += down;
+		position += phase / up;
+		phase %= up;
+	}
+
+	position -= n_frames;
+
+	for (unsigned c = 0; c < channels; ++c)
+		std::copy_n(work + c * stride + n_frames, n_history,
+			    history + c * n_history);
+
+	assert(size_t(out - dest) <= max_frames * channels);
+
+	*dest_size_r = (out - dest) * sizeof(S);
+	return dest;
+}
+
+const float *
+PcmSincResampler::ResampleFloat(unsigned _channels, unsigned _src_rate,
+				const float *src, size_t src_size,
+				unsigned _dest_rate, size_t *dest_size_r)
+{
+	return Resample<SincFloatTraits>(_channels, _src_rate, src, src_size,
+					 _dest_rate, dest_size_r);
+}
+
+const int16_t *
+PcmSincResampler::Resample16(unsigned _channels, unsigned _src_rate,
+			     const int16_t *src, size_t src_size,
+			     unsigned _dest_rate, size_t *dest_size_r)
+{
+	/* the integer kernel is faster, but the 16 bit coefficients
+	   limit the signal to noise ratio to about 75 dB, which is
+	   only good enough for the "fast" setting */
+	if (quality == Quality::FAST)
+		return Resample<SincInt16Traits>(_channels, _src_rate,
+						 src, src_size,
+						 _dest_rate, dest_size_r);
+
+	return Resample<SincIntegerTraits<int16_t, 16>>(_channels, _src_rate,
+							src, src_size,
+							_dest_rate,
+							dest_size_r);
+}
+
+const int32_t *
+PcmSincResampler::Resample24(unsigned _channels, unsigned _src_rate,
+			     const int32_t *src, size_t src_size,
+			     unsigned _dest_rate, size_t *dest_size_r)
+{
+	return Resample<SincIntegerTraits<int32_t, 24>>(_channels, _src_rate,
+					       src, src_size,
+					       _dest_rate, dest_size_r);
+}
+
+const int32_t *
+PcmSincResampler::Resample32(unsigned _channels, unsigned _src_rate,
+			     const int32_t *src, size_t src_size,
+			     unsigned _dest_rate, size_t *dest_size_r)
+{
+	return Resample<SincIntegerTraits<int32_t, 32>>(_channels, _src_rate,
+					       src, src_size,
+					       _dest_rate, dest_size_r);
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_PCM_RESAMPLE_SINC_HXX
+#define MPD_PCM_RESAMPLE_SINC_HXX
+
+#include "PcmBuffer.hxx"
+#include "Compiler.h"
+
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * A polyphase windowed-sinc resampler.  The ratio between the two
+ * sample rates is reduced to a fraction up/down, and one filter
+ * phase is precomputed for each of the "up" positions between two
+ * input frames (e.g. 160 phases for 44.1 kHz to 48 kHz, 2 for
+ * doubling the rate).  Each output sample is then a dot product of
+ * the input with one phase, which is computed with SIMD code if
+ * available.
+ *
+ * With Quality::FAST, 16 bit samples are filtered with 16 bit
+ * coefficients; everything else uses float.  Any number of channels
+ * is supported.
+ */
+class PcmSincResampler {
+public:
+	enum class Quality {
+		/**
+		 * 32 taps, 60 dB stop band attenuation.
+		 */
+		FAST,
+
+		/**
+		 * 64 taps, 80 dB stop band attenuation.
+		 */
+		MEDIUM,
+
+		/**
+		 * 128 taps, 100 dB stop band attenuation.
+		 */
+		BEST,
+	};
+
+	/**
+	 * Ratios with more phases are approximated by rounding the
+	 * position to the nearest of this many phases.
+	 */
+	static constexpr unsigned MAX_PHASES = 1024;
+
+	/**
+	 * The upper limit for the number of taps per phase; only
+	 * reached when downsampling by a large factor.
+	 */
+	static constexpr unsigned MAX_TAPS = 1024;
+
+	typedef float (*FloatKernel)(const float *x, const float *c,
+				     unsigned n);
+	typedef int32_t (*Int16Kernel)(const int16_t *x, const int16_t *c,
+				       unsigned n);
+
+private:
+	Quality quality;
+
+	unsigned channels, src_rate, dest_rate;
+
+	/**
+	 * The reduced ratio dest_rate/src_rate.
+	 */
+	unsigned up, down;
+
+	unsigned n_phases, n_taps;
+
+	/**
+	 * The filter bank: #n_phases+1 rows of #n_taps coefficients,
+	 * each row in reverse order, so it can be multiplied with
+	 * the input in ascending order.  The last row is for the
+	 * position just before the next input frame, which is only
+	 * used if there are fewer phases than #up.
+	 *
+	 * This is persistent state, therefore it is not kept in a
+	 * #PcmBuffer: PcmBuffer::Get() is declared gcc_malloc, which
+	 * allows the compiler to assume its contents are garbage.
+	 */
+	std::vector<float> coefficients;
+
+	/**
+	 * The same filter bank in Q14 format.
+	 */
+	std::vector<int16_t> coefficients16;
+
+	/**
+	 * The position of the next output frame: the offset of its
+	 * first input frame (relative to the start of the history)
+	 * and the phase (0 to up-1).
+	 */
+	size_t position;
+	unsigned phase;
+
+	/**
+	 * The last (n_taps-1) frames of each channel (planar).  The
+	 * element type depends on #history_int16.  Like the filter
+	 * bank, this must survive between calls and is therefore not
+	 * a #PcmBuffer.
+	 */
+	std::vector<float> history_buffer;
+	bool history_int16;
+
+	PcmBuffer work_buffer, dest_buffer;
+
+	FloatKernel float_kernel;
+	Int16Kernel int16_kernel;
+
+public:
+	PcmSincResampler();
+
+	PcmSincResampler(const PcmSincResampler &) = delete;
+	PcmSincResampler &operator=(const PcmSincResampler &) = delete;
+
+	/**
+	 * Change the filter quality.  This takes effect at the next
+	 * reconfiguration.
+	 */
+	void SetQuality(Quality _quality) {
+		quality = _quality;
+		src_rate = 0;
+	}
+
+	/**
+	 * Resets the filter state.  Use this at the boundary between
+	 * two distinct songs.
+	 */
+	void Reset();
+
+	/**
+	 * Resamples interleaved samples.  The filter is (re)configured
+	 * automatically when the parameters change.
+	 *
+	 * @return the destination buffer (never nullptr)
+	 */
+	const float *ResampleFloat(unsigned channels, unsigned src_rate,
+				   const float *src, size_t src_size,
+				   unsigned dest_rate, size_t *dest_size_r);
+
+	const int16_t *Resample16(unsigned channels, unsigned src_rate,
+				  const int16_t *src, size_t src_size,
+				  unsigned dest_rate, size_t *dest_size_r);
+
+	const int32_t *Resample24(unsigned channels, unsigned src_rate,
+				  const int32_t *src, size_t src_size,
+				  unsigned dest_rate, size_t *dest_size_r);
+
+	const int32_t *Resample32(unsigned channels, unsigned src_rate,
+				  const int32_t *src, size_t src_size,
+				  unsigned dest_rate, size_t *dest_size_r);
+
+	/**
+	 * Returns the filter delay in input frames.  Mostly useful
+	 * for tests and benchmarks.
+	 */
+	gcc_pure
+	unsigned GetDelay() const {
+		return n_taps / 2;
+	}
+
+private:
+	void Configure(unsigned channels, unsigned src_rate,
+		       unsigned dest_rate);
+
+	/**
+	 * Applies the filter phase at the given offset within the
+	 * bank to the input starting at #x.
+	 */
+	float Dot(const float *x, size_t offset) const {
+		return float_kernel(x, coefficients.data() + offset, n_taps);
+	}
+
+	int32_t Dot(const int16_t *x, size_t offset) const {
+		return int16_kernel(x, coefficients16.data() + offset,
+				    n_taps);
+	}
+
+	template<typename T>
+	const typename T::sample_type *
+	Resample(unsigned channels, unsigned src_rate,
+		 const typename T::sample_type *src, size_t src_size,
+		 unsigned dest_rate, size_t *dest_size_r);
+};
+
+#endif
@@ -75,4 +75,21 @@ PcmClampN(T *dest, const U *src, unsigned n)
 		*dest++ = PcmClamp<T, U, bits>(*src++);
 }
 
+/**
+ * Modified Bessel function of the first kind, order zero.  This is
+ * used for calculating Kaiser windows.
+ */
+gcc_const
+static inline double
+BesselI0(double x)
+{
+	double sum = 1, term = 1;
+	for (unsigned k = 1; term > 1e-12 * sum; ++k) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+	}
+
+	return sum;
+}
+
 #endif
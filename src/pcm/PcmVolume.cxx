@@ -19,19 +19,37 @@
 
 #include "config.h"
 #include "PcmVolume.hxx"
+#include "PcmVolumeSimd.hxx"
 #include "PcmUtils.hxx"
 #include "AudioFormat.hxx"
 
 #include <stdint.h>
 #include <string.h>
 
+static __thread PcmVolumeDither volume_dither = {
+	/* different seeds, or else all lanes would generate the
+	   same sequence */
+	{
+		0x00000000, 0x9e3779b9, 0x3c6ef372, 0xdaa66d2b,
+		0x78dde6e4, 0x1715609d, 0xb54cda56, 0x5384540f,
+	},
+};
+
+PcmVolumeDither &
+pcm_volume_dither()
+{
+	return volume_dither;
+}
+
 static void
-pcm_volume_change_8(int8_t *buffer, const int8_t *end, int volume)
+pcm_volume_change_8(int8_t *buffer, const int8_t *end, int volume,
+		    PcmVolumeDither &dither)
 {
-	while (buffer < end) {
+	for (unsigned lane = 0; buffer < end;
+	     lane = (lane + 1) % PCM_DITHER_LANES) {
 		int32_t sample = *buffer;
 
-		sample = (sample * volume + pcm_volume_dither() +
+		sample = (sample * volume + dither.Next(lane) +
 			  PCM_VOLUME_1 / 2)
 			/ PCM_VOLUME_1;
 
@@ -40,12 +58,14 @@ pcm_volume_change_8(int8_t *buffer, const int8_t *end, int volume)
 }
 
 static void
-pcm_volume_change_16(int16_t *buffer, const int16_t *end, int volume)
+pcm_volume_change_16(int16_t *buffer, const int16_t *end, int volume,
+		     PcmVolumeDither &dither)
 {
-	while (buffer < end) {
+	for (unsigned lane = 0; buffer < end;
+	     lane = (lane + 1) % PCM_DITHER_LANES) {
 		int32_t sample = *buffer;
 
-		sample = (sample * volume + pcm_volume_dither() +
+		sample = (sample * volume + dither.Next(lane) +
 			  PCM_VOLUME_1 / 2)
 			/ PCM_VOLUME_1;
 
@@ -85,20 +105,22 @@ pcm_volume_sample_24(int32_t sample, int32_t volume, gcc_unused int32_t dither)
 #endif
 
 static void
-pcm_volume_change_24(int32_t *buffer, const int32_t *end, int volume)
+pcm_volume_change_24(int32_t *buffer, const int32_t *end, int volume,
+		     PcmVolumeDither &dither)
 {
-	while (buffer < end) {
+	for (unsigned lane = 0; buffer < end;
+	     lane = (lane + 1) % PCM_DITHER_LANES) {
 #ifdef __i386__
 		/* assembly version for i386 */
 		int32_t sample = *buffer;
 
 		sample = pcm_volume_sample_24(sample, volume,
-					      pcm_volume_dither());
+					      dither.Next(lane));
 #else
 		/* portable version */
 		int64_t sample = *buffer;
 
-		sample = (sample * volume + pcm_volume_dither() +
+		sample = (sample * volume + dither.Next(lane) +
 			  PCM_VOLUME_1 / 2)
 			/ PCM_VOLUME_1;
 #endif
@@ -107,9 +129,11 @@ pcm_volume_change_24(int32_t *buffer, const int32_t *end, int volume)
 }
 
 static void
-pcm_volume_change_32(int32_t *buffer, const int32_t *end, int volume)
+pcm_volume_change_32(int32_t *buffer, const int32_t *end, int volume,
+		     gcc_unused PcmVolumeDither &dither)
 {
-	while (buffer < end) {
+	for (unsigned lane = 0; buffer < end;
+	     lane = (lane + 1) % PCM_DITHER_LANES) {
 #ifdef __i386__
 		/* assembly version for i386 */
 		int32_t sample = *buffer;
@@ -119,7 +143,7 @@ pcm_volume_change_32(int32_t *buffer, const int32_t *end, int volume)
 		/* portable version */
 		int64_t sample = *buffer;
 
-		sample = (sample * volume + pcm_volume_dither() +
+		sample = (sample * volume + dither.Next(lane) +
 			  PCM_VOLUME_1 / 2)
 			/ PCM_VOLUME_1;
 		*buffer++ = PcmClamp<int32_t, int64_t, 32>(sample);
@@ -137,6 +161,246 @@ pcm_volume_change_float(float *buffer, const float *end, float volume)
 	}
 }
 
+#ifdef HAVE_X86_SIMD
+
+/**
+ * Apply the volume to 8 bit and 16 bit samples.
+ *
+ * @return the end of the processed range; the remaining samples
+ * (less than #PCM_DITHER_LANES) are left to the scalar code
+ */
+template<typename T, unsigned bits>
+gcc_target("avx2")
+static T *
+pcm_volume_avx2(T *buffer, const T *end, int _volume,
+		PcmVolumeDither &dither)
+{
+	const __m256i volume = _mm256_set1_epi32(_volume);
+	const __m256i round = _mm256_set1_epi32(PCM_VOLUME_1 / 2);
+	__m256i state = Avx2LoadDither(dither);
+
+	for (; size_t(end - buffer) >= PCM_DITHER_LANES;
+	     buffer += PCM_DITHER_LANES) {
+		__m256i t = _mm256_mullo_epi32(Avx2Load8(buffer), volume);
+		t = _mm256_add_epi32(t, Avx2NextDither(state));
+		t = _mm256_add_epi32(t, round);
+		Avx2Store8(buffer, Avx2Scale<bits>(t));
+	}
+
+	Avx2StoreDither(dither, state);
+	return buffer;
+}
+
+/**
+ * Apply the volume to 24 bit and 32 bit samples.
+ */
+template<unsigned bits>
+gcc_target("avx2")
+static int32_t *
+pcm_volume_avx2_wide(int32_t *buffer, const int32_t *end, int _volume,
+		     PcmVolumeDither &dither)
+{
+	const __m256d volume = _mm256_set1_pd(_volume);
+	const __m256i round = _mm256_set1_epi32(PCM_VOLUME_1 / 2);
+	__m256i state = Avx2LoadDither(dither);
+
+	for (; size_t(end - buffer) >= PCM_DITHER_LANES;
+	     buffer += PCM_DITHER_LANES) {
+		const __m256i x = Avx2Load8(buffer);
+		const __m256i d = _mm256_add_epi32(Avx2NextDither(state),
+						   round);
+
+		const __m256d lo =
+			_mm256_add_pd(_mm256_mul_pd(Avx2ToDouble(x, 0),
+						    volume),
+				      Avx2ToDouble(d, 0));
+		const __m256d hi =
+			_mm256_add_pd(_mm256_mul_pd(Avx2ToDouble(x, 1),
+						    volume),
+				      Avx2ToDouble(d, 1));
+
+		Avx2Store8(buffer, Avx2Combine(Avx2ScaleWide<bits>(lo),
+					       Avx2ScaleWide<bits>(hi)));
+	}
+
+	Avx2StoreDither(dither, state);
+	return buffer;
+}
+
+gcc_target("avx2")
+static float *
+pcm_volume_avx2_float(float *buffer, const float *end, float _volume)
+{
+	const __m256 volume = _mm256_set1_ps(_volume);
+
+	for (; end - buffer >= 8; buffer += 8)
+		_mm256_storeu_ps(buffer, _mm256_mul_ps(_mm256_loadu_ps(buffer),
+						       volume));
+
+	return buffer;
+}
+
+#endif
+
+#ifdef HAVE_NEON
+
+template<typename T, unsigned bits>
+static T *
+pcm_volume_neon(T *buffer, const T *end, int _volume,
+		PcmVolumeDither &dither)
+{
+	const int32x4_t volume = vdupq_n_s32(_volume);
+	const int32x4_t round = vdupq_n_s32(PCM_VOLUME_1 / 2);
+	uint32x4_t state_lo = vld1q_u32(dither.state);
+	uint32x4_t state_hi = vld1q_u32(dither.state + 4);
+
+	for (; size_t(end - buffer) >= PCM_DITHER_LANES;
+	     buffer += PCM_DITHER_LANES) {
+		const NeonInt32x8 x = NeonLoad8(buffer);
+		const int32x4_t lo =
+			vaddq_s32(vmlaq_s32(NeonNextDither(state_lo),
+					    x.lo, volume), round);
+		const int32x4_t hi =
+			vaddq_s32(vmlaq_s32(NeonNextDither(state_hi),
+					    x.hi, volume), round);
+
+		NeonStore8(buffer, { NeonScale<bits>(lo),
+				     NeonScale<bits>(hi) });
+	}
+
+	vst1q_u32(dither.state, state_lo);
+	vst1q_u32(dither.state + 4, state_hi);
+	return buffer;
+}
+
+/**
+ * Multiply 4 samples with the volume, add dithering and rounding,
+ * and scale the product down in 64 bit lanes.
+ */
+template<unsigned bits>
+static inline int32x4_t
+NeonVolumeWide(int32x4_t x, int32x4_t d, int32x2_t volume)
+{
+	const int64x2_t lo = vmlal_s32(vmovl_s32(vget_low_s32(d)),
+				       vget_low_s32(x), volume);
+	const int64x2_t hi = vmlal_s32(vmovl_s32(vget_high_s32(d)),
+				       vget_high_s32(x), volume);
+
+	return NeonClamp<bits>(vcombine_s32(NeonScaleWide(lo),
+					    NeonScaleWide(hi)));
+}
+
+template<unsigned bits>
+static int32_t *
+pcm_volume_neon_wide(int32_t *buffer, const int32_t *end, int _volume,
+		     PcmVolumeDither &dither)
+{
+	const int32x2_t volume = vdup_n_s32(_volume);
+	const int32x4_t round = vdupq_n_s32(PCM_VOLUME_1 / 2);
+	uint32x4_t state_lo = vld1q_u32(dither.state);
+	uint32x4_t state_hi = vld1q_u32(dither.state + 4);
+
+	for (; size_t(end - buffer) >= PCM_DITHER_LANES;
+	     buffer += PCM_DITHER_LANES) {
+		const NeonInt32x8 x = NeonLoad8(buffer);
+		const int32x4_t d_lo = vaddq_s32(NeonNextDither(state_lo),
+						 round);
+		const int32x4_t d_hi = vaddq_s32(NeonNextDither(state_hi),
+						 round);
+
+		NeonStore8(buffer, { NeonVolumeWide<bits>(x.lo, d_lo, volume),
+				     NeonVolumeWide<bits>(x.hi, d_hi, volume) });
+	}
+
+	vst1q_u32(dither.state, state_lo);
+	vst1q_u32(dither.state + 4, state_hi);
+	return buffer;
+}
+
+static float *
+pcm_volume_neon_float(float *buffer, const float *end, float _volume)
+{
+	const float32x4_t volume = vdupq_n_f32(_volume);
+
+	for (; end - buffer >= 4; buffer += 4)
+		vst1q_f32(buffer, vmulq_f32(vld1q_f32(buffer), volume));
+
+	return buffer;
+}
+
+#endif
+
+/**
+ * Run the best vectorized kernel for this CPU on the bulk of the
+ * buffer.
+ *
+ * @return the end of the processed range; the rest is left to the
+ * scalar code
+ */
+template<typename T, unsigned bits>
+static T *
+pcm_volume_simd(T *buffer, const T *end, int volume,
+		PcmVolumeDither &dither)
+{
+	if (volume > PCM_VOLUME_SIMD_MAX)
+		return buffer;
+
+#ifdef HAVE_X86_SIMD
+	if (PcmHaveAVX2())
+		return pcm_volume_avx2<T, bits>(buffer, end, volume, dither);
+#endif
+
+#ifdef HAVE_NEON
+	return pcm_volume_neon<T, bits>(buffer, end, volume, dither);
+#else
+	(void)end;
+	(void)dither;
+	return buffer;
+#endif
+}
+
+/**
+ * The variant of pcm_volume_simd() for 24 bit and 32 bit samples.
+ */
+template<unsigned bits>
+static int32_t *
+pcm_volume_simd_wide(int32_t *buffer, const int32_t *end, int volume,
+		     PcmVolumeDither &dither)
+{
+	if (volume > PCM_VOLUME_SIMD_MAX)
+		return buffer;
+
+#ifdef HAVE_X86_SIMD
+	if (PcmHaveAVX2())
+		return pcm_volume_avx2_wide<bits>(buffer, end, volume, dither);
+#endif
+
+#ifdef HAVE_NEON
+	return pcm_volume_neon_wide<bits>(buffer, end, volume, dither);
+#else
+	(void)end;
+	(void)dither;
+	return buffer;
+#endif
+}
+
+static float *
+pcm_volume_simd_float(float *buffer, const float *end, float volume)
+{
+#ifdef HAVE_X86_SIMD
+	if (PcmHaveAVX2())
+		return pcm_volume_avx2_float(buffer, end, volume);
+#endif
+
+#ifdef HAVE_NEON
+	return pcm_volume_neon_float(buffer, end, volume);
+#else
+	(void)end;
+	(void)volume;
+	return buffer;
+#endif
+}
+
 bool
 pcm_volume(void *buffer, size_t length,
 	   SampleFormat format,
@@ -151,40 +415,59 @@ pcm_volume(void *buffer, size_t length,
 	}
 
 	const void *end = pcm_end_pointer(buffer, length);
+	PcmVolumeDither &dither = pcm_volume_dither();
+
 	switch (format) {
 	case SampleFormat::UNDEFINED:
 	case SampleFormat::DSD:
 	case SampleFormat::DSD_U8:
+	case SampleFormat::DSD_U16_LE:
+	case SampleFormat::DSD_U16_BE:
 	case SampleFormat::DSD_U32_BE:
 	case SampleFormat::DSD_U32_LE:
 		/* not implemented */
 		return false;
 
-	case SampleFormat::S8:
-		pcm_volume_change_8((int8_t *)buffer, (const int8_t *)end,
-				    volume);
+	case SampleFormat::S8: {
+		int8_t *p = pcm_volume_simd<int8_t, 8>((int8_t *)buffer,
+							(const int8_t *)end,
+							volume, dither);
+		pcm_volume_change_8(p, (const int8_t *)end, volume, dither);
 		return true;
+	}
 
-	case SampleFormat::S16:
-		pcm_volume_change_16((int16_t *)buffer, (const int16_t *)end,
-				     volume);
+	case SampleFormat::S16: {
+		int16_t *p = pcm_volume_simd<int16_t, 16>((int16_t *)buffer,
+							  (const int16_t *)end,
+							  volume, dither);
+		pcm_volume_change_16(p, (const int16_t *)end, volume, dither);
 		return true;
+	}
 
-	case SampleFormat::S24_P32:
-		pcm_volume_change_24((int32_t *)buffer, (const int32_t *)end,
-				     volume);
+	case SampleFormat::S24_P32: {
+		int32_t *p = pcm_volume_simd_wide<24>((int32_t *)buffer,
+						      (const int32_t *)end,
+						      volume, dither);
+		pcm_volume_change_24(p, (const int32_t *)end, volume, dither);
 		return true;
+	}
 
-	case SampleFormat::S32:
-		pcm_volume_change_32((int32_t *)buffer, (const int32_t *)end,
-				     volume);
+	case SampleFormat::S32: {
+		int32_t *p = pcm_volume_simd_wide<32>((int32_t *)buffer,
+						      (const int32_t *)end,
+						      volume, dither);
+		pcm_volume_change_32(p, (const int32_t *)end, volume, dither);
 		return true;
+	}
 
-	case SampleFormat::FLOAT:
-		pcm_volume_change_float((float *)buffer, (const float *)end,
-					pcm_volume_to_float(volume));
+	case SampleFormat::FLOAT: {
+		const float f = pcm_volume_to_float(volume);
+		float *p = pcm_volume_simd_float((float *)buffer,
+						 (const float *)end, f);
+		pcm_volume_change_float(p, (const float *)end, f);
 		return true;
 	}
+	}
 
 	assert(false);
 	gcc_unreachable();
@@ -50,19 +50,35 @@ pcm_volume_to_float(int volume)
 }
 
 /**
- * Returns the next volume dithering number, between -511 and +511.
- * This number is taken from a global PRNG, see pcm_prng().
+ * The number of independent PRNG sequences used for volume
+ * dithering.  Sample i of a buffer is dithered with lane
+ * (i % #PCM_DITHER_LANES), which allows vectorized code to generate
+ * exactly the same numbers as the scalar code.
  */
-static inline int
-pcm_volume_dither(void)
-{
-	static unsigned long state;
-	uint32_t r;
+static constexpr unsigned PCM_DITHER_LANES = 8;
 
-	r = state = pcm_prng(state);
+/**
+ * The state of the volume dithering PRNG, see pcm_prng().
+ */
+struct PcmVolumeDither {
+	uint32_t state[PCM_DITHER_LANES];
 
-	return (r & 511) - ((r >> 9) & 511);
-}
+	/**
+	 * Returns the next dithering number of the specified lane,
+	 * between -511 and +511.
+	 */
+	int Next(unsigned lane) {
+		uint32_t r = state[lane] = pcm_prng(state[lane]);
+
+		return (r & 511) - ((r >> 9) & 511);
+	}
+};
+
+/**
+ * Returns the volume dithering state of the current thread.
+ */
+PcmVolumeDither &
+pcm_volume_dither();
 
 /**
  * Adjust the volume of the specified PCM buffer.
@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Building blocks for the vectorized volume and mixing kernels in
+ * PcmVolume.cxx and PcmMix.cxx.  Each step processes
+ * #PCM_DITHER_LANES samples, one per dithering lane, so the results
+ * are identical to the scalar code.
+ *
+ * Samples of up to 16 bits are processed in 32 bit integer lanes.
+ * 24 and 32 bit samples need a wider intermediate product: x86 uses
+ * double precision (which represents all intermediate values
+ * exactly), ARM uses 64 bit integer lanes.
+ */
+
+#ifndef MPD_PCM_VOLUME_SIMD_HXX
+#define MPD_PCM_VOLUME_SIMD_HXX
+
+#include "PcmVolume.hxx"
+#include "util/CpuFeatures.hxx"
+
+#include <stdint.h>
+
+#ifdef HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#ifdef HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+static_assert(PCM_VOLUME_1 == 1 << 10, "PCM_VOLUME_1 is not 2^10");
+static_assert(PCM_DITHER_LANES == 8, "SIMD code assumes 8 dither lanes");
+
+/**
+ * The SIMD kernels are only used for volumes up to this value, which
+ * guarantees that no 32 bit lane overflows.  Bigger volumes (only
+ * possible with replay gain) are handled by the scalar code.
+ */
+static constexpr int PCM_VOLUME_SIMD_MAX = 1 << 15;
+
+static constexpr int32_t PCM_PRNG_MUL = 0x0019660d;
+static constexpr int32_t PCM_PRNG_ADD = 0x3c6ef35f;
+
+template<unsigned bits>
+struct PcmSampleRange {
+	static constexpr int32_t MIN = -(int64_t(1) << (bits - 1));
+	static constexpr int32_t MAX = (int64_t(1) << (bits - 1)) - 1;
+};
+
+#ifdef HAVE_X86_SIMD
+
+/**
+ * Cached result of CpuHasAVX2().
+ */
+static inline bool
+PcmHaveAVX2()
+{
+	static const bool value = CpuHasAVX2();
+	return value;
+}
+
+/**
+ * Advance all dithering lanes, and return the dithering numbers
+ * (see PcmVolumeDither::Next()).
+ */
+gcc_target("avx2")
+static inline __m256i
+Avx2NextDither(__m256i &state)
+{
+	state = _mm256_add_epi32(_mm256_mullo_epi32(state,
+						    _mm256_set1_epi32(PCM_PRNG_MUL)),
+				 _mm256_set1_epi32(PCM_PRNG_ADD));
+
+	const __m256i mask = _mm256_set1_epi32(511);
+	return _mm256_sub_epi32(_mm256_and_si256(state, mask),
+				_mm256_and_si256(_mm256_srli_epi32(state, 9),
+						 mask));
+}
+
+gcc_target("avx2")
+static inline __m256i
+Avx2LoadDither(const PcmVolumeDither &dither)
+{
+	return _mm256_loadu_si256((const __m256i *)dither.state);
+}
+
+gcc_target("avx2")
+static inline void
+Avx2StoreDither(PcmVolumeDither &dither, __m256i state)
+{
+	_mm256_storeu_si256((__m256i *)dither.state, state);
+}
+
+/**
+ * Load 8 samples into 32 bit lanes.
+ */
+gcc_target("avx2")
+static inline __m256i
+Avx2Load8(const int8_t *p)
+{
+	return _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)p));
+}
+
+gcc_target("avx2")
+static inline __m256i
+Avx2Load8(const int16_t *p)
+{
+	return _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)p));
+}
+
+gcc_target("avx2")
+static inline __m256i
+Avx2Load8(const int32_t *p)
+{
+	return _mm256_loadu_si256((const __m256i *)p);
+}
+
+/**
+ * Store 8 samples from 32 bit lanes.  The values must be in range
+ * already.
+ */
+gcc_target("avx2")
+static inline void
+Avx2Store8(int8_t *p, __m256i v)
+{
+	/* each 128 bit half contains its 4 bytes in the lowest 32
+	   bits after this */
+	v = _mm256_packs_epi32(v, v);
+	v = _mm256_packs_epi16(v, v);
+
+	_mm_storel_epi64((__m128i *)p,
+			 _mm_unpacklo_epi32(_mm256_castsi256_si128(v),
+					    _mm256_extracti128_si256(v, 1)));
+}
+
+gcc_target("avx2")
+static inline void
+Avx2Store8(int16_t *p, __m256i v)
+{
+	v = _mm256_packs_epi32(v, v);
+	v = _mm256_permute4x64_epi64(v, 0x08);
+	_mm_storeu_si128((__m128i *)p, _mm256_castsi256_si128(v));
+}
+
+gcc_target("avx2")
+static inline void
+Avx2Store8(int32_t *p, __m256i v)
+{
+	_mm256_storeu_si256((__m256i *)p, v);
+}
+
+gcc_target("avx2")
+static inline __m256i
+Avx2Clamp(__m256i v, int32_t min, int32_t max)
+{
+	return _mm256_min_epi32(_mm256_max_epi32(v, _mm256_set1_epi32(min)),
+				_mm256_set1_epi32(max));
+}
+
+/**
+ * Divide the sum (which includes dither and rounding) by
+ * #PCM_VOLUME_1 like the scalar code, i.e. rounding towards zero,
+ * and clamp the result.
+ */
+template<unsigned bits>
+gcc_target("avx2")
+static inline __m256i
+Avx2Scale(__m256i t)
+{
+	const __m256i bias = _mm256_and_si256(_mm256_srai_epi32(t, 31),
+					      _mm256_set1_epi32(PCM_VOLUME_1 - 1));
+	t = _mm256_srai_epi32(_mm256_add_epi32(t, bias), 10);
+	return Avx2Clamp(t, PcmSampleRange<bits>::MIN,
+			 PcmSampleRange<bits>::MAX);
+}
+
+/**
+ * The double precision variant of Avx2Scale() for 4 lanes.
+ */
+template<unsigned bits>
+gcc_target("avx2")
+static inline __m128i
+Avx2ScaleWide(__m256d t)
+{
+	t = _mm256_mul_pd(t, _mm256_set1_pd(1.0 / PCM_VOLUME_1));
+	t = _mm256_max_pd(t, _mm256_set1_pd(PcmSampleRange<bits>::MIN));
+	t = _mm256_min_pd(t, _mm256_set1_pd(PcmSampleRange<bits>::MAX));
+
+	/* truncation rounds towards zero, just like integer
+	   division */
+	return _mm256_cvttpd_epi32(t);
+}
+
+/**
+ * Convert the lower or upper 4 lanes to double precision.
+ */
+gcc_target("avx2")
+static inline __m256d
+Avx2ToDouble(__m256i v, int half)
+{
+	return _mm256_cvtepi32_pd(half == 0
+				  ? _mm256_castsi256_si128(v)
+				  : _mm256_extracti128_si256(v, 1));
+}
+
+gcc_target("avx2")
+static inline __m256i
+Avx2Combine(__m128i lo, __m128i hi)
+{
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+#endif
+
+#ifdef HAVE_NEON
+
+/**
+ * 8 samples in two 4x32 bit vectors.
+ */
+struct NeonInt32x8 {
+	int32x4_t lo, hi;
+};
+
+static inline int32x4_t
+NeonNextDither(uint32x4_t &state)
+{
+	state = vmlaq_u32(vdupq_n_u32(PCM_PRNG_ADD), state,
+			  vdupq_n_u32(PCM_PRNG_MUL));
+
+	const uint32x4_t mask = vdupq_n_u32(511);
+	return vsubq_s32(vreinterpretq_s32_u32(vandq_u32(state, mask)),
+			 vreinterpretq_s32_u32(vandq_u32(vshrq_n_u32(state, 9),
+							 mask)));
+}
+
+static inline NeonInt32x8
+NeonLoad8(const int8_t *p)
+{
+	const int16x8_t w = vmovl_s8(vld1_s8(p));
+	return { vmovl_s16(vget_low_s16(w)), vmovl_s16(vget_high_s16(w)) };
+}
+
+static inline NeonInt32x8
+NeonLoad8(const int16_t *p)
+{
+	const int16x8_t w = vld1q_s16(p);
+	return { vmovl_s16(vget_low_s16(w)), vmovl_s16(vget_high_s16(w)) };
+}
+
+static inline NeonInt32x8
+NeonLoad8(const int32_t *p)
+{
+	return { vld1q_s32(p), vld1q_s32(p + 4) };
+}
+
+static inline void
+NeonStore8(int8_t *p, NeonInt32x8 v)
+{
+	vst1_s8(p, vqmovn_s16(vcombine_s16(vqmovn_s32(v.lo),
+					   vqmovn_s32(v.hi))));
+}
+
+static inline void
+NeonStore8(int16_t *p, NeonInt32x8 v)
+{
+	vst1q_s16(p, vcombine_s16(vqmovn_s32(v.lo), vqmovn_s32(v.hi)));
+}
+
+static inline void
+NeonStore8(int32_t *p, NeonInt32x8 v)
+{
+	vst1q_s32(p, v.lo);
+	vst1q_s32(p + 4, v.hi);
+}
+
+/**
+ * See Avx2Scale().
+ */
+template<unsigned bits>
+static inline int32x4_t
+NeonScale(int32x4_t t)
+{
+	const int32x4_t bias = vandq_s32(vshrq_n_s32(t, 31),
+					 vdupq_n_s32(PCM_VOLUME_1 - 1));
+	t = vshrq_n_s32(vaddq_s32(t, bias), 10);
+	t = vmaxq_s32(t, vdupq_n_s32(PcmSampleRange<bits>::MIN));
+	return vminq_s32(t, vdupq_n_s32(PcmSampleRange<bits>::MAX));
+}
+
+/**
+ * The 64 bit variant of NeonScale() for 2 lanes; the result is
+ * saturated to 32 bits, but not clamped to the sample range yet.
+ */
+static inline int32x2_t
+NeonScaleWide(int64x2_t t)
+{
+	const int64x2_t bias = vandq_s64(vshrq_n_s64(t, 63),
+					 vdupq_n_s64(PCM_VOLUME_1 - 1));
+	return vqmovn_s64(vshrq_n_s64(vaddq_s64(t, bias), 10));
+}
+
+template<unsigned bits>
+static inline int32x4_t
+NeonClamp(int32x4_t v)
+{
+	v = vmaxq_s32(v, vdupq_n_s32(PcmSampleRange<bits>::MIN));
+	return vminq_s32(v, vdupq_n_s32(PcmSampleRange<bits>::MAX));
+}
+
+#endif
+
+#endif
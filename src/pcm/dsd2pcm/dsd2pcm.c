@@ -5,6 +5,14 @@
 
 #include "dsd2pcm.h"
 
+#if defined(__x86_64__) && (GCC_CHECK_VERSION(4,9) || defined(__clang__))
+#define DSD2PCM_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define DSD2PCM_NEON 1
+#include <arm_neon.h>
+#endif
+
 #define HTAPS    48             /* number of FIR constants */
 #define FIFOSIZE 16             /* must be a power of two */
 #define FIFOMASK (FIFOSIZE-1)   /* bit mask for FIFO offsets */
@@ -88,6 +96,22 @@ static const double htaps[HTAPS] = {
 static float ctables[CTABLES][256];
 static int precalculated = 0;
 
+/*
+ * Channels of a dsd2pcm_multi engine are padded to a multiple of
+ * this; one FIFO row holds the octets of all channels of one frame.
+ */
+#define MULTI_LANES 4
+
+typedef void (*multi_kernel_t)(const unsigned char *fifo, unsigned stride,
+			       unsigned ffp, float *out);
+
+static void multi_kernel_generic(const unsigned char *fifo, unsigned stride,
+				 unsigned ffp, float *out);
+
+static multi_kernel_t multi_kernel = multi_kernel_generic;
+
+static void select_multi_kernel(void);
+
 static void precalc(void)
 {
 	int t, e, m, k;
@@ -104,6 +128,7 @@ static void precalc(void)
 			ctables[CTABLES-1-t][e] = (float)acc;
 		}
 	}
+	select_multi_kernel();
 	precalculated = 1;
 }
 
@@ -182,3 +207,227 @@ extern void dsd2pcm_translate(
 	ptr->fifopos = ffp;
 }
 
+
+/*
+ * Multi-channel engine
+ *
+ * The FIFOs of all channels are interleaved (one row per frame), so
+ * the lookups of all channels can be summed in SIMD lanes.  Each
+ * kernel adds the two table values in single precision and
+ * accumulates in double precision in the same order as
+ * dsd2pcm_translate(), which makes its output bit-for-bit identical
+ * to the scalar per-channel path.
+ */
+
+struct dsd2pcm_multi_s
+{
+	unsigned channels;
+	unsigned stride;
+	unsigned fifopos;
+	unsigned char *fifo;
+	float *out;
+};
+
+/*
+ * Computes one output frame from the FIFO rows; "out" receives
+ * "stride" floats, of which the padding lanes are garbage.
+ */
+static void multi_kernel_generic(const unsigned char *fifo, unsigned stride,
+				 unsigned ffp, float *out)
+{
+	unsigned c, i;
+	const unsigned char *r1, *r2;
+	double acc;
+	for (c=0; c<stride; ++c) {
+		acc = 0;
+		for (i=0; i<CTABLES; ++i) {
+			r1 = fifo + ((ffp              -i) & FIFOMASK) * stride;
+			r2 = fifo + ((ffp-(CTABLES*2-1)+i) & FIFOMASK) * stride;
+			acc += ctables[i][r1[c]] + ctables[i][r2[c]];
+		}
+		out[c] = (float)acc;
+	}
+}
+
+#ifdef DSD2PCM_X86
+
+static inline void multi_block_sse2(const unsigned char *fifo, unsigned stride,
+				    unsigned ffp, unsigned c, float *out)
+{
+	unsigned i;
+	const unsigned char *r1, *r2;
+	const float *t;
+	__m128 a, b, s;
+	__m128d lo = _mm_setzero_pd(), hi = _mm_setzero_pd();
+	for (i=0; i<CTABLES; ++i) {
+		r1 = fifo + ((ffp              -i) & FIFOMASK) * stride + c;
+		r2 = fifo + ((ffp-(CTABLES*2-1)+i) & FIFOMASK) * stride + c;
+		t = ctables[i];
+		a = _mm_setr_ps(t[r1[0]], t[r1[1]], t[r1[2]], t[r1[3]]);
+		b = _mm_setr_ps(t[r2[0]], t[r2[1]], t[r2[2]], t[r2[3]]);
+		s = _mm_add_ps(a, b);
+		lo = _mm_add_pd(lo, _mm_cvtps_pd(s));
+		hi = _mm_add_pd(hi, _mm_cvtps_pd(_mm_movehl_ps(s, s)));
+	}
+	_mm_storeu_ps(out + c,
+		      _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+}
+
+static void multi_kernel_sse2(const unsigned char *fifo, unsigned stride,
+			      unsigned ffp, float *out)
+{
+	unsigned c;
+	for (c=0; c<stride; c+=4)
+		multi_block_sse2(fifo, stride, ffp, c, out);
+}
+
+__attribute__((target("avx2")))
+static void multi_kernel_avx2(const unsigned char *fifo, unsigned stride,
+			      unsigned ffp, float *out)
+{
+	unsigned c, i;
+	const unsigned char *r1, *r2;
+	const float *t;
+	__m256i i1, i2;
+	__m256 s;
+	__m256d lo, hi;
+	for (c=0; c+8<=stride; c+=8) {
+		lo = _mm256_setzero_pd();
+		hi = _mm256_setzero_pd();
+		for (i=0; i<CTABLES; ++i) {
+			r1 = fifo + ((ffp              -i) & FIFOMASK) * stride + c;
+			r2 = fifo + ((ffp-(CTABLES*2-1)+i) & FIFOMASK) * stride + c;
+			t = ctables[i];
+			i1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)r1));
+			i2 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)r2));
+			s = _mm256_add_ps(_mm256_i32gather_ps(t, i1, 4),
+					  _mm256_i32gather_ps(t, i2, 4));
+			lo = _mm256_add_pd(lo, _mm256_cvtps_pd(_mm256_castps256_ps128(s)));
+			hi = _mm256_add_pd(hi, _mm256_cvtps_pd(_mm256_extractf128_ps(s, 1)));
+		}
+		_mm256_storeu_ps(out + c,
+				 _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)),
+						      _mm256_cvtpd_ps(hi), 1));
+	}
+	if (c < stride)
+		multi_block_sse2(fifo, stride, ffp, c, out);
+}
+
+#endif /* DSD2PCM_X86 */
+
+#ifdef DSD2PCM_NEON
+
+static void multi_kernel_neon(const unsigned char *fifo, unsigned stride,
+			      unsigned ffp, float *out)
+{
+	unsigned c, i;
+	const unsigned char *r1, *r2;
+	const float *t;
+	float32x4_t s;
+	float64x2_t lo, hi;
+	for (c=0; c<stride; c+=4) {
+		lo = vdupq_n_f64(0);
+		hi = vdupq_n_f64(0);
+		for (i=0; i<CTABLES; ++i) {
+			float a[4], b[4];
+			r1 = fifo + ((ffp              -i) & FIFOMASK) * stride + c;
+			r2 = fifo + ((ffp-(CTABLES*2-1)+i) & FIFOMASK) * stride + c;
+			t = ctables[i];
+			a[0] = t[r1[0]]; a[1] = t[r1[1]]; a[2] = t[r1[2]]; a[3] = t[r1[3]];
+			b[0] = t[r2[0]]; b[1] = t[r2[1]]; b[2] = t[r2[2]]; b[3] = t[r2[3]];
+			s = vaddq_f32(vld1q_f32(a), vld1q_f32(b));
+			lo = vaddq_f64(lo, vcvt_f64_f32(vget_low_f32(s)));
+			hi = vaddq_f64(hi, vcvt_high_f64_f32(s));
+		}
+		vst1q_f32(out + c, vcvt_high_f32_f64(vcvt_f32_f64(lo), hi));
+	}
+}
+
+#endif /* DSD2PCM_NEON */
+
+static void select_multi_kernel(void)
+{
+#if defined(DSD2PCM_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		multi_kernel = multi_kernel_avx2;
+	else
+		multi_kernel = multi_kernel_sse2;
+#elif defined(DSD2PCM_NEON)
+	multi_kernel = multi_kernel_neon;
+#else
+	multi_kernel = multi_kernel_generic;
+#endif
+}
+
+extern dsd2pcm_multi* dsd2pcm_multi_init(unsigned channels)
+{
+	dsd2pcm_multi* ptr;
+	if (!precalculated) precalc();
+	ptr = (dsd2pcm_multi*) malloc(sizeof(dsd2pcm_multi));
+	if (!ptr) return NULL;
+	ptr->channels = channels;
+	ptr->stride = (channels + MULTI_LANES - 1) & ~(MULTI_LANES - 1);
+	/* 8 bytes of slack: the AVX2 kernel loads 8 octets per row */
+	ptr->fifo = (unsigned char*) malloc(FIFOSIZE * ptr->stride + 8);
+	ptr->out = (float*) malloc(ptr->stride * sizeof(float));
+	if (!ptr->fifo || !ptr->out) {
+		dsd2pcm_multi_destroy(ptr);
+		return NULL;
+	}
+	dsd2pcm_multi_reset(ptr);
+	return ptr;
+}
+
+extern void dsd2pcm_multi_destroy(dsd2pcm_multi* ptr)
+{
+	free(ptr->fifo);
+	free(ptr->out);
+	free(ptr);
+}
+
+extern void dsd2pcm_multi_reset(dsd2pcm_multi* ptr)
+{
+	memset(ptr->fifo, 0x69, FIFOSIZE * ptr->stride + 8);
+	ptr->fifopos = 0;
+}
+
+extern unsigned dsd2pcm_multi_channels(const dsd2pcm_multi* ptr)
+{
+	return ptr->channels;
+}
+
+extern void dsd2pcm_multi_translate(
+	dsd2pcm_multi* ptr,
+	size_t frames,
+	const unsigned char *src,
+	int lsbf,
+	float *dst)
+{
+	const unsigned channels = ptr->channels, stride = ptr->stride;
+	const multi_kernel_t kernel = multi_kernel;
+	unsigned ffp;
+	unsigned c;
+	unsigned char* row;
+	ffp = ptr->fifopos;
+	while (frames-- > 0) {
+		row = ptr->fifo + ffp * stride;
+		if (lsbf) {
+			for (c=0; c<channels; ++c)
+				row[c] = bit_reverse(src[c]);
+		} else
+			memcpy(row, src, channels);
+		src += channels;
+
+		row = ptr->fifo + ((ffp-CTABLES) & FIFOMASK) * stride;
+		for (c=0; c<stride; ++c)
+			row[c] = bit_reverse(row[c]);
+
+		kernel(ptr->fifo, stride, ffp, ptr->out);
+		memcpy(dst, ptr->out, channels * sizeof(*dst));
+		dst += channels;
+
+		ffp = (ffp + 1) & FIFOMASK;
+	}
+	ptr->fifopos = ffp;
+}
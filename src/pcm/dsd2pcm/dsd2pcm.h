@@ -56,6 +56,50 @@ extern void dsd2pcm_translate(dsd2pcm_ctx *ctx,
 	int lsbitfirst,
 	float *dst, ptrdiff_t dst_stride);
 
+struct dsd2pcm_multi_s;
+
+typedef struct dsd2pcm_multi_s dsd2pcm_multi;
+
+/**
+ * initializes a "dsd2pcm engine" for all channels of an interleaved
+ * stream; the channels are filtered together with the best SIMD
+ * kernel available on this CPU (selected at runtime), and the output
+ * is bit-for-bit identical to dsd2pcm_translate() on each channel
+ *
+ * Not thread-safe for the same reason as dsd2pcm_init().
+ */
+extern dsd2pcm_multi* dsd2pcm_multi_init(unsigned channels);
+
+/**
+ * deinitializes a multi-channel "dsd2pcm engine"
+ */
+extern void dsd2pcm_multi_destroy(dsd2pcm_multi *ctx);
+
+/**
+ * resets the internal state of all channels for a fresh new stream
+ */
+extern void dsd2pcm_multi_reset(dsd2pcm_multi *ctx);
+
+/**
+ * returns the number of channels passed to dsd2pcm_multi_init()
+ */
+extern unsigned dsd2pcm_multi_channels(const dsd2pcm_multi *ctx);
+
+/**
+ * "translates" interleaved frames of octets to interleaved floats
+ * (8:1 decimation)
+ * @param ctx -- pointer to abstract context (buffers)
+ * @param frames -- number of frames to "translate"
+ * @param src -- pointer to first octet (input, frames*channels octets)
+ * @param lsbitfirst -- bitorder, 0=msb first, 1=lsbfirst
+ * @param dst -- pointer to first float (output, frames*channels floats)
+ */
+extern void dsd2pcm_multi_translate(dsd2pcm_multi *ctx,
+	size_t frames,
+	const unsigned char *src,
+	int lsbitfirst,
+	float *dst);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
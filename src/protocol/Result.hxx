@@ -28,8 +28,14 @@
 
 class Client;
 
-extern const char *current_command;
-extern int command_list_num;
+/**
+ * The command being executed by the current thread, and its
+ * position in the command list.  These are thread-local because
+ * some commands are executed by worker threads (see
+ * ClientWorker.hxx).
+ */
+extern __thread const char *current_command;
+extern __thread int command_list_num;
 
 void
 command_success(Client &client);
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "ThreadFaults.hxx"
+
+#include <atomic>
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+static std::atomic<uint64_t> minor_faults, major_faults;
+
+#ifdef RUSAGE_THREAD
+
+/**
+ * The counter values of the current thread seen by the previous
+ * UpdateThreadFaults() call.
+ */
+static __thread bool thread_initialized;
+static __thread long thread_minor, thread_major;
+
+#endif
+
+void
+UpdateThreadFaults()
+{
+#ifdef RUSAGE_THREAD
+	struct rusage usage;
+	if (getrusage(RUSAGE_THREAD, &usage) < 0)
+		return;
+
+	if (thread_initialized) {
+		minor_faults.fetch_add(usage.ru_minflt - thread_minor,
+				       std::memory_order_relaxed);
+		major_faults.fetch_add(usage.ru_majflt - thread_major,
+				       std::memory_order_relaxed);
+	} else
+		thread_initialized = true;
+
+	thread_minor = usage.ru_minflt;
+	thread_major = usage.ru_majflt;
+#endif
+}
+
+PageFaults
+GetThreadFaults()
+{
+	return {
+		minor_faults.load(std::memory_order_relaxed),
+		major_faults.load(std::memory_order_relaxed),
+	};
+}
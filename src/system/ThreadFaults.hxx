@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_THREAD_FAULTS_HXX
+#define MPD_THREAD_FAULTS_HXX
+
+#include "Compiler.h"
+
+#include <stdint.h>
+
+struct PageFaults {
+	/**
+	 * Faults which were resolved without I/O, e.g. the first
+	 * access to an anonymous page.
+	 */
+	uint64_t minor;
+
+	/**
+	 * Faults which required I/O, e.g. swapping in.
+	 */
+	uint64_t major;
+};
+
+/**
+ * Add the page faults of the current thread since its previous call
+ * to the global counters.  The first call in each thread only
+ * records the baseline, so faults during thread startup are not
+ * counted.
+ *
+ * This is meant to be called periodically by the audio threads
+ * (decoder, player, outputs), to verify that the audio path never
+ * faults.  It does nothing on systems without RUSAGE_THREAD.
+ */
+void
+UpdateThreadFaults();
+
+/**
+ * Returns the sum of all page faults collected by
+ * UpdateThreadFaults().
+ */
+gcc_pure
+PageFaults
+GetThreadFaults();
+
+#endif
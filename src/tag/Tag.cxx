@@ -70,10 +70,8 @@ Tag::Clear()
 	time = -1;
 	has_playlist = false;
 
-	tag_pool_lock.lock();
 	for (unsigned i = 0; i < num_items; ++i)
 		tag_pool_put_item(items[i]);
-	tag_pool_lock.unlock();
 
 	g_free(items);
 	items = nullptr;
@@ -82,10 +80,8 @@ Tag::Clear()
 
 Tag::~Tag()
 {
-	tag_pool_lock.lock();
 	for (int i = num_items; --i >= 0; )
 		tag_pool_put_item(items[i]);
-	tag_pool_lock.unlock();
 
 	g_free(items);
 }
@@ -98,10 +94,8 @@ Tag::Tag(const Tag &other)
 	if (num_items > 0) {
 		items = (TagItem **)g_malloc(items_size(other));
 
-		tag_pool_lock.lock();
 		for (unsigned i = 0; i < num_items; i++)
 			items[i] = tag_pool_dup_item(other.items[i]);
-		tag_pool_lock.unlock();
 	}
 }
 
@@ -119,8 +113,6 @@ Tag::Merge(const Tag &base, const Tag &add)
 		? (TagItem **)g_malloc(items_size(*ret))
 		: nullptr;
 
-	tag_pool_lock.lock();
-
 	/* copy all items from "add" */
 
 	for (unsigned i = 0; i < add.num_items; ++i)
@@ -134,8 +126,6 @@ Tag::Merge(const Tag &base, const Tag &add)
 		if (!add.HasType(base.items[i]->type))
 			ret->items[n++] = tag_pool_dup_item(base.items[i]);
 
-	tag_pool_lock.unlock();
-
 	assert(n <= ret->num_items);
 
 	if (n < ret->num_items) {
@@ -199,9 +189,7 @@ Tag::AddItemInternal(TagType type, const char *value, size_t len)
 
 	items = (TagItem **)g_realloc(items, items_size(*this));
 
-	tag_pool_lock.lock();
 	items[i] = tag_pool_get_item(type, value, len);
-	tag_pool_lock.unlock();
 
 	g_free(p);
 }
@@ -35,10 +35,8 @@ TagBuilder::Clear()
 	time = -1;
 	has_playlist = false;
 
-	tag_pool_lock.lock();
 	for (auto i : items)
 		tag_pool_put_item(i);
-	tag_pool_lock.unlock();
 
 	items.clear();
 }
@@ -89,9 +87,7 @@ TagBuilder::AddItemInternal(TagType type, const char *value, size_t length)
 		length = strlen(value);
 	}
 
-	tag_pool_lock.lock();
 	auto i = tag_pool_get_item(type, value, length);
-	tag_pool_lock.unlock();
 
 	g_free(p);
 
@@ -20,136 +20,360 @@
 #include "config.h"
 #include "TagPool.hxx"
 #include "TagItem.hxx"
+#include "thread/Mutex.hxx"
 
 #include <glib.h>
 
+#include <atomic>
+#include <new>
+
 #include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
-Mutex tag_pool_lock;
+/**
+ * The pool is split into this many independent hash tables, each with
+ * its own lock, to reduce lock contention between the update threads.
+ * Must be a power of two.
+ */
+static constexpr unsigned SHARD_BITS = 4;
+static constexpr unsigned NUM_SHARDS = 1 << SHARD_BITS;
+
+/**
+ * The initial number of buckets in each shard; must be a power of
+ * two.
+ */
+static constexpr unsigned INITIAL_CAPACITY = 256;
+
+struct TagPoolSlot {
+	/**
+	 * The reference counter.  It is incremented without holding
+	 * the shard lock by tag_pool_dup_item(); all other
+	 * modifications happen while the lock is held.
+	 */
+	std::atomic<uint32_t> ref;
+
+	const uint32_t hash;
 
-#define NUM_SLOTS 4096
+	/**
+	 * The length of the value, to avoid strlen() calls while
+	 * probing.
+	 */
+	const uint32_t length;
 
-struct slot {
-	struct slot *next;
-	unsigned char ref;
 	TagItem item;
-} mpd_packed;
 
-static struct slot *slots[NUM_SLOTS];
+	TagPoolSlot(uint32_t _hash, uint32_t _length)
+		:ref(1), hash(_hash), length(_length) {}
 
-static inline unsigned
-calc_hash_n(TagType type, const char *p, size_t length)
-{
-	unsigned hash = 5381;
+	static size_t GetAllocationSize(size_t length) {
+		return sizeof(TagPoolSlot) - sizeof(item.value) + length + 1;
+	}
 
-	assert(p != nullptr);
+	static TagPoolSlot *Create(uint32_t hash, TagType type,
+				   const char *value, size_t length) {
+		void *p = g_malloc(GetAllocationSize(length));
+		TagPoolSlot *slot = new(p) TagPoolSlot(hash, length);
+		slot->item.type = type;
+		memcpy(slot->item.value, value, length);
+		slot->item.value[length] = 0;
+		return slot;
+	}
 
-	while (length-- > 0)
-		hash = (hash << 5) + hash + *p++;
+	void Free() {
+		this->~TagPoolSlot();
+		g_free(this);
+	}
 
-	return hash ^ type;
-}
+	static TagPoolSlot *FromItem(TagItem *item) {
+		return (TagPoolSlot *)(((char *)item) -
+				       offsetof(TagPoolSlot, item));
+	}
 
-static inline unsigned
-calc_hash(TagType type, const char *p)
-{
-	unsigned hash = 5381;
+	bool Match(uint32_t _hash, TagType type,
+		   const char *value, size_t _length) const {
+		return hash == _hash && length == _length &&
+			item.type == type &&
+			memcmp(item.value, value, length) == 0;
+	}
+};
 
-	assert(p != nullptr);
+/**
+ * One bucket of the open addressing hash table.  The hash is copied
+ * here, so probing does not need to dereference the slot pointer of
+ * mismatching entries.
+ */
+struct TagPoolBucket {
+	uint32_t hash;
 
-	while (*p != 0)
-		hash = (hash << 5) + hash + *p++;
+	/**
+	 * nullptr if this bucket is empty.
+	 */
+	TagPoolSlot *slot;
+};
 
-	return hash ^ type;
-}
+/**
+ * A hash table with linear probing and backward shift deletion
+ * (i.e. without tombstones).  It grows when it is 70% full.
+ */
+struct TagPoolShard {
+	Mutex mutex;
+
+	TagPoolBucket *buckets = nullptr;
+
+	/**
+	 * The number of buckets, a power of two (or 0 before the
+	 * first insertion).
+	 */
+	unsigned capacity = 0;
+
+	unsigned count = 0;
+
+	/**
+	 * The sum of all TagPoolSlot::ref.  Like those, it is
+	 * incremented without the lock by tag_pool_dup_item().
+	 */
+	std::atomic<unsigned long> references;
+
+	/**
+	 * The number of bytes allocated for the slots.
+	 */
+	size_t slot_bytes = 0;
+
+	/**
+	 * The sum of the distances of all entries from their home
+	 * buckets.
+	 */
+	unsigned long long total_probe = 0;
+
+	/**
+	 * The longest distance of an entry from its home bucket since
+	 * the last Grow().  Removals do not lower it.
+	 */
+	unsigned max_probe = 0;
+
+	TagPoolShard():references(0) {}
+
+	unsigned Home(uint32_t hash) const {
+		return hash & (capacity - 1);
+	}
+
+	/**
+	 * The distance of bucket #i from the specified hash's home
+	 * bucket.
+	 */
+	unsigned Distance(unsigned i, uint32_t hash) const {
+		return (i - Home(hash)) & (capacity - 1);
+	}
+
+	unsigned Next(unsigned i) const {
+		return (i + 1) & (capacity - 1);
+	}
+
+	TagPoolSlot *Find(uint32_t hash, TagType type,
+			  const char *value, size_t length) const {
+		if (capacity == 0)
+			return nullptr;
+
+		for (unsigned i = Home(hash); buckets[i].slot != nullptr;
+		     i = Next(i)) {
+			TagPoolSlot *slot = buckets[i].slot;
+			if (buckets[i].hash == hash &&
+			    slot->Match(hash, type, value, length))
+				return slot;
+		}
+
+		return nullptr;
+	}
+
+	void InsertNew(TagPoolSlot *slot) {
+		unsigned i = Home(slot->hash);
+		while (buckets[i].slot != nullptr)
+			i = Next(i);
+
+		buckets[i].hash = slot->hash;
+		buckets[i].slot = slot;
+
+		const unsigned probe = Distance(i, slot->hash);
+		total_probe += probe;
+		if (probe > max_probe)
+			max_probe = probe;
+	}
+
+	void Grow() {
+		TagPoolBucket *old_buckets = buckets;
+		const unsigned old_capacity = capacity;
+
+		capacity = old_capacity > 0
+			? old_capacity * 2
+			: INITIAL_CAPACITY;
+		buckets = g_new0(TagPoolBucket, capacity);
+		total_probe = 0;
+		max_probe = 0;
+
+		for (unsigned i = 0; i < old_capacity; ++i)
+			if (old_buckets[i].slot != nullptr)
+				InsertNew(old_buckets[i].slot);
+
+		g_free(old_buckets);
+	}
+
+	void Insert(TagPoolSlot *slot) {
+		if ((count + 1) * 10 > capacity * 7)
+			Grow();
+
+		InsertNew(slot);
+		++count;
+		slot_bytes += TagPoolSlot::GetAllocationSize(slot->length);
+	}
+
+	void Remove(TagPoolSlot *slot) {
+		unsigned i = Home(slot->hash);
+		while (buckets[i].slot != slot) {
+			assert(buckets[i].slot != nullptr);
+			i = Next(i);
+		}
 
-static inline struct slot *
-tag_item_to_slot(TagItem *item)
+		total_probe -= Distance(i, slot->hash);
+
+		/* shift following entries back into the gap, unless
+		   they are already at their home bucket or the gap is
+		   before their home bucket */
+		for (unsigned j = Next(i); buckets[j].slot != nullptr;
+		     j = Next(j)) {
+			const unsigned k = Home(buckets[j].hash);
+			const bool movable = i <= j
+				? (k <= i || k > j)
+				: (k <= i && k > j);
+			if (movable) {
+				total_probe -= Distance(j, buckets[j].hash) -
+					Distance(i, buckets[j].hash);
+				buckets[i] = buckets[j];
+				i = j;
+			}
+		}
+
+		buckets[i].slot = nullptr;
+		--count;
+		slot_bytes -= TagPoolSlot::GetAllocationSize(slot->length);
+	}
+};
+
+static TagPoolShard shards[NUM_SHARDS];
+
+/**
+ * FNV-1a over the value and the type, followed by a final avalanche
+ * step, because the low bits select the bucket and the high bits
+ * select the shard.
+ */
+gcc_pure
+static uint32_t
+calc_hash(TagType type, const char *p, size_t length)
 {
-	return (struct slot*)(((char*)item) - offsetof(struct slot, item));
+	assert(p != nullptr);
+
+	uint32_t hash = 2166136261u ^ type;
+	while (length-- > 0)
+		hash = (hash ^ (unsigned char)*p++) * 16777619u;
+
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35u;
+	hash ^= hash >> 16;
+	return hash;
 }
 
-static struct slot *slot_alloc(struct slot *next,
-			       TagType type,
-			       const char *value, int length)
+static inline TagPoolShard &
+get_shard(uint32_t hash)
 {
-	struct slot *slot;
-
-	slot = (struct slot *)
-		g_malloc(sizeof(*slot) - sizeof(slot->item.value) + length + 1);
-	slot->next = next;
-	slot->ref = 1;
-	slot->item.type = type;
-	memcpy(slot->item.value, value, length);
-	slot->item.value[length] = 0;
-	return slot;
+	return shards[hash >> (32 - SHARD_BITS)];
 }
 
 TagItem *
 tag_pool_get_item(TagType type, const char *value, size_t length)
 {
-	struct slot **slot_p, *slot;
-
-	slot_p = &slots[calc_hash_n(type, value, length) % NUM_SLOTS];
-	for (slot = *slot_p; slot != nullptr; slot = slot->next) {
-		if (slot->item.type == type &&
-		    length == strlen(slot->item.value) &&
-		    memcmp(value, slot->item.value, length) == 0 &&
-		    slot->ref < 0xff) {
-			assert(slot->ref > 0);
-			++slot->ref;
-			return &slot->item;
-		}
+	const uint32_t hash = calc_hash(type, value, length);
+	TagPoolShard &shard = get_shard(hash);
+	const ScopeLock protect(shard.mutex);
+
+	++shard.references;
+
+	TagPoolSlot *slot = shard.Find(hash, type, value, length);
+	if (slot != nullptr) {
+		assert(slot->ref > 0);
+		++slot->ref;
+		return &slot->item;
 	}
 
-	slot = slot_alloc(*slot_p, type, value, length);
-	*slot_p = slot;
+	slot = TagPoolSlot::Create(hash, type, value, length);
+	shard.Insert(slot);
 	return &slot->item;
 }
 
 TagItem *
 tag_pool_dup_item(TagItem *item)
 {
-	struct slot *slot = tag_item_to_slot(item);
+	TagPoolSlot *slot = TagPoolSlot::FromItem(item);
 
+	/* no lock needed: the caller holds a reference, so the
+	   counter cannot drop to zero meanwhile */
 	assert(slot->ref > 0);
-
-	if (slot->ref < 0xff) {
-		++slot->ref;
-		return item;
-	} else {
-		/* the reference counter overflows above 0xff;
-		   duplicate the item, and start with 1 */
-		size_t length = strlen(item->value);
-		struct slot **slot_p =
-			&slots[calc_hash_n(item->type, item->value,
-					   length) % NUM_SLOTS];
-		slot = slot_alloc(*slot_p, item->type,
-				  item->value, strlen(item->value));
-		*slot_p = slot;
-		return &slot->item;
-	}
+	++slot->ref;
+	get_shard(slot->hash).references.fetch_add(1,
+						   std::memory_order_relaxed);
+	return item;
 }
 
 void
 tag_pool_put_item(TagItem *item)
 {
-	struct slot **slot_p, *slot;
+	TagPoolSlot *slot = TagPoolSlot::FromItem(item);
+	TagPoolShard &shard = get_shard(slot->hash);
 
-	slot = tag_item_to_slot(item);
-	assert(slot->ref > 0);
-	--slot->ref;
+	{
+		const ScopeLock protect(shard.mutex);
+
+		--shard.references;
+
+		assert(slot->ref > 0);
+		if (--slot->ref > 0)
+			return;
+
+		shard.Remove(slot);
+	}
+
+	slot->Free();
+}
+
+TagPoolStats
+tag_pool_get_stats()
+{
+	TagPoolStats stats;
+	stats.items = 0;
+	stats.references = 0;
+	stats.bytes = 0;
+	stats.max_probe = 0;
+
+	unsigned long long total_probe = 0;
+
+	for (auto &shard : shards) {
+		const ScopeLock protect(shard.mutex);
 
-	if (slot->ref > 0)
-		return;
+		stats.items += shard.count;
+		stats.references +=
+			shard.references.load(std::memory_order_relaxed);
+		stats.bytes += shard.slot_bytes +
+			shard.capacity * sizeof(TagPoolBucket);
 
-	for (slot_p = &slots[calc_hash(item->type, item->value) % NUM_SLOTS];
-	     *slot_p != slot;
-	     slot_p = &(*slot_p)->next) {
-		assert(*slot_p != nullptr);
+		total_probe += shard.total_probe;
+		if (shard.max_probe > stats.max_probe)
+			stats.max_probe = shard.max_probe;
 	}
 
-	*slot_p = slot->next;
-	g_free(slot);
+	stats.mean_probe = stats.items > 0
+		? double(total_probe) / stats.items
+		: 0;
+	return stats;
 }
@@ -21,19 +21,64 @@
 #define MPD_TAG_POOL_HXX
 
 #include "TagType.h"
-#include "thread/Mutex.hxx"
+#include "Compiler.h"
 
-extern Mutex tag_pool_lock;
+#include <stddef.h>
 
 struct TagItem;
 
+/**
+ * Statistics about the #TagPool, see tag_pool_get_stats().
+ */
+struct TagPoolStats {
+	/**
+	 * The number of distinct #TagItem objects.
+	 */
+	unsigned items;
+
+	/**
+	 * The number of references to all items.
+	 */
+	unsigned long long references;
+
+	/**
+	 * The number of bytes allocated for items and hash tables.
+	 */
+	size_t bytes;
+
+	/**
+	 * The maximum and the average distance between an item's
+	 * hash table position and its home bucket.  The maximum is
+	 * only reset when a hash table grows, so after removals it
+	 * may be higher than the current longest distance.
+	 */
+	unsigned max_probe;
+	double mean_probe;
+};
+
+/*
+ * All of the following functions are thread-safe.  Each value is
+ * stored only once, and is reference counted.
+ */
+
 TagItem *
 tag_pool_get_item(TagType type, const char *value, size_t length);
 
+/**
+ * Obtain another reference to the item.  The caller must already hold
+ * a reference.
+ */
 TagItem *
 tag_pool_dup_item(TagItem *item);
 
 void
 tag_pool_put_item(TagItem *item);
 
+/**
+ * Returns the statistics, which are maintained by the other
+ * functions; this does not walk the hash tables.
+ */
+TagPoolStats
+tag_pool_get_stats();
+
 #endif
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_THREAD_SCHEDULE_HXX
+#define MPD_THREAD_SCHEDULE_HXX
+
+#include "check.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/**
+ * Scheduling parameters which are applied to a thread when it starts;
+ * see Thread::SetSchedule().
+ */
+struct ThreadSchedule {
+	/**
+	 * The scheduling policy (SCHED_OTHER, SCHED_FIFO, ...), or -1
+	 * to keep the one inherited from the main thread.
+	 */
+	int policy;
+
+	/**
+	 * The static priority for SCHED_FIFO and SCHED_RR.
+	 */
+	int priority;
+
+	/**
+	 * The timer slack in nanoseconds.  0 keeps the default.
+	 */
+	unsigned long timer_slack_ns;
+
+#ifdef __linux__
+	/**
+	 * The CPUs this thread may run on.  An empty set means no
+	 * restriction.
+	 */
+	cpu_set_t cpus;
+#endif
+
+	ThreadSchedule():policy(-1), priority(0), timer_slack_ns(0) {
+#ifdef __linux__
+		CPU_ZERO(&cpus);
+#endif
+	}
+};
+
+#endif
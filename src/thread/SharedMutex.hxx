@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_THREAD_SHARED_MUTEX_HXX
+#define MPD_THREAD_SHARED_MUTEX_HXX
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/**
+ * A reader/writer lock: any number of threads may hold it "shared"
+ * at the same time, but only one thread may hold it exclusively.
+ * The method names follow std::shared_mutex.  It is not recursive.
+ */
+class SharedMutex {
+#ifdef WIN32
+	SRWLOCK lock_;
+#else
+	pthread_rwlock_t rwlock;
+#endif
+
+public:
+#ifdef WIN32
+	SharedMutex() {
+		::InitializeSRWLock(&lock_);
+	}
+#else
+	SharedMutex() {
+		pthread_rwlockattr_t attr;
+		pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+		/* glibc prefers readers by default, which would let
+		   a steady stream of readers starve the writer */
+		pthread_rwlockattr_setkind_np(&attr,
+					      PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+		pthread_rwlock_init(&rwlock, &attr);
+		pthread_rwlockattr_destroy(&attr);
+	}
+
+	~SharedMutex() {
+		pthread_rwlock_destroy(&rwlock);
+	}
+#endif
+
+	SharedMutex(const SharedMutex &other) = delete;
+	SharedMutex &operator=(const SharedMutex &other) = delete;
+
+	void lock() {
+#ifdef WIN32
+		::AcquireSRWLockExclusive(&lock_);
+#else
+		pthread_rwlock_wrlock(&rwlock);
+#endif
+	}
+
+	void unlock() {
+#ifdef WIN32
+		::ReleaseSRWLockExclusive(&lock_);
+#else
+		pthread_rwlock_unlock(&rwlock);
+#endif
+	}
+
+	void lock_shared() {
+#ifdef WIN32
+		::AcquireSRWLockShared(&lock_);
+#else
+		pthread_rwlock_rdlock(&rwlock);
+#endif
+	}
+
+	void unlock_shared() {
+#ifdef WIN32
+		::ReleaseSRWLockShared(&lock_);
+#else
+		pthread_rwlock_unlock(&rwlock);
+#endif
+	}
+};
+
+#endif
@@ -19,15 +19,69 @@
 
 #include "config.h"
 #include "Thread.hxx"
+#include "Schedule.hxx"
 #include "util/Error.hxx"
+#include "Log.hxx"
+
+#include <map>
+#include <string>
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * The configured schedules, indexed by thread name or thread class.
+ * This is only modified during startup, before any thread has been
+ * started.
+ */
+static std::map<std::string, ThreadSchedule> thread_schedules;
+
+void
+Thread::SetSchedule(const char *_name, const ThreadSchedule &schedule)
+{
+	thread_schedules[_name] = schedule;
+}
+
+#ifndef WIN32
+
+/**
+ * Looks up the schedule for the specified thread name.  If there is
+ * none for the full name, the thread class (the part before the
+ * colon) is tried.
+ */
+gcc_pure
+static const ThreadSchedule *
+FindSchedule(const char *name)
+{
+	auto i = thread_schedules.find(name);
+	if (i == thread_schedules.end()) {
+		const char *colon = strchr(name, ':');
+		if (colon == nullptr)
+			return nullptr;
+
+		i = thread_schedules.find(std::string(name, colon));
+		if (i == thread_schedules.end())
+			return nullptr;
+	}
+
+	return &i->second;
+}
+
+#endif
 
 bool
-Thread::Start(void (*_f)(void *ctx), void *_ctx, Error &error)
+Thread::Start(void (*_f)(void *ctx), void *_ctx, const char *_name,
+	      Error &error)
 {
 	assert(!IsDefined());
 
 	f = _f;
 	ctx = _ctx;
+	snprintf(name, sizeof(name), "%s", _name != nullptr ? _name : "");
 
 #ifdef WIN32
 	handle = ::CreateThread(nullptr, 0, ThreadProc, this, 0, &id);
@@ -88,6 +142,43 @@ Thread::ThreadProc(LPVOID ctx)
 
 #else
 
+/**
+ * Applies the schedule to the current thread.
+ */
+static bool
+ApplySchedule(const ThreadSchedule &schedule, Error &error)
+{
+#ifdef __linux__
+	if (schedule.timer_slack_ns > 0)
+		prctl(PR_SET_TIMERSLACK, schedule.timer_slack_ns, 0, 0, 0);
+
+	if (CPU_COUNT(&schedule.cpus) > 0) {
+		int e = pthread_setaffinity_np(pthread_self(),
+					       sizeof(schedule.cpus),
+					       &schedule.cpus);
+		if (e != 0) {
+			error.SetErrno(e, "Failed to set the CPU affinity");
+			return false;
+		}
+	}
+#endif
+
+	if (schedule.policy >= 0) {
+		struct sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = schedule.priority;
+
+		int e = pthread_setschedparam(pthread_self(), schedule.policy,
+					      &param);
+		if (e != 0) {
+			error.SetErrno(e, "Failed to set the scheduling policy");
+			return false;
+		}
+	}
+
+	return true;
+}
+
 void *
 Thread::ThreadProc(void *ctx)
 {
@@ -101,6 +192,20 @@ Thread::ThreadProc(void *ctx)
 	thread.defined = true;
 #endif
 
+	if (thread.name[0] != 0) {
+#ifdef __linux__
+		/* the kernel truncates this to 15 characters */
+		prctl(PR_SET_NAME, thread.name, 0, 0, 0);
+#endif
+
+		const ThreadSchedule *schedule = FindSchedule(thread.name);
+		Error error;
+		if (schedule != nullptr && !ApplySchedule(*schedule, error))
+			FormatError(error,
+				    "Failed to apply the schedule of thread \"%s\"",
+				    thread.name);
+	}
+
 	thread.f(thread.ctx);
 	return nullptr;
 }
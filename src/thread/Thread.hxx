@@ -32,6 +32,7 @@
 #include <assert.h>
 
 class Error;
+struct ThreadSchedule;
 
 class Thread {
 #ifdef WIN32
@@ -54,6 +55,14 @@ class Thread {
 	void (*f)(void *ctx);
 	void *ctx;
 
+	/**
+	 * The name of this thread, e.g. "player" or "output:NAME".
+	 * The part before the colon is the thread class.  It is
+	 * shown in /proc, and selects the #ThreadSchedule.  Empty if
+	 * no name was given.
+	 */
+	char name[64];
+
 public:
 #ifdef WIN32
 	Thread():handle(nullptr) {}
@@ -99,9 +108,24 @@ public:
 #endif
 	}
 
-	bool Start(void (*f)(void *ctx), void *ctx, Error &error);
+	/**
+	 * Starts the thread.
+	 *
+	 * @param name the name of the thread (see #name), or nullptr
+	 */
+	bool Start(void (*f)(void *ctx), void *ctx, const char *name,
+		   Error &error);
 	void Join();
 
+	/**
+	 * Registers scheduling parameters for all threads which will
+	 * be started with the specified name, or with a name of the
+	 * specified class.  This must be called before the threads
+	 * are started, while MPD is still single-threaded.
+	 */
+	static void SetSchedule(const char *name,
+				const ThreadSchedule &schedule);
+
 private:
 #ifdef WIN32
 	static DWORD WINAPI ThreadProc(LPVOID ctx);
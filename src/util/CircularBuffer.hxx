@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_CIRCULAR_BUFFER_HXX
+#define MPD_CIRCULAR_BUFFER_HXX
+
+#include "WritableBuffer.hxx"
+
+#include <assert.h>
+#include <stddef.h>
+
+/**
+ * A first-in-first-out buffer with a fixed capacity.  Unlike
+ * #FifoBuffer, it never moves its contents; instead, the readable
+ * and writable ranges wrap around at the end of the allocation, so
+ * Read() and Write() may return less than GetSize() and GetSpace().
+ * It is not thread safe.
+ */
+template<typename T>
+class CircularBuffer {
+public:
+	typedef size_t size_type;
+	typedef WritableBuffer<T> Range;
+
+private:
+	T *const data;
+
+	const size_type capacity;
+
+	/**
+	 * The index of the first item to be read.
+	 */
+	size_type head;
+
+	/**
+	 * The number of items in the buffer.
+	 */
+	size_type size;
+
+public:
+	explicit CircularBuffer(size_type _capacity)
+		:data(new T[_capacity]), capacity(_capacity),
+		 head(0), size(0) {
+		assert(capacity > 0);
+	}
+
+	~CircularBuffer() {
+		delete[] data;
+	}
+
+	CircularBuffer(const CircularBuffer &) = delete;
+	CircularBuffer &operator=(const CircularBuffer &) = delete;
+
+	size_type GetCapacity() const {
+		return capacity;
+	}
+
+	size_type GetSize() const {
+		return size;
+	}
+
+	size_type GetSpace() const {
+		return capacity - size;
+	}
+
+	bool IsEmpty() const {
+		return size == 0;
+	}
+
+	bool IsFull() const {
+		return size == capacity;
+	}
+
+	void Clear() {
+		head = size = 0;
+	}
+
+	/**
+	 * Returns the range which may be written, up to the end of
+	 * the allocation.  When you are finished, call Append().
+	 */
+	Range Write() {
+		size_type tail = head + size;
+		if (tail >= capacity)
+			return Range(data + tail - capacity, capacity - size);
+
+		return Range(data + tail, capacity - tail);
+	}
+
+	/**
+	 * Expands the tail of the buffer, after data has been written
+	 * to the range returned by Write().
+	 */
+	void Append(size_type n) {
+		assert(n <= Write().size);
+
+		size += n;
+	}
+
+	/**
+	 * Returns the range which may be read, up to the end of the
+	 * allocation.
+	 */
+	Range Read() {
+		const size_type end = head + size;
+		return Range(data + head,
+			     (end > capacity ? capacity : end) - head);
+	}
+
+	/**
+	 * Marks items at the head as consumed.
+	 */
+	void Consume(size_type n) {
+		assert(n <= Read().size);
+
+		head += n;
+		if (head == capacity)
+			head = 0;
+		size -= n;
+		if (size == 0)
+			head = 0;
+	}
+};
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_CPU_FEATURES_HXX
+#define MPD_CPU_FEATURES_HXX
+
+#include "Compiler.h"
+
+/*
+ * Runtime detection of SIMD instruction set extensions.  Code which
+ * uses them is compiled with gcc_target() so the rest of MPD does not
+ * need special compiler flags, and must check these functions before
+ * calling it.
+ */
+
+#if defined(__x86_64__) && (GCC_CHECK_VERSION(4,9) || defined(__clang__))
+#define HAVE_X86_SIMD
+#define gcc_target(isa) __attribute__((target(isa)))
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define HAVE_NEON
+#endif
+
+#ifdef HAVE_X86_SIMD
+
+static inline bool
+CpuHasSSSE3()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("ssse3");
+}
+
+static inline bool
+CpuHasSSE41()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.1");
+}
+
+static inline bool
+CpuHasAVX2()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+#endif
@@ -22,33 +22,123 @@
 #ifdef __linux__
 #include <sys/mman.h>
 #include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
 #else
 #include <stdlib.h>
 #endif
 
 #ifdef __linux__
 
-/**
- * Round up the parameter, make it page-aligned.
- */
 gcc_const
 static size_t
-AlignToPageSize(size_t size)
+GetPageSize()
 {
 	static const long page_size = sysconf(_SC_PAGESIZE);
-	if (page_size > 0)
+	return page_size > 0 ? size_t(page_size) : 0;
+}
+
+gcc_const
+static size_t
+AlignToPageSize(size_t size)
+{
+	const size_t ps = GetPageSize();
+	if (ps == 0)
 		return size;
 
-	size_t ps(page_size);
 	return (size + ps - 1) / ps * ps;
 }
 
+#ifdef MAP_HUGETLB
+
+/**
+ * Determine the default huge page size, which is the one used by
+ * MAP_HUGETLB.
+ */
+static size_t
+ReadHugePageSize()
+{
+	size_t result = 2 * 1024 * 1024;
+
+	FILE *file = fopen("/proc/meminfo", "r");
+	if (file == nullptr)
+		return result;
+
+	char line[128];
+	unsigned long kb;
+	while (fgets(line, sizeof(line), file) != nullptr) {
+		if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1) {
+			if (kb > 0)
+				result = size_t(kb) * 1024;
+			break;
+		}
+	}
+
+	fclose(file);
+	return result;
+}
+
+gcc_const
+static size_t
+AlignToHugePageSize(size_t size)
+{
+	static const size_t huge_page_size = ReadHugePageSize();
+	return (size + huge_page_size - 1) / huge_page_size * huge_page_size;
+}
+
+#endif
+
+static size_t
+AlignSize(size_t size, HugePolicy policy)
+{
+#ifdef MAP_HUGETLB
+	if (policy == HugePolicy::HUGETLB)
+		return AlignToHugePageSize(size);
+#else
+	(void)policy;
+#endif
+
+	return AlignToPageSize(size);
+}
+
+/**
+ * Write to each page, so the kernel allocates all of them now
+ * instead of inside the audio threads.
+ */
+static void
+Prefault(void *p, size_t size)
+{
+	const size_t ps = GetPageSize();
+	volatile char *q = (volatile char *)p;
+	for (size_t i = 0; i < size; i += ps > 0 ? ps : 4096)
+		q[i] = 0;
+}
+
 void *
-HugeAllocate(size_t size)
+HugeAllocate(size_t size, HugePolicy policy)
 {
-	size = AlignToPageSize(size);
+	size = AlignSize(size, policy);
+
+	int flags = MAP_ANONYMOUS|MAP_PRIVATE;
+	switch (policy) {
+	case HugePolicy::LAZY:
+		flags |= MAP_NORESERVE;
+		break;
+
+	case HugePolicy::PREFAULT:
+	case HugePolicy::LOCK:
+		break;
+
+	case HugePolicy::HUGETLB:
+#ifdef MAP_HUGETLB
+		flags |= MAP_HUGETLB|MAP_POPULATE;
+		break;
+#else
+		errno = ENOSYS;
+		return nullptr;
+#endif
+	}
 
-	constexpr int flags = MAP_ANONYMOUS|MAP_PRIVATE|MAP_NORESERVE;
 	void *p = mmap(nullptr, size,
 		       PROT_READ|PROT_WRITE, flags,
 		       -1, 0);
@@ -58,7 +148,8 @@ HugeAllocate(size_t size)
 #ifdef MADV_HUGEPAGE
 	/* allow the Linux kernel to use "Huge Pages", which reduces page
 	   table overhead for this big chunk of data */
-	madvise(p, size, MADV_HUGEPAGE);
+	if (policy != HugePolicy::HUGETLB)
+		madvise(p, size, MADV_HUGEPAGE);
 #endif
 
 #ifdef MADV_DONTFORK
@@ -67,13 +158,25 @@ HugeAllocate(size_t size)
 	madvise(p, size, MADV_DONTFORK);
 #endif
 
+	if (policy == HugePolicy::PREFAULT || policy == HugePolicy::LOCK)
+		Prefault(p, size);
+
+	if (policy == HugePolicy::LOCK || policy == HugePolicy::HUGETLB) {
+		if (mlock(p, size) < 0) {
+			const int e = errno;
+			munmap(p, size);
+			errno = e;
+			return nullptr;
+		}
+	}
+
 	return p;
 }
 
 void
-HugeFree(void *p, size_t size)
+HugeFree(void *p, size_t size, HugePolicy policy)
 {
-	munmap(p, AlignToPageSize(size));
+	munmap(p, AlignSize(size, policy));
 }
 
 void
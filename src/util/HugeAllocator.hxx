@@ -24,23 +24,55 @@
 
 #include <stddef.h>
 
+/**
+ * Determines when the pages of a huge allocation are backed by
+ * physical memory.
+ */
+enum class HugePolicy {
+	/**
+	 * Pages are faulted in on first access, and may be discarded
+	 * with HugeDiscard().
+	 */
+	LAZY,
+
+	/**
+	 * All pages are faulted in by HugeAllocate().
+	 */
+	PREFAULT,
+
+	/**
+	 * Like #PREFAULT, but additionally lock the pages into RAM
+	 * with mlock(), so they can never be swapped out.
+	 */
+	LOCK,
+
+	/**
+	 * Like #LOCK, but require explicit huge pages (MAP_HUGETLB).
+	 * The allocation fails if the kernel has no huge pages left.
+	 */
+	HUGETLB,
+};
+
 #ifdef __linux__
 
 /**
  * Allocate a huge amount of memory.  This will be done in a way that
  * allows giving the memory back to the kernel as soon as we don't
  * need it anymore.  On the downside, this call is expensive.
+ *
+ * @return the allocation or nullptr on error (with errno set)
  */
 gcc_malloc
 void *
-HugeAllocate(size_t size);
+HugeAllocate(size_t size, HugePolicy policy=HugePolicy::LAZY);
 
 /**
  * @param p an allocation returned by HugeAllocate()
  * @param size the allocation's size as passed to HugeAllocate()
+ * @param policy the policy which was passed to HugeAllocate()
  */
 void
-HugeFree(void *p, size_t size);
+HugeFree(void *p, size_t size, HugePolicy policy=HugePolicy::LAZY);
 
 /**
  * Discard any data stored in the allocation and give the memory back
@@ -61,13 +93,13 @@ HugeDiscard(void *p, size_t size);
 
 gcc_malloc
 static inline void *
-HugeAllocate(size_t size)
+HugeAllocate(size_t size, HugePolicy=HugePolicy::LAZY)
 {
 	return malloc(size);
 }
 
 static inline void
-HugeFree(void *p, size_t)
+HugeFree(void *p, size_t, HugePolicy=HugePolicy::LAZY)
 {
 	free(p);
 }
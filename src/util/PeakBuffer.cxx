@@ -45,6 +45,22 @@ PeakBuffer::IsEmpty() const
 		 fifo_buffer_is_empty(peak_buffer));
 }
 
+size_t
+PeakBuffer::GetSize() const
+{
+	size_t size = 0, length;
+
+	if (normal_buffer != nullptr &&
+	    fifo_buffer_read(normal_buffer, &length) != nullptr)
+		size += length;
+
+	if (peak_buffer != nullptr &&
+	    fifo_buffer_read(peak_buffer, &length) != nullptr)
+		size += length;
+
+	return size;
+}
+
 const void *
 PeakBuffer::Read(size_t *length_r) const
 {
@@ -63,12 +79,39 @@ PeakBuffer::Read(size_t *length_r) const
 	return nullptr;
 }
 
+unsigned
+PeakBuffer::Read(const void *data_r[2], size_t length_r[2]) const
+{
+	unsigned n = 0;
+
+	if (normal_buffer != nullptr) {
+		data_r[n] = fifo_buffer_read(normal_buffer, &length_r[n]);
+		if (data_r[n] != nullptr)
+			++n;
+	}
+
+	if (peak_buffer != nullptr) {
+		data_r[n] = fifo_buffer_read(peak_buffer, &length_r[n]);
+		if (data_r[n] != nullptr)
+			++n;
+	}
+
+	return n;
+}
+
 void
 PeakBuffer::Consume(size_t length)
 {
-	if (normal_buffer != nullptr && !fifo_buffer_is_empty(normal_buffer)) {
-		fifo_buffer_consume(normal_buffer, length);
-		return;
+	size_t available;
+	if (normal_buffer != nullptr &&
+	    fifo_buffer_read(normal_buffer, &available) != nullptr) {
+		if (length <= available) {
+			fifo_buffer_consume(normal_buffer, length);
+			return;
+		}
+
+		fifo_buffer_consume(normal_buffer, available);
+		length -= available;
 	}
 
 	if (peak_buffer != nullptr && !fifo_buffer_is_empty(peak_buffer)) {
@@ -142,3 +185,28 @@ PeakBuffer::Append(const void *data, size_t length)
 	nbytes = AppendTo(peak_buffer, data, length);
 	return nbytes == length;
 }
+
+void *
+PeakBuffer::Write(size_t *max_length_r)
+{
+	if (peak_buffer != nullptr && !fifo_buffer_is_empty(peak_buffer))
+		return fifo_buffer_write(peak_buffer, max_length_r);
+
+	if (normal_buffer == nullptr)
+		normal_buffer = fifo_buffer_new(normal_size);
+
+	return fifo_buffer_write(normal_buffer, max_length_r);
+}
+
+void
+PeakBuffer::Append(size_t length)
+{
+	if (length == 0)
+		return;
+
+	/* same buffer selection as in Write() */
+	if (peak_buffer != nullptr && !fifo_buffer_is_empty(peak_buffer))
+		fifo_buffer_append(peak_buffer, length);
+	else
+		fifo_buffer_append(normal_buffer, length);
+}
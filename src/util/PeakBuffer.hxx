@@ -57,10 +57,43 @@ public:
 	gcc_pure
 	bool IsEmpty() const;
 
+	/**
+	 * Returns the number of bytes in both buffers.
+	 */
+	gcc_pure
+	size_t GetSize() const;
+
 	const void *Read(size_t *length_r) const;
+
+	/**
+	 * Like Read(), but returns the data of both buffers (in the
+	 * order they were appended), e.g. for writev().
+	 *
+	 * @return the number of areas (0 to 2)
+	 */
+	unsigned Read(const void *data_r[2], size_t length_r[2]) const;
+
+	/**
+	 * Mark data as consumed; it may span both buffers.
+	 */
 	void Consume(size_t length);
 
 	bool Append(const void *data, size_t length);
+
+	/**
+	 * Prepare writing directly into the buffer.  This never
+	 * allocates the peak buffer; if the normal buffer is full,
+	 * the caller should fall back to Append(const void *, size_t).
+	 *
+	 * @return a writable area, or nullptr if there is no room
+	 */
+	void *Write(size_t *max_length_r);
+
+	/**
+	 * Commit data which was written into the area returned by
+	 * Write().
+	 */
+	void Append(size_t length);
 };
 
 #endif
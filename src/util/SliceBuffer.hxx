@@ -23,20 +23,31 @@
 #include "HugeAllocator.hxx"
 #include "Compiler.h"
 
+#include <atomic>
 #include <utility>
 #include <new>
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * This class pre-allocates a certain number of objects, and allows
  * callers to allocate and free these objects ("slices").
+ *
+ * Allocate() and Free() are lock-free and may be called from any
+ * number of threads.  The free list is a stack of slice indices
+ * whose head is tagged with a counter, which is incremented by each
+ * allocation to rule out the ABA problem.
  */
 template<typename T>
 class SliceBuffer {
 	union Slice {
-		Slice *next;
+		/**
+		 * The index of the next free slice plus one; 0 marks
+		 * the end of the list.
+		 */
+		std::atomic_uint next;
 
 		T value;
 	};
@@ -51,29 +62,39 @@ class SliceBuffer {
 	 * avoid page faulting on the new allocation, so the kernel
 	 * does not need to reserve physical memory pages.
 	 */
-	unsigned n_initialized;
+	std::atomic_uint n_initialized;
 
 	/**
 	 * The number of slices currently allocated.
 	 */
-	unsigned n_allocated;
+	std::atomic_uint n_allocated;
+
+	/**
+	 * How the memory for #data was allocated.
+	 */
+	const HugePolicy policy;
 
 	Slice *const data;
 
 	/**
-	 * Pointer to the first free element in the chain.
+	 * The head of the "available" list: the lower 32 bits are
+	 * the index of the first free slice plus one (0 if the list
+	 * is empty), the upper 32 bits are the tag.
 	 */
-	Slice *available;
+	std::atomic<uint64_t> available;
 
 	size_t CalcAllocationSize() const {
 		return n_max * sizeof(Slice);
 	}
 
+	static constexpr uint64_t INDEX_MASK = 0xffffffff;
+
 public:
-	SliceBuffer(unsigned _count)
+	SliceBuffer(unsigned _count, HugePolicy _policy=HugePolicy::LAZY)
 		:n_max(_count), n_initialized(0), n_allocated(0),
-		 data((Slice *)HugeAllocate(CalcAllocationSize())),
-		 available(nullptr) {
+		 policy(_policy),
+		 data((Slice *)HugeAllocate(CalcAllocationSize(), policy)),
+		 available(0) {
 		assert(n_max > 0);
 	}
 
@@ -82,7 +103,7 @@ public:
 		   assertion checks for leaks */
 		assert(n_allocated == 0);
 
-		HugeFree(data, CalcAllocationSize());
+		HugeFree(data, CalcAllocationSize(), policy);
 	}
 
 	SliceBuffer(const SliceBuffer &other) = delete;
@@ -100,42 +121,60 @@ public:
 	}
 
 	bool IsEmpty() const {
-		return n_allocated == 0;
+		return n_allocated.load(std::memory_order_relaxed) == 0;
 	}
 
 	bool IsFull() const {
-		return n_allocated == n_max;
+		return n_allocated.load(std::memory_order_relaxed) == n_max;
 	}
 
-	template<typename... Args>
-	T *Allocate(Args&&... args) {
-		assert(n_initialized <= n_max);
-		assert(n_allocated <= n_initialized);
+	/**
+	 * Returns the number of slices currently allocated.  This is
+	 * only a snapshot when other threads allocate concurrently.
+	 */
+	unsigned GetAllocated() const {
+		return n_allocated.load(std::memory_order_relaxed);
+	}
 
-		if (available == nullptr) {
-			if (n_initialized == n_max) {
-				/* out of (internal) memory, buffer is full */
-				assert(n_allocated == n_max);
-				return nullptr;
-			}
+	/**
+	 * Returns the position of the given slice (0 to capacity-1),
+	 * which allows callers to associate external per-slice
+	 * resources.
+	 */
+	gcc_pure
+	unsigned GetIndex(const T *value) const {
+		const Slice *slice = reinterpret_cast<const Slice *>(value);
+		assert(slice >= data && slice < data + n_max);
+
+		return slice - data;
+	}
 
-			available = &data[n_initialized++];
-			available->next = nullptr;
+	template<typename... Args>
+	T *Allocate(Args&&... args) {
+		Slice *slice = Pop();
+		if (slice == nullptr) {
+			/* the "available" list is empty: use a slice
+			   which has never been used before */
+			unsigned n = n_initialized.load(std::memory_order_relaxed);
+			do {
+				if (n == n_max)
+					/* out of (internal) memory,
+					   buffer is full */
+					return nullptr;
+			} while (!n_initialized.compare_exchange_weak(n, n + 1,
+								      std::memory_order_relaxed));
+
+			slice = &data[n];
 		}
 
-		/* allocate a slice */
-		T *value = &available->value;
-		available = available->next;
-		++n_allocated;
+		n_allocated.fetch_add(1, std::memory_order_relaxed);
 
 		/* construct the object */
-		return ::new((void *)value) T(std::forward<Args>(args)...);
+		return ::new((void *)&slice->value) T(std::forward<Args>(args)...);
 	}
 
 	void Free(T *value) {
-		assert(n_initialized <= n_max);
 		assert(n_allocated > 0);
-		assert(n_allocated <= n_initialized);
 
 		Slice *slice = reinterpret_cast<Slice *>(value);
 		assert(slice >= data && slice < data + n_max);
@@ -144,16 +183,44 @@ public:
 		value->~T();
 
 		/* insert the slice in the "available" linked list */
-		slice->next = available;
-		available = slice;
-		--n_allocated;
-
-		/* give memory back to the kernel when the last slice
-		   was freed */
-		if (n_allocated == 0) {
-			HugeDiscard(data, CalcAllocationSize());
-			n_initialized = 0;
-			available = nullptr;
+		const unsigned index = slice - data + 1;
+		uint64_t head = available.load(std::memory_order_relaxed);
+		do {
+			slice->next.store(unsigned(head & INDEX_MASK),
+					  std::memory_order_relaxed);
+		} while (!available.compare_exchange_weak(head,
+							  (head & ~INDEX_MASK) | index,
+							  std::memory_order_release,
+							  std::memory_order_relaxed));
+
+		n_allocated.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+private:
+	/**
+	 * Remove the first slice from the "available" list.
+	 *
+	 * @return the slice or nullptr if the list is empty
+	 */
+	Slice *Pop() {
+		uint64_t head = available.load(std::memory_order_acquire);
+		while (true) {
+			const unsigned index = unsigned(head & INDEX_MASK);
+			if (index == 0)
+				return nullptr;
+
+			Slice *slice = &data[index - 1];
+
+			/* if another thread has popped this slice in
+			   the meantime, "next" may be garbage, but
+			   then the tag has changed and the CAS
+			   fails */
+			const uint64_t new_head =
+				(((head >> 32) + 1) << 32) |
+				slice->next.load(std::memory_order_relaxed);
+			if (available.compare_exchange_weak(head, new_head,
+							    std::memory_order_acquire))
+				return slice;
 		}
 	}
 };
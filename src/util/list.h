@@ -401,6 +401,15 @@ static inline void list_splice_tail_init(struct list_head *list,
 #define list_entry(ptr, type, member) \
 	container_of(ptr, type, member)
 
+/**
+ * list_entry_const - get the const struct for this const entry
+ * @ptr:	the const &struct list_head pointer.
+ * @type:	the type of the struct this is embedded in.
+ * @member:	the name of the list_struct within the struct.
+ */
+#define list_entry_const(ptr, type, member) \
+	((const type *)((const uint8_t *)(ptr) - offsetof(type, member)))
+
 /**
  * list_first_entry - get the first element from a list
  * @ptr:	the list head to take the element from.
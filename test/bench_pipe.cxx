@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/*
+ * This program measures the throughput and latency of the
+ * #MusicBuffer / #MusicPipe hot path: one "decoder" thread allocates
+ * chunks and pushes them into a pipe, the "player" (main) thread moves
+ * them to the output pipe and returns consumed chunks, and 1 to 8
+ * "output" threads walk the output pipe like OutputThread.cxx does.
+ *
+ * Usage: bench_pipe [NUM_CHUNKS [NUM_OUTPUTS]]
+ */
+
+#include "config.h"
+#include "MusicBuffer.hxx"
+#include "MusicPipe.hxx"
+#include "MusicChunk.hxx"
+#include "thread/Thread.hxx"
+#include "system/Clock.hxx"
+#include "util/Error.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr unsigned MAX_OUTPUTS = 8;
+static constexpr unsigned BUFFER_CHUNKS = 1024;
+
+struct BenchOutput {
+	Thread thread;
+
+	struct BenchContext *ctx;
+
+	/**
+	 * The number of chunks this output has finished.  It keeps a
+	 * reference to the last one, because it needs its "next"
+	 * attribute.
+	 */
+	std::atomic_ulong consumed;
+
+	/**
+	 * The time between MusicPipe::Push() in the decoder thread
+	 * and the consumption of each chunk, in microseconds.
+	 */
+	std::vector<uint64_t> latencies;
+};
+
+struct BenchContext {
+	MusicBuffer buffer;
+	MusicPipe decoder_pipe, output_pipe;
+
+	unsigned long n_chunks;
+	unsigned n_outputs;
+
+	Thread decoder_thread;
+	BenchOutput outputs[MAX_OUTPUTS];
+
+	BenchContext(unsigned long _n_chunks, unsigned _n_outputs)
+		:buffer(BUFFER_CHUNKS),
+		 n_chunks(_n_chunks), n_outputs(_n_outputs) {}
+};
+
+static void
+decoder_func(void *_ctx)
+{
+	BenchContext &ctx = *(BenchContext *)_ctx;
+
+	for (unsigned long i = 0; i < ctx.n_chunks; ++i) {
+		music_chunk *chunk;
+		while ((chunk = ctx.buffer.Allocate()) == nullptr)
+			/* the buffer is full; wait for the outputs */
+			sched_yield();
+
+#ifndef NDEBUG
+		chunk->audio_format = AudioFormat(44100, SampleFormat::S16, 2);
+#endif
+		chunk->length = chunk->capacity;
+
+		const uint64_t now = MonotonicClockUS();
+		memcpy(chunk->data, &now, sizeof(now));
+
+		ctx.decoder_pipe.Push(chunk);
+	}
+}
+
+static void
+output_func(void *_output)
+{
+	BenchOutput &output = *(BenchOutput *)_output;
+	const BenchContext &ctx = *output.ctx;
+
+	const music_chunk *chunk = nullptr;
+	for (unsigned long i = 0; i < ctx.n_chunks;) {
+		const music_chunk *next = chunk != nullptr
+			? chunk->next
+			: ctx.output_pipe.Peek();
+		if (next == nullptr) {
+			sched_yield();
+			continue;
+		}
+
+		uint64_t pushed;
+		memcpy(&pushed, next->data, sizeof(pushed));
+		output.latencies[i] = MonotonicClockUS() - pushed;
+
+		chunk = next;
+		output.consumed.store(++i, std::memory_order_release);
+	}
+}
+
+/**
+ * The "player" loop: move chunks from the decoder pipe to the output
+ * pipe, and return chunks which were consumed by all outputs.
+ */
+static void
+player_loop(BenchContext &ctx)
+{
+	unsigned long shifted = 0;
+
+	while (true) {
+		bool busy = false;
+
+		music_chunk *chunk;
+		while ((chunk = ctx.decoder_pipe.Shift()) != nullptr) {
+			ctx.output_pipe.Push(chunk);
+			busy = true;
+		}
+
+		unsigned long min_consumed = ctx.n_chunks;
+		for (unsigned i = 0; i < ctx.n_outputs; ++i)
+			min_consumed = std::min(min_consumed,
+						ctx.outputs[i].consumed.load(std::memory_order_acquire));
+
+		if (min_consumed == ctx.n_chunks)
+			break;
+
+		/* all outputs still hold a reference to the last
+		   chunk they consumed */
+		while (shifted + 1 < min_consumed) {
+			ctx.buffer.Return(ctx.output_pipe.Shift());
+			++shifted;
+			busy = true;
+		}
+
+		if (!busy)
+			sched_yield();
+	}
+
+	ctx.output_pipe.Clear(ctx.buffer);
+}
+
+static uint64_t
+percentile(const std::vector<uint64_t> &sorted, double p)
+{
+	return sorted[std::min(sorted.size() - 1,
+			       size_t(p * sorted.size()))];
+}
+
+static void
+start_thread(Thread &thread, void (*f)(void *ctx), void *ctx)
+{
+	Error error;
+	if (!thread.Start(f, ctx, nullptr, error)) {
+		fprintf(stderr, "%s\n", error.GetMessage());
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void
+run(unsigned long n_chunks, unsigned n_outputs)
+{
+	BenchContext ctx(n_chunks, n_outputs);
+
+	for (unsigned i = 0; i < n_outputs; ++i) {
+		BenchOutput &output = ctx.outputs[i];
+		output.ctx = &ctx;
+		output.consumed = 0;
+		output.latencies.resize(n_chunks);
+	}
+
+	const uint64_t start = MonotonicClockUS();
+
+	for (unsigned i = 0; i < n_outputs; ++i)
+		start_thread(ctx.outputs[i].thread, output_func,
+			     &ctx.outputs[i]);
+
+	start_thread(ctx.decoder_thread, decoder_func, &ctx);
+
+	player_loop(ctx);
+
+	ctx.decoder_thread.Join();
+	for (unsigned i = 0; i < n_outputs; ++i)
+		ctx.outputs[i].thread.Join();
+
+	const uint64_t duration = std::max<uint64_t>(MonotonicClockUS() - start, 1);
+
+	std::vector<uint64_t> latencies;
+	latencies.reserve(n_chunks * n_outputs);
+	for (unsigned i = 0; i < n_outputs; ++i)
+		latencies.insert(latencies.end(),
+				 ctx.outputs[i].latencies.begin(),
+				 ctx.outputs[i].latencies.end());
+	std::sort(latencies.begin(), latencies.end());
+
+	printf("outputs=%u chunks/s=%.0f latency_us p50=%llu p99=%llu p99.9=%llu max=%llu\n",
+	       n_outputs, n_chunks * 1000000. / duration,
+	       (unsigned long long)percentile(latencies, 0.5),
+	       (unsigned long long)percentile(latencies, 0.99),
+	       (unsigned long long)percentile(latencies, 0.999),
+	       (unsigned long long)latencies.back());
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc > 3) {
+		fprintf(stderr, "Usage: bench_pipe [NUM_CHUNKS [NUM_OUTPUTS]]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned long n_chunks = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 1000000;
+	if (n_chunks == 0) {
+		fprintf(stderr, "Invalid number of chunks\n");
+		return EXIT_FAILURE;
+	}
+
+	if (argc > 2) {
+		const unsigned n_outputs = strtoul(argv[2], nullptr, 10);
+		if (n_outputs < 1 || n_outputs > MAX_OUTPUTS) {
+			fprintf(stderr, "Invalid number of outputs\n");
+			return EXIT_FAILURE;
+		}
+
+		run(n_chunks, n_outputs);
+		return EXIT_SUCCESS;
+	}
+
+	for (unsigned n_outputs = 1; n_outputs <= MAX_OUTPUTS; ++n_outputs)
+		run(n_chunks, n_outputs);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the speed and the quality of the built-in
+ * #PcmSincResampler, and compares it with libsamplerate (if
+ * available).  The input is a stereo sine wave; the quality is the
+ * signal to noise ratio of the output after fitting the ideal sine
+ * wave to it (least squares), so the filter delay does not matter.
+ *
+ * Usage: bench_resample [SRC_RATE DEST_RATE [FREQUENCY]]
+ */
+
+#include "config.h"
+#include "pcm/PcmResampleSinc.hxx"
+#include "system/Clock.hxx"
+
+#ifdef HAVE_LIBSAMPLERATE
+#include <samplerate.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static constexpr unsigned CHANNELS = 2;
+static constexpr unsigned SECONDS = 20;
+
+/**
+ * The number of frames passed to the resampler at a time; roughly
+ * one #music_chunk.
+ */
+static constexpr unsigned PIECE = 1024;
+
+static unsigned src_rate = 44100, dest_rate = 48000;
+static double frequency = 1000;
+
+/**
+ * Returns the signal to noise ratio (in dB) of the first channel of
+ * the given interleaved output.
+ */
+static double
+measure_snr(const std::vector<float> &dest)
+{
+	const size_t n_frames = dest.size() / CHANNELS;
+	const size_t skip = dest_rate / 10;
+	const double w = 2 * M_PI * frequency / dest_rate;
+
+	/* fit a*sin(wt)+b*cos(wt) */
+	double ss = 0, sc = 0, cc = 0, ys = 0, yc = 0;
+	for (size_t i = skip; i < n_frames - skip; ++i) {
+		const double s = sin(w * i), c = cos(w * i);
+		const double y = dest[i * CHANNELS];
+		ss += s * s;
+		sc += s * c;
+		cc += c * c;
+		ys += y * s;
+		yc += y * c;
+	}
+
+	const double det = ss * cc - sc * sc;
+	const double a = (ys * cc - yc * sc) / det;
+	const double b = (yc * ss - ys * sc) / det;
+
+	double signal = 0, noise = 0;
+	for (size_t i = skip; i < n_frames - skip; ++i) {
+		const double expected = a * sin(w * i) + b * cos(w * i);
+		const double error = dest[i * CHANNELS] - expected;
+		signal += expected * expected;
+		noise += error * error;
+	}
+
+	return 10 * log10(signal / noise);
+}
+
+static void
+report(const char *name, const std::vector<float> &dest, uint64_t duration)
+{
+	printf("%-24s realtime=%7.0fx snr=%6.1f dB\n", name,
+	       SECONDS * 1000000. / std::max<uint64_t>(duration, 1),
+	       measure_snr(dest));
+}
+
+static void
+run_sinc(const std::vector<float> &src, PcmSincResampler::Quality quality,
+	 const char *name)
+{
+	PcmSincResampler resampler;
+	resampler.SetQuality(quality);
+
+	std::vector<float> dest;
+	dest.reserve(size_t(SECONDS + 1) * dest_rate * CHANNELS);
+
+	const uint64_t start = MonotonicClockUS();
+
+	for (size_t i = 0; i < src.size(); i += PIECE * CHANNELS) {
+		size_t size;
+		const float *p =
+			resampler.ResampleFloat(CHANNELS, src_rate, &src[i],
+						PIECE * CHANNELS * sizeof(float),
+						dest_rate, &size);
+		dest.insert(dest.end(), p, p + size / sizeof(float));
+	}
+
+	report(name, dest, MonotonicClockUS() - start);
+}
+
+static void
+run_sinc16(const std::vector<float> &src, PcmSincResampler::Quality quality,
+	   const char *name)
+{
+	std::vector<int16_t> src16(src.size());
+	for (size_t i = 0; i < src.size(); ++i)
+		src16[i] = lrint(src[i] * 32767);
+
+	PcmSincResampler resampler;
+	resampler.SetQuality(quality);
+
+	std::vector<float> dest;
+	dest.reserve(size_t(SECONDS + 1) * dest_rate * CHANNELS);
+
+	const uint64_t start = MonotonicClockUS();
+
+	for (size_t i = 0; i < src16.size(); i += PIECE * CHANNELS) {
+		size_t size;
+		const int16_t *p =
+			resampler.Resample16(CHANNELS, src_rate, &src16[i],
+					     PIECE * CHANNELS * sizeof(int16_t),
+					     dest_rate, &size);
+		for (size_t j = 0; j < size / sizeof(int16_t); ++j)
+			dest.push_back(p[j] / 32767.);
+	}
+
+	report(name, dest, MonotonicClockUS() - start);
+}
+
+#ifdef HAVE_LIBSAMPLERATE
+
+static void
+run_lsr(const std::vector<float> &src, int converter)
+{
+	int error;
+	SRC_STATE *state = src_new(converter, CHANNELS, &error);
+	if (state == nullptr) {
+		fprintf(stderr, "libsamplerate: %s\n", src_strerror(error));
+		exit(EXIT_FAILURE);
+	}
+
+	std::vector<float> dest;
+	dest.reserve(size_t(SECONDS + 1) * dest_rate * CHANNELS);
+
+	const double ratio = double(dest_rate) / src_rate;
+	std::vector<float> out(size_t(PIECE * ratio + 16) * CHANNELS);
+
+	const uint64_t start = MonotonicClockUS();
+
+	for (size_t i = 0; i < src.size(); i += PIECE * CHANNELS) {
+		SRC_DATA data;
+		data.data_in = const_cast<float *>(&src[i]);
+		data.input_frames = PIECE;
+		data.data_out = &out.front();
+		data.output_frames = out.size() / CHANNELS;
+		data.src_ratio = ratio;
+		data.end_of_input = 0;
+
+		error = src_process(state, &data);
+		if (error != 0) {
+			fprintf(stderr, "libsamplerate: %s\n",
+				src_strerror(error));
+			exit(EXIT_FAILURE);
+		}
+
+		dest.insert(dest.end(), out.begin(),
+			    out.begin() + data.output_frames_gen * CHANNELS);
+	}
+
+	const uint64_t duration = MonotonicClockUS() - start;
+	src_delete(state);
+
+	char name[64];
+	snprintf(name, sizeof(name), "lsr %s", src_get_name(converter));
+	report(name, dest, duration);
+}
+
+#endif
+
+int
+main(int argc, char **argv)
+{
+	if (argc != 1 && argc != 3 && argc != 4) {
+		fprintf(stderr,
+			"Usage: bench_resample [SRC_RATE DEST_RATE [FREQUENCY]]\n");
+		return EXIT_FAILURE;
+	}
+
+	if (argc > 1) {
+		src_rate = strtoul(argv[1], nullptr, 10);
+		dest_rate = strtoul(argv[2], nullptr, 10);
+		if (src_rate == 0 || dest_rate == 0) {
+			fprintf(stderr, "Invalid sample rate\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (argc > 3)
+		frequency = strtod(argv[3], nullptr);
+
+	if (frequency <= 0 || frequency >= std::min(src_rate, dest_rate) / 2) {
+		fprintf(stderr, "Invalid frequency\n");
+		return EXIT_FAILURE;
+	}
+
+	const size_t n_frames = size_t(SECONDS) * src_rate / PIECE * PIECE;
+	std::vector<float> src(n_frames * CHANNELS);
+	for (size_t i = 0; i < n_frames; ++i)
+		for (unsigned c = 0; c < CHANNELS; ++c)
+			src[i * CHANNELS + c] =
+				0.5 * sin(2 * M_PI * frequency * i / src_rate);
+
+	printf("%u Hz -> %u Hz, %g Hz sine, %u seconds\n",
+	       src_rate, dest_rate, frequency, SECONDS);
+
+	run_sinc(src, PcmSincResampler::Quality::FAST, "internal-fast");
+	run_sinc(src, PcmSincResampler::Quality::MEDIUM, "internal");
+	run_sinc(src, PcmSincResampler::Quality::BEST, "internal-best");
+	run_sinc16(src, PcmSincResampler::Quality::FAST,
+		   "internal-fast (16 bit)");
+	run_sinc16(src, PcmSincResampler::Quality::MEDIUM,
+		   "internal (16 bit)");
+
+#ifdef HAVE_LIBSAMPLERATE
+	run_lsr(src, SRC_SINC_FASTEST);
+	run_lsr(src, SRC_SINC_MEDIUM_QUALITY);
+	run_lsr(src, SRC_SINC_BEST_QUALITY);
+#endif
+
+	return EXIT_SUCCESS;
+}
@@ -56,6 +56,12 @@ config_get_string(gcc_unused enum ConfigOption option,
 	return default_value;
 }
 
+bool
+config_get_bool(gcc_unused enum ConfigOption option, bool default_value)
+{
+	return default_value;
+}
+
 int main(int argc, char **argv)
 {
 	AudioFormat in_audio_format, out_audio_format;
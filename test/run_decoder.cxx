@@ -151,6 +151,19 @@ decoder_data(gcc_unused Decoder &decoder,
 	return DecoderCommand::NONE;
 }
 
+DecoderCommand
+decoder_data_direct(Decoder &decoder, InputStream *is,
+		    size_t length, uint16_t kbit_rate,
+		    DecoderWriteFunction write, void *ctx)
+{
+	uint8_t *buffer = new uint8_t[length];
+	write(buffer, 0, length, ctx);
+	DecoderCommand cmd = decoder_data(decoder, is, buffer, length,
+					  kbit_rate);
+	delete[] buffer;
+	return cmd;
+}
+
 DecoderCommand
 decoder_tag(gcc_unused Decoder &decoder,
 	    gcc_unused InputStream *is,
@@ -73,7 +73,12 @@ find_named_config_block(ConfigOption option, const char *name)
 }
 
 PlayerControl::PlayerControl(gcc_unused unsigned _buffer_chunks,
-			       gcc_unused unsigned _buffered_before_play) {}
+			     gcc_unused size_t _chunk_size,
+			     gcc_unused HugePolicy _buffer_policy,
+			     gcc_unused unsigned _buffered_before_play,
+			     gcc_unused unsigned _buffer_time,
+			     gcc_unused unsigned _stream_buffer_time,
+			     gcc_unused unsigned _lookahead_chunks) {}
 PlayerControl::~PlayerControl() {}
 
 static struct audio_output *
@@ -69,6 +69,7 @@ class PcmVolumeTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(TestVolume24);
 	CPPUNIT_TEST(TestVolume32);
 	CPPUNIT_TEST(TestVolumeFloat);
+	CPPUNIT_TEST(TestVolumeOddSize);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -77,6 +78,7 @@ public:
 	void TestVolume24();
 	void TestVolume32();
 	void TestVolumeFloat();
+	void TestVolumeOddSize();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(PcmVolumeTest);
@@ -87,6 +89,7 @@ class PcmFormatTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(TestFormat16to24);
 	CPPUNIT_TEST(TestFormat16to32);
 	CPPUNIT_TEST(TestFormatFloat);
+	CPPUNIT_TEST(TestFused);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -94,6 +97,7 @@ public:
 	void TestFormat16to24();
 	void TestFormat16to32();
 	void TestFormatFloat();
+	void TestFused();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(PcmFormatTest);
@@ -104,6 +108,7 @@ class PcmMixTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(TestMix16);
 	CPPUNIT_TEST(TestMix24);
 	CPPUNIT_TEST(TestMix32);
+	CPPUNIT_TEST(TestAddSaturate);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -111,8 +116,45 @@ public:
 	void TestMix16();
 	void TestMix24();
 	void TestMix32();
+	void TestAddSaturate();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(PcmMixTest);
 
+class PcmDsdTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(PcmDsdTest);
+	CPPUNIT_TEST(TestDsdToFloat);
+	CPPUNIT_TEST(TestDecimate);
+	CPPUNIT_TEST(TestNoiseShaping);
+	CPPUNIT_TEST(TestPack);
+	CPPUNIT_TEST(TestPackTo);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestDsdToFloat();
+	void TestDecimate();
+	void TestNoiseShaping();
+	void TestPack();
+	void TestPackTo();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PcmDsdTest);
+
+class PcmResampleTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(PcmResampleTest);
+	CPPUNIT_TEST(TestFrameCount);
+	CPPUNIT_TEST(TestDC);
+	CPPUNIT_TEST(TestSine);
+	CPPUNIT_TEST(TestChannels);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestFrameCount();
+	void TestDC();
+	void TestSine();
+	void TestChannels();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PcmResampleTest);
+
 #endif
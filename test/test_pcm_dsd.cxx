@@ -0,0 +1,358 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "test_pcm_all.hxx"
+#include "test_pcm_util.hxx"
+#include "pcm/PcmDsd.hxx"
+#include "pcm/PcmDsdDecimate.hxx"
+#include "pcm/PcmDsdPack.hxx"
+#include "system/ByteOrder.hxx"
+#include "pcm/dsd2pcm/dsd2pcm.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <math.h>
+#include <string.h>
+
+static void
+TestDsdChannels(unsigned channels, bool lsbfirst)
+{
+	constexpr unsigned N = 2048;
+	const auto src = TestDataBuffer<uint8_t, N * 8>();
+	const unsigned n_frames = N * 8 / channels;
+
+	/* reference: the scalar per-channel dsd2pcm path */
+	float expected[N * 8];
+	dsd2pcm_ctx *ctx[8];
+	for (unsigned c = 0; c < channels; ++c)
+		ctx[c] = dsd2pcm_init();
+
+	/* translate in uneven pieces to verify the FIFO state is
+	   carried over between calls */
+	constexpr unsigned piece = 333;
+	for (unsigned i = 0; i < n_frames; i += piece) {
+		const unsigned n = std::min(piece, n_frames - i);
+		for (unsigned c = 0; c < channels; ++c)
+			dsd2pcm_translate(ctx[c], n,
+					  src + i * channels + c, channels,
+					  lsbfirst,
+					  expected + i * channels + c, channels);
+	}
+
+	for (unsigned c = 0; c < channels; ++c)
+		dsd2pcm_destroy(ctx[c]);
+
+	PcmDsd dsd;
+	for (unsigned i = 0; i < n_frames; i += piece) {
+		const unsigned n = std::min(piece, n_frames - i);
+		size_t dest_size;
+		const float *dest = dsd.ToFloat(channels, lsbfirst,
+						src + i * channels,
+						n * channels, &dest_size);
+		CPPUNIT_ASSERT(dest != nullptr);
+		CPPUNIT_ASSERT_EQUAL(n * channels * sizeof(float), dest_size);
+		CPPUNIT_ASSERT(memcmp(dest, expected + i * channels,
+				      dest_size) == 0);
+	}
+}
+
+void
+PcmDsdTest::TestDsdToFloat()
+{
+	for (unsigned channels = 1; channels <= 8; ++channels) {
+		TestDsdChannels(channels, false);
+		TestDsdChannels(channels, true);
+	}
+}
+
+/**
+ * Decimate a sine wave of the given frequency from 352.8 kHz to
+ * 88.2 kHz and return the peak amplitude of the output (after the
+ * filters have settled).
+ */
+static float
+DecimateSine(PcmDsdDecimator &decimator, unsigned channels, double frequency)
+{
+	constexpr unsigned src_rate = 352800, dest_rate = 88200;
+	constexpr unsigned n_frames = 16384;
+
+	float src[n_frames * 2];
+	for (unsigned i = 0; i < n_frames; ++i)
+		for (unsigned c = 0; c < channels; ++c)
+			src[i * channels + c] =
+				0.5 * sin(2 * M_PI * frequency * i / src_rate);
+
+	decimator.Reset();
+
+	float peak = 0;
+	unsigned n_out = 0;
+
+	/* feed odd-sized pieces to verify that the stage phases are
+	   carried over */
+	constexpr unsigned piece = 1001;
+	for (unsigned i = 0; i < n_frames; i += piece) {
+		const unsigned n = std::min(piece, n_frames - i);
+		size_t dest_size;
+		const float *dest =
+			decimator.Decimate(channels, src_rate, dest_rate,
+					   src + i * channels,
+					   n * channels * sizeof(*src),
+					   &dest_size);
+		const unsigned n_samples = dest_size / sizeof(*dest);
+		for (unsigned j = 0; j < n_samples; ++j, ++n_out)
+			if (n_out >= 256 * channels)
+				peak = std::max(peak, std::abs(dest[j]));
+	}
+
+	CPPUNIT_ASSERT_EQUAL(n_frames / 4 * channels, n_out);
+	return peak;
+}
+
+void
+PcmDsdTest::TestDecimate()
+{
+	CPPUNIT_ASSERT(PcmDsdDecimator::CanDecimate(352800, 88200));
+	CPPUNIT_ASSERT(PcmDsdDecimator::CanDecimate(1411200, 176400));
+	CPPUNIT_ASSERT(!PcmDsdDecimator::CanDecimate(352800, 48000));
+	CPPUNIT_ASSERT(!PcmDsdDecimator::CanDecimate(352800, 352800));
+
+	PcmDsdDecimator decimator;
+
+	for (unsigned channels = 1; channels <= 2; ++channels) {
+		/* pass band */
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5,
+					     DecimateSine(decimator, channels,
+							  1000),
+					     0.005);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5,
+					     DecimateSine(decimator, channels,
+							  20000),
+					     0.005);
+
+		/* stop band */
+		CPPUNIT_ASSERT(DecimateSine(decimator, channels, 60000) < 0.001);
+		CPPUNIT_ASSERT(DecimateSine(decimator, channels, 150000) < 0.001);
+	}
+}
+
+void
+PcmDsdTest::TestNoiseShaping()
+{
+	constexpr unsigned N = 16384;
+	float src[N];
+	for (unsigned i = 0; i < N; ++i)
+		src[i] = 0.25 * sin(2 * M_PI * 1000 * i / 352800.);
+
+	PcmDsdDecimator decimator;
+	size_t f_size;
+	const float *f = decimator.Decimate(1, 352800, 88200,
+					    src, sizeof(src), &f_size);
+	CPPUNIT_ASSERT_EQUAL(N / 4 * sizeof(*f), f_size);
+
+	size_t dest_size;
+	const int16_t *dest = (const int16_t *)
+		decimator.ToInteger(SampleFormat::S16, f, f_size, &dest_size);
+	CPPUNIT_ASSERT(dest != nullptr);
+	CPPUNIT_ASSERT_EQUAL(N / 4 * sizeof(*dest), dest_size);
+
+	/* the shaped quantization error is bounded, even though it
+	   is larger than plain rounding */
+	for (unsigned i = 0; i < N / 4; ++i)
+		CPPUNIT_ASSERT(std::abs(dest[i] - f[i] * 32768) < 16);
+}
+
+/**
+ * A straightforward implementation of the packed formats, which
+ * PcmDsdPacker must reproduce bit by bit.
+ */
+static std::vector<uint8_t>
+ReferencePack(PcmDsdPacker::Type type, unsigned channels,
+	      const uint8_t *src, size_t n_frames)
+{
+	std::vector<uint8_t> dest;
+
+	switch (type) {
+	case PcmDsdPacker::Type::DOP:
+		for (size_t i = 0; i + 2 <= n_frames; i += 2) {
+			const uint32_t marker = (i / 2) % 2 == 0
+				? 0xff050000 : 0xfffa0000;
+			for (unsigned c = 0; c < channels; ++c) {
+				const uint32_t x = marker |
+					(src[i * channels + c] << 8) |
+					src[(i + 1) * channels + c];
+				const uint8_t *p = (const uint8_t *)&x;
+				dest.insert(dest.end(), p, p + 4);
+			}
+		}
+		break;
+
+	case PcmDsdPacker::Type::U16_LE:
+	case PcmDsdPacker::Type::U16_BE:
+	case PcmDsdPacker::Type::U32_LE:
+	case PcmDsdPacker::Type::U32_BE: {
+		const bool u32 = type == PcmDsdPacker::Type::U32_LE ||
+			type == PcmDsdPacker::Type::U32_BE;
+		const bool big_endian = type == PcmDsdPacker::Type::U16_BE ||
+			type == PcmDsdPacker::Type::U32_BE;
+		const unsigned frames = u32 ? 4 : 2;
+
+		for (size_t i = 0; i + frames <= n_frames; i += frames) {
+			for (unsigned c = 0; c < channels; ++c) {
+				/* big endian: the oldest byte first */
+				for (unsigned k = 0; k < frames; ++k) {
+					const unsigned f = big_endian
+						? k : frames - 1 - k;
+					dest.push_back(src[(i + f) * channels + c]);
+				}
+			}
+		}
+		break;
+	}
+	}
+
+	return dest;
+}
+
+static void
+TestPackChannels(PcmDsdPacker::Type type, unsigned channels)
+{
+	constexpr size_t N = 1001;
+	std::vector<uint8_t> src(N * channels);
+	RandomInt<uint8_t> r;
+	std::generate(src.begin(), src.end(), r);
+
+	const std::vector<uint8_t> expected =
+		ReferencePack(type, channels, &src.front(), N);
+
+	PcmDsdPacker packer;
+	packer.Open(type, channels);
+	CPPUNIT_ASSERT(packer.GetFrameSize() > 0);
+
+	/* feed odd chunk sizes; the packer must carry the remaining
+	   frames over to the next call */
+	std::vector<uint8_t> result;
+	size_t position = 0, chunk = 1;
+	while (position < N) {
+		const size_t n = std::min(chunk, N - position);
+
+		size_t dest_size;
+		const uint8_t *dest = (const uint8_t *)
+			packer.Pack(&src[position * channels], n * channels,
+				    &dest_size);
+		CPPUNIT_ASSERT_EQUAL(size_t(0),
+				     dest_size % packer.GetFrameSize());
+		result.insert(result.end(), dest, dest + dest_size);
+
+		/* the device accepts only one frame of the result;
+		   submit the rest again */
+		size_t consumed = dest_size;
+		if (dest_size > packer.GetFrameSize() && chunk % 3 == 0)
+			consumed = packer.GetFrameSize();
+
+		if (dest_size > 0) {
+			const size_t src_size =
+				packer.CalcSourceSize(consumed);
+			CPPUNIT_ASSERT_EQUAL(size_t(0),
+					     src_size % channels);
+			result.resize(result.size() - dest_size + consumed);
+			position += src_size / channels;
+		} else
+			position += n;
+
+		chunk = chunk * 7 % 61 + 1;
+	}
+
+	CPPUNIT_ASSERT_EQUAL(expected.size(), result.size());
+	CPPUNIT_ASSERT(result == expected);
+}
+
+void
+PcmDsdTest::TestPack()
+{
+	static constexpr PcmDsdPacker::Type types[] = {
+		PcmDsdPacker::Type::DOP,
+		PcmDsdPacker::Type::U16_LE,
+		PcmDsdPacker::Type::U16_BE,
+		PcmDsdPacker::Type::U32_LE,
+		PcmDsdPacker::Type::U32_BE,
+	};
+
+	for (auto type : types)
+		for (unsigned channels = 1; channels <= 8; ++channels)
+			TestPackChannels(type, channels);
+}
+
+static void
+TestPackToChannels(PcmDsdPacker::Type type, unsigned channels)
+{
+	constexpr size_t N = 999;
+	std::vector<uint8_t> src(N * channels);
+	RandomInt<uint8_t> r;
+	std::generate(src.begin(), src.end(), r);
+
+	const std::vector<uint8_t> expected =
+		ReferencePack(type, channels, &src.front(), N);
+
+	PcmDsdPacker packer;
+	packer.Open(type, channels);
+	const size_t frame_size = packer.GetFrameSize();
+
+	/* a small destination buffer (like a memory-mapped ring
+	   buffer close to its end) limits how much is consumed */
+	std::vector<uint8_t> result(expected.size() + frame_size);
+	size_t position = 0, dest_position = 0, n_dest_frames = 1;
+	while (position < N) {
+		const size_t max_dest_size =
+			std::min(n_dest_frames * frame_size,
+				 result.size() - dest_position);
+
+		size_t dest_size;
+		const size_t consumed =
+			packer.PackTo(&result[dest_position], max_dest_size,
+				      &src[position * channels],
+				      std::min<size_t>(N - position, 37) * channels,
+				      &dest_size);
+		CPPUNIT_ASSERT(consumed > 0);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), consumed % channels);
+		CPPUNIT_ASSERT(dest_size <= max_dest_size);
+
+		position += consumed / channels;
+		dest_position += dest_size;
+		n_dest_frames = n_dest_frames % 5 + 1;
+	}
+
+	result.resize(dest_position);
+	CPPUNIT_ASSERT(result == expected);
+}
+
+void
+PcmDsdTest::TestPackTo()
+{
+	static constexpr PcmDsdPacker::Type types[] = {
+		PcmDsdPacker::Type::DOP,
+		PcmDsdPacker::Type::U16_BE,
+		PcmDsdPacker::Type::U32_LE,
+	};
+
+	for (auto type : types)
+		for (unsigned channels = 1; channels <= 8; ++channels)
+			TestPackToChannels(type, channels);
+}
@@ -21,11 +21,15 @@
 #include "test_pcm_all.hxx"
 #include "test_pcm_util.hxx"
 #include "pcm/PcmFormat.hxx"
+#include "pcm/PcmChannels.hxx"
+#include "pcm/PcmFused.hxx"
 #include "pcm/PcmDither.hxx"
 #include "pcm/PcmUtils.hxx"
 #include "pcm/PcmBuffer.hxx"
 #include "AudioFormat.hxx"
 
+#include <string.h>
+
 void
 PcmFormatTest::TestFormat8to16()
 {
@@ -112,3 +116,122 @@ PcmFormatTest::TestFormatFloat()
 	for (size_t i = 0; i < N; ++i)
 		CPPUNIT_ASSERT_EQUAL(src[i], d[i]);
 }
+
+/**
+ * Converts with the separate format and channel conversion
+ * functions.
+ */
+static const void *
+TestPcmConvertStaged(PcmBuffer &buffer1, PcmBuffer &buffer2,
+		     PcmDither &dither,
+		     SampleFormat src_format, unsigned src_channels,
+		     SampleFormat dest_format, unsigned dest_channels,
+		     const void *src, size_t src_size, size_t *dest_size_r)
+{
+	size_t size;
+	switch (dest_format) {
+	case SampleFormat::S16: {
+		auto p = pcm_convert_to_16(buffer1, dither, src_format,
+					   src, src_size, &size);
+		return pcm_convert_channels_16(buffer2,
+					       dest_channels, src_channels,
+					       p, size, dest_size_r);
+	}
+
+	case SampleFormat::S24_P32: {
+		auto p = pcm_convert_to_24(buffer1, src_format,
+					   src, src_size, &size);
+		return pcm_convert_channels_24(buffer2,
+					       dest_channels, src_channels,
+					       p, size, dest_size_r);
+	}
+
+	case SampleFormat::S32: {
+		auto p = pcm_convert_to_32(buffer1, src_format,
+					   src, src_size, &size);
+		return pcm_convert_channels_32(buffer2,
+					       dest_channels, src_channels,
+					       p, size, dest_size_r);
+	}
+
+	case SampleFormat::FLOAT: {
+		auto p = pcm_convert_to_float(buffer1, src_format,
+					      src, src_size, &size);
+		return pcm_convert_channels_float(buffer2,
+						  dest_channels, src_channels,
+						  p, size, dest_size_r);
+	}
+
+	default:
+		return nullptr;
+	}
+}
+
+void
+PcmFormatTest::TestFused()
+{
+	constexpr unsigned N = 1024;
+	const auto src16 = TestDataBuffer<int16_t, N>();
+	const auto src24 = TestDataBuffer<int32_t, N>(RandomInt24());
+	const auto src32 = TestDataBuffer<int32_t, N>();
+	const auto src_float = TestDataBuffer<float, N>(RandomFloat());
+
+	static constexpr SampleFormat formats[] = {
+		SampleFormat::S16,
+		SampleFormat::S24_P32,
+		SampleFormat::S32,
+		SampleFormat::FLOAT,
+	};
+
+	const void *const sources[] = {
+		src16, src24, src32, src_float,
+	};
+
+	static constexpr unsigned channels[][2] = {
+		{ 1, 2 },
+		{ 2, 1 },
+	};
+
+	for (unsigned s = 0; s < 4; ++s) {
+		for (unsigned d = 0; d < 4; ++d) {
+			if (s == d)
+				continue;
+
+			for (const auto &c : channels) {
+				const SampleFormat src_format = formats[s];
+				const SampleFormat dest_format = formats[d];
+				const size_t src_size =
+					N * sample_format_size(src_format);
+
+				PcmFusedKernel kernel =
+					pcm_fused_kernel(src_format, c[0],
+							 dest_format, c[1]);
+				CPPUNIT_ASSERT(kernel != nullptr);
+
+				PcmBuffer buffer1, buffer2;
+				PcmDither dither1, dither2;
+				size_t expected_size;
+				const void *expected =
+					TestPcmConvertStaged(buffer1, buffer2,
+							     dither1,
+							     src_format, c[0],
+							     dest_format, c[1],
+							     sources[s],
+							     src_size,
+							     &expected_size);
+				CPPUNIT_ASSERT(expected != nullptr);
+
+				uint8_t dest[N * 2 * 4];
+				CPPUNIT_ASSERT(expected_size <= sizeof(dest));
+				kernel(dither2, dest, sources[s], N / c[0]);
+
+				CPPUNIT_ASSERT(memcmp(dest, expected,
+						      expected_size) == 0);
+			}
+		}
+	}
+
+	/* no specialization for surround */
+	CPPUNIT_ASSERT(pcm_fused_kernel(SampleFormat::S16, 6,
+					SampleFormat::FLOAT, 2) == nullptr);
+}
@@ -80,3 +80,42 @@ PcmMixTest::TestMix32()
 {
 	TestPcmMix<int32_t, SampleFormat::S32>();
 }
+
+/**
+ * Mix without cross-fading (MixRamp), which saturates at the limits
+ * of the sample format.
+ */
+template<typename T, SampleFormat format, unsigned bits,
+	 typename G=RandomInt<T>>
+static void
+TestPcmAddSaturate(G g=G())
+{
+	constexpr unsigned N = 259;
+	const auto src1 = TestDataBuffer<T, N>(g);
+	const auto src2 = TestDataBuffer<T, N>(g);
+
+	auto result = src1;
+	bool success = pcm_mix(result.begin(), src2.begin(), sizeof(result),
+			       format, -1);
+	CPPUNIT_ASSERT(success);
+
+	constexpr int64_t max = (int64_t(1) << (bits - 1)) - 1;
+	constexpr int64_t min = -max - 1;
+
+	auto expected = src1;
+	for (unsigned i = 0; i < N; ++i) {
+		int64_t sum = int64_t(src1[i]) + int64_t(src2[i]);
+		expected[i] = sum > max ? max : (sum < min ? min : sum);
+	}
+
+	AssertEqualWithTolerance(result, expected, 0);
+}
+
+void
+PcmMixTest::TestAddSaturate()
+{
+	TestPcmAddSaturate<int8_t, SampleFormat::S8, 8>();
+	TestPcmAddSaturate<int16_t, SampleFormat::S16, 16>();
+	TestPcmAddSaturate<int32_t, SampleFormat::S24_P32, 24>(RandomInt24());
+	TestPcmAddSaturate<int32_t, SampleFormat::S32, 32>();
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2003-2013 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "test_pcm_all.hxx"
+#include "pcm/PcmResampleSinc.hxx"
+
+#include <algorithm>
+#include <vector>
+
+#include <math.h>
+
+/**
+ * Feeds #src to the resampler in pieces of #piece frames and returns
+ * the concatenated output.
+ */
+template<typename T, typename F>
+static std::vector<T>
+TestPcmResampleAll(F f, unsigned channels, const std::vector<T> &src,
+		   unsigned piece)
+{
+	std::vector<T> result;
+	const size_t n_frames = src.size() / channels;
+	for (size_t i = 0; i < n_frames; i += piece) {
+		const size_t n = std::min<size_t>(piece, n_frames - i);
+		size_t dest_size;
+		const T *dest = f(&src[i * channels],
+				  n * channels * sizeof(T), &dest_size);
+		CPPUNIT_ASSERT(dest != nullptr);
+		CPPUNIT_ASSERT_EQUAL(size_t(0),
+				     dest_size % (channels * sizeof(T)));
+		result.insert(result.end(), dest,
+			      dest + dest_size / sizeof(T));
+	}
+
+	return result;
+}
+
+static std::vector<float>
+TestPcmResampleFloat(PcmSincResampler &r, unsigned channels,
+		     unsigned src_rate, const std::vector<float> &src,
+		     unsigned dest_rate, unsigned piece=1000)
+{
+	return TestPcmResampleAll<float>([&](const float *s, size_t size,
+					     size_t *dest_size_r){
+			return r.ResampleFloat(channels, src_rate, s, size,
+					       dest_rate, dest_size_r);
+		}, channels, src, piece);
+}
+
+static std::vector<int16_t>
+TestPcmResample16(PcmSincResampler &r, unsigned channels,
+		  unsigned src_rate, const std::vector<int16_t> &src,
+		  unsigned dest_rate, unsigned piece=1000)
+{
+	return TestPcmResampleAll<int16_t>([&](const int16_t *s, size_t size,
+					       size_t *dest_size_r){
+			return r.Resample16(channels, src_rate, s, size,
+					    dest_rate, dest_size_r);
+		}, channels, src, piece);
+}
+
+/**
+ * Generates a sine wave with an amplitude of 1.
+ */
+static std::vector<float>
+TestPcmSine(unsigned rate, double frequency, size_t n_frames)
+{
+	std::vector<float> result(n_frames);
+	for (size_t i = 0; i < n_frames; ++i)
+		result[i] = sin(2 * M_PI * frequency * i / rate);
+	return result;
+}
+
+/**
+ * Compares the resampler output with the ideal sine wave (shifted by
+ * the filter delay), and returns the signal to noise ratio in dB.
+ * The start and the end are skipped, because the filter is still
+ * settling there.
+ */
+template<typename T>
+static double
+TestPcmSineSNR(const std::vector<T> &dest, double scale, unsigned delay,
+	       unsigned src_rate, unsigned dest_rate, double frequency)
+{
+	double signal = 0, noise = 0;
+	const size_t skip = 4096;
+	CPPUNIT_ASSERT(dest.size() > 2 * skip);
+	for (size_t i = skip; i < dest.size() - skip; ++i) {
+		const double t = double(i) / dest_rate -
+			double(delay) / src_rate;
+		const double expected = sin(2 * M_PI * frequency * t);
+		const double error = dest[i] / scale - expected;
+		signal += expected * expected;
+		noise += error * error;
+	}
+
+	return 10 * log10(signal / noise);
+}
+
+void
+PcmResampleTest::TestFrameCount()
+{
+	static constexpr unsigned rates[][2] = {
+		{ 44100, 48000 },
+		{ 48000, 44100 },
+		{ 44100, 96000 },
+		{ 192000, 44100 },
+		{ 22050, 44100 },
+		{ 8000, 11025 },
+	};
+
+	PcmSincResampler r;
+	for (const auto &i : rates) {
+		const unsigned src_rate = i[0], dest_rate = i[1];
+		const std::vector<float> src(src_rate * 2);
+
+		/* one second, in odd pieces */
+		const auto dest = TestPcmResampleFloat(r, 2, src_rate, src,
+						       dest_rate, 441);
+		CPPUNIT_ASSERT_EQUAL(size_t(dest_rate * 2), dest.size());
+	}
+}
+
+void
+PcmResampleTest::TestDC()
+{
+	for (unsigned q = 0; q < 3; ++q) {
+		PcmSincResampler r;
+		r.SetQuality(PcmSincResampler::Quality(q));
+
+		const std::vector<float> src(44100, 0.5);
+		const auto dest = TestPcmResampleFloat(r, 1, 44100, src, 48000);
+
+		for (size_t i = 2048; i < dest.size(); ++i)
+			CPPUNIT_ASSERT(fabs(dest[i] - 0.5) < 1e-4);
+
+		const std::vector<int16_t> src16(44100, 16384);
+		const auto dest16 = TestPcmResample16(r, 1, 44100, src16,
+						      48000);
+
+		for (size_t i = 2048; i < dest16.size(); ++i)
+			CPPUNIT_ASSERT(abs(dest16[i] - 16384) <= 4);
+	}
+}
+
+void
+PcmResampleTest::TestSine()
+{
+	static constexpr struct {
+		unsigned src_rate, dest_rate;
+		double frequency;
+	} cases[] = {
+		{ 44100, 48000, 1000 },
+		{ 44100, 48000, 15000 },
+		{ 48000, 44100, 997 },
+		{ 44100, 88200, 5000 },
+		{ 96000, 44100, 3000 },
+	};
+
+	static constexpr double min_snr[] = { 50, 70, 90 };
+
+	for (unsigned q = 0; q < 3; ++q) {
+		for (const auto &c : cases) {
+			PcmSincResampler r;
+			r.SetQuality(PcmSincResampler::Quality(q));
+
+			const auto src = TestPcmSine(c.src_rate, c.frequency,
+						     c.src_rate / 2);
+			const auto dest = TestPcmResampleFloat(r, 1,
+							       c.src_rate, src,
+							       c.dest_rate);
+			const double snr =
+				TestPcmSineSNR(dest, 1, r.GetDelay(),
+					       c.src_rate, c.dest_rate,
+					       c.frequency);
+			CPPUNIT_ASSERT(snr > min_snr[q]);
+		}
+	}
+
+	/* 16 bit: limited by the quantization noise */
+	PcmSincResampler r;
+	const auto sine = TestPcmSine(44100, 1000, 22050);
+	std::vector<int16_t> src(sine.size());
+	for (size_t i = 0; i < src.size(); ++i)
+		src[i] = lrint(sine[i] * 16384);
+
+	const auto dest = TestPcmResample16(r, 1, 44100, src, 48000);
+	CPPUNIT_ASSERT(TestPcmSineSNR(dest, 16384, r.GetDelay(),
+				      44100, 48000, 1000) > 70);
+}
+
+void
+PcmResampleTest::TestChannels()
+{
+	constexpr unsigned channels = 6;
+	constexpr size_t n_frames = 10000;
+
+	std::vector<float> src(n_frames * channels);
+	std::vector<std::vector<float>> planar(channels);
+	for (unsigned c = 0; c < channels; ++c) {
+		planar[c] = TestPcmSine(44100, 500 * (c + 1), n_frames);
+		for (size_t i = 0; i < n_frames; ++i)
+			src[i * channels + c] = planar[c][i];
+	}
+
+	PcmSincResampler r;
+	const auto dest = TestPcmResampleFloat(r, channels, 44100, src, 48000,
+					       777);
+
+	/* each channel must be the same as if it had been resampled
+	   alone */
+	for (unsigned c = 0; c < channels; ++c) {
+		PcmSincResampler mono;
+		const auto expected = TestPcmResampleFloat(mono, 1, 44100,
+							   planar[c], 48000);
+		CPPUNIT_ASSERT_EQUAL(expected.size() * channels, dest.size());
+
+		for (size_t i = 0; i < expected.size(); ++i)
+			CPPUNIT_ASSERT(fabs(dest[i * channels + c] -
+					    expected[i]) < 1e-6);
+	}
+}
@@ -183,3 +183,44 @@ PcmVolumeTest::TestVolumeFloat()
 	for (unsigned i = 0; i < N; ++i)
 		CPPUNIT_ASSERT_DOUBLES_EQUAL(src[i] / 2, dest[i], 1);
 }
+
+/**
+ * Apply the volume to a buffer whose size is not a multiple of the
+ * SIMD vector size, and compare with the exact result.
+ */
+template<typename T, SampleFormat format, unsigned bits,
+	 typename G=RandomInt<T>>
+static void
+TestPcmVolumeOddSize(int volume, G g=G())
+{
+	constexpr unsigned N = 259;
+	const auto src = TestDataBuffer<T, N>(g);
+
+	T dest[N];
+	std::copy(src.begin(), src.end(), dest);
+	CPPUNIT_ASSERT_EQUAL(true,
+			     pcm_volume(dest, sizeof(dest), format, volume));
+
+	constexpr int64_t max = (int64_t(1) << (bits - 1)) - 1;
+	constexpr int64_t min = -max - 1;
+
+	for (unsigned i = 0; i < N; ++i) {
+		int64_t expected = int64_t(src[i]) * volume / PCM_VOLUME_1;
+		expected = std::min(std::max(expected, min), max);
+
+		CPPUNIT_ASSERT(dest[i] >= expected - 1);
+		CPPUNIT_ASSERT(dest[i] <= expected + 1);
+	}
+}
+
+void
+PcmVolumeTest::TestVolumeOddSize()
+{
+	for (int volume : { PCM_VOLUME_1 * 3 / 4, PCM_VOLUME_1 * 2 }) {
+		TestPcmVolumeOddSize<int8_t, SampleFormat::S8, 8>(volume);
+		TestPcmVolumeOddSize<int16_t, SampleFormat::S16, 16>(volume);
+		TestPcmVolumeOddSize<int32_t, SampleFormat::S24_P32, 24>(volume,
+									 RandomInt24());
+		TestPcmVolumeOddSize<int32_t, SampleFormat::S32, 32>(volume);
+	}
+}
@@ -41,13 +41,36 @@ check_descending_priority(const Queue *queue,
 	}
 }
 
+static void
+check_position_order(const Queue &queue)
+{
+	for (unsigned position = 0; position < queue.GetLength(); ++position)
+		CPPUNIT_ASSERT_EQUAL(position,
+				     queue.OrderToPosition(queue.PositionToOrder(position)));
+}
+
+static void
+check_changes(const Queue &queue, uint32_t version)
+{
+	std::vector<unsigned> expected;
+	for (unsigned i = 0; i < queue.GetLength(); ++i)
+		if (queue.IsNewerAtPosition(i, version))
+			expected.push_back(i);
+
+	std::vector<unsigned> positions;
+	queue.GetChanges(version, positions);
+	CPPUNIT_ASSERT(positions == expected);
+}
+
 class QueuePriorityTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST_SUITE(QueuePriorityTest);
 	CPPUNIT_TEST(TestPriority);
+	CPPUNIT_TEST(TestMoveAndChanges);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
 	void TestPriority();
+	void TestMoveAndChanges();
 };
 
 void
@@ -190,6 +213,49 @@ QueuePriorityTest::TestPriority()
 	CPPUNIT_ASSERT_EQUAL(6u, a_order);
 }
 
+void
+QueuePriorityTest::TestMoveAndChanges()
+{
+	static Song songs[16];
+
+	Queue queue(32);
+
+	for (unsigned i = 0; i < ARRAY_SIZE(songs); ++i)
+		queue.Append(&songs[i], 0);
+
+	queue.random = true;
+	queue.ShuffleOrder();
+	check_position_order(queue);
+	queue.IncrementVersion();
+
+	queue.MovePostion(2, 9);
+	check_position_order(queue);
+	queue.IncrementVersion();
+
+	queue.MoveRange(10, 13, 1);
+	check_position_order(queue);
+	queue.IncrementVersion();
+
+	queue.SwapOrders(0, 15);
+	queue.DeletePosition(5);
+	check_position_order(queue);
+	queue.IncrementVersion();
+
+	const uint32_t v4 = queue.version;
+	queue.SetPriority(3, 10, -1);
+	check_position_order(queue);
+	queue.IncrementVersion();
+
+	for (uint32_t version = 0; version <= queue.version + 1; ++version)
+		check_changes(queue, version);
+
+	std::vector<unsigned> positions;
+	queue.GetChanges(v4, positions);
+	CPPUNIT_ASSERT_EQUAL(size_t(1), positions.size());
+	CPPUNIT_ASSERT_EQUAL(3u, positions.front());
+
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(QueuePriorityTest);
 
 int
@@ -0,0 +1,212 @@
+#include "config.h"
+#include "db/TagIndex.hxx"
+#include "SongFilter.hxx"
+#include "Song.hxx"
+#include "tag/Tag.hxx"
+#include "tag/TagBuilder.hxx"
+#include "util/Error.hxx"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <vector>
+
+#include <stdarg.h>
+#include <string.h>
+
+std::string
+Song::GetURI() const
+{
+	return uri;
+}
+
+/**
+ * Creates a song with the given (type, value) tag items; the list
+ * is terminated with TAG_NUM_OF_ITEM_TYPES.
+ */
+static Song
+MakeSong(TagType type, const char *value, ...)
+{
+	Song song;
+	memset(&song, 0, sizeof(song));
+
+	TagBuilder builder;
+
+	va_list ap;
+	va_start(ap, value);
+	while (type != TAG_NUM_OF_ITEM_TYPES) {
+		builder.AddItem(type, value);
+		type = TagType(va_arg(ap, int));
+		if (type != TAG_NUM_OF_ITEM_TYPES)
+			value = va_arg(ap, const char *);
+	}
+	va_end(ap);
+
+	song.tag = builder.Commit();
+	return song;
+}
+
+static std::vector<Song *>
+Lookup(const TagIndex &index, unsigned tag, const char *value,
+       bool fold_case=false)
+{
+	const SongFilter filter(tag, value, fold_case);
+
+	std::vector<Song *> result;
+	CPPUNIT_ASSERT(index.Lookup(filter, result));
+	return result;
+}
+
+static std::vector<std::string>
+VisitValues(const TagIndex &index, TagType type)
+{
+	std::vector<std::string> result;
+	Error error;
+	CPPUNIT_ASSERT(index.VisitValues(type,
+					 [&result](const char *value, Error &){
+						 result.emplace_back(value);
+						 return true;
+					 }, error));
+	return result;
+}
+
+class TagIndexTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(TagIndexTest);
+	CPPUNIT_TEST(TestAddRemove);
+	CPPUNIT_TEST(TestAlbumArtistFallback);
+	CPPUNIT_TEST(TestVisitValues);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestAddRemove();
+	void TestAlbumArtistFallback();
+	void TestVisitValues();
+};
+
+void
+TagIndexTest::TestAddRemove()
+{
+	Song a = MakeSong(TAG_ARTIST, "Foo", TAG_TITLE, "One",
+			  TAG_NUM_OF_ITEM_TYPES);
+	Song b = MakeSong(TAG_ARTIST, "Bar", TAG_TITLE, "Two",
+			  TAG_NUM_OF_ITEM_TYPES);
+	Song c = MakeSong(TAG_ARTIST, "Foo", TAG_ARTIST, "Foo",
+			  TAG_TITLE, "Three",
+			  TAG_NUM_OF_ITEM_TYPES);
+
+	TagIndex index;
+	index.Add(a);
+	index.Add(b);
+	index.Add(c);
+
+	/* duplicate values in one tag are indexed once */
+	auto result = Lookup(index, TAG_ARTIST, "Foo");
+	CPPUNIT_ASSERT_EQUAL(size_t(2), result.size());
+	CPPUNIT_ASSERT_EQUAL(&a, result[0]);
+	CPPUNIT_ASSERT_EQUAL(&c, result[1]);
+
+	result = Lookup(index, TAG_ARTIST, "foo", true);
+	CPPUNIT_ASSERT_EQUAL(size_t(2), result.size());
+
+	result = Lookup(index, LOCATE_TAG_ANY_TYPE, "Two");
+	CPPUNIT_ASSERT_EQUAL(size_t(1), result.size());
+	CPPUNIT_ASSERT_EQUAL(&b, result[0]);
+
+	CPPUNIT_ASSERT(Lookup(index, TAG_ARTIST, "Baz").empty());
+
+	/* remove a song in the middle of a posting list, and
+	   re-add it like an updated tag */
+	index.Remove(a);
+	result = Lookup(index, TAG_ARTIST, "Foo");
+	CPPUNIT_ASSERT_EQUAL(size_t(1), result.size());
+	CPPUNIT_ASSERT_EQUAL(&c, result[0]);
+	CPPUNIT_ASSERT(Lookup(index, TAG_TITLE, "One").empty());
+
+	index.Add(a);
+	result = Lookup(index, TAG_ARTIST, "Foo");
+	CPPUNIT_ASSERT_EQUAL(size_t(2), result.size());
+	CPPUNIT_ASSERT_EQUAL(&c, result[0]);
+	CPPUNIT_ASSERT_EQUAL(&a, result[1]);
+
+	index.Remove(c);
+	index.Remove(a);
+	index.Remove(b);
+	CPPUNIT_ASSERT(Lookup(index, TAG_ARTIST, "Foo").empty());
+	CPPUNIT_ASSERT(VisitValues(index, TAG_ARTIST).empty());
+
+	delete a.tag;
+	delete b.tag;
+	delete c.tag;
+}
+
+void
+TagIndexTest::TestAlbumArtistFallback()
+{
+	Song a = MakeSong(TAG_ARTIST, "Foo", TAG_NUM_OF_ITEM_TYPES);
+	Song b = MakeSong(TAG_ALBUM_ARTIST, "Foo", TAG_ARTIST, "Bar",
+			  TAG_NUM_OF_ITEM_TYPES);
+
+	TagIndex index;
+	index.Add(a);
+	index.Add(b);
+
+	/* SongFilter falls back from "album artist" to "artist",
+	   so the candidates include both lists, in walk order */
+	auto result = Lookup(index, TAG_ALBUM_ARTIST, "Foo");
+	CPPUNIT_ASSERT_EQUAL(size_t(2), result.size());
+	CPPUNIT_ASSERT_EQUAL(&a, result[0]);
+	CPPUNIT_ASSERT_EQUAL(&b, result[1]);
+
+	result = Lookup(index, TAG_ARTIST, "Foo");
+	CPPUNIT_ASSERT_EQUAL(size_t(1), result.size());
+	CPPUNIT_ASSERT_EQUAL(&a, result[0]);
+
+	delete a.tag;
+	delete b.tag;
+}
+
+void
+TagIndexTest::TestVisitValues()
+{
+	Song a = MakeSong(TAG_ARTIST, "Foo", TAG_ALBUM, "X",
+			  TAG_NUM_OF_ITEM_TYPES);
+	Song b = MakeSong(TAG_ARTIST, "Bar", TAG_NUM_OF_ITEM_TYPES);
+
+	TagIndex index;
+	index.Add(a);
+	index.Add(b);
+
+	auto values = VisitValues(index, TAG_ARTIST);
+	CPPUNIT_ASSERT_EQUAL(size_t(2), values.size());
+	CPPUNIT_ASSERT_EQUAL(std::string("Bar"), values[0]);
+	CPPUNIT_ASSERT_EQUAL(std::string("Foo"), values[1]);
+
+	/* songs without the type are reported as the empty string */
+	values = VisitValues(index, TAG_ALBUM);
+	CPPUNIT_ASSERT_EQUAL(size_t(2), values.size());
+	CPPUNIT_ASSERT_EQUAL(std::string(), values[0]);
+	CPPUNIT_ASSERT_EQUAL(std::string("X"), values[1]);
+
+	index.Remove(b);
+	values = VisitValues(index, TAG_ALBUM);
+	CPPUNIT_ASSERT_EQUAL(size_t(1), values.size());
+	CPPUNIT_ASSERT_EQUAL(std::string("X"), values[0]);
+
+	index.Remove(a);
+	delete a.tag;
+	delete b.tag;
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TagIndexTest);
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}